@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <services/Console.h>
+#include <services/Timer.h>
+#include <stream/VGAStream.h>
+#include <util/Clock.h>
+#include <Test.h>
+
+using namespace nre;
+
+/**
+ * Measures how many bytes the console copies from the screen buffer of a session to the screen,
+ * while the console tag is shown after switching to it. This is done for an idle session and for
+ * one that scrolls, each with and without damage tracking.
+ */
+
+static const timevalue_t DURATION       = 1000;   // ms
+static const timevalue_t SCROLL_DELAY   = 5;      // ms
+
+static void run(TimerSession &timer, bool track, bool scroll) {
+    // creating the session switches to it
+    ConsoleSession cons("console", 1, "ConsBench");
+    cons.track_damage(track);
+    VGAStream cs(cons, 0);
+    cs.clear(0);
+
+    Clock clock(1000);
+    timevalue_t start = clock.source_time();
+    timevalue_t end = clock.source_time(DURATION);
+    size_t lines = 0;
+    while(clock.source_time() < end) {
+        if(scroll)
+            cs << "Line " << lines++ << ": The quick brown fox jumps over the lazy dog\n";
+        timer.wait_until(scroll ? clock.source_time(SCROLL_DELAY) : end);
+    }
+    timevalue_t ms = clock.dest_time_of(clock.source_time() - start);
+
+    Console::Stats stats = cons.get_stats();
+    WVPRINT((scroll ? "Scrolling" : "Idle") << " console " << (track ? "with" : "without")
+                                            << " damage tracking: " << stats.refreshs
+                                            << " refreshs, " << lines << " lines");
+    WVPERF((stats.bytes * 1000) / ms, "bytes/s");
+}
+
+int main() {
+    TimerSession timer("timer");
+    for(int scroll = 0; scroll < 2; ++scroll) {
+        run(timer, false, scroll);
+        run(timer, true, scroll);
+    }
+    return 0;
+}
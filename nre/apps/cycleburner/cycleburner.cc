@@ -19,6 +19,8 @@
  */
 
 #include <arch/Types.h>
+#include <kobj/GlobalThread.h>
+#include <kobj/Sc.h>
 #include <stream/VGAStream.h>
 #include <services/Console.h>
 #include <services/Timer.h>
@@ -31,6 +33,7 @@ using namespace nre;
 
 #define INTRO_TIME      5000    // ms
 #define WAIT_TIME       50      // ms
+#define MIGRATE_CHECK   20      // frames
 #define SIN_LUTSIZE     (1 << 8)
 #define SQRT_LUTSIZE    (1 << 16)
 #define SQRT_PRESHIFT   (2)
@@ -296,34 +299,58 @@ public:
     }
 };
 
-int main() {
-    TimerSession timer("timer");
-    ConsoleSession console("console", 1, "CycleBurner");
-
-    gen_sinlut();
-    gen_sqrtlut();
+static TimerSession *timer;
+static Clock *clock;
+static IntroAnimator *ia;
+static QuoteAnimator<25, 80> *qa;
+static uint16_t *screen;
+static timevalue_t starttime;
 
-    Clock clock(1000);
-    IntroAnimator *ia = new IntroAnimator();
-    PlasmaAnimator<25, 80> *pa = new PlasmaAnimator<25, 80>();
-    QuoteAnimator<25, 80> *qa = new QuoteAnimator<25, 80>(pa);
-
-    uint16_t *screen = reinterpret_cast<uint16_t*>(console.screen().virt() + VGAStream::TEXT_OFF);
-    timevalue_t starttime = clock.dest_time();
-    while(1) {
-        timevalue_t now = clock.dest_time();
+static void burn(void*) {
+    // allow the load balancer of root to move us to a different CPU
+    Sc *sc = Thread::current<GlobalThread>()->sc();
+    for(uint frame = 1; ; ++frame) {
+        timevalue_t now = clock->dest_time();
 
         if(now - starttime < INTRO_TIME) {
-            ia->render(clock.source_time());
+            ia->render(clock->source_time());
             ia->blt_to(screen);
         }
         else {
-            qa->render(clock.source_time());
+            qa->render(clock->source_time());
             qa->blt_to(screen);
         }
 
         // Wait
-        timer.wait_until(clock.source_time(WAIT_TIME));
+        timer->wait_until(clock->source_time(WAIT_TIME));
+
+        if(frame % MIGRATE_CHECK == 0) {
+            cpu_t cpu = sc->migration();
+            // all state is global, so we can simply continue in a new thread on the other CPU
+            if(cpu != CPU::current().log_id()) {
+                GlobalThread::create(burn, cpu, "burner")->start();
+                return;
+            }
+        }
     }
+}
+
+int main() {
+    timer = new TimerSession("timer");
+    ConsoleSession console("console", 1, "CycleBurner");
+
+    gen_sinlut();
+    gen_sqrtlut();
+
+    clock = new Clock(1000);
+    ia = new IntroAnimator();
+    PlasmaAnimator<25, 80> *pa = new PlasmaAnimator<25, 80>();
+    qa = new QuoteAnimator<25, 80>(pa);
+
+    screen = reinterpret_cast<uint16_t*>(console.screen().virt() + VGAStream::TEXT_OFF);
+    starttime = clock->dest_time();
+    // the main thread can't move, because the program ends with it
+    GlobalThread::create(burn, CPU::current().log_id(), "burner")->start();
+    GlobalThread::join_all();
     return 0;
 }
@@ -139,6 +139,7 @@ static void runtest(DataSpace &buffer, size_t d) {
 int main(int argc, char **argv) {
     if(argc < 2 || strcmp(argv[1], "no-check") != 0) {
         ConsoleSession cons("console", 1, "DiskTest");
+        cons.track_damage(true);
         VGAStream s(cons, 0);
         s.clear(0);
         s << "Welcome to the disk test program!\n\n";
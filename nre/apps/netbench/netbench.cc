@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <services/Network.h>
+#include <stream/Serial.h>
+#include <util/Clock.h>
+#include <util/Endian.h>
+#include <Test.h>
+
+using namespace nre;
+
+/**
+ * An iperf-like benchmark for the network service. For every NIC, it sends frames of different
+ * sizes as fast as the service accepts them for a fixed time and reports the packets per second
+ * and the throughput. If the transmit ring is full, it waits for the service to catch up. Frames received in the meantime are counted as well.
+ * Afterwards, it measures the virtual switch of the service by sending unicast frames from one
+ * session to another session of the same NIC.
+ */
+
+static const timevalue_t DURATION   = 1000;   // ms
+static const uint16_t PROTO_BENCH   = 0x88b5; // local experimental ethertype
+static const size_t frame_sizes[]   = {64, 512, 1514};
+
+static uint8_t frame[1514];
+
+static size_t drain(NetworkSession &sess) {
+    size_t count = 0;
+    while(sess.consumer().has_data()) {
+        void *packet;
+        sess.consumer().get(packet);
+        sess.consumer().next();
+        count++;
+    }
+    return count;
+}
+
+static void build_frame(const Network::EthernetAddr &dst, const Network::EthernetAddr &src,
+                        size_t size) {
+    Network::EthernetHeader *header = reinterpret_cast<Network::EthernetHeader*>(frame);
+    uint64_t mac = dst.raw();
+    memcpy(header->mac_dst, &mac, sizeof(header->mac_dst));
+    mac = src.raw();
+    memcpy(header->mac_src, &mac, sizeof(header->mac_src));
+    header->proto = Endian::hton16(PROTO_BENCH);
+    for(size_t i = sizeof(*header); i < size; ++i)
+        frame[i] = i & 0xFF;
+}
+
+static void run_size(NetworkSession &sess, const Network::NIC &info, size_t size) {
+    build_frame(Network::EthernetAddr(0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF), info.mac, size);
+
+    Clock clock(1000);
+    size_t sent = 0, busy = 0, received = 0;
+    uint64_t dropped = sess.tx_status().dropped;
+    timevalue_t start = clock.source_time();
+    timevalue_t end = clock.source_time(DURATION);
+    while(clock.source_time() < end) {
+        if(sess.send(frame, size))
+            sent++;
+        else {
+            // let the service catch up with the NIC instead of spinning
+            busy++;
+            sess.wait_tx(sess.in_flight() / 2);
+        }
+        received += drain(sess);
+    }
+    sess.wait_tx();
+    timevalue_t ms = clock.dest_time_of(clock.source_time() - start);
+    dropped = sess.tx_status().dropped - dropped;
+
+    uint64_t pps = ((sent - dropped) * 1000) / ms;
+    WVPRINT(info.name << ": " << size << "b frames: sent " << sent << ", ring full " << busy
+                      << " times, dropped " << dropped << ", received " << received);
+    WVPERF(pps, "packets/s");
+    WVPERF((pps * size) / 1024, "KiB/s");
+}
+
+static void run_switch(size_t id, const Network::NIC &info) {
+    // two locally administered addresses that are not used by anybody else
+    Network::EthernetAddr mac_a(0x02, 0x4e, 0x52, 0x45, 0x00, 0x01);
+    Network::EthernetAddr mac_b(0x02, 0x4e, 0x52, 0x45, 0x00, 0x02);
+    NetworkSession a("network", id);
+    NetworkSession b("network", id);
+    a.add_mac(mac_a);
+    b.add_mac(mac_b);
+
+    for(size_t i = 0; i < ARRAY_SIZE(frame_sizes); ++i) {
+        size_t size = frame_sizes[i];
+        build_frame(mac_b, mac_a, size);
+
+        Clock clock(1000);
+        size_t sent = 0, busy = 0, received = 0;
+        timevalue_t start = clock.source_time();
+        timevalue_t end = clock.source_time(DURATION);
+        while(clock.source_time() < end) {
+            if(a.send(frame, size))
+                sent++;
+            else {
+                busy++;
+                a.wait_tx(a.in_flight() / 2);
+            }
+            received += drain(b);
+        }
+        timevalue_t ms = clock.dest_time_of(clock.source_time() - start);
+        received += drain(b);
+
+        // mac_b is registered at b, so that the switch delivers the frames to b without the NIC
+        Network::Stats stats = a.get_stats();
+        uint64_t pps = (received * 1000) / ms;
+        WVPRINT(info.name << ": switched " << size << "b frames: sent " << sent << ", ring full "
+                          << busy << " times, received " << received << ", tx dropped "
+                          << stats.tx_dropped);
+        WVPERF(pps, "packets/s");
+        WVPERF((pps * size) / 1024, "KiB/s");
+    }
+}
+
+int main() {
+    for(size_t id = 0; id < Network::MAX_NICS; ++id) {
+        try {
+            NetworkSession sess("network", id);
+            Network::NIC info = sess.get_info();
+            WVPRINT("Benchmarking NIC " << id << " (" << info.name << ", " << info.mac << ")");
+            for(size_t i = 0; i < ARRAY_SIZE(frame_sizes); ++i)
+                run_size(sess, info, frame_sizes[i]);
+            run_switch(id, info);
+        }
+        catch(const Exception &e) {
+            if(e.code() != E_ARGS_INVALID)
+                Serial::get() << "NIC " << id << " failed: " << e.msg() << "\n";
+        }
+    }
+    return 0;
+}
@@ -20,9 +20,14 @@
 
 using namespace nre;
 
-int main() {
+int main(int argc, char *argv[]) {
     // don't put it on the stack since its too large :)
     ChildManager *cm = new ChildManager();
+    // we can't give our childs more than we got from our parent
+    for(int i = 1; i < argc; ++i) {
+        if(strncmp(argv[i], "quota=", 6) == 0)
+            cm->budget().parse(argv[i] + 6, strlen(argv[i] + 6));
+    }
     for(auto mem = Hip::get().mem_begin(); mem != Hip::get().mem_end(); ++mem) {
         if(strstr(mem->cmdline(), "bin/apps/test") != nullptr) {
             ChildConfig cfg(0, "subtest");
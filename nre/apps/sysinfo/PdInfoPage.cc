@@ -20,14 +20,14 @@
 
 using namespace nre;
 
-void PdInfoPage::refresh_console(bool) {
+void PdInfoPage::refresh_console() {
     ScopedLock<UserSm> guard(&_sm);
     VGAStream cs(_cons, 0);
     cs.clear(0);
 
+    _sysinfo.snapshot(_snap);
+
     // display header
-    size_t memtotal, memfree;
-    _sysinfo.get_mem(memtotal, memfree);
     cs << fmt("Pd", MAX_NAME_LEN) << ": " << fmt("VirtMem", 24) << fmt("PhysMem", 24)
        << fmt("Threads", 8) << "\n";
     for(uint i = 0; i < VGAStream::COLS; i++)
@@ -36,22 +36,19 @@ void PdInfoPage::refresh_console(bool) {
     size_t totalthreads = 0;
     size_t totalphys = 0;
     size_t totalvirt = 0;
-    for(size_t idx = 0, c = 0; c < ROWS; ++c, ++idx) {
-        SysInfo::Child child;
-        if(!_sysinfo.get_child(idx, child))
-            break;
-
-        if(idx >= _top) {
+    for(size_t idx = 0; idx < _snap.child_count; ++idx) {
+        const SysInfo::SnapshotChild &child = _snap.children[idx];
+        if(idx >= _top && idx < _top + ROWS) {
             size_t namelen = 0;
-            const char *name = getname(child.cmdline(), namelen);
+            const char *name = getname(child.cmdline, namelen);
             cs << fmt(name, MAX_NAME_LEN, namelen) << ": "
-               << fmt(child.virt_mem() / 1024, 20) << " KiB"
-               << fmt(child.phys_mem() / 1024, 20) << " KiB"
-               << fmt(child.threads(), 8) << "\n";
+               << fmt(child.virt / 1024, 20) << " KiB"
+               << fmt(child.phys / 1024, 20) << " KiB"
+               << fmt(child.threads, 8) << "\n";
         }
-        totalvirt += child.virt_mem();
-        totalphys += child.phys_mem();
-        totalthreads += child.threads();
+        totalvirt += child.virt;
+        totalphys += child.phys;
+        totalthreads += child.threads;
     }
 
     // display footer
@@ -59,7 +56,7 @@ void PdInfoPage::refresh_console(bool) {
         cs << '-';
     cs << fmt("Total", MAX_NAME_LEN) << ": "
        << fmt(totalvirt / 1024, 20) << " KiB"
-       << fmt(totalphys / 1024, 8) << " of " << fmt(memtotal / 1024, 8) << " KiB"
+       << fmt(totalphys / 1024, 8) << " of " << fmt(_snap.mem_total / 1024, 8) << " KiB"
        << fmt(totalthreads, 8) << "\n";
     display_footer(cs, 1);
 }
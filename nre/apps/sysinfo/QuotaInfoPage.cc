@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <stream/VGAStream.h>
+#include <stream/OStringStream.h>
+
+#include "SysInfoPage.h"
+
+using namespace nre;
+
+void QuotaInfoPage::refresh_console() {
+    ScopedLock<UserSm> guard(&_sm);
+    VGAStream cs(_cons, 0);
+    cs.clear(0);
+    _sysinfo.snapshot(_snap);
+
+    // display header
+    cs << fmt("Pd", MAX_NAME_LEN) << ":";
+    for(size_t r = 0; r < ChildQuota::COUNT; ++r) {
+        const char *name = ChildQuota::name(static_cast<ChildQuota::Resource>(r));
+        cs << fmt(r == ChildQuota::MEM ? "mem (KiB)" : name, MAX_QUOTA_LEN);
+    }
+    cs << "\n";
+    for(uint i = 0; i < VGAStream::COLS; i++)
+        cs << '-';
+
+    for(size_t idx = _top, c = 0; idx < _snap.child_count && c < ROWS; ++c, ++idx) {
+        const SysInfo::SnapshotChild &child = _snap.children[idx];
+        size_t namelen = 0;
+        const char *name = getname(child.cmdline, namelen);
+        cs << fmt(name, MAX_NAME_LEN, namelen) << ":";
+        for(size_t r = 0; r < ChildQuota::COUNT; ++r) {
+            size_t div = r == ChildQuota::MEM ? 1024 : 1;
+            char buf[32];
+            OStringStream os(buf, sizeof(buf));
+            os << child.quota_used[r] / div << "/";
+            if(child.quota_limit[r] == ChildQuota::UNLIMITED)
+                os << "-";
+            else
+                os << child.quota_limit[r] / div;
+            cs << fmt(buf, MAX_QUOTA_LEN);
+        }
+        cs << "\n";
+    }
+    display_footer(cs, 2);
+}
@@ -20,10 +20,11 @@
 
 using namespace nre;
 
-void ScInfoPage::refresh_console(bool update) {
+void ScInfoPage::refresh_console() {
     ScopedLock<UserSm> guard(&_sm);
     VGAStream cs(_cons, 0);
     cs.clear(0);
+    _sysinfo.snapshot(_snap);
 
     size_t end = _left + Math::min(VISIBLE_CPUS, CPU::count());
 
@@ -35,35 +36,29 @@ void ScInfoPage::refresh_console(bool update) {
     for(uint i = 0; i < VGAStream::COLS; i++)
         cs << '-';
 
-    // determine the total time elapsed on each CPU. this way we don't assume that exactly 1sec
-    // has passed since last update and are thus less dependend on the timer-service.
-    static timevalue_t cputotal[Hip::MAX_CPUS];
-    for(size_t cpu = 0; cpu < CPU::count(); ++cpu)
-        cputotal[cpu] = _sysinfo.get_total_time(cpu, update);
-
-    for(size_t idx = _top, c = 0; c < ROWS; ++c, ++idx) {
-        SysInfo::TimeUser tu;
-        if(!_sysinfo.get_timeuser(idx, tu))
-            break;
-
+    // the percentage is relative to the total time elapsed on each CPU. this way we don't assume
+    // that exactly 1sec has passed since last update and are thus less dependend on the
+    // timer-service.
+    for(size_t idx = _top, c = 0; idx < _snap.sc_count && c < ROWS; ++c, ++idx) {
+        const SysInfo::SnapshotSc &sc = _snap.scs[idx];
         size_t namelen = 0;
-        const char *name = getname(tu.name(), namelen);
+        const char *name = getname(sc.name, namelen);
         namelen = Math::min<size_t>(namelen, MAX_NAME_LEN);
         double percent;
-        if(tu.time() == 0)
+        if(sc.time == 0)
             percent = 0;
         else
-            percent = 100. / (static_cast<double>(cputotal[tu.cpu()]) / tu.time());
+            percent = 100. / (static_cast<double>(_snap.cpu_time[sc.cpu]) / sc.time);
 
         cs << fmt(name, MAX_NAME_LEN, namelen) << ":";
         // display the time only if its currently visible
-        if(tu.cpu() >= _left && tu.cpu() < end) {
-            cs << fmt("", (tu.cpu() - _left) * MAX_TIME_LEN) << fmt(percent, MAX_TIME_LEN, 1)
-               << fmt("", (end - tu.cpu() - 1) * MAX_TIME_LEN);
+        if(sc.cpu >= _left && sc.cpu < end) {
+            cs << fmt("", (sc.cpu - _left) * MAX_TIME_LEN) << fmt(percent, MAX_TIME_LEN, 1)
+               << fmt("", (end - sc.cpu - 1) * MAX_TIME_LEN);
         }
         else
             cs << fmt("", (end - _left) * MAX_TIME_LEN);
-        cs << fmt(tu.totaltime() / 1000, MAX_SUMTIME_LEN) << "ms\n";
+        cs << fmt(sc.totaltime / 1000, MAX_SUMTIME_LEN) << "ms\n";
     }
     display_footer(cs, 0);
 }
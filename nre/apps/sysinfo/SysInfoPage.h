@@ -26,7 +26,7 @@ public:
     static const size_t ROWS            = nre::VGAStream::ROWS - 3;
 
     explicit SysInfoPage(nre::ConsoleSession &cons, nre::SysInfoSession &sysinfo)
-        : _left(0), _top(0), _cons(cons), _sysinfo(sysinfo), _sm() {
+        : _left(0), _top(0), _cons(cons), _sysinfo(sysinfo), _sm(), _snap() {
     }
     virtual ~SysInfoPage() {
     }
@@ -47,30 +47,33 @@ public:
     virtual size_t max_left() const {
         return 0;
     }
-    virtual void refresh_console(bool update) = 0;
+    virtual void refresh_console() = 0;
 
 protected:
     void display_footer(nre::VGAStream &cs, size_t i) {
+        static const char *names[] = {"Scs", "Pds", "Quotas"};
+        size_t width = nre::VGAStream::COLS / ARRAY_SIZE(names);
         cs.pos(0, nre::VGAStream::ROWS - 1);
-        cs.color(i == 0 ? 0x17 : 0x71);
-        cs << nre::fmt("Scs", nre::VGAStream::COLS / 2);
-        cs.color(i == 1 ? 0x17 : 0x71);
-        cs << nre::fmt("Pds", nre::VGAStream::COLS / 2);
+        for(size_t p = 0; p < ARRAY_SIZE(names); ++p) {
+            cs.color(i == p ? 0x17 : 0x71);
+            cs << nre::fmt(names[p], p == ARRAY_SIZE(names) - 1
+                                     ? nre::VGAStream::COLS - p * width : width);
+        }
     }
 
-    const char *getname(const nre::String &name, size_t &len) {
+    const char *getname(const char *name, size_t &len) {
         // don't display the path to the program (might be long) and cut off arguments
-        size_t lastslash = 0, end = name.length();
-        for(size_t i = 0; i < name.length(); ++i) {
-            if(name.str()[i] == '/')
+        size_t lastslash = 0, end = strlen(name);
+        for(size_t i = 0; name[i]; ++i) {
+            if(name[i] == '/')
                 lastslash = i + 1;
-            else if(name.str()[i] == ' ') {
+            else if(name[i] == ' ') {
                 end = i;
                 break;
             }
         }
         len = end - lastslash;
-        return name.str() + lastslash;
+        return name + lastslash;
     }
 
     size_t _left;
@@ -78,6 +81,7 @@ protected:
     nre::ConsoleSession &_cons;
     nre::SysInfoSession &_sysinfo;
     nre::UserSm _sm;
+    nre::SysInfo::Snapshot _snap;
 };
 
 class ScInfoPage : public SysInfoPage {
@@ -91,7 +95,7 @@ public:
     virtual size_t max_left() const {
         return nre::CPU::count() > VISIBLE_CPUS ? nre::CPU::count() - VISIBLE_CPUS : 0;
     }
-    virtual void refresh_console(bool update);
+    virtual void refresh_console();
 };
 
 class PdInfoPage : public SysInfoPage {
@@ -99,5 +103,14 @@ public:
     explicit PdInfoPage(nre::ConsoleSession &cons, nre::SysInfoSession &sysinfo)
         : SysInfoPage(cons, sysinfo) {
     }
-    virtual void refresh_console(bool update);
+    virtual void refresh_console();
+};
+
+class QuotaInfoPage : public SysInfoPage {
+    static const size_t MAX_QUOTA_LEN   = 12;
+public:
+    explicit QuotaInfoPage(nre::ConsoleSession &cons, nre::SysInfoSession &sysinfo)
+        : SysInfoPage(cons, sysinfo) {
+    }
+    virtual void refresh_console();
 };
@@ -29,12 +29,13 @@ static ConsoleSession cons("console", 0, "SysInfo");
 static size_t page = 0;
 static SysInfoPage *pages[] = {
     new ScInfoPage(cons, sysinfo),
-    new PdInfoPage(cons, sysinfo)
+    new PdInfoPage(cons, sysinfo),
+    new QuotaInfoPage(cons, sysinfo)
 };
 
 static void input_thread(void*) {
     while(1) {
-        bool changed = false, update = false;
+        bool changed = false;
         Console::ReceivePacket *pk = cons.consumer().get();
         if(!(pk->flags & Keyboard::RELEASE)) {
             switch(pk->keycode) {
@@ -61,7 +62,7 @@ static void input_thread(void*) {
                     break;
                 case Keyboard::VK_TAB:
                     page = (page + 1) % ARRAY_SIZE(pages);
-                    changed = update = true;
+                    changed = true;
                     break;
                 case Keyboard::VK_LEFT:
                     if(pages[page]->left() > 0) {
@@ -79,7 +80,7 @@ static void input_thread(void*) {
         }
         cons.consumer().next();
         if(changed)
-            pages[page]->refresh_console(update);
+            pages[page]->refresh_console();
     }
 }
 
@@ -88,7 +89,9 @@ static void refresh_thread() {
     Clock clock(1000);
     while(1) {
         timevalue_t next = clock.source_time(1000);
-        pages[page]->refresh_console(true);
+        // start a new second and let all pages read the result from the shared snapshot
+        sysinfo.update_snapshot(true);
+        pages[page]->refresh_console();
 
         // wait a second
         timer.wait_until(next);
@@ -96,6 +99,9 @@ static void refresh_thread() {
 }
 
 int main() {
+    // we write only via VGAStream
+    cons.track_damage(true);
+
     // disable cursor
     Console::Register regs = cons.get_regs();
     regs.cursor_style = 0x2000;
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <services/Tracer.h>
+#include <services/Timer.h>
+#include <stream/Serial.h>
+#include <Hip.h>
+#include <cstring>
+
+using namespace nre;
+
+/**
+ * Controls the tracing of all Pds. The commands are executed in the given order:
+ *  start[=<hexmask>]   enable all or the given tracepoints
+ *  stop                disable all tracepoints
+ *  wait=<ms>           wait for the given number of milliseconds
+ *  dump                let the tracer write all events to the log
+ * For example: "tracectl start wait=2000 stop dump"
+ */
+int main(int argc, char *argv[]) {
+    TracerSession tracer("tracer", "tracectl");
+    TimerSession *timer = nullptr;
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "start") == 0)
+            tracer.start();
+        else if(strncmp(argv[i], "start=", 6) == 0)
+            tracer.start(strtoul(argv[i] + 6, nullptr, 16));
+        else if(strcmp(argv[i], "stop") == 0)
+            tracer.stop();
+        else if(strcmp(argv[i], "dump") == 0)
+            tracer.dump();
+        else if(strncmp(argv[i], "wait=", 5) == 0) {
+            if(!timer)
+                timer = new TimerSession("timer");
+            timer->wait_for(Hip::get().freq_tsc * strtoul(argv[i] + 5, nullptr, 10));
+        }
+        else
+            Serial::get() << "Unknown command '" << argv[i] << "'\n";
+    }
+    delete timer;
+    return 0;
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <util/ACPITableBuilder.h>
+#include <cstring>
+
+#include "ACPITest.h"
+
+using namespace nre;
+using namespace nre::test;
+
+static void test_acpi();
+
+const TestCase acpitest = {
+    "ACPI table set", test_acpi,
+};
+
+// the blob is visible at two "physical" addresses: the RSDT references it below 4G, the XSDT
+// above 4G, so that truncated XSDT entries would not be found
+static const uint64_t LOW_BASE      = 0x1000;
+static const uint64_t HIGH_BASE     = 0x100001000ULL;
+static const size_t BLOB_SIZE       = 0x1000;
+
+static char blob[BLOB_SIZE] ALIGNED(8);
+static size_t blob_pos;
+
+class BlobMapper : public ACPITableBuilder::Mapper {
+public:
+    virtual const void *map(uint64_t phys, size_t size) {
+        uint64_t base = phys >= HIGH_BASE ? HIGH_BASE : LOW_BASE;
+        if(phys < base || phys + size > base + BLOB_SIZE)
+            throw Exception(E_NOT_FOUND, "Address outside of the blob");
+        return blob + (phys - base);
+    }
+};
+
+static void *alloc(size_t size) {
+    void *res = blob + blob_pos;
+    blob_pos += (size + 7) & ~static_cast<size_t>(7);
+    return res;
+}
+
+static uint32_t low(const void *p) {
+    return LOW_BASE + (reinterpret_cast<const char*>(p) - blob);
+}
+
+static uint64_t high(const void *p) {
+    return HIGH_BASE + (reinterpret_cast<const char*>(p) - blob);
+}
+
+static ACPI::RSDT *make_table(const char *signature, size_t len) {
+    ACPI::RSDT *tbl = reinterpret_cast<ACPI::RSDT*>(alloc(len));
+    memcpy(tbl->signature, signature, 4);
+    tbl->length = len;
+    tbl->revision = 1;
+    return tbl;
+}
+
+static void fix_checksum(ACPI::RSDT *tbl) {
+    tbl->checksum = 0;
+    tbl->checksum = -ACPITableBuilder::checksum(tbl, tbl->length);
+}
+
+static ACPI::RSDP *make_blob(uint8_t revision) {
+    memset(blob, 0, sizeof(blob));
+    blob_pos = 0;
+
+    // the DSDT is only referenced by the FACP
+    ACPI::RSDT *dsdt = make_table("DSDT", sizeof(ACPI::RSDT) + 16);
+    fix_checksum(dsdt);
+    ACPI::RSDT *facp = make_table("FACP", 244);
+    uint64_t xdsdt = high(dsdt);
+    memcpy(reinterpret_cast<char*>(facp) + 140, &xdsdt, sizeof(xdsdt));
+    fix_checksum(facp);
+
+    ACPI::RSDT *ssdt1 = make_table("SSDT", sizeof(ACPI::RSDT) + 8);
+    ssdt1->oemRevision = 1;
+    fix_checksum(ssdt1);
+    ACPI::RSDT *ssdt2 = make_table("SSDT", sizeof(ACPI::RSDT) + 8);
+    ssdt2->oemRevision = 2;
+    fix_checksum(ssdt2);
+
+    // a MADT with one LAPIC and two interrupt source overrides
+    size_t madtlen = sizeof(ACPI::MADT) + 8 + 2 * sizeof(ACPI::APICIntr);
+    ACPI::MADT *madt = reinterpret_cast<ACPI::MADT*>(make_table("APIC", madtlen));
+    madt->apic[0].type = ACPI::APIC::LAPIC;
+    madt->apic[0].length = 8;
+    char *entries = reinterpret_cast<char*>(madt->apic);
+    ACPI::APICIntr *iso = reinterpret_cast<ACPI::APICIntr*>(entries + 8);
+    iso[0].type = ACPI::APIC::INTR;
+    iso[0].length = sizeof(ACPI::APICIntr);
+    iso[0].irq = 0;
+    iso[0].gsi = 2;
+    iso[1].type = ACPI::APIC::INTR;
+    iso[1].length = sizeof(ACPI::APICIntr);
+    iso[1].irq = 9;
+    iso[1].gsi = 20;
+    fix_checksum(madt);
+
+    // a table with a broken checksum
+    ACPI::RSDT *bad = make_table("BAD!", sizeof(ACPI::RSDT));
+    fix_checksum(bad);
+    bad->checksum++;
+
+    // a table that is only listed in the RSDT
+    ACPI::RSDT *old = make_table("OLD!", sizeof(ACPI::RSDT));
+    fix_checksum(old);
+
+    const ACPI::RSDT *xtables[] = {facp, ssdt1, madt, bad, ssdt2};
+    ACPI::RSDT *xsdt = make_table("XSDT", sizeof(ACPI::RSDT) + ARRAY_SIZE(xtables) * 8);
+    for(size_t i = 0; i < ARRAY_SIZE(xtables); ++i) {
+        uint64_t addr = high(xtables[i]);
+        memcpy(reinterpret_cast<char*>(xsdt + 1) + i * 8, &addr, sizeof(addr));
+    }
+    fix_checksum(xsdt);
+
+    const ACPI::RSDT *tables[] = {facp, madt, old};
+    ACPI::RSDT *rsdt = make_table("RSDT", sizeof(ACPI::RSDT) + ARRAY_SIZE(tables) * 4);
+    for(size_t i = 0; i < ARRAY_SIZE(tables); ++i) {
+        uint32_t addr = low(tables[i]);
+        memcpy(reinterpret_cast<char*>(rsdt + 1) + i * 4, &addr, sizeof(addr));
+    }
+    fix_checksum(rsdt);
+
+    ACPI::RSDP *rsdp = reinterpret_cast<ACPI::RSDP*>(alloc(sizeof(ACPI::RSDP)));
+    memcpy(rsdp->signature, "RSD PTR ", 8);
+    rsdp->revision = revision;
+    rsdp->rsdtAddr = low(rsdt);
+    rsdp->length = sizeof(ACPI::RSDP);
+    rsdp->xsdtAddr = high(xsdt);
+    rsdp->checksum = -ACPITableBuilder::checksum(rsdp, 20);
+    rsdp->xchecksum = -ACPITableBuilder::checksum(rsdp, sizeof(ACPI::RSDP));
+    return rsdp;
+}
+
+static const ACPI::TableSet *build(ACPITableBuilder &builder, char *&mem) {
+    mem = new char[builder.size()];
+    builder.build(mem);
+    return reinterpret_cast<const ACPI::TableSet*>(mem);
+}
+
+static void test_acpi() {
+    BlobMapper mapper;
+    char *mem;
+
+    // with XSDT
+    {
+        ACPITableBuilder builder;
+        builder.load(make_blob(2), mapper);
+        // FACP, DSDT, 2 SSDTs and the MADT
+        WVPASSEQ(builder.count(), static_cast<size_t>(5));
+        const ACPI::TableSet *set = build(builder, mem);
+        WVPASSEQ(set->magic, ACPI::TableSet::MAGIC);
+        WVPASSEQ(set->count, static_cast<uint32_t>(5));
+        WVPASSEQ(static_cast<size_t>(set->size), builder.size());
+        WVPASS(set->find("FACP") != nullptr);
+        WVPASS(set->find("DSDT") != nullptr);
+        WVPASS(set->find("BAD!") == nullptr);
+        WVPASS(set->find("OLD!") == nullptr);
+        WVPASS(set->find("FACP", 1) == nullptr);
+
+        // the instances are numbered in the order of the XSDT
+        const ACPI::RSDT *ssdt = set->find("SSDT", 0);
+        WVPASS(ssdt && ssdt->oemRevision == 1);
+        ssdt = set->find("SSDT", 1);
+        WVPASS(ssdt && ssdt->oemRevision == 2);
+        WVPASS(set->find("SSDT", 2) == nullptr);
+
+        // the copies are still valid
+        for(uint32_t i = 0; i < set->count; ++i) {
+            const ACPI::RSDT *tbl = set->find(set->entries[i].signature, set->entries[i].instance);
+            WVPASS(tbl != nullptr);
+            WVPASSEQ(ACPITableBuilder::checksum(tbl, tbl->length), static_cast<uint8_t>(0));
+        }
+
+        WVPASSEQ(set->irq_to_gsi(0), 2U);
+        WVPASSEQ(set->irq_to_gsi(1), 1U);
+        WVPASSEQ(set->irq_to_gsi(9), 20U);
+        WVPASSEQ(set->irq_to_gsi(20), 20U);
+        delete[] mem;
+    }
+
+    // fallback to the RSDT
+    {
+        // ACPI 1.0 has no XSDT
+        ACPITableBuilder builder;
+        builder.load(make_blob(0), mapper);
+        const ACPI::TableSet *set = build(builder, mem);
+        WVPASS(set->find("OLD!") != nullptr);
+        WVPASS(set->find("SSDT") == nullptr);
+        delete[] mem;
+    }
+    {
+        // a broken XSDT
+        ACPITableBuilder builder;
+        ACPI::RSDP *rsdp = make_blob(2);
+        const void *xsdt = mapper.map(rsdp->xsdtAddr, sizeof(ACPI::RSDT));
+        const_cast<ACPI::RSDT*>(reinterpret_cast<const ACPI::RSDT*>(xsdt))->checksum++;
+        builder.load(rsdp, mapper);
+        const ACPI::TableSet *set = build(builder, mem);
+        WVPASS(set->find("OLD!") != nullptr);
+        WVPASS(set->find("DSDT") != nullptr);
+        WVPASSEQ(set->irq_to_gsi(9), 20U);
+        delete[] mem;
+    }
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <util/ACPITableBuilder.h>
+#include <util/ATARE.h>
+#include <cstring>
+
+#include "ATARETest.h"
+
+using namespace nre;
+using namespace nre::test;
+
+static void test_atare();
+
+const TestCase ataretest = {
+    "ATARE PCI routing", test_atare,
+};
+
+/**
+ * A minimal AML assembler. All package lengths are encoded with 2 bytes.
+ */
+class AML {
+    static const size_t MAX_DEPTH   = 8;
+
+public:
+    explicit AML(const char *signature) : _pos(sizeof(ACPI::RSDT)), _depth() {
+        memset(_buf, 0, sizeof(_buf));
+        memcpy(table()->signature, signature, 4);
+    }
+
+    void byte(uint8_t b) {
+        _buf[_pos++] = b;
+    }
+    void name(const char *n) {
+        size_t len = strlen(n);
+        memcpy(_buf + _pos, n, len);
+        _pos += len;
+    }
+    void data(uint32_t v) {
+        if(v <= 1)
+            byte(v);
+        else if(v <= 0xFF) {
+            byte(0x0A);
+            byte(v);
+        }
+        else {
+            byte(0x0C);
+            for(int i = 0; i < 4; ++i)
+                byte(v >> (i * 8));
+        }
+    }
+    void begin(uint8_t op) {
+        byte(op);
+        _stack[_depth++] = _pos;
+        _pos += 2;
+    }
+    void end() {
+        size_t start = _stack[--_depth];
+        size_t len = _pos - start;
+        _buf[start] = 0x40 | (len & 0xF);
+        _buf[start + 1] = len >> 4;
+    }
+
+    void scope(const char *n) {
+        begin(0x10);
+        name(n);
+    }
+    void device(const char *n) {
+        byte(0x5B);
+        begin(0x82);
+        name(n);
+    }
+    void named(const char *n, uint32_t value) {
+        byte(0x08);
+        name(n);
+        data(value);
+    }
+    void routes(const char *n, const uint32_t (*prt)[3], size_t count) {
+        byte(0x08);
+        name(n);
+        begin(0x12);
+        byte(count);
+        for(size_t i = 0; i < count; ++i) {
+            begin(0x12);
+            byte(4);
+            data(prt[i][0]);
+            data(prt[i][1]);
+            data(0);
+            data(prt[i][2]);
+            end();
+        }
+        end();
+    }
+
+    ACPI::RSDT *table() {
+        ACPI::RSDT *tbl = reinterpret_cast<ACPI::RSDT*>(_buf);
+        tbl->length = _pos;
+        tbl->checksum = 0;
+        tbl->checksum = -ACPITableBuilder::checksum(tbl, _pos);
+        return tbl;
+    }
+
+private:
+    uint8_t _buf[512];
+    size_t _pos;
+    size_t _stack[MAX_DEPTH];
+    size_t _depth;
+};
+
+static bool get_gsi(const ACPI::RoutingTable *rt, BDF bdf, uint pin, BDF parent, uint expected) {
+    uint gsi;
+    return rt->get_gsi(bdf, pin, parent, gsi) && gsi == expected;
+}
+
+static void test_atare() {
+    // the host bridge routes three slots directly, a bridge without _PRT in slot 3 and a bridge
+    // with its own _PRT in slot 4, whose package is defined in an SSDT
+    static const uint32_t pci0[][3] = {
+        {0x0001FFFF, 0, 16}, {0x0001FFFF, 1, 17}, {0x0002FFFF, 0, 18}, {0x0003FFFF, 2, 19},
+        {0x0004FFFF, 0, 23},
+    };
+    static const uint32_t brg2[][3] = {
+        {0x0000FFFF, 0, 0x120},
+    };
+
+    AML dsdt("DSDT");
+    dsdt.scope("\\_SB_");
+    dsdt.device("PCI0");
+    dsdt.named("_ADR", 0);
+    dsdt.routes("_PRT", pci0, ARRAY_SIZE(pci0));
+    dsdt.device("BRG1");
+    dsdt.named("_ADR", 0x00030000);
+    dsdt.end();
+    dsdt.device("BRG2");
+    dsdt.named("_ADR", 0x00040000);
+    // Method(_PRT, 0) { Return(PRTB) }
+    dsdt.begin(0x14);
+    dsdt.name("_PRT");
+    dsdt.byte(0);
+    dsdt.byte(0xA4);
+    dsdt.name("PRTB");
+    dsdt.end();
+    dsdt.end();
+    dsdt.end();
+    dsdt.end();
+
+    AML ssdt("SSDT");
+    ssdt.scope("\\\x2F\x03_SB_PCI0BRG2");
+    ssdt.routes("PRTB", brg2, ARRAY_SIZE(brg2));
+    ssdt.end();
+
+    ACPITableBuilder builder;
+    WVPASS(builder.add(dsdt.table()));
+    WVPASS(builder.add(ssdt.table()));
+    char *tables = new char[builder.size()];
+    builder.build(tables);
+
+    ATARE atare(*reinterpret_cast<ACPI::TableSet*>(tables), 0);
+    WVPASSEQ(atare.routes(), ARRAY_SIZE(pci0) + ARRAY_SIZE(brg2));
+
+    size_t slots = ACPI::RoutingTable::slots_for(atare.routes());
+    char *mem = new char[ACPI::RoutingTable::size(slots)];
+    ACPI::RoutingTable *rt = reinterpret_cast<ACPI::RoutingTable*>(mem);
+    rt->init(slots);
+    atare.build_routing(rt);
+    WVPASSEQ(static_cast<size_t>(rt->count), ARRAY_SIZE(pci0) + ARRAY_SIZE(brg2));
+
+    // devices on the root bus
+    BDF root;
+    WVPASS(get_gsi(rt, BDF(0, 1, 0), 0, root, 16));
+    WVPASS(get_gsi(rt, BDF(0, 1, 0), 1, root, 17));
+    WVPASS(get_gsi(rt, BDF(0, 2, 0), 0, root, 18));
+    WVPASS(!get_gsi(rt, BDF(0, 2, 0), 1, root, 0));
+
+    // behind BRG1, which has no _PRT: INTA of slot 2 is swizzled to INTC of the bridge
+    WVPASS(get_gsi(rt, BDF(1, 2, 0), 0, BDF(0, 3, 0), 19));
+    WVPASS(!get_gsi(rt, BDF(1, 1, 0), 0, BDF(0, 3, 0), 0));
+
+    // behind BRG2, which has its own routing; GSIs above 255 are kept
+    WVPASS(get_gsi(rt, BDF(2, 0, 0), 0, BDF(0, 4, 0), 0x120));
+    WVPASS(!get_gsi(rt, BDF(2, 0, 0), 1, BDF(0, 4, 0), 0));
+
+    delete[] mem;
+    delete[] tables;
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <subsystem/ChildManager.h>
+#include <mem/DataSpace.h>
+#include <kobj/Sm.h>
+#include <util/Profiler.h>
+#include <util/ScopedLock.h>
+
+#include "ChildStartup.h"
+
+using namespace nre;
+using namespace nre::test;
+
+static void test_childstartup();
+
+const TestCase childstartup = {
+    "Child startup", test_childstartup
+};
+
+static const size_t CHILDS = 16;
+
+static int idle_child(int, char *[]) {
+    // wait until we get killed
+    Sm sm(0);
+    sm.down();
+    return 0;
+}
+
+static int exiting_child(int, char *[]) {
+    return 3;
+}
+
+static void start_childs(size_t pool, const char *cmdline) {
+    ChildManager *mng = new ChildManager(pool);
+    Hip::mem_iterator self = Hip::get().mem_begin();
+    DataSpace ds(self->size, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::R, self->addr);
+    Child::id_type ids[CHILDS];
+
+    AvgProfiler prof(CHILDS);
+    for(size_t i = 0; i < CHILDS; ++i) {
+        ChildConfig cfg(0, cmdline);
+        cfg.entry(reinterpret_cast<uintptr_t>(idle_child));
+        prof.start();
+        ids[i] = mng->load(ds.virt(), self->size, cfg);
+        prof.stop();
+    }
+
+    size_t portals = 0;
+    {
+        ScopedLock<ChildManager> guard(mng);
+        for(auto it = mng->begin(); it != mng->end(); ++it)
+            portals += it->portals();
+    }
+
+    WVPRINT("Using '" << cmdline << "' with a pool of " << pool << " Ecs per CPU:");
+    WVPERF(prof.avg(), "cycles per child");
+    WVPRINT("min: " << prof.min());
+    WVPRINT("max: " << prof.max());
+    WVPERF(portals / CHILDS, "portals per child");
+    // the childs run on one CPU only, so they should not get portals for the others
+    WVPASSEQ(portals, CHILDS * ChildManager::portals_per_cpu());
+
+    for(size_t i = 0; i < CHILDS; ++i)
+        mng->kill(ids[i]);
+    while(mng->count() > 0)
+        mng->dead_sm().down();
+
+    // the exits are reported in the order in which the childs have been killed
+    ChildManager::ExitInfo info;
+    bool lost;
+    for(size_t i = 0; i < CHILDS; ++i) {
+        WVPASS(mng->fetch_exit(info, lost));
+        WVPASS(!lost);
+        WVPASSEQ(info.id, ids[i]);
+        WVPASSEQ(info.reason, ChildManager::KILLED);
+    }
+    WVPASS(!mng->fetch_exit(info, lost));
+    delete mng;
+}
+
+static void exit_child() {
+    ChildManager *mng = new ChildManager();
+    Hip::mem_iterator self = Hip::get().mem_begin();
+    DataSpace ds(self->size, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::R, self->addr);
+
+    ChildConfig cfg(0, "exitingchild");
+    cfg.entry(reinterpret_cast<uintptr_t>(exiting_child));
+    Child::id_type id = mng->load(ds.virt(), self->size, cfg);
+    while(mng->count() > 0)
+        mng->dead_sm().down();
+
+    ChildManager::ExitInfo info;
+    bool lost;
+    WVPASS(mng->fetch_exit(info, lost));
+    WVPASSEQ(info.id, id);
+    WVPASSEQ(info.reason, ChildManager::EXITED);
+    WVPASSEQ(info.code, 3);
+    delete mng;
+}
+
+static void test_childstartup() {
+    start_childs(1, "idlechild");
+    start_childs(4, "idlechild");
+    start_childs(1, "idlechild handlers=own");
+    exit_child();
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+
+#include <util/ThreadedDeleter.h>
+#include <util/Atomic.h>
+#include <collection/SList.h>
+#include <Test.h>
+#include <CPU.h>
+
+#include "DeleterTest.h"
+
+using namespace nre;
+using namespace nre::test;
+
+static void test_deleter();
+
+const TestCase deletertest = {
+    "Batched ThreadedDeleter", test_deleter
+};
+
+static const size_t OBJECTS = 100;
+
+struct Item : public SListItem {
+    explicit Item() : SListItem(), invalid(false) {
+    }
+    volatile bool invalid;
+};
+
+class TestDeleter : public ThreadedDeleter<Item> {
+public:
+    explicit TestDeleter() : ThreadedDeleter<Item>("test"), calls(), bad_calls(), destroyed(),
+                             bad_destroys() {
+    }
+
+    ulong calls;
+    ulong bad_calls;
+    ulong destroyed;
+    ulong bad_destroys;
+
+private:
+    virtual void call(Item *const *objs, size_t count) {
+        Atomic::add(&calls, +1);
+        // all objects of the batch have to be invalidated before
+        for(size_t i = 0; i < count; ++i) {
+            if(!objs[i]->invalid)
+                Atomic::add(&bad_calls, +1);
+        }
+    }
+    virtual void invalidate(Item *obj) {
+        obj->invalid = true;
+    }
+    virtual void destroy(Item *obj) {
+        if(!obj->invalid)
+            bad_destroys++;
+        destroyed++;
+        delete obj;
+    }
+};
+
+static void test_deleter() {
+    TestDeleter *del = new TestDeleter();
+    for(size_t i = 0; i < OBJECTS; ++i)
+        del->del(new Item());
+    // wait() returns only after the objects have been destroyed, not just dequeued
+    del->wait();
+
+    ThreadedDeleter<Item>::Stats stats = del->stats();
+    WVPASSEQ(del->destroyed, static_cast<ulong>(OBJECTS));
+    WVPASSEQ(del->bad_destroys, 0UL);
+    WVPASSEQ(del->bad_calls, 0UL);
+    WVPASSEQ(stats.queued, static_cast<size_t>(0));
+    WVPASSEQ(stats.deleted, static_cast<ulong>(OBJECTS));
+    WVPASS(stats.max_queued >= 1 && stats.max_queued <= OBJECTS);
+    // there is one handshake with all CPUs per batch
+    WVPASS(stats.batches >= OBJECTS / ThreadedDeleter<Item>::MAX_BATCH);
+    WVPASS(stats.batches <= OBJECTS);
+    WVPASSEQ(del->calls, stats.batches * CPU::count());
+    WVPASS(stats.last_latency <= stats.max_latency);
+    WVPRINT("Deleted " << stats.deleted << " objects in " << stats.batches
+                       << " batches, max latency " << stats.max_latency << " us");
+    delete del;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <kobj/GlobalThread.h>
+#include <services/Log.h>
+#include <stream/OStringStream.h>
+#include <util/Util.h>
+#include <CPU.h>
+
+#include "LogRing.h"
+
+using namespace nre;
+using namespace nre::test;
+
+static void test_logring();
+
+const TestCase logring = {
+    "Log ring", test_logring,
+};
+
+static const size_t LINES = 500;
+
+static LogSession *sess;
+static uint64_t cycles[Hip::MAX_CPUS];
+
+static void log_thread(void*) {
+    cpu_t cpu = CPU::current().log_id();
+    char buf[64];
+    uint64_t start = Util::tsc();
+    for(size_t i = 0; i < LINES; ++i) {
+        OStringStream os(buf, sizeof(buf));
+        os << "cpu " << cpu << " line " << i;
+        sess->write(String(buf, os.length()));
+    }
+    cycles[cpu] = (Util::tsc() - start) / LINES;
+}
+
+static void test_logring() {
+    // as long as we write no more lines than fit into the ring, nothing may be dropped, no matter
+    // how fast the writer is
+    sess = new LogSession("log", "logtest");
+    size_t cap = sess->capacity();
+    WVPASS(cap > 0);
+    char buf[64];
+    for(size_t i = 0; i < cap; ++i) {
+        OStringStream os(buf, sizeof(buf));
+        os << "line " << i;
+        sess->write(String(buf, os.length()));
+    }
+    WVPASSEQ(sess->dropped(), static_cast<size_t>(0));
+    WVPASSEQ(sess->written(), cap);
+    delete sess;
+
+    // all threads write into the same session, i.e. into the same ring, from different CPUs
+    sess = new LogSession("log", "logtest");
+    Reference<GlobalThread> *threads = new Reference<GlobalThread>[CPU::count()];
+    for(auto it = CPU::begin(); it != CPU::end(); ++it) {
+        threads[it->log_id()] = GlobalThread::create(log_thread, it->log_id(), "logtest");
+        threads[it->log_id()]->start();
+    }
+
+    uint64_t total = 0;
+    for(auto it = CPU::begin(); it != CPU::end(); ++it) {
+        threads[it->log_id()]->join();
+        WVPRINT("CPU " << it->log_id() << ": " << cycles[it->log_id()] << " cycles per line");
+        total += cycles[it->log_id()];
+    }
+    WVPERF(total / CPU::count(), "cycles per line");
+
+    // the writer may drop lines if it does not keep up, but every line is either in the ring or
+    // has been counted as dropped
+    WVPRINT("Dropped " << sess->dropped() << " of " << LINES * CPU::count() << " lines");
+    WVPASSEQ(sess->written() + sess->dropped(), LINES * CPU::count());
+
+    delete[] threads;
+    delete sess;
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+
+#include <util/CPUPlacer.h>
+
+#include "PlacementTest.h"
+
+using namespace nre;
+using namespace nre::test;
+
+static void test_placement();
+
+const TestCase placementtest = {
+    "CPU placement", test_placement,
+};
+
+// 2 packages with 2 cores with 2 threads each; CPU = package * 4 + core * 2 + thread
+static void init(CPUPlacer &placer) {
+    for(cpu_t cpu = 0; cpu < 8; ++cpu)
+        placer.add(cpu, cpu & 1, (cpu >> 1) & 1, cpu >> 2);
+}
+
+// cpu_t is a char type, which WVPASSEQ can't compare with a literal
+static uint place(CPUPlacer &placer, Placement::Policy policy, const CPUSet &cpus = CPUSet(),
+                  cpu_t near = CPUPlacer::NO_CPU) {
+    return placer.place(policy, cpus, near);
+}
+
+static void test_spread() {
+    CPUPlacer placer;
+    init(placer);
+    // one thread per core first, alternating between the packages
+    WVPASSEQ(place(placer, Placement::SPREAD), 0U);
+    WVPASSEQ(place(placer, Placement::SPREAD), 4U);
+    WVPASSEQ(place(placer, Placement::SPREAD), 2U);
+    WVPASSEQ(place(placer, Placement::SPREAD), 6U);
+    // then the hyperthreads
+    WVPASSEQ(place(placer, Placement::SPREAD), 1U);
+
+    // a released CPU is used again
+    placer.release(4);
+    WVPASSEQ(place(placer, Placement::SPREAD), 4U);
+
+    // the measured load counts as well
+    CPUPlacer loaded;
+    init(loaded);
+    loaded.load(0, Placement::FULL_LOAD);
+    loaded.load(4, Placement::FULL_LOAD / 2);
+    WVPASSEQ(place(loaded, Placement::SPREAD), 6U);
+}
+
+static void test_pack() {
+    CPUPlacer placer;
+    init(placer);
+    // CPU 0 takes threads until the PACK_LIMIT is reached
+    size_t n = CPUPlacer::PACK_LIMIT / CPUPlacer::PLACED_LOAD;
+    for(size_t i = 0; i < n; ++i)
+        WVPASSEQ(place(placer, Placement::PACK), 0U);
+    WVPASSEQ(place(placer, Placement::PACK), 1U);
+}
+
+static void test_sibling_avoid() {
+    CPUPlacer placer;
+    init(placer);
+    placer.load(0, Placement::FULL_LOAD / 2);
+    placer.load(6, Placement::FULL_LOAD / 2);
+    // the siblings of 0 and 6 are busy, so the idle cores are used first
+    WVPASSEQ(place(placer, Placement::SIBLING_AVOID), 2U);
+    WVPASSEQ(place(placer, Placement::SIBLING_AVOID), 4U);
+    // afterwards, the threads are still kept away from the siblings of the busy CPUs
+    for(int i = 0; i < 4; ++i)
+        WVPASSEQ(place(placer, Placement::SIBLING_AVOID) % 2, 0U);
+}
+
+static void test_near() {
+    CPUPlacer placer;
+    init(placer);
+    // the CPU itself until it is full, then its sibling, then the same package
+    size_t n = CPUPlacer::PACK_LIMIT / CPUPlacer::PLACED_LOAD;
+    for(size_t i = 0; i < n; ++i)
+        WVPASSEQ(place(placer, Placement::NEAR, CPUSet(), 5), 5U);
+    WVPASSEQ(place(placer, Placement::NEAR, CPUSet(), 5), 4U);
+    placer.load(4, Placement::FULL_LOAD);
+    WVPASSEQ(place(placer, Placement::NEAR, CPUSet(), 5), 6U);
+    // without a valid CPU, it behaves like SPREAD
+    WVPASSEQ(place(placer, Placement::NEAR, CPUSet(), CPUPlacer::NO_CPU), 0U);
+}
+
+static void test_restricted() {
+    CPUPlacer placer;
+    init(placer);
+    CPUSet cpus(CPUSet::NONE);
+    cpus.set(3);
+    cpus.set(7);
+    WVPASSEQ(place(placer, Placement::SPREAD, cpus), 3U);
+    WVPASSEQ(place(placer, Placement::SPREAD, cpus), 7U);
+    WVPASSEQ(place(placer, Placement::PACK, cpus), 3U);
+
+    // CPUs that are not online are never chosen
+    CPUSet offline(CPUSet::NONE);
+    offline.set(12);
+    try {
+        placer.place(Placement::SPREAD, offline);
+        WVPASS(false);
+    }
+    catch(const Exception &e) {
+        WVPASSEQ(e.code(), E_NOT_FOUND);
+    }
+}
+
+static void test_placement() {
+    test_spread();
+    test_pack();
+    test_sibling_avoid();
+    test_near();
+    test_restricted();
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+
+#include <subsystem/ChildQuota.h>
+#include <arch/Defines.h>
+#include <cstring>
+
+#include "QuotaTest.h"
+
+using namespace nre;
+using namespace nre::test;
+
+static void test_quota();
+
+const TestCase quotatest = {
+    "Child quota", test_quota,
+};
+
+static bool try_charge(ChildQuota &q, ChildQuota::Resource r, size_t amount) {
+    try {
+        q.charge(r, amount);
+        return true;
+    }
+    catch(const Exception &e) {
+        WVPASSEQ(e.code(), E_CAPACITY);
+        return false;
+    }
+}
+
+static void test_quota() {
+    ChildQuota q;
+    WVPASS(!q.limited());
+    WVPASSEQ(q.limit(ChildQuota::MEM), ChildQuota::UNLIMITED);
+
+    const char *str = "mem:4M,sc:2,caps:0x10";
+    q.parse(str, strlen(str));
+    WVPASS(q.limited());
+    WVPASSEQ(q.limit(ChildQuota::MEM), static_cast<size_t>(4 * 1024 * 1024));
+    WVPASSEQ(q.limit(ChildQuota::SC), static_cast<size_t>(2));
+    WVPASSEQ(q.limit(ChildQuota::CAPS), static_cast<size_t>(16));
+    WVPASSEQ(q.limit(ChildQuota::DS), ChildQuota::UNLIMITED);
+
+    // charge up to the limit, but not beyond
+    WVPASS(try_charge(q, ChildQuota::SC, 1));
+    WVPASS(try_charge(q, ChildQuota::SC, 1));
+    WVPASS(!try_charge(q, ChildQuota::SC, 1));
+    WVPASSEQ(q.used(ChildQuota::SC), static_cast<size_t>(2));
+    q.release(ChildQuota::SC, 1);
+    WVPASS(try_charge(q, ChildQuota::SC, 1));
+
+    // either both are charged or none
+    bool failed = false;
+    try {
+        q.charge(ChildQuota::MEM, 4096, ChildQuota::CAPS, 17);
+    }
+    catch(const Exception &e) {
+        failed = true;
+    }
+    WVPASS(failed);
+    WVPASSEQ(q.used(ChildQuota::MEM), static_cast<size_t>(0));
+    WVPASSEQ(q.used(ChildQuota::CAPS), static_cast<size_t>(0));
+
+    // invalid specifications are rejected
+    const char *invalid[] = {"foo:1", "mem", "mem:x", "sc:1;ds:2"};
+    for(size_t i = 0; i < ARRAY_SIZE(invalid); ++i) {
+        ChildQuota tmp;
+        failed = false;
+        try {
+            tmp.parse(invalid[i], strlen(invalid[i]));
+        }
+        catch(const Exception &e) {
+            failed = true;
+        }
+        WVPASS(failed);
+    }
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <kobj/GlobalThread.h>
+#include <kobj/RWLock.h>
+#include <kobj/Sm.h>
+#include <util/Atomic.h>
+#include <util/Util.h>
+#include <arch/Defines.h>
+#include <Test.h>
+#include <Hip.h>
+#include <CPU.h>
+
+#include "RWLockTest.h"
+
+using namespace nre;
+using namespace nre::test;
+
+static void test_rwlock();
+
+const TestCase rwlocktest = {
+    "RWLock", test_rwlock
+};
+
+// how long we wait for something that should happen (or should not happen)
+static const uint WAIT_MS = 50;
+
+struct Shared {
+    explicit Shared() : lock(), entered(0), release(0), seq(0) {
+    }
+    RWLock lock;
+    // upped by a client as soon as it holds the lock
+    Sm entered;
+    // upped by the test to let a client release the lock again
+    Sm release;
+    volatile ulong seq;
+};
+
+struct Client {
+    Shared *sh;
+    bool write;
+    // the order in which the clients got the lock (starting with 1; 0 = not yet)
+    volatile ulong pos;
+};
+
+static void client(void*) {
+    Client *c = Thread::current()->get_tls<Client*>(Thread::TLS_PARAM);
+    if(c->write)
+        c->sh->lock.down_write();
+    else
+        c->sh->lock.down_read();
+    c->pos = Atomic::add(&c->sh->seq, +1) + 1;
+    c->sh->entered.up();
+
+    c->sh->release.down();
+    if(c->write)
+        c->sh->lock.up_write();
+    else
+        c->sh->lock.up_read();
+}
+
+static Reference<GlobalThread> start(Client &c, Shared &sh, bool write) {
+    c.sh = &sh;
+    c.write = write;
+    c.pos = 0;
+    Reference<GlobalThread> gt = GlobalThread::create(client, CPU::current().log_id(),
+                                                      "rwlock-client");
+    gt->set_tls<Client*>(Thread::TLS_PARAM, &c);
+    gt->start();
+    return gt;
+}
+
+/**
+ * @return true if a client got the lock within WAIT_MS
+ */
+static bool entered(Shared &sh) {
+    return sh.entered.down(Util::tsc() + static_cast<timevalue_t>(Hip::get().freq_tsc) * WAIT_MS);
+}
+
+static void test_readers() {
+    // all readers hold the lock at the same time
+    Shared sh;
+    Client c[3];
+    Reference<GlobalThread> gts[3];
+    for(size_t i = 0; i < ARRAY_SIZE(c); ++i)
+        gts[i] = start(c[i], sh, false);
+    for(size_t i = 0; i < ARRAY_SIZE(c); ++i)
+        WVPASS(entered(sh));
+    WVPASSEQ(sh.seq, static_cast<ulong>(ARRAY_SIZE(c)));
+
+    for(size_t i = 0; i < ARRAY_SIZE(c); ++i)
+        sh.release.up();
+    for(size_t i = 0; i < ARRAY_SIZE(c); ++i)
+        gts[i]->join();
+}
+
+static void test_writer() {
+    // neither readers nor other writers get in as long as a writer holds the lock
+    Shared sh;
+    Client w1, r, w2;
+    Reference<GlobalThread> w1t = start(w1, sh, true);
+    WVPASS(entered(sh));
+    Reference<GlobalThread> rt = start(r, sh, false);
+    Reference<GlobalThread> w2t = start(w2, sh, true);
+    WVPASS(!entered(sh));
+    WVPASSEQ(r.pos, 0UL);
+    WVPASSEQ(w2.pos, 0UL);
+
+    // the readers that blocked on the writer come first, then the next writer
+    sh.release.up();
+    w1t->join();
+    WVPASS(entered(sh));
+    WVPASSEQ(r.pos, 2UL);
+    WVPASS(!entered(sh));
+    sh.release.up();
+    rt->join();
+    WVPASS(entered(sh));
+    WVPASSEQ(w2.pos, 3UL);
+    sh.release.up();
+    w2t->join();
+}
+
+static void test_starvation() {
+    // a waiting writer keeps new readers out, so that it is not starved by a stream of readers
+    Shared sh;
+    Client r1, w, r2;
+    Reference<GlobalThread> r1t = start(r1, sh, false);
+    WVPASS(entered(sh));
+    Reference<GlobalThread> wt = start(w, sh, true);
+    WVPASS(!entered(sh));
+    Reference<GlobalThread> r2t = start(r2, sh, false);
+    WVPASS(!entered(sh));
+    WVPASSEQ(r2.pos, 0UL);
+
+    sh.release.up();
+    r1t->join();
+    WVPASS(entered(sh));
+    WVPASSEQ(w.pos, 2UL);
+    sh.release.up();
+    wt->join();
+    WVPASS(entered(sh));
+    WVPASSEQ(r2.pos, 3UL);
+    sh.release.up();
+    r2t->join();
+}
+
+static void test_rwlock() {
+    test_readers();
+    test_writer();
+    test_starvation();
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <kobj/GlobalThread.h>
+#include <kobj/UserSm.h>
+#include <kobj/Sm.h>
+#include <util/LockStats.h>
+#include <util/Atomic.h>
+#include <util/Util.h>
+#include <arch/Defines.h>
+#include <Test.h>
+#include <CPU.h>
+
+#include "UserSmTest.h"
+
+using namespace nre;
+using namespace nre::test;
+
+static void test_usersm();
+
+const TestCase usersmtest = {
+    "UserSm contention", test_usersm
+};
+
+static const uint ITERATIONS = 10000;
+
+/**
+ * The semaphore as it was before, i.e. that blocks immediately on contention
+ */
+class BlockingSm {
+public:
+    explicit BlockingSm() : _sem(0), _value(1) {
+    }
+    void down() {
+        if(Atomic::add(&_value, -1) <= 0)
+            _sem.down();
+    }
+    void up() {
+        if(Atomic::add(&_value, +1) < 0)
+            _sem.up();
+    }
+
+private:
+    Sm _sem;
+    long _value;
+};
+
+static void enable_stats(BlockingSm &, LockStats *) {
+}
+static void enable_stats(UserSm &sm, LockStats *stats) {
+    sm.stats(stats);
+}
+
+template<class SM>
+struct Bench {
+    SM sm;
+    volatile bool go;
+    volatile ulong counter;
+    uint64_t latency;
+};
+
+template<class SM>
+static void worker(void*) {
+    Bench<SM> *b = Thread::current()->get_tls<Bench<SM>*>(Thread::TLS_PARAM);
+    while(!b->go)
+        Util::pause();
+    uint64_t latency = 0;
+    for(uint i = 0; i < ITERATIONS; ++i) {
+        uint64_t start = Util::tsc();
+        b->sm.down();
+        latency += Util::tsc() - start;
+        // a short critical section, as it is typical for NRE
+        b->counter++;
+        b->sm.up();
+    }
+    Atomic::add(&b->latency, latency);
+}
+
+template<class SM>
+static void run(const char *name, size_t cpus, LockStats *stats = nullptr) {
+    Bench<SM> *b = new Bench<SM>();
+    b->go = false;
+    b->counter = 0;
+    b->latency = 0;
+    enable_stats(b->sm, stats);
+    Reference<GlobalThread> *gts = new Reference<GlobalThread>[cpus];
+    size_t n = 0;
+    for(auto it = CPU::begin(); it != CPU::end() && n < cpus; ++it, ++n) {
+        gts[n] = GlobalThread::create(worker<SM>, it->log_id(), "usersm-worker");
+        gts[n]->set_tls<Bench<SM>*>(Thread::TLS_PARAM, b);
+        gts[n]->start();
+    }
+
+    uint64_t start = Util::tsc();
+    b->go = true;
+    for(size_t i = 0; i < n; ++i)
+        gts[i]->join();
+    uint64_t total = Util::tsc() - start;
+
+    WVPASSEQ(b->counter, static_cast<ulong>(n * ITERATIONS));
+    WVPRINT(name << " with " << n << " CPUs:");
+    WVPERF(total / (n * ITERATIONS), "cycles per critical section");
+    WVPERF(b->latency / (n * ITERATIONS), "cycles per down");
+    if(stats)
+        WVPRINT(*stats);
+    delete[] gts;
+    delete b;
+}
+
+static void test_usersm() {
+    size_t counts[] = {1, 2, CPU::count()};
+    for(size_t i = 0; i < ARRAY_SIZE(counts); ++i) {
+        if(counts[i] > CPU::count() || (i > 0 && counts[i] == counts[i - 1]))
+            continue;
+        run<BlockingSm>("BlockingSm", counts[i]);
+
+        LockStats stats("usersm-test");
+        run<UserSm>("UserSm", counts[i], &stats);
+    }
+}
@@ -39,6 +39,15 @@
 #include "tests/Sessions.h"
 #include "tests/ProducerConsumer.h"
 #include "tests/ThreadRefs.h"
+#include "tests/LogRing.h"
+#include "tests/QuotaTest.h"
+#include "tests/ChildStartup.h"
+#include "tests/UserSmTest.h"
+#include "tests/RWLockTest.h"
+#include "tests/ACPITest.h"
+#include "tests/ATARETest.h"
+#include "tests/PlacementTest.h"
+#include "tests/DeleterTest.h"
 
 using namespace nre;
 using namespace nre::test;
@@ -76,6 +85,15 @@ const TestCase testcases[] = {
     sessions,
     prodcons,
     threadrefs,
+    logring,
+    quotatest,
+    childstartup,
+    usersmtest,
+    rwlocktest,
+    acpitest,
+    ataretest,
+    placementtest,
+    deletertest,
 };
 
 int main() {
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <services/VMControl.h>
+#include <services/Timer.h>
+#include <stream/Serial.h>
+#include <Hip.h>
+#include <cstring>
+
+using namespace nre;
+
+static const size_t MAX_ITEMS   = 64;
+static const char *event_names[] = {"started", "exited", "crashed"};
+
+static VMControlSession *ctrl;
+static size_t last_vm = 0;
+
+static void list() {
+    static String names[MAX_ITEMS];
+    static VMControl::VMInfo vms[MAX_ITEMS];
+    size_t total = ctrl->configs(names, MAX_ITEMS);
+    Serial::get() << "VM configs:\n";
+    for(size_t i = 0; i < Math::min(total, MAX_ITEMS); ++i)
+        Serial::get() << "  [" << i << "] " << names[i] << "\n";
+    total = ctrl->vms(vms, MAX_ITEMS);
+    Serial::get() << "Running VMs:\n";
+    for(size_t i = 0; i < Math::min(total, MAX_ITEMS); ++i) {
+        Serial::get() << "  id=" << vms[i].id << " config=" << vms[i].config
+                      << " console=" << vms[i].console << " cpu=" << vms[i].cpu
+                      << " mem=" << (vms[i].mem / 1024) << "K"
+                      << (vms[i].initialized ? "" : " (not initialized)") << "\n";
+    }
+}
+
+static void print_event(const VMControl::Event &ev) {
+    Serial::get() << "Event: VM " << ev.vm << " (config " << ev.config << ") "
+                  << event_names[ev.type] << "\n";
+}
+
+static void wait_event(VMControl::EventType type) {
+    while(true) {
+        VMControl::Event *ev = ctrl->events().get();
+        VMControl::Event copy = *ev;
+        ctrl->events().next();
+        print_event(copy);
+        if(copy.type == type && copy.vm == last_vm)
+            break;
+    }
+}
+
+static size_t vm_arg(const char *arg) {
+    // "<cmd>" refers to the last started VM, "<cmd>=<id>" to the given one
+    const char *eq = strchr(arg, '=');
+    return eq ? strtoul(eq + 1, nullptr, 10) : last_vm;
+}
+
+/**
+ * Controls the VMs of vmmng via the vmctrl service. The commands are executed in the given order:
+ *  list                    list the configs and running VMs
+ *  start=<cfg>[@<cpus>]    start config <cfg> on the given CPUs (hex mask; all by default)
+ *  stop[=<id>]             ask the VMM to terminate the VM
+ *  reset[=<id>]            ask the VMM to reset the VM
+ *  kill[=<id>]             kill the VM
+ *  wait=<ms>               wait for the given number of milliseconds
+ *  await=<event>           wait until the last VM has been started/exited/crashed
+ *  events                  print all pending events
+ * Without id, stop, reset and kill refer to the last started VM. For example:
+ * "vmctl start=0@1 await=started wait=5000 reset wait=5000 stop await=exited"
+ */
+int main(int argc, char *argv[]) {
+    ctrl = new VMControlSession("vmctrl");
+    TimerSession *timer = nullptr;
+    for(int i = 1; i < argc; ++i) {
+        try {
+            if(strcmp(argv[i], "list") == 0)
+                list();
+            else if(strncmp(argv[i], "start=", 6) == 0) {
+                const char *end;
+                size_t cfg = strtoul(argv[i] + 6, &end, 10);
+                CPUSet cpus(CPUSet::ALL);
+                if(*end == '@') {
+                    ulong mask = strtoul(end + 1, nullptr, 16);
+                    cpus = CPUSet(CPUSet::NONE);
+                    for(cpu_t cpu = 0; cpu < sizeof(mask) * 8; ++cpu) {
+                        if(mask & (1UL << cpu))
+                            cpus.set(cpu);
+                    }
+                }
+                last_vm = ctrl->start(cfg, cpus);
+                Serial::get() << "Started config " << cfg << " as VM " << last_vm << "\n";
+            }
+            else if(strncmp(argv[i], "stop", 4) == 0)
+                ctrl->stop(vm_arg(argv[i]));
+            else if(strncmp(argv[i], "reset", 5) == 0)
+                ctrl->reset(vm_arg(argv[i]));
+            else if(strncmp(argv[i], "kill", 4) == 0)
+                ctrl->kill(vm_arg(argv[i]));
+            else if(strncmp(argv[i], "wait=", 5) == 0) {
+                if(!timer)
+                    timer = new TimerSession("timer");
+                timer->wait_for(Hip::get().freq_tsc * strtoul(argv[i] + 5, nullptr, 10));
+            }
+            else if(strncmp(argv[i], "await=", 6) == 0) {
+                size_t type = 0;
+                while(type < ARRAY_SIZE(event_names) && strcmp(event_names[type], argv[i] + 6) != 0)
+                    type++;
+                if(type == ARRAY_SIZE(event_names))
+                    Serial::get() << "Unknown event '" << (argv[i] + 6) << "'\n";
+                else
+                    wait_event(static_cast<VMControl::EventType>(type));
+            }
+            else if(strcmp(argv[i], "events") == 0) {
+                while(ctrl->events().has_data()) {
+                    print_event(*ctrl->events().get());
+                    ctrl->events().next();
+                }
+            }
+            else
+                Serial::get() << "Unknown command '" << argv[i] << "'\n";
+        }
+        catch(const Exception &e) {
+            Serial::get() << "Command '" << argv[i] << "' failed: " << e.msg() << "\n";
+        }
+    }
+    delete timer;
+    delete ctrl;
+    return 0;
+}
@@ -19,27 +19,70 @@
 #include <subsystem/Child.h>
 #include <ipc/Producer.h>
 #include <services/VMManager.h>
-#include <collection/SList.h>
+#include <collection/SListTreap.h>
+#include <util/CPUSet.h>
 
 #include "VMConfig.h"
 
-class RunningVM : public nre::SListItem {
+class RunningVM;
+
+/**
+ * The node to find a VM by the selector of its Pd
+ */
+class RunningVMPdNode : public nre::TreapNode<capsel_t> {
 public:
-    explicit RunningVM(VMConfig *cfg, size_t console, nre::Child::id_type id, capsel_t pd)
-        : nre::SListItem(), _cfg(cfg), _console(console), _id(id), _pd(pd), _prod() {
+    explicit RunningVMPdNode(capsel_t pd, RunningVM *vm) : nre::TreapNode<capsel_t>(pd), _vm(vm) {
+    }
+
+    RunningVM *vm() const {
+        return _vm;
     }
 
-    const VMConfig *cfg() const {
+private:
+    RunningVM *_vm;
+};
+
+class RunningVM : public nre::SListTreapNode<nre::Child::id_type> {
+public:
+    explicit RunningVM(VMConfig *cfg, size_t console, nre::Child::id_type id, capsel_t pd,
+                       cpu_t cpu, const nre::CPUSet &cpus)
+        : nre::SListTreapNode<nre::Child::id_type>(id), _cfg(cfg), _console(console),
+          _pdnode(pd, this), _cpu(cpu), _cpus(cpus), _stopping(false), _prod() {
+    }
+
+    VMConfig *cfg() const {
         return _cfg;
     }
     size_t console() const {
         return _console;
     }
     nre::Child::id_type id() const {
-        return _id;
+        return key();
     }
     capsel_t pd() const {
-        return _pd;
+        return _pdnode.key();
+    }
+    RunningVMPdNode *pdnode() {
+        return &_pdnode;
+    }
+    /**
+     * @return the CPU of the main thread and the CPUs the VM has been started with
+     */
+    cpu_t cpu() const {
+        return _cpu;
+    }
+    const nre::CPUSet &cpus() const {
+        return _cpus;
+    }
+    /**
+     * @return true if somebody asked the VM to terminate or killed it. That is, whether its
+     *  termination is expected
+     */
+    bool stopping() const {
+        return _stopping;
+    }
+    void stopping(bool stopping) {
+        _stopping = stopping;
     }
 
     bool initialized() const {
@@ -49,16 +92,22 @@ public:
         _prod = prod;
     }
     void execute(nre::VMManager::Event event) {
-        assert(_prod);
+        if(!_prod)
+            throw nre::Exception(nre::E_NOT_FOUND, "VMM has not connected yet");
         nre::VMManager::Packet pk;
         pk.event = event;
-        _prod->produce(pk);
+        if(!_prod->produce(pk))
+            throw nre::Exception(nre::E_CAPACITY, "VMM does not accept requests");
+        if(event != nre::VMManager::RESET)
+            _stopping = true;
     }
 
 private:
     VMConfig *_cfg;
     size_t _console;
-    nre::Child::id_type _id;
-    capsel_t _pd;
+    RunningVMPdNode _pdnode;
+    cpu_t _cpu;
+    nre::CPUSet _cpus;
+    bool _stopping;
     nre::Producer<nre::VMManager::Packet> *_prod;
 };
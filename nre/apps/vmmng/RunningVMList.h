@@ -17,95 +17,286 @@
 #pragma once
 
 #include <kobj/UserSm.h>
-#include <collection/SList.h>
+#include <collection/SListTreap.h>
+#include <services/Console.h>
+#include <services/Placement.h>
 #include <util/ScopedLock.h>
 
 #include "RunningVM.h"
+#include "VMCtrlService.h"
 
+/**
+ * The list of running VMs. The VMs can be found by their id and by the selector of their Pd. Since
+ * VMs can be removed at any time, no pointers to them are handed out. Instead, the VMs are
+ * referred to by their id and looked up again under the lock of the list.
+ */
 class RunningVMList {
-    static const size_t MAX_VMS     = 64;
-
-    explicit RunningVMList() : _sm(), _max(), _list(is_less), _consoles() {
+    explicit RunningVMList() : _sm(), _vms(), _bypd(), _consoles(), _listener(), _placement() {
     }
 
 public:
+    /**
+     * What is left of a removed VM
+     */
+    struct Removed {
+        VMConfig *cfg;
+        nre::CPUSet cpus;
+        // whether its termination was unexpected
+        bool crashed;
+    };
+
     static RunningVMList &get() {
         return _inst;
     }
 
     size_t count() const {
-        return _list.length();
+        return _vms.length();
     }
-    size_t max_idx() const {
-        return _max;
+
+    /**
+     * Lets the list up <sm> whenever a VM has been added or removed
+     */
+    void listen(nre::Sm *sm) {
+        _listener = sm;
+    }
+
+    /**
+     * Lets the list choose the CPUs for the VMs via <placement>
+     */
+    void placement(nre::PlacementSession *placement) {
+        _placement = placement;
     }
-    void add(nre::ChildManager &cm, VMConfig *cfg, cpu_t cpu) {
+
+    /**
+     * Starts the given VM config and adds it to the list. The main thread of the VMM is put on
+     * the least loaded CPU of <cpus>.
+     *
+     * @param cm the child manager
+     * @param cfg the VM config
+     * @param cpus the CPUs to present to the VM
+     * @return the id of the VM
+     */
+    nre::Child::id_type add(nre::ChildManager &cm, VMConfig *cfg,
+                            const nre::CPUSet &cpus = nre::CPUSet(nre::CPUSet::ALL)) {
         nre::ScopedLock<nre::UserSm> guard(&_sm);
-        size_t console = alloc_console();
+        cpu_t cpu = place(cpus);
+        size_t console;
+        try {
+            console = alloc_console();
+        }
+        catch(...) {
+            unplace(cpu);
+            throw;
+        }
         try {
-            nre::Child::id_type id = cfg->start(cm, console, cpu);
+            nre::Child::id_type id = cfg->start(cm, console, cpu, cpus);
             nre::Reference<const nre::Child> child = cm.get(id);
-            if(child.valid()) {
-                _list.insert(new RunningVM(cfg, console, id, child->pd()));
-                _max = nre::Math::max(_max, console);
-            }
+            if(!child.valid())
+                throw nre::Exception(nre::E_NOT_FOUND, "VM died during startup");
+            RunningVM *vm = new RunningVM(cfg, console, id, child->pd(), cpu, cpus);
+            _vms.insert(vm);
+            _bypd.insert(vm->pdnode());
+            notify(nre::VMControl::STARTED, id, cfg->no());
+            return id;
         }
         catch(...) {
             free_console(console);
+            unplace(cpu);
             throw;
         }
     }
-    RunningVM *get(size_t idx) {
+    /**
+     * @return the id of the VM with index <idx> (ObjCap::INVALID if there is none)
+     */
+    nre::Child::id_type id_at(size_t idx) {
         nre::ScopedLock<nre::UserSm> guard(&_sm);
-        auto it = _list.begin();
-        for(; it != _list.end() && idx-- > 0; ++it)
+        auto it = _vms.begin();
+        for(; it != _vms.end() && idx-- > 0; ++it)
             ;
-        if(it == _list.end())
-            return nullptr;
-        return &*it;
+        if(it == _vms.end())
+            return nre::ObjCap::INVALID;
+        return it->id();
+    }
+
+    /**
+     * Connects the VM with the Pd <pd> to the VMM's ring <prod>
+     *
+     * @return the id of the VM
+     * @throws Exception if the VM does not exist or is already connected
+     */
+    nre::Child::id_type attach(capsel_t pd, nre::Producer<nre::VMManager::Packet> *prod) {
+        nre::ScopedLock<nre::UserSm> guard(&_sm);
+        RunningVMPdNode *node = _bypd.find(pd);
+        if(!node)
+            throw nre::Exception(nre::E_NOT_FOUND, "Corresponding VM not found");
+        if(node->vm()->initialized())
+            throw nre::Exception(nre::E_EXISTS, "Already initialized");
+        node->vm()->set_producer(prod);
+        return node->vm()->id();
     }
-    RunningVM *get_by_pd(capsel_t pd) {
+    /**
+     * Disconnects the VM with given id from its VMM, if it still exists
+     */
+    void detach(nre::Child::id_type id) {
         nre::ScopedLock<nre::UserSm> guard(&_sm);
-        for(auto it = _list.begin(); it != _list.end(); ++it) {
-            if(it->pd() == pd)
-                return &*it;
+        RunningVM *vm = _vms.find(id);
+        if(vm)
+            vm->set_producer(nullptr);
+    }
+
+    /**
+     * Fills <infos> with the information about the VMs, starting at index <first>
+     *
+     * @return the number of VMs written to <infos>
+     */
+    size_t info(nre::ChildManager &cm, size_t first, nre::VMControl::VMInfo *infos, size_t max) {
+        nre::ScopedLock<nre::UserSm> guard(&_sm);
+        auto it = _vms.begin();
+        for(; it != _vms.end() && first-- > 0; ++it)
+            ;
+        size_t n = 0;
+        for(; it != _vms.end() && n < max; ++it, ++n) {
+            nre::VMControl::VMInfo &info = infos[n];
+            info.id = it->id();
+            info.config = it->cfg()->no();
+            info.console = it->console();
+            info.initialized = it->initialized();
+            info.cpu = it->cpu();
+            info.mem = 0;
+            nre::Reference<const nre::Child> c = cm.get(it->id());
+            if(c.valid()) {
+                size_t virt;
+                c->reglist().memusage(virt, info.mem);
+            }
         }
-        return nullptr;
+        return n;
     }
-    void remove(RunningVM *vm) {
+
+    /**
+     * Sends <event> to the VMM of the VM with given id
+     *
+     * @throws Exception if the VM does not exist or the VMM has not connected yet
+     */
+    void execute(nre::Child::id_type id, nre::VMManager::Event event) {
         nre::ScopedLock<nre::UserSm> guard(&_sm);
-        if(_list.remove(vm)) {
-            free_console(vm->console());
-            delete vm;
+        find(id)->execute(event);
+    }
+
+    /**
+     * Kills the VM with given id and removes it from the list
+     *
+     * @throws Exception if the VM does not exist
+     */
+    void kill(nre::ChildManager &cm, nre::Child::id_type id) {
+        {
+            nre::ScopedLock<nre::UserSm> guard(&_sm);
+            find(id)->stopping(true);
+        }
+        cm.kill(id);
+        remove(id, false);
+    }
+
+    /**
+     * Removes the VM with given id from the list
+     *
+     * @param id the VM id
+     * @param failed whether the VM terminated abnormally. if so and it has not been asked to
+     *  terminate, it is considered crashed
+     * @param rem if not null, it will be set to what is left of the VM
+     * @return true if it has been removed
+     */
+    bool remove(nre::Child::id_type id, bool failed, Removed *rem = nullptr) {
+        nre::ScopedLock<nre::UserSm> guard(&_sm);
+        RunningVM *vm = _vms.find(id);
+        if(!vm)
+            return false;
+        bool crashed = failed && !vm->stopping();
+        if(rem) {
+            rem->cfg = vm->cfg();
+            rem->cpus = vm->cpus();
+            rem->crashed = crashed;
+        }
+        do_remove(vm, crashed);
+        return true;
+    }
+
+    /**
+     * Removes all VMs whose child does no longer exist. This is only necessary if we have missed
+     * exits of the child manager.
+     */
+    void reap(nre::ChildManager &cm) {
+        nre::ScopedLock<nre::UserSm> guard(&_sm);
+        for(auto it = _vms.begin(); it != _vms.end(); ) {
+            RunningVM *vm = &*it++;
+            // we don't know how it terminated
+            if(!cm.get(vm->id()).valid())
+                do_remove(vm, !vm->stopping());
         }
     }
 
 private:
-    size_t alloc_console() {
-        // 0 is the management console
-        for(size_t i = 1; i < MAX_VMS; ++i) {
-            if(!_consoles[i]) {
-                _consoles[i] = true;
-                return i;
+    RunningVM *find(nre::Child::id_type id) {
+        RunningVM *vm = _vms.find(id);
+        if(!vm)
+            VTHROW(Exception, E_NOT_FOUND, "VM " << id << " not found");
+        return vm;
+    }
+    void do_remove(RunningVM *vm, bool crashed) {
+        _vms.remove(vm);
+        _bypd.remove(vm->pdnode());
+        notify(crashed ? nre::VMControl::CRASHED : nre::VMControl::EXITED, vm->id(),
+               vm->cfg()->no());
+        free_console(vm->console());
+        unplace(vm->cpu());
+        delete vm;
+    }
+    cpu_t place(const nre::CPUSet &cpus) {
+        if(_placement)
+            return _placement->place(nre::Placement::SPREAD, cpus);
+        cpu_t cpu = cpus.get().first_set();
+        if(cpu >= nre::CPU::count())
+            throw nre::Exception(nre::E_ARGS_INVALID, "No valid CPU given");
+        return cpu;
+    }
+    void unplace(cpu_t cpu) {
+        if(_placement) {
+            try {
+                _placement->release(cpu);
+            }
+            catch(const nre::Exception &) {
+                // the placement is released when our session is closed anyway
             }
         }
-        throw nre::Exception(nre::E_CAPACITY, "All VM consoles in use");
     }
-    void free_console(size_t i) {
-        _consoles[i] = false;
-        for(size_t i = 1; i < MAX_VMS; ++i) {
-            if(_consoles[i])
-                _max = i;
-        }
+    void notify(nre::VMControl::EventType type, nre::Child::id_type id, size_t config) {
+        if(_listener)
+            _listener->up();
+        nre::VMControl::Event ev;
+        ev.type = type;
+        ev.vm = id;
+        ev.config = config;
+        VMCtrlService::notify(ev);
     }
 
-    static bool is_less(const RunningVM &a, const RunningVM &b) {
-        return a.console() < b.console();
+    size_t alloc_console() {
+        // 0 is the management console. if there are more VMs than consoles, they share them
+        size_t best = 1;
+        for(size_t i = 2; i < nre::Console::SUBCONS; ++i) {
+            if(_consoles[i] < _consoles[best])
+                best = i;
+        }
+        _consoles[best]++;
+        return best;
+    }
+    void free_console(size_t i) {
+        _consoles[i]--;
     }
 
     nre::UserSm _sm;
-    size_t _max;
-    nre::SortedSList<RunningVM> _list;
-    bool _consoles[MAX_VMS];
+    nre::SListTreap<RunningVM> _vms;
+    nre::Treap<RunningVMPdNode> _bypd;
+    size_t _consoles[nre::Console::SUBCONS];
+    nre::Sm *_listener;
+    nre::PlacementSession *_placement;
     static RunningVMList _inst;
 };
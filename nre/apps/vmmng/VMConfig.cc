@@ -37,13 +37,13 @@ void VMConfig::find_mods(size_t len) {
     }
 }
 
-Child::id_type VMConfig::start(ChildManager &cm, size_t console, cpu_t cpu) {
+Child::id_type VMConfig::start(ChildManager &cm, size_t console, cpu_t cpu, const CPUSet &cpus) {
     static char args[MAX_ARGS_LEN];
     auto first = _mods.begin();
     OStringStream os(args, sizeof(args));
     os << first->args() << " console:" << console << " constitle:" << _name;
 
-    VMChildConfig cfg(_mods, args, cpu);
+    VMChildConfig cfg(_mods, args, cpu, cpus);
     Hip::mem_iterator mod = get_module(first->name());
     DataSpace ds(mod->size, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::R, mod->addr);
     return cm.load(ds.virt(), mod->size, cfg);
@@ -49,8 +49,10 @@ class VMConfig : public nre::SListItem {
 
     class VMChildConfig : public nre::ChildConfig {
     public:
-        explicit VMChildConfig(const nre::SList<Module> &mods, const nre::String &cmdline, cpu_t cpu)
+        explicit VMChildConfig(const nre::SList<Module> &mods, const nre::String &cmdline,
+                               cpu_t cpu, const nre::CPUSet &cpus)
             : nre::ChildConfig(0, cmdline, cpu), _mods(mods) {
+            this->cpus(cpus);
         }
 
         virtual bool get_module(size_t i, nre::HipMem &mem) const {
@@ -69,9 +71,10 @@ class VMConfig : public nre::SListItem {
     };
 
 public:
-    explicit VMConfig(uintptr_t phys, size_t size, const char *name)
-        : nre::SListItem(), _ds(size, nre::DataSpaceDesc::ANONYMOUS, nre::DataSpaceDesc::R, phys),
-          _name(name), _mods() {
+    explicit VMConfig(size_t no, uintptr_t phys, size_t size, const char *name)
+        : nre::SListItem(), _no(no),
+          _ds(size, nre::DataSpaceDesc::ANONYMOUS, nre::DataSpaceDesc::R, phys), _name(name),
+          _mods() {
         find_mods(size);
     }
     ~VMConfig() {
@@ -81,6 +84,9 @@ public:
         }
     }
 
+    size_t no() const {
+        return _no;
+    }
     const char *name() const {
         return _name;
     }
@@ -88,12 +94,14 @@ public:
         auto first = _mods.cbegin();
         return first->args();
     }
-    nre::Child::id_type start(nre::ChildManager &cm, size_t console, cpu_t cpu);
+    nre::Child::id_type start(nre::ChildManager &cm, size_t console, cpu_t cpu,
+                              const nre::CPUSet &cpus = nre::CPUSet(nre::CPUSet::ALL));
 
 private:
     void find_mods(size_t len);
     static nre::Hip::mem_iterator get_module(const nre::String &name);
 
+    size_t _no;
     nre::DataSpace _ds;
     const char *_name;
     nre::SList<Module> _mods;
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include "VMCtrlService.h"
+#include "VMConfig.h"
+#include "RunningVMList.h"
+
+using namespace nre;
+
+VMCtrlService *VMCtrlService::_inst = nullptr;
+
+VMConfig *VMCtrlService::config(size_t no) {
+    for(auto it = _configs.begin(); it != _configs.end(); ++it) {
+        if(it->no() == no)
+            return &*it;
+    }
+    VTHROW(Exception, E_NOT_FOUND, "VM config " << no << " not found");
+}
+
+void VMCtrlService::portal(VMCtrlServiceSession *sess) {
+    UtcbFrameRef uf;
+    try {
+        VMControl::Command cmd;
+        uf >> cmd;
+
+        RunningVMList &vml = RunningVMList::get();
+        switch(cmd) {
+            case VMControl::SUBSCRIBE: {
+                capsel_t dssel = uf.get_delegated(0).offset();
+                capsel_t smsel = uf.get_delegated(0).offset();
+                uf.finish_input();
+
+                sess->subscribe(new DataSpace(dssel), new Sm(smsel, false));
+                uf.accept_delegates();
+                uf << E_SUCCESS;
+            }
+            break;
+
+            case VMControl::LIST_CONFIGS: {
+                size_t first;
+                uf >> first;
+                uf.finish_input();
+
+                size_t total = _inst->_configs.length();
+                size_t n = first < total ? Math::min(total - first, VMControl::MAX_LIST) : 0;
+                uf << E_SUCCESS << total << n;
+                auto it = _inst->_configs.begin();
+                for(size_t i = 0; it != _inst->_configs.end() && i < first + n; ++it, ++i) {
+                    if(i >= first)
+                        uf << String(it->name());
+                }
+            }
+            break;
+
+            case VMControl::LIST_VMS: {
+                size_t first;
+                uf >> first;
+                uf.finish_input();
+
+                // collect them first, because VMs might disappear in the meantime
+                VMControl::VMInfo infos[VMControl::MAX_LIST];
+                size_t n = vml.info(_inst->_cm, first, infos, VMControl::MAX_LIST);
+                uf << E_SUCCESS << Math::max(vml.count(), first + n) << n;
+                for(size_t i = 0; i < n; ++i)
+                    uf << infos[i];
+            }
+            break;
+
+            case VMControl::START: {
+                size_t no;
+                CPUSet cpus;
+                uf >> no >> cpus;
+                uf.finish_input();
+
+                VMConfig *cfg = _inst->config(no);
+                Child::id_type id = vml.add(_inst->_cm, cfg, cpus);
+                uf << E_SUCCESS << id;
+            }
+            break;
+
+            case VMControl::STOP:
+            case VMControl::RESET:
+            case VMControl::KILL: {
+                Child::id_type id;
+                uf >> id;
+                uf.finish_input();
+
+                if(cmd == VMControl::KILL)
+                    vml.kill(_inst->_cm, id);
+                else if(cmd == VMControl::STOP)
+                    vml.execute(id, VMManager::TERMINATE);
+                else
+                    vml.execute(id, VMManager::RESET);
+                uf << E_SUCCESS;
+            }
+            break;
+        }
+    }
+    catch(const Exception &e) {
+        Syscalls::revoke(uf.delegation_window(), true);
+        uf.clear();
+        uf << e;
+    }
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <ipc/ServiceSession.h>
+#include <ipc/Service.h>
+#include <ipc/Producer.h>
+#include <services/VMControl.h>
+#include <subsystem/ChildManager.h>
+#include <util/ScopedLock.h>
+
+class VMConfig;
+
+class VMCtrlServiceSession : public nre::ServiceSession {
+public:
+    explicit VMCtrlServiceSession(nre::Service *s, size_t id, portal_func func)
+        : ServiceSession(s, id, func), _ds(), _sm(), _prod() {
+    }
+    virtual ~VMCtrlServiceSession() {
+        delete _prod;
+        delete _ds;
+        delete _sm;
+    }
+
+    nre::Producer<nre::VMControl::Event> *prod() {
+        return _prod;
+    }
+
+    void subscribe(nre::DataSpace *ds, nre::Sm *sm) {
+        if(_ds)
+            throw nre::Exception(nre::E_EXISTS, "Already subscribed");
+        _ds = ds;
+        _sm = sm;
+        _prod = new nre::Producer<nre::VMControl::Event>(*_ds, *_sm, false);
+    }
+
+private:
+    nre::DataSpace *_ds;
+    nre::Sm *_sm;
+    nre::Producer<nre::VMControl::Event> *_prod;
+};
+
+/**
+ * The control-plane of vmmng. It lets other Pds list the VM configs and the running VMs, start,
+ * stop, reset and kill VMs and informs them about the lifecycle of all VMs.
+ */
+class VMCtrlService : public nre::Service {
+    explicit VMCtrlService(const char *name, nre::ChildManager &cm,
+                           nre::SList<VMConfig> &configs)
+        : Service(name, nre::CPUSet(nre::CPUSet::ALL), reinterpret_cast<portal_func>(portal)),
+          _cm(cm), _configs(configs) {
+        // we want to accept two caps for the event ring
+        for(auto it = nre::CPU::begin(); it != nre::CPU::end(); ++it) {
+            nre::Reference<nre::LocalThread> ec = get_thread(it->log_id());
+            nre::UtcbFrameRef uf(ec->utcb());
+            uf.accept_delegates(1);
+        }
+    }
+
+public:
+    static VMCtrlService *create(const char *name, nre::ChildManager &cm,
+                                 nre::SList<VMConfig> &configs) {
+        return _inst = new VMCtrlService(name, cm, configs);
+    }
+
+    /**
+     * Delivers <ev> to all subscribers. If the ring of a subscriber is full, the event is dropped
+     * for that subscriber.
+     */
+    static void notify(const nre::VMControl::Event &ev) {
+        if(_inst)
+            _inst->broadcast(ev);
+    }
+
+private:
+    void broadcast(const nre::VMControl::Event &ev) {
+        nre::ScopedReadLock<Service> guard(this);
+        for(auto it = sessions_begin(); it != sessions_end(); ++it) {
+            VMCtrlServiceSession *sess = static_cast<VMCtrlServiceSession*>(&*it);
+            if(sess->prod())
+                sess->prod()->produce(ev);
+        }
+    }
+
+    VMConfig *config(size_t no);
+
+    virtual VMCtrlServiceSession *create_session(size_t id, const nre::String &,
+                                                 portal_func func) {
+        return new VMCtrlServiceSession(this, id, func);
+    }
+
+    PORTAL static void portal(VMCtrlServiceSession *sess);
+
+    nre::ChildManager &_cm;
+    nre::SList<VMConfig> &_configs;
+    static VMCtrlService *_inst;
+};
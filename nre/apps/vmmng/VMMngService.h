@@ -39,25 +39,32 @@ public:
         return nre::Atomic::add(&_macs, +1);
     }
     virtual void invalidate() {
-        RunningVMList::get().remove(_vm);
+        // the producer is destroyed with us. if the VM is gone as well, the exit of its child will
+        // remove it from the list
+        if(_ds)
+            RunningVMList::get().detach(_vm);
     }
 
     void init(nre::DataSpace *ds, nre::Sm *sm, capsel_t pd) {
-        RunningVM *vm = RunningVMList::get().get_by_pd(pd);
-        if(!vm)
-            throw nre::Exception(nre::E_NOT_FOUND, "Corresponding VM not found");
-        if(_ds || vm->initialized())
+        if(_ds)
             throw nre::Exception(nre::E_EXISTS, "Already initialized");
-        _vm = vm;
+        nre::Producer<nre::VMManager::Packet> *prod =
+            new nre::Producer<nre::VMManager::Packet>(*ds, *sm, false);
+        try {
+            _vm = RunningVMList::get().attach(pd, prod);
+        }
+        catch(...) {
+            delete prod;
+            throw;
+        }
         _ds = ds;
         _sm = sm;
-        _prod = new nre::Producer<nre::VMManager::Packet>(*_ds, *_sm, false);
-        vm->set_producer(_prod);
+        _prod = prod;
     }
 
 private:
     uint _macs;
-    RunningVM *_vm;
+    nre::Child::id_type _vm;
     nre::DataSpace *_ds;
     nre::Sm *_sm;
     nre::Producer<nre::VMManager::Packet> *_prod;
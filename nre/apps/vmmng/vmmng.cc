@@ -16,67 +16,152 @@
 
 #include <subsystem/ChildManager.h>
 #include <services/Console.h>
-#include <services/Timer.h>
 #include <services/Keyboard.h>
+#include <services/Placement.h>
 #include <stream/Serial.h>
 #include <stream/VGAStream.h>
-#include <collection/Cycler.h>
-#include <util/Clock.h>
+#include <stream/OStringStream.h>
+#include <util/Util.h>
 #include <Hip.h>
+#include <cstring>
 
 #include "VMConfig.h"
 #include "RunningVM.h"
 #include "RunningVMList.h"
 #include "VMMngService.h"
+#include "VMCtrlService.h"
 
 using namespace nre;
 
 static const uint CUR_ROW_COLOR = 0x70;
+// the interval in milliseconds in which the memory usage of the VMs is updated
+static const uint REFRESH_INTERVAL  = 1000;
 
 static UserSm sm;
 static size_t vmidx = 0;
+static size_t vmtop = 0;
 static ConsoleSession cons("console", 0, "VMManager");
 static SList<VMConfig> configs;
 static ChildManager cm;
-static Cycler<CPU::iterator> cpucyc(CPU::begin(), CPU::end());
+static PlacementSession placement("placement");
+static Sm refresh_sm(0);
+static bool autorestart = false;
+
+// what is currently on the screen, so that we only write the rows that changed
+static char screen[VGAStream::ROWS][VGAStream::COLS];
+static uint8_t screen_color[VGAStream::ROWS];
+
+static timevalue_t to_us(timevalue_t tsc) {
+    return (tsc * 1000) / Hip::get().freq_tsc;
+}
+
+static void put_row(VGAStream &cs, uint y, const char *text, uint8_t color) {
+    char row[VGAStream::COLS];
+    size_t len = Math::min<size_t>(strlen(text), VGAStream::COLS);
+    memcpy(row, text, len);
+    memset(row + len, ' ', VGAStream::COLS - len);
+    if(screen_color[y] == color && memcmp(screen[y], row, VGAStream::COLS) == 0)
+        return;
+
+    memcpy(screen[y], row, VGAStream::COLS);
+    screen_color[y] = color;
+    cs.pos(0, y);
+    cs.color(color);
+    for(uint x = 0; x < VGAStream::COLS; ++x)
+        cs << row[x];
+}
+
+static const VMConfig *config(size_t no) {
+    for(auto it = configs.begin(); it != configs.end(); ++it) {
+        if(it->no() == no)
+            return &*it;
+    }
+    return nullptr;
+}
 
 static void refresh_console() {
     ScopedLock<UserSm> guard(&sm);
+    RunningVMList &vml = RunningVMList::get();
     VGAStream cs(cons, 0);
-    cs.clear(0);
-    cs << "Welcome to the interactive VM manager!\n\n";
-    cs << "VM configurations:\n";
-    size_t no = 1;
-    for(auto it = configs.begin(); it != configs.end(); ++it, ++no)
-        cs << "  [" << no << "] " << it->name() << "\n";
-    cs << "\n";
-
-    cs << "Running VMs:\n";
-    RunningVM *vm;
-    if(vmidx >= RunningVMList::get().count())
-        vmidx = RunningVMList::get().count() - 1;
-    for(size_t i = 0; (vm = RunningVMList::get().get(i)) != nullptr; ++i) {
-        Reference<const Child> c = cm.get(vm->id());
-        // detect crashed VMs
-        if(!c.valid()) {
-            RunningVMList::get().remove(vm);
-            i--;
-            continue;
+    uint8_t color = cs.color();
+    char buf[VGAStream::COLS + 1];
+    uint y = 0;
+
+    put_row(cs, y++, "Welcome to the interactive VM manager!", color);
+    put_row(cs, y++, "", color);
+    put_row(cs, y++, "VM configurations:", color);
+    for(auto it = configs.begin(); it != configs.end() && y < VGAStream::ROWS - 4; ++it) {
+        OStringStream os(buf, sizeof(buf));
+        os << "  [" << (it->no() + 1) << "] " << it->name();
+        put_row(cs, y++, buf, color);
+    }
+    put_row(cs, y++, "", color);
+    put_row(cs, y++, "Running VMs:", color);
+
+    // keep the selected VM visible
+    size_t count = vml.count();
+    size_t rows = VGAStream::ROWS - 2 - y;
+    if(vmidx >= count)
+        vmidx = count > 0 ? count - 1 : 0;
+    if(vmidx < vmtop)
+        vmtop = vmidx;
+    else if(vmidx >= vmtop + rows)
+        vmtop = vmidx - rows + 1;
+
+    // take a copy, because the VMs might vanish at any time
+    VMControl::VMInfo infos[VGAStream::ROWS];
+    size_t n = vml.info(cm, vmtop, infos, rows);
+    for(size_t i = 0; i < rows; ++i) {
+        buf[0] = '\0';
+        if(i < n) {
+            OStringStream os(buf, sizeof(buf));
+            const VMConfig *cfg = config(infos[i].config);
+            os << "  [" << infos[i].console << "] ID:" << infos[i].id << " CPU:" << infos[i].cpu
+               << " MEM:" << (infos[i].mem / 1024) << "K CFG:" << (cfg ? cfg->name() : "?");
         }
+        put_row(cs, y++, buf, i < n && vmidx == vmtop + i ? CUR_ROW_COLOR : color);
+    }
+    put_row(cs, y++, "", color);
+    put_row(cs, y++, "Press R to reset or K to kill the selected VM", color);
+    cs.color(color);
+}
+
+static void handle_exit(const ChildManager::ExitInfo &info) {
+    static const char *reasons[] = {"exited", "faulted", "has been killed", "timed out"};
+    RunningVMList &vml = RunningVMList::get();
+    RunningVMList::Removed rem;
+    // a clean exit of the guest is no crash, even if nobody asked for it
+    bool failed = info.reason != ChildManager::EXITED || info.code != 0;
+    if(!vml.remove(info.id, failed, &rem))
+        return;
+
+    Serial::get() << "VM " << info.id << " (" << rem.cfg->name() << ") " << reasons[info.reason]
+                  << " (code " << info.code << "); removed after "
+                  << to_us(Util::tsc() - info.time) << "us\n";
+    if(rem.crashed && autorestart) {
+        try {
+            Child::id_type id = vml.add(cm, rem.cfg, rem.cpus);
+            Serial::get() << "VM " << info.id << " restarted as VM " << id << " after "
+                          << to_us(Util::tsc() - info.time) << "us\n";
+        }
+        catch(const Exception &e) {
+            Serial::get() << "Restart of VM " << info.id << " failed: " << e.msg() << "\n";
+        }
+    }
+}
+
+static void reaper_thread(void*) {
+    while(1) {
+        cm.dead_sm().down();
 
-        uint8_t oldcol = cs.color();
-        if(vmidx == i)
-            cs.color(CUR_ROW_COLOR);
-        size_t virt, phys;
-        c->reglist().memusage(virt, phys);
-        cs << "  [" << vm->console() << "] CPU:" << c->cpu() << " MEM:" << (phys / 1024);
-        cs << "K CFG:" << vm->cfg()->name();
-        while(cs.x() != 0)
-            cs << ' ';
-        if(vmidx == i)
-            cs.color(oldcol);
+        ChildManager::ExitInfo info;
+        bool lost;
+        while(cm.fetch_exit(info, lost)) {
+            if(lost)
+                RunningVMList::get().reap(cm);
+            handle_exit(info);
+        }
     }
-    cs << "\nPress R to reset or K to kill the selected VM";
 }
 
 static void input_thread(void*) {
@@ -92,7 +177,7 @@ static void input_thread(void*) {
                         ;
                     if(it != configs.end()) {
                         try {
-                            vml.add(cm, &*it, cpucyc.next()->log_id());
+                            vml.add(cm, &*it);
                         }
                         catch(const Exception &e) {
                             Serial::get() << "Start of '" << it->name() << "' failed: " << e.msg() << "\n";
@@ -103,40 +188,54 @@ static void input_thread(void*) {
             break;
 
             case Keyboard::VK_R: {
-                ScopedLock<UserSm> guard(&sm);
-                RunningVM *vm = vml.get(vmidx);
-                if(vm && (pk->flags & Keyboard::RELEASE))
-                    vm->execute(VMManager::RESET);
+                if(pk->flags & Keyboard::RELEASE) {
+                    Child::id_type id;
+                    {
+                        ScopedLock<UserSm> guard(&sm);
+                        id = vml.id_at(vmidx);
+                    }
+                    // execute() looks it up again, so it doesn't matter if it is gone by now
+                    if(id != ObjCap::INVALID) {
+                        try {
+                            vml.execute(id, VMManager::RESET);
+                        }
+                        catch(const Exception &e) {
+                            Serial::get() << "Reset of VM " << id << " failed: " << e.msg() << "\n";
+                        }
+                    }
+                }
             }
             break;
 
             case Keyboard::VK_UP:
                 if((~pk->flags & Keyboard::RELEASE) && vmidx > 0) {
                     vmidx--;
-                    refresh_console();
+                    refresh_sm.up();
                 }
                 break;
 
             case Keyboard::VK_DOWN:
-                if((~pk->flags & Keyboard::RELEASE) && vmidx < vml.count()) {
+                if((~pk->flags & Keyboard::RELEASE) && vmidx + 1 < vml.count()) {
                     vmidx++;
-                    refresh_console();
+                    refresh_sm.up();
                 }
                 break;
 
             case Keyboard::VK_K: {
                 if(pk->flags & Keyboard::RELEASE) {
-                    Child::id_type id = ObjCap::INVALID;
+                    Child::id_type id;
                     {
                         ScopedLock<UserSm> guard(&sm);
-                        RunningVM *vm = vml.get(vmidx);
-                        if(vm) {
-                            id = vm->id();
-                            vml.remove(vm);
+                        id = vml.id_at(vmidx);
+                    }
+                    if(id != ObjCap::INVALID) {
+                        try {
+                            vml.kill(cm, id);
+                        }
+                        catch(const Exception &e) {
+                            Serial::get() << "Kill of VM " << id << " failed: " << e.msg() << "\n";
                         }
                     }
-                    if(id != ObjCap::INVALID)
-                        cm.kill(id);
                 }
             }
             break;
@@ -146,30 +245,42 @@ static void input_thread(void*) {
 }
 
 static void refresh_thread(void*) {
-    TimerSession timer("timer");
-    Clock clock(1000);
     while(1) {
-        timevalue_t next = clock.source_time(1000);
         refresh_console();
 
-        // wait a second
-        timer.wait_until(next);
+        // wait until something changed, but at most REFRESH_INTERVAL to update the memory usage
+        refresh_sm.down(Util::tsc() + REFRESH_INTERVAL * Hip::get().freq_tsc);
     }
 }
 
-int main() {
+static void control_thread(void*) {
+    VMCtrlService::create("vmctrl", cm, configs)->start();
+}
+
+int main(int argc, char *argv[]) {
     const Hip &hip = Hip::get();
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "autorestart") == 0)
+            autorestart = true;
+    }
+    // we write only via VGAStream
+    cons.track_damage(true);
 
     for(auto mem = hip.mem_begin(); mem != hip.mem_end(); ++mem) {
         if(strstr(mem->cmdline(), ".vmconfig")) {
-            VMConfig *cfg = new VMConfig(mem->addr, mem->size, mem->cmdline());
+            VMConfig *cfg = new VMConfig(configs.length(), mem->addr, mem->size, mem->cmdline());
             configs.append(cfg);
             Serial::get() << *cfg << "\n";
         }
     }
 
+    RunningVMList::get().listen(&refresh_sm);
+    RunningVMList::get().placement(&placement);
+
+    GlobalThread::create(reaper_thread, CPU::current().log_id(), "vmmng-reaper")->start();
     GlobalThread::create(input_thread, CPU::current().log_id(), "vmmng-input")->start();
     GlobalThread::create(refresh_thread, CPU::current().log_id(), "vmmng-refresh")->start();
+    GlobalThread::create(control_thread, CPU::current().log_id(), "vmmng-ctrl")->start();
     VMMngService::create("vmmanager")->start();
     return 0;
 }
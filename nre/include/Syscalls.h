@@ -203,10 +203,15 @@ public:
      *
      * @param sm the capability selector for the Sm
      * @param op the operation (DOWN, ZERO or UP)
-     * @throws SyscallException if the system-call failed (result != E_SUCCESS)
+     * @param timeout for DOWN and ZERO: the TSC value at which to give up (0 = never)
+     * @throws SyscallException if the system-call failed (result != E_SUCCESS), which includes
+     *  E_TIMEOUT if the timeout has been reached
      */
-    static void sm_ctrl(capsel_t sm, SmOp op) {
-        SyscallABI::syscall(sm << 8 | SM_CTRL | op);
+    static void sm_ctrl(capsel_t sm, SmOp op, timevalue_t timeout = 0) {
+        if(timeout == 0)
+            SyscallABI::syscall(sm << 8 | SM_CTRL | op);
+        else
+            SyscallABI::syscall(sm << 8 | SM_CTRL | op, timeout >> 32, timeout & 0xFFFFFFFF);
     }
 
     /**
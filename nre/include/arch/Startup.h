@@ -27,6 +27,7 @@
 #define INIT_PRIO_CAPSPACE  INIT_PRIO_SYS(2)
 #define INIT_PRIO_LOGGING   INIT_PRIO_SYS(3)
 #define INIT_PRIO_RCU       INIT_PRIO_SYS(3)
+#define INIT_PRIO_LOCKSTATS INIT_PRIO_SYS(3)
 #define INIT_PRIO_CPUS      INIT_PRIO_SYS(4)
 #define INIT_PRIO_VMEM      INIT_PRIO_SYS(5)
 #define INIT_PRIO_PMEM      INIT_PRIO_SYS(6)
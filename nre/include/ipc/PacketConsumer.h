@@ -82,6 +82,44 @@ public:
         size_t len = (_if->buffer[_if->rpos] + 2 * sizeof(size_t) - 1) / sizeof(size_t);
         _if->rpos = (_if->rpos + len) % _max;
     }
+
+    /**
+     * Retrieves up to <max> packets, starting at the current position, without blocking. The
+     * packets stay in the ringbuffer until you call next(count), so that the producer will not
+     * touch them while you're working with them.
+     *
+     * @param buffers will be set to the packet-data
+     * @param lengths will be set to the packet-lengths
+     * @param max the maximum number of packets
+     * @return the number of packets
+     */
+    template<typename T>
+    size_t peek(T **buffers, size_t *lengths, size_t max) {
+        size_t count = 0;
+        size_t pos = _if->rpos;
+        while(count < max && pos != _if->wpos) {
+            if(_if->buffer[pos] == static_cast<size_t>(-1))
+                pos = 0;
+            buffers[count] = (T*)(_if->buffer + pos + 1);
+            lengths[count] = _if->buffer[pos];
+            pos = (pos + (lengths[count] + 2 * sizeof(size_t) - 1) / sizeof(size_t)) % _max;
+            count++;
+        }
+        return count;
+    }
+
+    /**
+     * Releases the next <count> packets, which you've received via peek().
+     *
+     * @param count the number of packets
+     */
+    void next(size_t count) {
+        while(count-- > 0) {
+            if(_if->buffer[_if->rpos] == static_cast<size_t>(-1))
+                _if->rpos = 0;
+            next();
+        }
+    }
 };
 
 }
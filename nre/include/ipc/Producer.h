@@ -72,8 +72,23 @@ public:
      * that new data is available
      */
     void next() {
+        advance();
+        notify();
+    }
+
+    /**
+     * Moves to the next slot without notifying the consumer. This way, multiple items can be
+     * produced with one notify() afterwards.
+     */
+    void advance() {
         _if->wpos = (_if->wpos + 1) & (_max - 1);
         Sync::memory_barrier();
+    }
+
+    /**
+     * Notifies the consumer that new data is available
+     */
+    void notify() {
         try {
             _sm.up();
         }
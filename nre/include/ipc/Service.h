@@ -19,7 +19,7 @@
 #include <kobj/LocalThread.h>
 #include <kobj/Pt.h>
 #include <kobj/Sm.h>
-#include <kobj/UserSm.h>
+#include <kobj/RWLock.h>
 #include <ipc/ServiceCPUHandler.h>
 #include <ipc/ServiceSession.h>
 #include <utcb/UtcbFrame.h>
@@ -59,7 +59,7 @@ class Service {
         }
 
     private:
-        virtual void call() {
+        virtual void call(ServiceSession *const *, size_t) {
             // call an empty portal with the session-Ec
             UtcbFrame uf;
             Pt(_s->get_thread(CPU::current().log_id()), cleanup_portal).call(uf);
@@ -69,7 +69,7 @@ class Service {
             obj->destroy();
         }
         virtual void destroy(ServiceSession *obj) {
-            ScopedLock<UserSm> guard(&_s->_sm);
+            ScopedWriteLock<RWLock> guard(&_s->_sm);
             if(obj->rem_ref())
                 delete obj;
         }
@@ -169,6 +169,12 @@ public:
     const char *name() const {
         return _name;
     }
+    /**
+     * @return the deleter for the sessions, e.g. to configure its latency target or to monitor it
+     */
+    ThreadedDeleter<ServiceSession> &deleter() {
+        return _deleter;
+    }
     /**
      * @return the portal-function
      */
@@ -187,10 +193,20 @@ public:
      * iterate over all sessions to prevent that the list is manipulated during that time.
      */
     void up() {
-        _sm.up();
+        _sm.up_write();
     }
     void down() {
-        _sm.down();
+        _sm.down_write();
+    }
+    /**
+     * The same for ScopedReadLock<Service>, which can be used if you only walk over the sessions
+     * and don't need to exclude other threads that do the same.
+     */
+    void up_read() {
+        _sm.up_read();
+    }
+    void down_read() {
+        _sm.down_read();
     }
 
     /**
@@ -217,7 +233,7 @@ public:
      */
     template<class T>
     Reference<T> get_session(size_t id) {
-        ScopedLock<UserSm> guard(&_sm);
+        ScopedReadLock<RWLock> guard(&_sm);
         T *sess = static_cast<T*>(_sessions.find(id));
         if(!sess)
             VTHROW(ServiceException, E_ARGS_INVALID, "Session " << id << " doesn't exist");
@@ -244,13 +260,13 @@ protected:
 
 private:
     Reference<ServiceSession> get_first() {
-        ScopedLock<UserSm> guard(&_sm);
+        ScopedReadLock<RWLock> guard(&_sm);
         if(_sessions.length() > 0)
             return Reference<ServiceSession>(&*_sessions.begin());
         return Reference<ServiceSession>();
     }
     Reference<ServiceSession> get_session_by_ident(capsel_t ident) {
-        ScopedLock<UserSm> guard(&_sm);
+        ScopedReadLock<RWLock> guard(&_sm);
         for(auto it = _sessions.begin(); it != _sessions.end(); ++it) {
             if(it->portal_caps() == ident)
                 return Reference<ServiceSession>(&*it);
@@ -284,7 +300,7 @@ private:
 
     size_t _next_id;
     capsel_t _regcaps;
-    UserSm _sm;
+    RWLock _sm;
     Sm _stop_sm;
     bool _stop;
     const char *_name;
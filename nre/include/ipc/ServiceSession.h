@@ -67,6 +67,13 @@ public:
     }
 
 protected:
+    /**
+     * Is called as soon as this session has been closed, i.e. removed from the sessions of the
+     * service. Since the destruction is deferred, this may be overwritten to make the session
+     * unreachable for others right away.
+     */
+    virtual void closed() {
+    }
     /**
      * Is called if this session should be destroyed. May be overwritten to give the session a
      * chance to do some cleanup or similar.
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <kobj/Sm.h>
+#include <kobj/UserSm.h>
+#include <util/Atomic.h>
+#include <Compiler.h>
+
+namespace nre {
+
+/**
+ * A reader-writer lock for read-mostly data structures. Readers only perform an atomic add, as
+ * long as no writer holds or waits for the lock, i.e. they don't enter the kernel in this case.
+ * Writers are serialized by a UserSm and have priority over readers: as soon as a writer announces
+ * itself, new readers block until it is done. The writer waits until the readers that were active
+ * at that point have left.
+ *
+ * To announce itself, the writer subtracts MAX_READERS from the reader count, so that a negative
+ * count tells readers that a writer is pending. The number of readers it has to wait for is kept
+ * separately in _departing.
+ */
+class RWLock {
+    static const long MAX_READERS   = 1L << 30;
+
+public:
+    /**
+     * Creates an unlocked reader-writer lock
+     */
+    explicit RWLock() : _wsm(), _readsm(0), _writesm(0), _readers(0), _departing(0) {
+    }
+
+    /**
+     * Acquires the lock for reading. Blocks if a writer holds the lock or waits for it.
+     */
+    void down_read() {
+        if(EXPECT_FALSE(Atomic::add(&_readers, +1) < 0))
+            _readsm.down();
+    }
+
+    /**
+     * Releases the lock for reading
+     */
+    void up_read() {
+        if(EXPECT_FALSE(Atomic::add(&_readers, -1) <= 0)) {
+            // a writer is pending. if we're the last one it waits for, wake it up
+            if(Atomic::add(&_departing, -1) == 1)
+                _writesm.up();
+        }
+    }
+
+    /**
+     * Acquires the lock for writing. Blocks until all readers and the previous writer are gone.
+     */
+    void down_write() {
+        _wsm.down();
+        long active = Atomic::add(&_readers, -MAX_READERS);
+        if(active != 0 && Atomic::add(&_departing, active) + active != 0)
+            _writesm.down();
+    }
+
+    /**
+     * Releases the lock for writing and lets the readers in that have blocked meanwhile
+     */
+    void up_write() {
+        long blocked = Atomic::add(&_readers, MAX_READERS) + MAX_READERS;
+        for(long i = 0; i < blocked; ++i)
+            _readsm.up();
+        _wsm.up();
+    }
+
+    /**
+     * The up-/down-implementation to allow ScopedLock<RWLock>, which acquires it for writing
+     */
+    void down() {
+        down_write();
+    }
+    void up() {
+        up_write();
+    }
+
+private:
+    RWLock(const RWLock&);
+    RWLock& operator=(const RWLock&);
+
+    UserSm _wsm;
+    Sm _readsm;
+    Sm _writesm;
+    volatile long _readers;
+    volatile long _departing;
+};
+
+}
@@ -35,7 +35,8 @@ public:
         ALLOC,
         CREATE,
         JOIN,
-        DESTROY
+        DESTROY,
+        MIGRATION
     };
 
     /**
@@ -51,6 +52,17 @@ public:
         return _qpd;
     }
 
+    /**
+     * Tells the load balancer of root whether this Sc may be moved to another CPU and asks whether
+     * it should be. Since the Ec is bound to its CPU, root can't move it. Instead, the thread has
+     * to create a new thread on the returned CPU and terminate itself. Therefore, only Scs that
+     * call this method are considered by the load balancer, all others stay on their CPU.
+     *
+     * @param migratable whether the Sc may be moved (false pins it to its CPU again)
+     * @return the CPU to move to (the current one, if it should stay)
+     */
+    cpu_t migration(bool migratable = true);
+
 private:
     /**
      * Binds this object to the given sc-selector for thread <gt>. This is intended for the main
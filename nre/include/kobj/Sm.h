@@ -70,6 +70,24 @@ public:
         Syscalls::sm_ctrl(sel(), Syscalls::SM_DOWN);
     }
 
+    /**
+     * Like down(), but gives up if nobody did an up() until the TSC reaches <timeout>.
+     *
+     * @param timeout the TSC value at which to give up (0 = never)
+     * @return false if the timeout has been reached
+     */
+    bool down(timevalue_t timeout) {
+        try {
+            Syscalls::sm_ctrl(sel(), Syscalls::SM_DOWN, timeout);
+            return true;
+        }
+        catch(const SyscallException &e) {
+            if(e.code() != E_TIMEOUT)
+                throw;
+            return false;
+        }
+    }
+
     /**
      * Performs a zero on this semaphore. That is, if the value of it is zero, it will block until
      * someone does an up(). Otherwise it will set the value to zero.
@@ -40,6 +40,8 @@ class Utcb;
 class Thread : public Ec, public SListItem, public RefCounted {
     friend class RCU;
     friend class RCULock;
+    friend class Trace;
+    friend class FuncProfiler;
 
     static const size_t TLS_SIZE    = 4;
 
@@ -150,6 +152,8 @@ private:
                            uintptr_t &stack, uint &flags);
 
     uint32_t _rcu_counter;
+    void *_trace;
+    void *_profile;
     uintptr_t _utcb_addr;
     uintptr_t _stack_addr;
     uint _flags;
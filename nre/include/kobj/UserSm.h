@@ -17,30 +17,73 @@
 #pragma once
 
 #include <kobj/Sm.h>
+#include <kobj/Thread.h>
 #include <util/Atomic.h>
+#include <Compiler.h>
 
 namespace nre {
 
+class LockStats;
+
 /**
- * A user semaphore optimized for the case where we do not block.
+ * A user semaphore optimized for the case where we do not block. If it is not available, we spin
+ * for a while before we block on the kernel semaphore, as long as the last one that acquired it
+ * runs on a different CPU. Since most critical sections are much shorter than blocking and waking
+ * up, this saves the kernel round trip in most cases. The number of spins is adjusted depending
+ * on whether spinning has been successful the last time.
  */
 class UserSm {
+    static const cpu_t NO_OWNER     = static_cast<cpu_t>(-1);
+
 public:
+    static const uint MIN_SPINS     = 16;
+    static const uint MAX_SPINS     = 4096;
+
     /**
      * Creates a user semaphore.
      *
      * @param initial the initial value for the semaphore (default 1)
      */
-    explicit UserSm(uint initial = 1) : _sem(0), _value(initial) {
+    explicit UserSm(uint initial = 1)
+        : _sem(0), _value(initial), _owner(NO_OWNER), _spins(MIN_SPINS), _stats() {
+    }
+
+    /**
+     * @return the contention statistics (nullptr if not enabled)
+     */
+    LockStats *stats() const {
+        return _stats;
+    }
+    /**
+     * Enables the collection of contention statistics in <stats>. By default, they are disabled.
+     *
+     * @param stats the statistics object (not copied; nullptr to disable it again)
+     */
+    void stats(LockStats *stats) {
+        _stats = stats;
+    }
+
+    /**
+     * Decreases the value, if it is greater than zero.
+     *
+     * @return true if the value has been decreased, i.e. if we've got the semaphore
+     */
+    bool try_down() {
+        if(!decrease())
+            return false;
+        acquired(false, false, 0);
+        return true;
     }
 
     /**
-     * Performs a down on this semaphore. That is, if the value is zero, it blocks on the associated
-     * kernel semaphore. If not, it decreases the value.
+     * Performs a down on this semaphore. That is, if the value is zero, it spins for a while
+     * and blocks on the associated kernel semaphore afterwards. If not, it decreases the value.
      */
     void down() {
-        if(Atomic::add(&_value, -1) <= 0)
-            _sem.down();
+        if(EXPECT_FALSE(!decrease()))
+            down_slow();
+        else
+            acquired(false, false, 0);
     }
 
     /**
@@ -53,8 +96,32 @@ public:
     }
 
 private:
+    bool decrease() {
+        long val = _value;
+        while(val > 0) {
+            if(Atomic::cmpnswap(&_value, val, val - 1))
+                return true;
+            val = _value;
+        }
+        return false;
+    }
+    void acquired(bool contended, bool blocked, timevalue_t waited) {
+        Thread *t = ExecEnv::get_current_thread();
+        _owner = t ? t->cpu() : NO_OWNER;
+        if(EXPECT_FALSE(_stats))
+            account(contended, blocked, waited);
+    }
+    void account(bool contended, bool blocked, timevalue_t waited);
+    void down_slow();
+
+    UserSm(const UserSm&);
+    UserSm& operator=(const UserSm&);
+
     Sm _sem;
-    long _value;
+    volatile long _value;
+    volatile cpu_t _owner;
+    uint _spins;
+    LockStats *_stats;
 };
 
 }
@@ -21,6 +21,7 @@
 #include <mem/DataSpace.h>
 #include <utcb/UtcbFrame.h>
 #include <util/BDF.h>
+#include <cstring>
 
 namespace nre {
 
@@ -33,11 +34,30 @@ public:
      * The available commands
      */
     enum Command {
-        FIND_TABLE,
-        IRQ_TO_GSI,
-        GET_GSI,
+        GET_TABLES,
+        GET_ROUTING,
     };
 
+    /**
+     * The number of ISA IRQs, for which interrupt source overrides are precomputed
+     */
+    static const uint ISA_IRQS  = 16;
+
+    /**
+     * Root system description pointer
+     */
+    struct RSDP {
+        uint32_t signature[2];
+        uint8_t checksum;
+        char oemId[6];
+        uint8_t revision;
+        uint32_t rsdtAddr;
+        // since 2.0
+        uint32_t length;
+        uint64_t xsdtAddr;
+        uint8_t xchecksum;
+    } PACKED;
+
     /**
      * Root system descriptor table
      */
@@ -53,6 +73,226 @@ public:
         uint32_t creatorRevision;
     } PACKED;
 
+    /**
+     * APIC Structure (5.2.11.4)
+     */
+    struct APIC {
+        enum Type {
+            LAPIC = 0, IOAPIC = 1, INTR = 2,
+        };
+        uint8_t type;
+        uint8_t length;
+    } PACKED;
+
+    /**
+     * Interrupt Source Override (5.2.11.8)
+     */
+    struct APICIntr : public APIC {
+        uint8_t bus;
+        uint8_t irq;
+        uint32_t gsi;
+        uint16_t flags;
+    } PACKED;
+
+    /**
+     * Multiple APIC Description Table
+     */
+    struct MADT : public RSDT {
+        uint32_t apic_addr;
+        uint32_t flags;
+        APIC apic[];
+    } PACKED;
+
+    /**
+     * An entry in the index of a TableSet
+     */
+    struct TableEntry {
+        char signature[4];
+        uint32_t instance;
+        // relative to the beginning of the TableSet
+        uint32_t offset;
+        uint32_t length;
+    } PACKED;
+
+    /**
+     * All ACPI tables of the system, as exported by the ACPI service in one read-only dataspace.
+     * The tables have been verified by the service and are indexed by signature and instance.
+     * The index is followed by the tables themselves.
+     */
+    struct TableSet {
+        static const uint32_t MAGIC = 0x54504341;   // "ACPT"
+
+        uint32_t magic;
+        uint32_t size;
+        uint32_t count;
+        // the GSI for each ISA IRQ, taking the interrupt source overrides of the MADT into account
+        uint32_t isa_gsi[ISA_IRQS];
+        // sorted by signature and instance
+        TableEntry entries[];
+
+        /**
+         * Finds the table with given name
+         *
+         * @param name the name of the table
+         * @param instance the instance (0 = the first one, 1 = the second, ...)
+         * @return the table or nullptr if it doesn't exist
+         */
+        const RSDT *find(const char *name, uint instance = 0) const {
+            size_t lo = 0, hi = count;
+            while(lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                const TableEntry *e = entries + mid;
+                int res = memcmp(e->signature, name, 4);
+                if(res == 0)
+                    res = e->instance < instance ? -1 : e->instance > instance ? 1 : 0;
+                if(res == 0) {
+                    uintptr_t addr = reinterpret_cast<uintptr_t>(this) + e->offset;
+                    return reinterpret_cast<const RSDT*>(addr);
+                }
+                if(res < 0)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return nullptr;
+        }
+
+        /**
+         * Determines the GSI that corresponds to the given ISA IRQ. IRQs without an interrupt
+         * source override are assumed to be identity mapped.
+         *
+         * @param irq the ISA IRQ
+         * @return the GSI
+         */
+        uint irq_to_gsi(uint irq) const {
+            return irq < ISA_IRQS ? isa_gsi[irq] : irq;
+        }
+    } PACKED;
+
+    /**
+     * A slot in the RoutingTable
+     */
+    struct Route {
+        uint64_t key;
+        uint32_t gsi;
+        uint32_t used;
+    } PACKED;
+
+    /**
+     * The PCI interrupt routing, i.e. the GSI for each (parent, device, pin) triple, as found in
+     * the _PRT objects of the DSDT and SSDTs. It is a hash table with open addressing, which is
+     * built once by the ACPI service and exported in one read-only dataspace.
+     */
+    struct RoutingTable {
+        static const uint32_t MAGIC = 0x54525041;   // "APRT"
+
+        uint32_t magic;
+        // the number of slots (a power of 2)
+        uint32_t slots;
+        uint32_t count;
+        uint32_t reserved;
+        Route routes[];
+
+        /**
+         * @param count the number of routes
+         * @return the number of slots to use for <count> routes
+         */
+        static size_t slots_for(size_t count) {
+            size_t slots = 16;
+            while(slots < count * 2)
+                slots *= 2;
+            return slots;
+        }
+        /**
+         * @return the number of bytes for a table with <slots> slots
+         */
+        static size_t size(size_t slots) {
+            return sizeof(RoutingTable) + slots * sizeof(Route);
+        }
+
+        /**
+         * Initializes an empty table with <slots> slots
+         */
+        void init(size_t slots) {
+            magic = MAGIC;
+            this->slots = slots;
+            count = 0;
+            reserved = 0;
+            memset(routes, 0, slots * sizeof(Route));
+        }
+
+        /**
+         * Adds the given route, if there is none for that triple yet
+         *
+         * @param parent the device that has the _PRT object (e.g. the host bridge or a bridge)
+         * @param dev the device number behind <parent>
+         * @param pin the IRQ pin (0 = INTA, ...)
+         * @param gsi the GSI
+         * @return true if it has been added
+         */
+        bool add(BDF parent, uint dev, uint pin, uint gsi) {
+            uint64_t k = key(parent, dev, pin);
+            for(size_t i = hash(k);; i = (i + 1) & (slots - 1)) {
+                if(!routes[i].used) {
+                    if(count + 1 >= slots)
+                        return false;
+                    routes[i].key = k;
+                    routes[i].gsi = gsi;
+                    routes[i].used = 1;
+                    count++;
+                    return true;
+                }
+                if(routes[i].key == k)
+                    return false;
+            }
+        }
+
+        /**
+         * Searches for the route of the given triple
+         *
+         * @param gsi will be set to the GSI, if found
+         * @return true if found
+         */
+        bool find(BDF parent, uint dev, uint pin, uint &gsi) const {
+            uint64_t k = key(parent, dev, pin);
+            for(size_t i = hash(k); routes[i].used; i = (i + 1) & (slots - 1)) {
+                if(routes[i].key == k) {
+                    gsi = routes[i].gsi;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Determines the GSI of the device <bdf>, which is behind <parent>. If <parent> is a
+         * bridge on the root bus without routing information, the pin is swizzled according to
+         * the PCI-to-PCI bridge specification and the routing of the root bus is used.
+         *
+         * @param bdf the device
+         * @param pin the IRQ pin of the device (0 = INTA, ...)
+         * @param parent the parent device (the host bridge for devices on the root bus)
+         * @param gsi will be set to the GSI, if found
+         * @return true if found
+         */
+        bool get_gsi(BDF bdf, uint pin, BDF parent, uint &gsi) const {
+            if(find(parent, bdf.device(), pin, gsi))
+                return true;
+            BDF root(parent.value() & ~0xFFFFU);
+            if(parent.bus() == 0 && !(parent == root))
+                return find(root, parent.device(), (pin + bdf.device()) % 4, gsi);
+            return false;
+        }
+
+    private:
+        static uint64_t key(BDF parent, uint dev, uint pin) {
+            return (static_cast<uint64_t>(parent.value()) << 7) | ((dev & 0x1F) << 2) | (pin & 0x3);
+        }
+        size_t hash(uint64_t k) const {
+            return ((k * 0x9E3779B97F4A7C15ULL) >> 32) & (slots - 1);
+        }
+    } PACKED;
+
 private:
     ACPI();
 };
@@ -67,7 +307,34 @@ public:
      *
      * @param service the service name
      */
-    explicit ACPISession(const String &service) : PtClientSession(service) {
+    explicit ACPISession(const String &service) : PtClientSession(service), _ds(), _routing() {
+    }
+    /**
+     * Unmaps the tables, if necessary
+     */
+    virtual ~ACPISession() {
+        delete _routing;
+        delete _ds;
+    }
+
+    /**
+     * Requests the ACPI tables from the service, if not already done. Afterwards, all lookups are
+     * done locally.
+     *
+     * @return the ACPI tables
+     * @throws Exception if there is no ACPI
+     */
+    const ACPI::TableSet &tables() const {
+        if(!_ds) {
+            ScopedCapSels cap;
+            UtcbFrame uf;
+            uf.delegation_window(Crd(cap.get(), 0, Crd::OBJ_ALL));
+            uf << ACPI::GET_TABLES;
+            pt().call(uf);
+            uf.check_reply();
+            _ds = new DataSpace(cap.release());
+        }
+        return *reinterpret_cast<const ACPI::TableSet*>(_ds->virt());
     }
 
     /**
@@ -75,36 +342,47 @@ public:
      *
      * @param name the name of the table
      * @param instance the instance that is encountered (0 = the first one, 1 = the second, ...)
-     * @return a dataspace that contains the table
+     * @return the table, which stays valid as long as this session exists
      * @throws Exception if the table doesn't exist
      */
-    DataSpace find_table(const String &name, uint instance = 0) const {
-        ScopedCapSels cap;
-        UtcbFrame uf;
-        uf.delegation_window(Crd(cap.get(), 0, Crd::OBJ_ALL));
-        uf << ACPI::FIND_TABLE << name << instance;
-        pt().call(uf);
-        uf.check_reply();
-        return DataSpace(cap.release());
+    const ACPI::RSDT *find_table(const char *name, uint instance = 0) const {
+        const ACPI::RSDT *tbl = tables().find(name, instance);
+        if(!tbl)
+            VTHROW(Exception, E_NOT_FOUND,
+                   "Unable to find ACPI table '" << name << "' #" << instance);
+        return tbl;
     }
 
     /**
-     * Determines the GSI that corresponds to the given ISA IRQ. If the MADT is present, it will
-     * be searched for an interrupt source override entry for that IRQ. If not found or MADT
+     * Determines the GSI that corresponds to the given ISA IRQ. If the MADT is present, it has
+     * been searched for an interrupt source override entry for that IRQ. If not found or MADT
      * is not present, it will be assumed that the IRQ is identity mapped to the GSI.
      *
      * @param irq the ISA IRQ
      * @return the GSI
      */
     uint irq_to_gsi(uint irq) const {
-        UtcbFrame uf;
-        uf << ACPI::IRQ_TO_GSI << irq;
-        pt().call(uf);
+        return tables().irq_to_gsi(irq);
+    }
 
-        uf.check_reply();
-        uint gsi;
-        uf >> gsi;
-        return gsi;
+    /**
+     * Requests the PCI interrupt routing from the service, if not already done. Afterwards, all
+     * lookups are done locally.
+     *
+     * @return the routing table
+     * @throws Exception if there is no ACPI
+     */
+    const ACPI::RoutingTable &routing() const {
+        if(!_routing) {
+            ScopedCapSels cap;
+            UtcbFrame uf;
+            uf.delegation_window(Crd(cap.get(), 0, Crd::OBJ_ALL));
+            uf << ACPI::GET_ROUTING;
+            pt().call(uf);
+            uf.check_reply();
+            _routing = new DataSpace(cap.release());
+        }
+        return *reinterpret_cast<const ACPI::RoutingTable*>(_routing->virt());
     }
 
     /**
@@ -114,17 +392,23 @@ public:
      * @param pin the IRQ pin of the device
      * @param parent_bdf the bus-device-function triple of the parent device (e.g. bridge)
      * @return the GSI
+     * @throws Exception if not found
      */
     uint get_gsi(BDF bdf, uint8_t pin, BDF parent_bdf) const {
-        UtcbFrame uf;
-        uf << ACPI::GET_GSI << bdf << pin << parent_bdf;
-        pt().call(uf);
-
-        uf.check_reply();
         uint gsi;
-        uf >> gsi;
+        if(!routing().get_gsi(bdf, pin, parent_bdf, gsi)) {
+            VTHROW(Exception, E_NOT_FOUND,
+                   "Unable to find GSI for " << bdf << " parent " << parent_bdf << " pin " << pin);
+        }
         return gsi;
     }
+
+private:
+    ACPISession(const ACPISession&);
+    ACPISession& operator=(const ACPISession&);
+
+    mutable DataSpace *_ds;
+    mutable DataSpace *_routing;
 };
 
 }
@@ -20,7 +20,10 @@
 #include <ipc/ClientSession.h>
 #include <ipc/Consumer.h>
 #include <mem/DataSpace.h>
+#include <util/ScopedCapSels.h>
 #include <util/ScopedPtr.h>
+#include <util/Atomic.h>
+#include <util/Math.h>
 
 namespace nre {
 
@@ -43,7 +46,8 @@ public:
         GET_REGS,
         SET_REGS,
         GET_MODEINFO,
-        SET_MODE
+        SET_MODE,
+        GET_STATS
     };
 
     /**
@@ -111,6 +115,35 @@ public:
         size_t offset;
     };
 
+    /**
+     * The damage area, which is shared between the client and the console. The client marks the
+     * parts of its screen buffer that it has changed and the console copies only these to the
+     * screen, as long as the screen is refreshed from the buffer (i.e. while the console tag is
+     * shown). If the client does not enable the tracking, the whole buffer is copied periodically.
+     */
+    struct Damage {
+        static const size_t WORDS       = (ExecEnv::PAGE_SIZE - sizeof(word_t) * 3) / sizeof(word_t);
+        static const size_t ROWS        = WORDS * sizeof(word_t) * 8;
+        static const size_t MIN_ROW     = 64;
+
+        // whether the client marks all changes
+        volatile word_t enabled;
+        // the number of bytes in the screen buffer that are covered by one bit; a power of 2
+        volatile word_t row_size;
+        // set by the client when it has marked something and notified the console about it
+        volatile word_t pending;
+        // the bitmap of changed rows (only changed atomically)
+        word_t rows[WORDS];
+    };
+
+    /**
+     * Statistics about the refreshs of the screen from the buffer of a session
+     */
+    struct Stats {
+        uint64_t refreshs;
+        uint64_t bytes;
+    };
+
     /**
      * A packet that we receive from the console
      */
@@ -127,6 +160,7 @@ public:
  */
 class ConsoleSession : public ClientSession {
     static const size_t IN_DS_SIZE      = ExecEnv::PAGE_SIZE;
+    static const size_t DAMAGE_DS_SIZE  = ExecEnv::PAGE_SIZE;
 
 public:
     /**
@@ -144,10 +178,15 @@ public:
         : ClientSession(service, build_args(console, mode, title)),
           _in_ds(IN_DS_SIZE, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW),
           _out_ds(new DataSpace(size, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW)), _sm(0),
-          _consumer(_in_ds, _sm, true) {
+          _consumer(_in_ds, _sm, true),
+          _dmg_ds(DAMAGE_DS_SIZE, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW), _notify() {
+        damage_area()->row_size = row_size(size);
         create();
     }
     virtual ~ConsoleSession() {
+        capsel_t notify = _notify->sel();
+        delete _notify;
+        CapSelSpace::get().free(notify);
         delete _out_ds;
     }
 
@@ -160,6 +199,7 @@ public:
      */
     void set_mode(size_t mode, size_t size) {
         ScopedPtr<DataSpace> out_ds(new DataSpace(size, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW));
+        damage_area()->row_size = row_size(size);
         UtcbFrame uf;
         uf << Console::SET_MODE << mode;
         uf.delegate(out_ds->sel());
@@ -221,6 +261,59 @@ public:
         uf.check_reply();
     }
 
+    /**
+     * Enables or disables the damage tracking. If enabled, the client promises to call damage()
+     * for all changes of the screen memory. VGAStream does that automatically. Without it, the
+     * console periodically copies the whole buffer while it refreshes the screen from it.
+     *
+     * @param enabled whether to enable it
+     */
+    void track_damage(bool enabled) {
+        Console::Damage *dmg = damage_area();
+        dmg->enabled = enabled;
+        // let the console copy everything we did so far
+        if(enabled)
+            damage(0, _out_ds->size());
+    }
+
+    /**
+     * Marks the range <offset> .. <offset> + <size> in the screen memory as changed and notifies
+     * the console, if it has not already been notified.
+     *
+     * @param offset the offset in the screen memory
+     * @param size the number of bytes
+     */
+    void damage(size_t offset, size_t size) {
+        Console::Damage *dmg = damage_area();
+        if(!dmg->enabled || size == 0)
+            return;
+        size_t first = offset / dmg->row_size;
+        size_t last = Math::min<size_t>((offset + size - 1) / dmg->row_size, Console::Damage::ROWS - 1);
+        for(size_t r = first; r <= last; ++r) {
+            word_t bit = static_cast<word_t>(1) << (r % (sizeof(word_t) * 8));
+            word_t *word = dmg->rows + r / (sizeof(word_t) * 8);
+            if(~*word & bit)
+                Atomic::bit_or(word, bit);
+        }
+        if(!dmg->pending && Atomic::cmpnswap(&dmg->pending, 0, 1))
+            _notify->up();
+    }
+
+    /**
+     * Requests the statistics about the refreshs from our screen buffer
+     *
+     * @return the statistics
+     */
+    Console::Stats get_stats() {
+        UtcbFrame uf;
+        uf << Console::GET_STATS;
+        Pt(caps() + CPU::current().log_id()).call(uf);
+        uf.check_reply();
+        Console::Stats stats;
+        uf >> stats;
+        return stats;
+    }
+
     /**
      * @return the consumer to receive packets from the console
      */
@@ -244,14 +337,26 @@ public:
     }
 
 private:
+    Console::Damage *damage_area() {
+        return reinterpret_cast<Console::Damage*>(_dmg_ds.virt());
+    }
+    static size_t row_size(size_t size) {
+        return Math::max(Console::Damage::MIN_ROW,
+                         Math::next_pow2((size + Console::Damage::ROWS - 1) / Console::Damage::ROWS));
+    }
+
     void create() {
+        ScopedCapSels cap;
         UtcbFrame uf;
+        uf.delegation_window(Crd(cap.get(), 0, Crd::OBJ_ALL));
         uf << Console::CREATE;
         uf.delegate(_in_ds.sel(), 0);
         uf.delegate(_out_ds->sel(), 1);
         uf.delegate(_sm.sel(), 2);
+        uf.delegate(_dmg_ds.sel(), 3);
         Pt(caps() + CPU::current().log_id()).call(uf);
         uf.check_reply();
+        _notify = new Sm(cap.release(), false);
     }
 
     static String build_args(size_t console, size_t mode, const String &title) {
@@ -264,6 +369,8 @@ private:
     DataSpace *_out_ds;
     Sm _sm;
     Consumer<Console::ReceivePacket> _consumer;
+    DataSpace _dmg_ds;
+    Sm *_notify;
 };
 
 }
@@ -34,7 +34,10 @@ public:
      */
     enum Command {
         REBOOT,
-        SHARE_DS
+        SHARE_DS,
+        FOCUS,
+        ADD_HOTKEY,
+        GET_DROPPED
     };
 
     /**
@@ -183,7 +186,10 @@ private:
 };
 
 /**
- * Represents a session at the keyboard service
+ * Represents a session at the keyboard service. The service delivers the keyboard events only to
+ * the session that requested the focus most recently. Other sessions can register hot-keys to
+ * receive specific events regardless of the focus. If the ring of a session is full, new events
+ * are dropped.
  */
 class KeyboardSession : public PtClientSession {
     static const size_t DS_SIZE = ExecEnv::PAGE_SIZE;
@@ -193,11 +199,15 @@ public:
      * Creates a new session at given service
      *
      * @param service the service name
+     * @param focus whether to request the focus. by default, the session doesn't take the focus
+     *  away from the session that has it, i.e. it has to call focus() explicitly.
      */
-    explicit KeyboardSession(const String &service)
+    explicit KeyboardSession(const String &service, bool focus = false)
         : PtClientSession(service), _ds(DS_SIZE, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW), _sm(0),
           _consumer(_ds, _sm, true) {
         share();
+        if(focus)
+            this->focus();
     }
 
     /**
@@ -222,6 +232,44 @@ public:
         return res;
     }
 
+    /**
+     * Requests the focus, i.e. all following keyboard events are delivered to this session until
+     * another session requests the focus.
+     */
+    void focus() {
+        UtcbFrame uf;
+        uf << Keyboard::FOCUS;
+        pt().call(uf);
+        uf.check_reply();
+    }
+
+    /**
+     * Registers a hot-key. That is, the events for <keycode> are delivered to this session even if
+     * it does not have the focus, as long as all <flags> are set.
+     *
+     * @param keycode the keycode
+     * @param flags the flags (e.g. modifiers) that have to be set
+     */
+    void add_hotkey(Keyboard::keycode_t keycode, uint flags = 0) {
+        UtcbFrame uf;
+        uf << Keyboard::ADD_HOTKEY << keycode << flags;
+        pt().call(uf);
+        uf.check_reply();
+    }
+
+    /**
+     * @return the number of events that have been dropped, because our ring was full
+     */
+    ulong dropped() {
+        UtcbFrame uf;
+        uf << Keyboard::GET_DROPPED;
+        pt().call(uf);
+        uf.check_reply();
+        ulong count;
+        uf >> count;
+        return count;
+    }
+
     /**
      * Trys to reboot the PC with the keyboard
      */
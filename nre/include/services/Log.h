@@ -17,13 +17,70 @@
 #pragma once
 
 #include <ipc/PtClientSession.h>
+#include <ipc/Producer.h>
+#include <mem/DataSpace.h>
 #include <utcb/UtcbFrame.h>
+#include <kobj/UserSm.h>
 #include <kobj/Pt.h>
+#include <util/ScopedLock.h>
+#include <util/Math.h>
+#include <util/Util.h>
+#include <CPU.h>
 
 namespace nre {
 
 /**
- * Represents a session at the log-service
+ * Types for the log service
+ */
+class LogRing {
+public:
+    /**
+     * The size of the ring of a session
+     */
+    static const size_t SIZE            = 64 * 1024;
+    /**
+     * The maximum number of characters per record
+     */
+    static const size_t MAX_LINE_LEN    = 120;
+
+    /**
+     * The available commands
+     */
+    enum Command {
+        WRITE,
+        GET_RING,
+    };
+
+    enum Severity {
+        INFO,
+        WARNING,
+        ERROR,
+    };
+
+    /**
+     * A line in the ring
+     */
+    struct Record {
+        // the TSC value when the line has been written
+        uint64_t tsc;
+        // the number of records that have been dropped before this one, because the ring was full
+        uint32_t dropped;
+        uint16_t cpu;
+        uint8_t severity;
+        uint8_t len;
+        char line[MAX_LINE_LEN];
+    };
+
+private:
+    LogRing();
+};
+
+/**
+ * Represents a session at the log-service. The lines are put into a ring in shared memory, which is
+ * drained asynchronously by the service. If the service does not keep up, lines are dropped
+ * instead of blocking the writer; the next line that fits into the ring carries the number of
+ * dropped lines. If the ring is not available (e.g., because the dataspace can't be joined), the
+ * lines are sent via portal calls.
  */
 class LogSession : public PtClientSession {
 public:
@@ -33,20 +90,114 @@ public:
      * @param service the service name
      * @param name the program name
      */
-    explicit LogSession(const String &service, const String &name) : PtClientSession(service, name) {
+    explicit LogSession(const String &service, const String &name)
+        : PtClientSession(service, name), _sm(), _ds(), _ringsm(), _smsel(ObjCap::INVALID),
+          _prod(), _dropped(), _total_dropped(), _written() {
+        init_ring();
+    }
+    ~LogSession() {
+        delete _prod;
+        delete _ringsm;
+        delete _ds;
+        if(_smsel != ObjCap::INVALID) {
+            Syscalls::revoke(Crd(_smsel, 0, Crd::OBJ_ALL), true);
+            CapSelSpace::get().free(_smsel);
+        }
+    }
+
+    /**
+     * @return the number of lines that have been dropped so far, because the ring was full
+     */
+    size_t dropped() const {
+        return _total_dropped;
+    }
+    /**
+     * @return the number of records that fit into the ring (0 if the portal is used instead)
+     */
+    size_t capacity() const {
+        return _prod ? _prod->rblength() - 1 : 0;
+    }
+    /**
+     * @return the number of lines that have been put into the ring so far
+     */
+    size_t written() const {
+        return _written;
     }
 
     /**
-     * Writes the given line to the log service. Note that the line should be short enough to fit
-     * into the Utcb!
+     * Writes the given line to the log service. Lines that are longer than LogRing::MAX_LINE_LEN
+     * are split into multiple records.
      *
      * @param line the line
+     * @param severity the severity of the line
      */
-    void write(const String &line) {
-        UtcbFrame uf;
-        uf << line;
-        pt().call(uf);
+    void write(const String &line, LogRing::Severity severity = LogRing::INFO) {
+        if(_prod) {
+            ScopedLock<UserSm> guard(&_sm);
+            size_t pos = 0;
+            do {
+                size_t amount = Math::min(line.length() - pos, LogRing::MAX_LINE_LEN);
+                put(line.str() + pos, amount, severity);
+                pos += amount;
+            }
+            while(pos < line.length());
+        }
+        else {
+            UtcbFrame uf;
+            uf << LogRing::WRITE << line << severity;
+            pt().call(uf);
+        }
+    }
+
+private:
+    void put(const char *str, size_t len, LogRing::Severity severity) {
+        LogRing::Record *rec = _prod->current();
+        if(!rec) {
+            _dropped++;
+            _total_dropped++;
+            return;
+        }
+        rec->tsc = Util::tsc();
+        rec->dropped = _dropped;
+        rec->cpu = CPU::current().log_id();
+        rec->severity = severity;
+        rec->len = len;
+        memcpy(rec->line, str, len);
+        _prod->next();
+        _dropped = 0;
+        _written++;
+    }
+
+    void init_ring() {
+        try {
+            ScopedCapSels caps(2, 2);
+            UtcbFrame uf;
+            uf.delegation_window(Crd(caps.get(), 1, Crd::OBJ_ALL));
+            uf << LogRing::GET_RING;
+            pt().call(uf);
+            uf.check_reply();
+            // the dataspace takes over its selector as soon as it exists. the Sm does not free its
+            // selector, so we do that ourselves
+            _ds = new DataSpace(caps.get());
+            _smsel = caps.release() + 1;
+            _ringsm = new Sm(_smsel, true);
+            _prod = new Producer<LogRing::Record>(*_ds, *_ringsm, false);
+        }
+        catch(const Exception&) {
+            // fall back to portal calls
+            delete _ds;
+            _ds = nullptr;
+        }
     }
+
+    UserSm _sm;
+    DataSpace *_ds;
+    Sm *_ringsm;
+    capsel_t _smsel;
+    Producer<LogRing::Record> *_prod;
+    uint32_t _dropped;
+    size_t _total_dropped;
+    size_t _written;
 };
 
 }
@@ -29,7 +29,22 @@ namespace nre {
 class Mouse {
 public:
     /**
-     * A packet that we receive from the service
+     * The bits in the status of a packet
+     */
+    enum Status {
+        BUTTONS         = 0x07,
+        X_SIGN          = 1 << 4,
+        Y_SIGN          = 1 << 5,
+        X_OVERFLOW      = 1 << 6,
+        Y_OVERFLOW      = 1 << 7,
+    };
+
+    static const int MIN_DELTA  = -256;
+    static const int MAX_DELTA  = 255;
+
+    /**
+     * A packet that we receive from the service. The movement is encoded as 9-bit two's
+     * complement, with the sign bits in the status.
      */
     struct Packet {
         uint8_t status;
@@ -38,6 +53,27 @@ public:
         uint8_t z;
     };
 
+    /**
+     * @return the movement in x direction
+     */
+    static int delta_x(const Packet &pk) {
+        return pk.x - ((pk.status & X_SIGN) ? 256 : 0);
+    }
+    /**
+     * @return the movement in y direction
+     */
+    static int delta_y(const Packet &pk) {
+        return pk.y - ((pk.status & Y_SIGN) ? 256 : 0);
+    }
+    /**
+     * Sets the movement of <pk> to <x>,<y>, which have to be between MIN_DELTA and MAX_DELTA
+     */
+    static void set_delta(Packet &pk, int x, int y) {
+        pk.x = x & 0xFF;
+        pk.y = y & 0xFF;
+        pk.status = (pk.status & ~(X_SIGN | Y_SIGN)) | (x < 0 ? X_SIGN : 0) | (y < 0 ? Y_SIGN : 0);
+    }
+
 private:
     Mouse();
 };
@@ -22,6 +22,9 @@
 #include <ipc/PacketConsumer.h>
 #include <ipc/PacketProducer.h>
 #include <utcb/UtcbFrame.h>
+#include <util/Sync.h>
+#include <util/Util.h>
+#include <cstring>
 
 namespace nre {
 
@@ -31,6 +34,7 @@ namespace nre {
 class Network {
 public:
     static const size_t MAX_NICS            = 4;
+    static const size_t MAX_MACS            = 8;
 
     /**
      * The available commands
@@ -38,6 +42,9 @@ public:
     enum Command {
         INIT,
         GET_INFO,
+        ADD_MAC,
+        REMOVE_MAC,
+        GET_STATS,
     };
 
     /**
@@ -117,6 +124,43 @@ public:
         char name[64];
     };
 
+    /**
+     * The statistics of a session (used for GET_STATS)
+     */
+    struct Stats {
+        // the number of frames delivered to the session
+        uint64_t rx_packets;
+        // the number of frames for the session that were dropped because its ring was full
+        uint64_t rx_dropped;
+        // the number of frames the session has sent
+        uint64_t tx_packets;
+        // the number of frames of the session the NIC can't send
+        uint64_t tx_dropped;
+    };
+
+    /**
+     * The transmit progress of a session. The service reports it via the status dataspace after
+     * each batch of frames it has taken from the transmit ring.
+     */
+    struct TxStatus {
+        // the total number of frames that have been taken from the transmit ring
+        uint64_t completed;
+        // the total number of frames thereof that have been dropped, because the NIC can't send
+        // them (e.g., they are too large). if the NIC has no room, the frames are not dropped, but
+        // kept in the transmit ring, so that <completed> lags behind
+        uint64_t dropped;
+    };
+
+    /**
+     * The layout of the status dataspace. The service overwrites the status in place and <seq> is
+     * odd while it does so. Thus, the client always sees the latest status, no matter how long it
+     * hasn't looked at it.
+     */
+    struct TxStatusSlot {
+        uint32_t seq;
+        TxStatus status;
+    };
+
 private:
     Network();
 };
@@ -138,8 +182,11 @@ public:
                             size_t outbuf = 32 * 1024)
         : PtClientSession(service, build_args(id)),
           _inds(inbuf, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW), _insm(0),
-          _outds(outbuf, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW), _outsm(0),
-          _cons(_inds, _insm, true), _prod(_outds, _outsm, true) {
+          _outds(outbuf, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW),
+          _outsm(CapSelSpace::get().allocate(), true),
+          _statusds(ExecEnv::PAGE_SIZE, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW), _statussm(0),
+          _cons(_inds, _insm, true), _prod(_outds, _outsm, true),
+          _sent(), _txstatus() {
         init();
     }
 
@@ -158,6 +205,45 @@ public:
         return res;
     }
 
+    /**
+     * Registers the given unicast or multicast address for this session. As soon as a session
+     * has registered at least one address, it receives only the frames that are sent to one of
+     * its addresses and broadcast frames. Otherwise, it receives all frames.
+     *
+     * @param mac the address
+     */
+    void add_mac(const Network::EthernetAddr &mac) {
+        UtcbFrame uf;
+        uf << Network::ADD_MAC << mac;
+        pt().call(uf);
+        uf.check_reply();
+    }
+
+    /**
+     * Unregisters the given address.
+     *
+     * @param mac the address
+     */
+    void remove_mac(const Network::EthernetAddr &mac) {
+        UtcbFrame uf;
+        uf << Network::REMOVE_MAC << mac;
+        pt().call(uf);
+        uf.check_reply();
+    }
+
+    /**
+     * @return the statistics of this session
+     */
+    Network::Stats get_stats() {
+        Network::Stats res;
+        UtcbFrame uf;
+        uf << Network::GET_STATS;
+        pt().call(uf);
+        uf.check_reply();
+        uf >> res;
+        return res;
+    }
+
     /**
      * @return the dataspace for incoming packets
      */
@@ -179,23 +265,72 @@ public:
     }
 
     /**
-     * Sends the given packet.
+     * Sends the given packet. Note that the service sends the packets asynchronously. Use
+     * tx_status() or wait_tx() to find out whether they have been sent.
      *
      * @param buffer the packet
      * @param size the packet-size
-     * @return true if successfull
+     * @return true if successfull, false if the ring is full, i.e. the service has not caught up yet
      */
     bool send(const void *buffer, size_t size) {
-        return _prod.produce(buffer, size);
+        if(!_prod.produce(buffer, size))
+            return false;
+        _sent++;
+        return true;
+    }
+
+    /**
+     * @return the latest transmit progress reported by the service
+     */
+    const Network::TxStatus &tx_status() {
+        const volatile Network::TxStatusSlot *slot =
+            reinterpret_cast<const volatile Network::TxStatusSlot*>(_statusds.virt());
+        while(true) {
+            uint32_t seq = slot->seq;
+            if(seq & 1) {
+                Util::pause();
+                continue;
+            }
+            Sync::memory_barrier();
+            _txstatus.completed = slot->status.completed;
+            _txstatus.dropped = slot->status.dropped;
+            Sync::memory_barrier();
+            if(slot->seq == seq)
+                return _txstatus;
+        }
+    }
+
+    /**
+     * @return the number of packets that have been passed to send(), but have not been processed
+     *  by the service yet
+     */
+    size_t in_flight() {
+        return _sent - tx_status().completed;
+    }
+
+    /**
+     * Blocks until at most <max> packets are in flight. This allows clients to pace themselves
+     * according to the speed of the NIC.
+     *
+     * @param max the maximum number of packets in flight
+     */
+    void wait_tx(size_t max = 0) {
+        // the service ups the semaphore after every update of the status
+        while(in_flight() > max)
+            _statussm.zero();
     }
 
 private:
     void init() {
+        memset(reinterpret_cast<void*>(_statusds.virt()), 0, sizeof(Network::TxStatusSlot));
         UtcbFrame uf;
         uf.delegate(_outds.sel(), 0);
-        uf.delegate(_outsm.sel(), 1);
-        uf.delegate(_inds.sel(), 2);
-        uf.delegate(_insm.sel(), 3);
+        uf.delegate(_inds.sel(), 1);
+        uf.delegate(_insm.sel(), 2);
+        uf.delegate(_statusds.sel(), 3);
+        uf.delegate(_statussm.sel(), 4);
+        // we get the semaphore to notify the service about new packets
+        uf.delegation_window(Crd(_outsm.sel(), 0, Crd::OBJ_ALL));
         uf << Network::INIT;
         pt().call(uf);
         uf.check_reply();
@@ -211,8 +346,12 @@ private:
     Sm _insm;
     DataSpace _outds;
     Sm _outsm;
+    DataSpace _statusds;
+    Sm _statussm;
     PacketConsumer _cons;
     PacketProducer _prod;
+    uint64_t _sent;
+    Network::TxStatus _txstatus;
 };
 
 }
@@ -18,7 +18,10 @@
 
 #include <arch/Types.h>
 #include <ipc/PtClientSession.h>
+#include <mem/DataSpace.h>
 #include <utcb/UtcbFrame.h>
+#include <util/ScopedCapSels.h>
+#include <util/Math.h>
 #include <util/BDF.h>
 
 namespace nre {
@@ -30,6 +33,64 @@ class PCIConfig {
 public:
     typedef uint32_t value_type;
 
+    // the number of dwords in the standard header
+    static const size_t HEADER_DWORDS   = 16;
+    // the maximum number of capabilities that are recorded per device
+    static const size_t MAX_CAPS        = 16;
+    // the maximum number of dwords that can be read with one READ_BLOCK
+    static const size_t MAX_BLOCK       = 64;
+
+    /**
+     * A capability of a device. Legacy capabilities have an offset below 0x100, extended ones
+     * an offset above.
+     */
+    struct Cap {
+        uint16_t id;
+        uint16_t offset;
+    };
+
+    /**
+     * The properties of a device as recorded by the service during enumeration. Note that the
+     * header is not updated afterwards, i.e. only the static parts of it should be used.
+     */
+    struct Device {
+        BDF bdf;
+        value_type header[HEADER_DWORDS];
+        size_t capcount;
+        Cap caps[MAX_CAPS];
+
+        uint16_t vendor() const {
+            return header[0] & 0xFFFF;
+        }
+        uint16_t device() const {
+            return header[0] >> 16;
+        }
+        uint8_t theclass() const {
+            return header[2] >> 24;
+        }
+        uint8_t subclass() const {
+            return (header[2] >> 16) & 0xFF;
+        }
+        uint8_t header_type() const {
+            return (header[3] >> 16) & 0x7F;
+        }
+        bool multifunc() const {
+            return header[3] & 0x800000;
+        }
+        /**
+         * @param id the capability id
+         * @param extended whether to search for an extended capability
+         * @return the offset of the capability in bytes (0 if not present)
+         */
+        size_t find_cap(uint id, bool extended) const {
+            for(size_t i = 0; i < capcount; ++i) {
+                if(caps[i].id == id && (caps[i].offset >= 0x100) == extended)
+                    return caps[i].offset;
+            }
+            return 0;
+        }
+    };
+
     /**
      * The available commands
      */
@@ -39,7 +100,10 @@ public:
         ADDR,
         REBOOT,
         SEARCH_DEVICE,
-        SEARCH_BRIDGE
+        SEARCH_BRIDGE,
+        GET_DEVICE,
+        READ_BLOCK,
+        MAP_MMCONFIG
     };
 
 private:
@@ -94,6 +158,65 @@ public:
         uf.check_reply();
     }
 
+    /**
+     * Reads <count> dwords, starting at <offset>, into <buf>. That is, the whole config space of a
+     * device can be read with a few calls (256 bytes per call) instead of one call per dword.
+     *
+     * @param bdf the bus-device-function triple
+     * @param offset the offset (in bytes)
+     * @param buf the buffer to write to
+     * @param count the number of dwords to read
+     * @throws Exception if not found
+     */
+    void read_block(BDF bdf, size_t offset, value_type *buf, size_t count) const {
+        while(count > 0) {
+            size_t amount = Math::min(count, PCIConfig::MAX_BLOCK);
+            UtcbFrame uf;
+            uf << PCIConfig::READ_BLOCK << bdf << offset << amount;
+            pt().call(uf);
+            uf.check_reply();
+            for(size_t i = 0; i < amount; ++i)
+                uf >> buf[i];
+            buf += amount;
+            offset += amount * sizeof(value_type);
+            count -= amount;
+        }
+    }
+
+    /**
+     * Retrieves the properties of the given device from the inventory of the service
+     *
+     * @param bdf the bus-device-function triple
+     * @param dev will be filled
+     * @throws Exception if the device does not exist
+     */
+    void get_device(BDF bdf, PCIConfig::Device &dev) const {
+        UtcbFrame uf;
+        uf << PCIConfig::GET_DEVICE << bdf;
+        pt().call(uf);
+        uf.check_reply();
+        uf >> dev;
+    }
+
+    /**
+     * Maps the 4 KiB MMCONFIG page of given device read-only into the own address space. This way,
+     * the config space can be read without any further IPC. This is only permitted if the service
+     * has been started with the "mapmmconfig" argument.
+     *
+     * @param bdf the bus-device-function triple
+     * @return the dataspace
+     * @throws Exception if not permitted, there is no MMCONFIG or the device does not exist
+     */
+    DataSpace *map_mmconfig(BDF bdf) const {
+        ScopedCapSels cap;
+        UtcbFrame uf;
+        uf.delegation_window(Crd(cap.get(), 0, Crd::OBJ_ALL));
+        uf << PCIConfig::MAP_MMCONFIG << bdf;
+        pt().call(uf);
+        uf.check_reply();
+        return new DataSpace(cap.release());
+    }
+
     /**
      * Determines the address of given bdf and offset
      *
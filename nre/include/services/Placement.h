@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <ipc/PtClientSession.h>
+#include <utcb/UtcbFrame.h>
+#include <util/CPUSet.h>
+#include <util/Math.h>
+
+namespace nre {
+
+/**
+ * Types for the placement service
+ */
+class Placement {
+public:
+    /**
+     * The available commands
+     */
+    enum Command {
+        PLACE,
+        RELEASE,
+        GET_LOAD
+    };
+
+    /**
+     * The placement policies
+     */
+    enum Policy {
+        // use the least loaded core, preferring the least loaded package
+        SPREAD,
+        // fill the CPUs in topology order, i.e. use the first CPU that has capacity left
+        PACK,
+        // like SPREAD, but only use CPUs whose hyperthread siblings are idle
+        SIBLING_AVOID,
+        // use the CPU that is closest to the CPU of a given service and has capacity left
+        NEAR
+    };
+
+    // the load of a fully utilized CPU
+    static const uint FULL_LOAD     = 1000;
+
+    /**
+     * The state of one CPU, as reported by GET_LOAD
+     */
+    struct CPULoad {
+        cpu_t cpu;
+        uint8_t thread;
+        uint8_t core;
+        uint8_t package;
+        // the utilization in the last measurement interval (in 1/FULL_LOAD)
+        uint load;
+        // the number of threads that have been placed on this CPU and not been released yet
+        uint placed;
+    };
+
+private:
+    Placement();
+};
+
+/**
+ * Represents a session at the placement service, which is provided by root. It chooses CPUs for
+ * new threads or childs, based on the topology of the CPUs and their current load. Every
+ * placement is charged to the chosen CPU until it is released or the session is closed, so that
+ * the service can take threads into account that did not run yet.
+ */
+class PlacementSession : public PtClientSession {
+public:
+    /**
+     * Creates a new session at given service
+     *
+     * @param service the service name
+     */
+    explicit PlacementSession(const String &service) : PtClientSession(service) {
+    }
+
+    /**
+     * Chooses a CPU according to the given policy.
+     *
+     * @param policy the policy
+     * @param cpus the CPUs to choose from
+     * @param near the service to be close to (only used for Placement::NEAR)
+     * @return the chosen CPU
+     * @throws Exception if none of <cpus> is online
+     */
+    cpu_t place(Placement::Policy policy, const CPUSet &cpus = CPUSet(CPUSet::ALL),
+                const String &near = String()) {
+        UtcbFrame uf;
+        uf << Placement::PLACE << policy << cpus << near;
+        pt().call(uf);
+        uf.check_reply();
+        cpu_t cpu;
+        uf >> cpu;
+        return cpu;
+    }
+
+    /**
+     * Releases a placement on CPU <cpu>, i.e. tells the service that the thread is gone
+     *
+     * @param cpu the CPU that has been returned by place()
+     */
+    void release(cpu_t cpu) {
+        UtcbFrame uf;
+        uf << Placement::RELEASE << cpu;
+        pt().call(uf);
+        uf.check_reply();
+    }
+
+    /**
+     * Retrieves the state of all online CPUs
+     *
+     * @param loads the array to write the state to
+     * @param max the size of <loads>
+     * @return the number of CPUs written to <loads>
+     */
+    size_t get_load(Placement::CPULoad *loads, size_t max) {
+        UtcbFrame uf;
+        uf << Placement::GET_LOAD;
+        pt().call(uf);
+        uf.check_reply();
+        size_t count;
+        uf >> count;
+        for(size_t i = 0; i < count && i < max; ++i)
+            uf >> loads[i];
+        return Math::min(count, max);
+    }
+};
+
+}
@@ -17,14 +17,28 @@
 #pragma once
 
 #include <arch/Types.h>
+#include <arch/ExecEnv.h>
 #include <ipc/PtClientSession.h>
+#include <mem/DataSpace.h>
+#include <subsystem/ChildQuota.h>
 #include <utcb/UtcbFrame.h>
+#include <util/ScopedCapSels.h>
+#include <util/Math.h>
+#include <util/Sync.h>
+#include <util/Util.h>
+#include <Hip.h>
+#include <cstring>
 
 namespace nre {
 
 
 class SysInfo {
 public:
+    static const size_t MAX_CMDLINE_LEN     = 128;
+    static const size_t MAX_SCNAME_LEN      = 64;
+    static const size_t MAX_SNAPSHOT_CHILDS = 128;
+    static const size_t MAX_SNAPSHOT_SCS    = 256;
+
     /**
      * The information about a global thread
      */
@@ -107,6 +121,56 @@ public:
         size_t _threads;
     };
 
+    /**
+     * A global thread in the snapshot; see TimeUser
+     */
+    struct SnapshotSc {
+        char name[MAX_SCNAME_LEN];
+        cpu_t cpu;
+        timevalue_t time;
+        timevalue_t totaltime;
+    };
+
+    /**
+     * A Pd in the snapshot; see Child
+     */
+    struct SnapshotChild {
+        char cmdline[MAX_CMDLINE_LEN];
+        size_t virt;
+        size_t phys;
+        size_t threads;
+        // the usage and limits of the resources (ChildQuota::UNLIMITED if there is no limit)
+        size_t quota_used[ChildQuota::COUNT];
+        size_t quota_limit[ChildQuota::COUNT];
+    };
+
+    /**
+     * The snapshot of the whole system, which is located in a dataspace that is shared between the
+     * service and all clients. The service increments <seq> before and after every update, i.e. it
+     * is odd while an update is in progress. Thus, readers can detect whether they have read a
+     * consistent state without any IPC or lock.
+     */
+    struct Snapshot {
+        volatile uint32_t seq;
+        uint32_t cpus;
+        size_t mem_total;
+        size_t mem_free;
+        // the total time elapsed on each CPU since the last update (in microseconds)
+        timevalue_t cpu_time[Hip::MAX_CPUS];
+        // root is always the first child. Pds and Scs beyond the maximum are left out.
+        size_t child_count;
+        size_t sc_count;
+        SnapshotChild children[MAX_SNAPSHOT_CHILDS];
+        SnapshotSc scs[MAX_SNAPSHOT_SCS];
+    };
+
+    /**
+     * @return the size of the dataspace for the snapshot
+     */
+    static size_t snapshot_size() {
+        return Math::round_up<size_t>(sizeof(Snapshot), ExecEnv::PAGE_SIZE);
+    }
+
     /**
      * The available commands
      */
@@ -115,6 +179,8 @@ public:
         GET_TIMEUSER,
         GET_MEM,
         GET_CHILD,
+        GET_SNAPSHOT,
+        UPDATE_SNAPSHOT,
     };
 };
 
@@ -128,7 +194,10 @@ public:
      *
      * @param service the service name
      */
-    explicit SysInfoSession(const String &service) : PtClientSession(service) {
+    explicit SysInfoSession(const String &service) : PtClientSession(service), _ds() {
+    }
+    virtual ~SysInfoSession() {
+        delete _ds;
     }
 
     /**
@@ -201,6 +270,70 @@ public:
         uf >> c._cmdline >> c._virt >> c._phys >> c._threads;
         return true;
     }
+
+    /**
+     * Lets the service fill the snapshot with the current state of the system. That is, everything
+     * that is available via the per-index calls above is collected in one go. If <update> is set,
+     * the Sc times are updated as well, so that a new measurement period is started (like
+     * get_total_time(cpu, true) does). For live monitors it is sufficient that one thread calls
+     * this periodically; all others just read the snapshot via snapshot().
+     *
+     * @param update whether to update the Sc times
+     */
+    void update_snapshot(bool update) {
+        UtcbFrame uf;
+        uf << SysInfo::UPDATE_SNAPSHOT << update;
+        pt().call(uf);
+        uf.check_reply();
+    }
+
+    /**
+     * Copies the last snapshot to <s>. This does not involve IPC (except for the first call, which
+     * joins the shared dataspace). Note that only the valid entries of the children and Scs are
+     * copied.
+     *
+     * @param s will be filled
+     */
+    void snapshot(SysInfo::Snapshot &s) {
+        if(!_ds)
+            _ds = get_snapshot();
+        const SysInfo::Snapshot *shared = reinterpret_cast<const SysInfo::Snapshot*>(_ds->virt());
+        while(true) {
+            uint32_t seq = shared->seq;
+            // the service is updating it right now
+            if(seq & 1) {
+                Util::pause();
+                continue;
+            }
+            Sync::memory_barrier();
+            s.cpus = shared->cpus;
+            s.mem_total = shared->mem_total;
+            s.mem_free = shared->mem_free;
+            memcpy(s.cpu_time, shared->cpu_time, sizeof(s.cpu_time));
+            s.child_count = Math::min(shared->child_count, SysInfo::MAX_SNAPSHOT_CHILDS);
+            s.sc_count = Math::min(shared->sc_count, SysInfo::MAX_SNAPSHOT_SCS);
+            memcpy(s.children, shared->children, s.child_count * sizeof(SysInfo::SnapshotChild));
+            memcpy(s.scs, shared->scs, s.sc_count * sizeof(SysInfo::SnapshotSc));
+            Sync::memory_barrier();
+            if(shared->seq == seq) {
+                s.seq = seq;
+                break;
+            }
+        }
+    }
+
+private:
+    DataSpace *get_snapshot() {
+        ScopedCapSels cap;
+        UtcbFrame uf;
+        uf.delegation_window(Crd(cap.get(), 0, Crd::OBJ_ALL));
+        uf << SysInfo::GET_SNAPSHOT;
+        pt().call(uf);
+        uf.check_reply();
+        return new DataSpace(cap.release());
+    }
+
+    DataSpace *_ds;
 };
 
 }
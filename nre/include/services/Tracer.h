@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <ipc/PtClientSession.h>
+#include <mem/DataSpace.h>
+#include <utcb/UtcbFrame.h>
+#include <util/ScopedCapSels.h>
+
+namespace nre {
+
+/**
+ * Types for the tracer service
+ */
+class Tracer {
+public:
+    /**
+     * The available commands
+     */
+    enum Command {
+        GET_AREA,
+        START,
+        STOP,
+        DUMP
+    };
+};
+
+/**
+ * Represents a session at the tracer service. Every Pd that records events has one, through which
+ * it gets its trace area. Besides that, it can be used to control the tracing of all Pds. The first
+ * session that does so owns the control until it is closed; for all others, start, stop and dump
+ * fail with E_ARGS_INVALID.
+ */
+class TracerSession : public PtClientSession {
+public:
+    /**
+     * Creates a new session at given service
+     *
+     * @param service the service name
+     * @param name the program name
+     */
+    explicit TracerSession(const String &service, const String &name)
+        : PtClientSession(service, name) {
+    }
+
+    /**
+     * Requests the trace area for this session. It is created by the service and initialized as
+     * soon as the client attaches to it.
+     *
+     * @return the dataspace for the trace area
+     */
+    DataSpace *get_area() {
+        ScopedCapSels cap;
+        UtcbFrame uf;
+        uf.delegation_window(Crd(cap.get(), 0, Crd::OBJ_ALL));
+        uf << Tracer::GET_AREA;
+        pt().call(uf);
+        uf.check_reply();
+        return new DataSpace(cap.release());
+    }
+
+    /**
+     * Enables the given tracepoints in all Pds
+     *
+     * @param mask the tracepoints (bit n = Trace::Point n)
+     */
+    void start(word_t mask = ~static_cast<word_t>(0)) {
+        UtcbFrame uf;
+        uf << Tracer::START << mask;
+        pt().call(uf);
+        uf.check_reply();
+    }
+
+    /**
+     * Disables all tracepoints in all Pds
+     */
+    void stop() {
+        UtcbFrame uf;
+        uf << Tracer::STOP;
+        pt().call(uf);
+        uf.check_reply();
+    }
+
+    /**
+     * Lets the service merge the buffers of all Pds and write them to the log
+     */
+    void dump() {
+        UtcbFrame uf;
+        uf << Tracer::DUMP;
+        pt().call(uf);
+        uf.check_reply();
+    }
+};
+
+}
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <ipc/PtClientSession.h>
+#include <ipc/Consumer.h>
+#include <mem/DataSpace.h>
+#include <kobj/Sm.h>
+#include <utcb/UtcbFrame.h>
+#include <util/CPUSet.h>
+
+namespace nre {
+
+/**
+ * Types for the vmctrl service
+ */
+class VMControl {
+public:
+    enum Command {
+        SUBSCRIBE,
+        LIST_CONFIGS,
+        LIST_VMS,
+        START,
+        STOP,
+        RESET,
+        KILL,
+    };
+
+    // the maximum number of items in one reply of LIST_CONFIGS and LIST_VMS
+    static const size_t MAX_LIST    = 16;
+
+    enum EventType {
+        STARTED,    // the VM has been started
+        EXITED,     // the VM has terminated after STOP or KILL
+        CRASHED,    // the VM has terminated without being asked to
+    };
+
+    /**
+     * A lifecycle event, as delivered to the subscribers
+     */
+    struct Event {
+        EventType type;
+        size_t vm;
+        size_t config;
+    };
+
+    /**
+     * Information about a running VM
+     */
+    struct VMInfo {
+        size_t id;
+        size_t config;
+        size_t console;
+        cpu_t cpu;
+        // the physical memory in use in bytes
+        size_t mem;
+        // whether the VMM has connected to the vmmanager service yet (required for STOP and RESET)
+        bool initialized;
+    };
+
+private:
+    VMControl();
+};
+
+/**
+ * Represents a session at the vmctrl service, which is provided by vmmng. It allows other Pds to
+ * manage the VMs of vmmng, i.e. to start, stop, reset and kill them. The lifecycle events of all
+ * VMs are delivered to every session via a ring.
+ */
+class VMControlSession : public PtClientSession {
+    static const size_t DS_SIZE = ExecEnv::PAGE_SIZE;
+
+public:
+    /**
+     * Creates a new session at given service and subscribes to the lifecycle events
+     *
+     * @param service the service name
+     */
+    explicit VMControlSession(const String &service)
+        : PtClientSession(service), _ds(DS_SIZE, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW),
+          _sm(0), _consumer(_ds, _sm, true) {
+        subscribe();
+    }
+
+    /**
+     * @return the consumer to receive the lifecycle events. If the ring is full, new events are
+     *  dropped
+     */
+    Consumer<VMControl::Event> &events() {
+        return _consumer;
+    }
+
+    /**
+     * Retrieves the names of the VM configs. The index in <names> is the config number.
+     *
+     * @param names the array to write the names to
+     * @param max the size of <names>
+     * @return the total number of configs (might be larger than <max>)
+     */
+    size_t configs(String *names, size_t max) const {
+        size_t total = 0;
+        for(size_t first = 0; first < max; ) {
+            UtcbFrame uf;
+            uf << VMControl::LIST_CONFIGS << first;
+            pt().call(uf);
+            uf.check_reply();
+            size_t n;
+            uf >> total >> n;
+            for(size_t i = 0; i < n && first < max; ++i)
+                uf >> names[first++];
+            if(n == 0 || first >= total)
+                break;
+        }
+        return total;
+    }
+
+    /**
+     * Retrieves information about the running VMs
+     *
+     * @param vms the array to write the information to
+     * @param max the size of <vms>
+     * @return the total number of VMs (might be larger than <max>)
+     */
+    size_t vms(VMControl::VMInfo *vms, size_t max) const {
+        size_t total = 0;
+        for(size_t first = 0; first < max; ) {
+            UtcbFrame uf;
+            uf << VMControl::LIST_VMS << first;
+            pt().call(uf);
+            uf.check_reply();
+            size_t n;
+            uf >> total >> n;
+            for(size_t i = 0; i < n && first < max; ++i)
+                uf >> vms[first++];
+            if(n == 0 || first >= total)
+                break;
+        }
+        return total;
+    }
+
+    /**
+     * Starts the VM config <config>. The VM gets the CPUs <cpus> and its main thread runs on the
+     * least loaded of them.
+     *
+     * @param config the config number
+     * @param cpus the CPUs to use
+     * @return the id of the VM
+     */
+    size_t start(size_t config, const CPUSet &cpus = CPUSet(CPUSet::ALL)) {
+        UtcbFrame uf;
+        uf << VMControl::START << config << cpus;
+        pt().call(uf);
+        uf.check_reply();
+        size_t id;
+        uf >> id;
+        return id;
+    }
+
+    /**
+     * Asks the VMM of the VM with given id to terminate
+     */
+    void stop(size_t id) {
+        command(VMControl::STOP, id);
+    }
+    /**
+     * Asks the VMM of the VM with given id to reset the VM
+     */
+    void reset(size_t id) {
+        command(VMControl::RESET, id);
+    }
+    /**
+     * Kills the VM with given id
+     */
+    void kill(size_t id) {
+        command(VMControl::KILL, id);
+    }
+
+private:
+    void command(VMControl::Command cmd, size_t id) {
+        UtcbFrame uf;
+        uf << cmd << id;
+        pt().call(uf);
+        uf.check_reply();
+    }
+    void subscribe() {
+        UtcbFrame uf;
+        uf.delegate(_ds.sel(), 0);
+        uf.delegate(_sm.sel(), 1);
+        uf << VMControl::SUBSCRIBE;
+        pt().call(uf);
+        uf.check_reply();
+    }
+
+    DataSpace _ds;
+    Sm _sm;
+    Consumer<VMControl::Event> _consumer;
+};
+
+}
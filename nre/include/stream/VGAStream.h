@@ -57,6 +57,7 @@ public:
         assert(page < TEXT_PAGES);
         uintptr_t addr = _sess.screen().virt() + TEXT_OFF + page * PAGE_SIZE;
         memset(reinterpret_cast<void*>(addr), 0, PAGE_SIZE);
+        _sess.damage(TEXT_OFF + page * PAGE_SIZE, PAGE_SIZE);
     }
 
     /**
@@ -141,6 +142,8 @@ public:
     void put(ushort value, ushort *base, uint &pos);
 
 private:
+    void damage(ushort *base, uint pos, uint count);
+
     ConsoleSession &_sess;
     uint _page;
     uint _pos;
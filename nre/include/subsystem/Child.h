@@ -22,6 +22,7 @@
 #include <kobj/UserSm.h>
 #include <ipc/ClientSession.h>
 #include <subsystem/ChildMemory.h>
+#include <subsystem/ChildQuota.h>
 #include <subsystem/ServiceRegistry.h>
 #include <collection/SList.h>
 #include <collection/SListTreap.h>
@@ -209,6 +210,32 @@ public:
         return _gsis;
     }
 
+    /**
+     * @return the resource limits and the current usage
+     */
+    const ChildQuota &quota() const {
+        return _quota;
+    }
+
+    /**
+     * @return the number of portals that have been created for this child so far. They are
+     *  created on demand for the CPUs the child uses.
+     */
+    size_t portals() const {
+        size_t count = 0;
+        for(size_t i = 0; i < _ptcount; ++i) {
+            if(_pts[i])
+                count++;
+        }
+        return count;
+    }
+    /**
+     * @return true if the child has its own handler Ecs for exceptions and resource requests
+     */
+    bool dedicated_handlers() const {
+        return _handlers != nullptr;
+    }
+
     /**
      * @return the announced Scs
      */
@@ -239,10 +266,10 @@ public:
     void close_session(capsel_t handle);
 
 private:
-    explicit Child(ChildManager *cm, id_type id, const String &cmdline)
+    explicit Child(ChildManager *cm, id_type id, const String &cmdline, const ChildQuota &quota)
         : SListTreapNode<size_t>(id), RefCounted(), _cm(cm), _id(id), _cmdline(cmdline), _started(),
-          _pd(), _ec(), _pts(), _ptcount(), _regs(), _io(PortManager::USED), _scs(), _gsis(),
-          _sessions(), _joins(),  _gsi_caps(CapSelSpace::get().allocate(Hip::MAX_GSIS)),
+          _pd(), _ec(), _ptsel(), _pts(), _ptcount(), _handlers(), _slot(), _regs(), _quota(quota), _io(PortManager::USED), _scs(),
+          _gsis(), _sessions(), _joins(),  _gsi_caps(CapSelSpace::get().allocate(Hip::MAX_GSIS)),
           _gsi_next(), _entry(), _main(), _stack(), _utcb(), _hip(), _sm() {
     }
 public:
@@ -250,8 +277,10 @@ public:
 
 private:
     void destroy() {
-        for(size_t i = 0; i < _ptcount; ++i)
+        for(size_t i = 0; i < _ptcount; ++i) {
             delete _pts[i];
+            _pts[i] = nullptr;
+        }
     }
 
     void alloc_thread(uintptr_t *stack_addr, uintptr_t *utcb_addr);
@@ -261,9 +290,13 @@ private:
     void join_thread(void *ptr, capsel_t sm);
     void term_thread(void *ptr, uintptr_t stack, uintptr_t utcb);
     void remove_thread(capsel_t cap);
+    cpu_t migrate_thread(capsel_t cap, bool migratable);
     void destroy_thread(SchedEntity *se);
     void destroy_sc(capsel_t cap);
 
+    void charge_ds(size_t mem);
+    void release_ds(size_t mem);
+
     void release_gsis();
     void release_ports();
     void release_scs();
@@ -279,9 +312,13 @@ private:
     bool _started;
     Pd *_pd;
     Reference<GlobalThread> _ec;
+    capsel_t _ptsel;
     Pt **_pts;
     size_t _ptcount;
+    Reference<LocalThread> *_handlers;
+    size_t _slot;
     ChildMemory _regs;
+    ChildQuota _quota;
     PortManager _io;
     SList<SchedEntity> _scs;
     BitField<Hip::MAX_GSIS> _gsis;
@@ -18,6 +18,7 @@
 
 #include <arch/Types.h>
 #include <util/CPUSet.h>
+#include <subsystem/ChildQuota.h>
 #include <String.h>
 #include <CPU.h>
 
@@ -25,12 +26,14 @@ namespace nre {
 
 /**
  * This class is used to configure a child. You can specify the CPUs presented to him, the
- * main-function and the modules. Later this will also be used to restrict access to resources.
- * You may create a subclass to have more flexibility regarding the modules.
+ * main-function, the modules and the resource limits. You may create a subclass to have more
+ * flexibility regarding the modules.
  */
 class ChildConfig {
 public:
     static const size_t MAX_WAITS       = 4;
+    // the default time in milliseconds to wait for the services in "provides=..."
+    static const uint DEFAULT_WAIT_TIMEOUT  = 30000;
 
     enum ModuleAccess {
         OWN,                // access only to its own module
@@ -47,7 +50,7 @@ public:
      */
     explicit ChildConfig(size_t no, const String &cmdline, cpu_t cpu = CPU::current().log_id())
         : _no(no), _last(false), _modaccess(OWN), _cpu(cpu), _cpus(), _entry(0), _waitcount(),
-          _waits(), _cmdline() {
+          _waits(), _waittimeout(DEFAULT_WAIT_TIMEOUT), _dedicated(false), _quota(), _cmdline() {
         parse(cmdline);
     }
     virtual ~ChildConfig() {
@@ -79,6 +82,43 @@ public:
     const String &wait(size_t i) const {
         return _waits[i];
     }
+    /**
+     * The time in milliseconds that the ChildManager waits at most for the services, specified
+     * by "waittimeout=<ms>" on the command line. 0 means forever.
+     *
+     * @return the wait timeout
+     */
+    uint wait_timeout() const {
+        return _waittimeout;
+    }
+    void wait_timeout(uint ms) {
+        _waittimeout = ms;
+    }
+
+    /**
+     * Whether the child gets its own handler Ecs for exceptions and resource requests instead of
+     * sharing them with the other childs. This is intended for childs that cause a lot of
+     * pagefaults or requests (e.g. VMMs), so that they don't delay the others. It is specified by
+     * "handlers=own" on the command line.
+     *
+     * @return true if the child should get dedicated handlers
+     */
+    bool dedicated_handlers() const {
+        return _dedicated;
+    }
+    void dedicated_handlers(bool dedicated) {
+        _dedicated = dedicated;
+    }
+
+    /**
+     * @return the resource limits
+     */
+    const ChildQuota &quota() const {
+        return _quota;
+    }
+    ChildQuota &quota() {
+        return _quota;
+    }
 
     /**
      * @return the commandline
@@ -149,7 +189,14 @@ private:
                     _last = true;
                 else if(strncmp(start, "provides=", 9) == 0 && _waitcount < MAX_WAITS)
                     _waits[_waitcount++] = String(start + 9, len - 9);
+                else if(strncmp(start, "waittimeout=", 12) == 0)
+                    _waittimeout = strtoul(start + 12, nullptr, 10);
+                else if(len == 12 && strncmp(start, "handlers=own", 12) == 0)
+                    _dedicated = true;
                 else {
+                    // the quota is passed on to the child, so that it can subdivide it
+                    if(strncmp(start, "quota=", 6) == 0)
+                        _quota.parse(start + 6, len - 6);
                     if(pos + len + 1 >= sizeof(buffer))
                         len = sizeof(buffer) - (pos + 2);
                     memcpy(buffer + pos, start, len + 1);
@@ -170,6 +217,9 @@ private:
     uintptr_t _entry;
     size_t _waitcount;
     String _waits[MAX_WAITS];
+    uint _waittimeout;
+    bool _dedicated;
+    ChildQuota _quota;
     String _cmdline;
 };
 
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <kobj/Pt.h>
+#include <kobj/RWLock.h>
 #include <collection/SListTreap.h>
 #include <subsystem/ServiceRegistry.h>
 #include <subsystem/Child.h>
@@ -61,7 +62,19 @@ class ChildManager {
      */
     class Portals {
     public:
-        static const size_t COUNT   = 9;
+        // the number of portals per CPU (exceptions, startup and the service portals)
+        static const size_t PER_CPU = 24;
+
+        /**
+         * Describes one of the portals that each child gets on each CPU it uses
+         */
+        struct Desc {
+            capsel_t no;
+            PORTAL void (*portal)(Child*);
+            word_t mtd;
+            bool srv;       // whether it is bound to the service-Ec
+        };
+        static const Desc descs[];
 
         PORTAL static void startup(Child *child);
         PORTAL static void init_caps(Child *child);
@@ -96,11 +109,19 @@ class ChildManager {
         }
 
     private:
-        virtual void call() {
+        virtual void call(Child *const *objs, size_t count) {
             // call an empty portal with the child-Ecs
             UtcbFrame uf;
-            Pt(_cm->_ecs[CPU::current().log_id()], cleanup_portal).call(uf);
-            Pt(_cm->_srvecs[CPU::current().log_id()], cleanup_portal).call(uf);
+            cpu_t cpu = CPU::current().log_id();
+            for(size_t i = 0; i < _cm->_pool; ++i) {
+                Pt(_cm->_ecs[cpu * _cm->_pool + i], cleanup_portal).call(uf);
+                Pt(_cm->_srvecs[cpu * _cm->_pool + i], cleanup_portal).call(uf);
+            }
+            // and the dedicated ones of the childs that are currently deleted, if any
+            for(size_t i = 0; i < count; ++i) {
+                if(objs[i]->_handlers && objs[i]->_handlers[cpu].valid())
+                    Pt(objs[i]->_handlers[cpu], cleanup_portal).call(uf);
+            }
         }
 
         virtual void invalidate(Child *obj) {
@@ -136,16 +157,44 @@ class ChildManager {
 public:
     typedef typename SListTreap<Child>::const_iterator iterator;
 
+    /**
+     * The reasons for the removal of a child
+     */
+    enum ExitReason {
+        EXITED,     // the child terminated itself; the code is its exit code
+        FAULTED,    // the child caused an unresolvable exception; the code is the vector
+        KILLED,     // the child has been killed via kill()
+        TIMEOUT,    // the child did not register its service in time
+    };
+
+    /**
+     * Describes the removal of a child
+     */
+    struct ExitInfo {
+        Child::id_type id;
+        ExitReason reason;
+        int code;
+        // the TSC value at which the child has been removed
+        timevalue_t time;
+    };
+
     /**
      * Some settings
      */
     static const size_t MAX_CMDLINE_LEN     = 256;
     static const size_t MAX_MODAUX_LEN      = ExecEnv::PAGE_SIZE;
+    // the number of exits that are kept for fetch_exit()
+    static const size_t MAX_EXITS           = 64;
 
     /**
-     * Creates a new child manager. It will already create all Ecs that are required
+     * Creates a new child manager. It will already create all Ecs that are required. The portals
+     * of the childs are bound to a pool of handler Ecs on each CPU, whereas each child is assigned
+     * to one Ec of the pool. That is, with a larger pool, the pagefaults and requests of different
+     * childs are handled in parallel, at the cost of 2 Ecs per pool entry and CPU.
+     *
+     * @param pool the number of handler Ecs per CPU
      */
-    explicit ChildManager();
+    explicit ChildManager(size_t pool = 1);
     /**
      * Deletes this child manager, i.e. it kills and deletes all childs and deletes all Ecs
      */
@@ -155,18 +204,30 @@ public:
      * Loads a child task. That is, it treats <addr>...<addr>+<size> as an ELF file, creates a new
      * Pd, adds the correspondings segments to that Pd, creates a main thread and finally starts
      * the main thread. Afterwards, if the command line contains "provides=..." it waits until
-     * the service with given name is registered.
+     * the service with given name is registered. If that doesn't happen within the wait timeout
+     * of <config>, the child is killed.
      *
      * @param addr the address of the ELF file
      * @param size the size of the ELF file
      * @param config the config to use. this allows you to specify the access to the modules, the
-     *  presented CPUs and other things
+     *  presented CPUs, the resource limits and other things
      * @return the id of the created child
      * @throws ELFException if the ELF is invalid
-     * @throws Exception if something else failed
+     * @throws Exception if the limits exceed the budget or something else failed
+     * @throws ChildException if a service has not been registered in time
      */
     Child::id_type load(uintptr_t addr, size_t size, const ChildConfig &config);
 
+    /**
+     * Waits until the service with given name is registered. Only registrations of this name
+     * wake us up.
+     *
+     * @param name the service name
+     * @param timeout the TSC value at which to give up (0 = never)
+     * @return true if the service is registered, false if the timeout has been reached
+     */
+    bool wait_service(const String &name, timevalue_t timeout = 0);
+
     /**
      * @return the number of childs
      */
@@ -174,12 +235,59 @@ public:
         return _child_count;
     }
     /**
-     * @return a semaphore that is up'ed as soon as a child has been killed
+     * @return the number of portals a child gets for each CPU it uses
+     */
+    static size_t portals_per_cpu() {
+        return Portals::PER_CPU;
+    }
+    /**
+     * @return the number of handler Ecs per CPU that are shared among the childs
+     */
+    size_t pool() const {
+        return _pool;
+    }
+    /**
+     * The budget of this child manager, from which the limits of the childs are reserved. By
+     * default, it is unlimited. A ChildManager that runs in a child should set it to its own
+     * quota, so that it can't hand out more than it has.
+     *
+     * @return the budget
+     */
+    ChildQuota &budget() {
+        return _budget;
+    }
+    const ChildQuota &budget() const {
+        return _budget;
+    }
+
+    /**
+     * @return a semaphore that is up'ed as soon as a child has been killed. Afterwards, the reason
+     *  can be retrieved via fetch_exit()
      */
     Sm &dead_sm() {
         return _diesm;
     }
 
+    /**
+     * Fetches the oldest exit that has not been fetched yet. Only the last MAX_EXITS exits are
+     * kept. If older ones have been dropped, <lost> is set to true. In this case, the caller should
+     * check the childs it is interested in via get().
+     *
+     * @param info will be set to the exit
+     * @param lost will be set to true if exits have been dropped before this one
+     * @return true if there was an exit
+     */
+    bool fetch_exit(ExitInfo &info, bool &lost) {
+        ScopedLock<UserSm> guard(&_sm);
+        lost = _exit_wpos - _exit_rpos > MAX_EXITS;
+        if(lost)
+            _exit_rpos = _exit_wpos - MAX_EXITS;
+        if(_exit_rpos == _exit_wpos)
+            return false;
+        info = _exits[_exit_rpos++ % MAX_EXITS];
+        return true;
+    }
+
     /**
      * The up-/down-implementation to allow ScopedLock<ChildManager>. This is required if you want
      * to iterate over all childs to prevent that the list is manipulated during that time.
@@ -224,7 +332,7 @@ public:
      */
     void kill(Child::id_type id) {
         Reference<const Child> child = get(id);
-        destroy_child(const_cast<Child*>(&*child));
+        destroy_child(const_cast<Child*>(&*child), KILLED, 0);
     }
 
     /**
@@ -233,6 +341,12 @@ public:
     const ServiceRegistry &registry() const {
         return _registry;
     }
+    /**
+     * @return the deleter for the childs, e.g. to configure its latency target or to monitor it
+     */
+    ThreadedDeleter<Child> &deleter() {
+        return _deleter;
+    }
     /**
      * Registers the given service. This is used to let the task that hosts the childmanager
      * register services as well (by default, only its child tasks do so).
@@ -277,7 +391,6 @@ private:
                          const BitField<Hip::MAX_CPUS> &available) {
         ScopedLock<UserSm> guard(&_sm);
         const ServiceRegistry::Service *srv = _registry.reg(c, name, pts, 1 << CPU::order(), available);
-        _regsm.up();
         return srv->sm().sel();
     }
     void unreg_service(Child *c, const String& name) {
@@ -285,10 +398,17 @@ private:
         _registry.unreg(c, name);
     }
 
+    Reference<LocalThread> create_handler(cpu_t cpu, uint order);
+    void create_portals(Child *c, cpu_t cpu);
+    void delegate_portals(UtcbFrameRef &uf, Child *c, cpu_t cpu);
+
+    void reserve(const ChildQuota &quota);
+    void unreserve(const ChildQuota &quota);
+
     void exception_kill(Child *c, int vector);
     void term_child(Child *c, int vector, UtcbExcFrameRef &uf);
     void kill_child(Child *c, int vector, UtcbExcFrameRef &uf, ExitType type, int exitcode);
-    void destroy_child(Child *c);
+    void destroy_child(Child *c, ExitReason reason, int code);
 
     static void prepare_stack(Child *c, uintptr_t &sp, uintptr_t csp);
     void build_hip(Child *c, const ChildConfig &config);
@@ -302,15 +422,19 @@ private:
 
     size_t _next_id;
     size_t _child_count;
+    size_t _pool;
     SListTreap<Child> _childs;
     ChildDeleter _deleter;
     DataSpaceManager<DataSpace> _dsm;
     ServiceRegistry _registry;
+    ChildQuota _budget;
     mutable UserSm _sm;
-    UserSm _switchsm;
+    RWLock _switchsm;
     mutable UserSm _slotsm;
-    Sm _regsm;
     Sm _diesm;
+    ExitInfo _exits[MAX_EXITS];
+    size_t _exit_rpos;
+    size_t _exit_wpos;
     Reference<LocalThread> *_ecs;
     Reference<LocalThread> *_srvecs;
 };
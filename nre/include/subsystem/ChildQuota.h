@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <arch/Types.h>
+#include <stream/OStringStream.h>
+#include <util/Atomic.h>
+#include <Exception.h>
+
+namespace nre {
+
+class OStream;
+
+/**
+ * The resource limits of a child and its current usage. Every resource that the ChildManager
+ * hands out to a child is charged here first, so that a child can't exhaust the resources of
+ * everybody else. The limits are specified on the command line via
+ * "quota=mem:<bytes>,ds:<n>,sc:<n>,sess:<n>,caps:<n>", where the number may have a K, M or G
+ * suffix. Resources that are not mentioned are unlimited.
+ *
+ * Since a ChildManager in a child (e.g. apps/sub) requests all resources for its children from
+ * its own parent, its children can never use more than the ChildManager itself is allowed to. The
+ * ChildManager can subdivide its quota by giving its children limits, which are reserved from its
+ * budget.
+ */
+class ChildQuota {
+public:
+    static const size_t UNLIMITED   = static_cast<size_t>(-1);
+
+    enum Resource {
+        MEM,        // physical memory in bytes
+        DS,         // number of mapped dataspaces
+        SC,         // number of Scs (without the main thread)
+        SESSION,    // number of open sessions
+        CAPS,       // number of capabilities delegated for dataspaces, sessions, Scs and GSIs
+        COUNT
+    };
+
+    /**
+     * Creates an unlimited quota
+     */
+    explicit ChildQuota() {
+        for(size_t i = 0; i < COUNT; ++i) {
+            _limit[i] = UNLIMITED;
+            _used[i] = 0;
+        }
+    }
+
+    /**
+     * @return the name of the given resource, as used on the command line
+     */
+    static const char *name(Resource r) {
+        static const char *names[] = {"mem", "ds", "sc", "sess", "caps"};
+        return names[r];
+    }
+
+    /**
+     * @return true if at least one resource is limited
+     */
+    bool limited() const {
+        for(size_t i = 0; i < COUNT; ++i) {
+            if(_limit[i] != UNLIMITED)
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * @return the limit of <r>
+     */
+    size_t limit(Resource r) const {
+        return _limit[r];
+    }
+    /**
+     * Sets the limit of <r> to <limit>
+     */
+    void limit(Resource r, size_t limit) {
+        _limit[r] = limit;
+    }
+    /**
+     * @return the current usage of <r>
+     */
+    size_t used(Resource r) const {
+        return _used[r];
+    }
+
+    /**
+     * Charges <amount> of resource <r>.
+     *
+     * @param r the resource
+     * @param amount the amount
+     * @throws Exception if the limit would be exceeded
+     */
+    void charge(Resource r, size_t amount) {
+        while(true) {
+            size_t old = _used[r];
+            if(old + amount < old || old + amount > _limit[r]) {
+                VTHROW(Exception, E_CAPACITY, "Quota for " << name(r) << " exceeded (used="
+                                              << old << ", limit=" << _limit[r]
+                                              << ", requested=" << amount << ")");
+            }
+            if(Atomic::cmpnswap(_used + r, old, old + amount))
+                break;
+        }
+    }
+
+    /**
+     * Charges <amount1> of <r1> and <amount2> of <r2> or nothing at all.
+     *
+     * @throws Exception if one of the limits would be exceeded
+     */
+    void charge(Resource r1, size_t amount1, Resource r2, size_t amount2) {
+        charge(r1, amount1);
+        try {
+            charge(r2, amount2);
+        }
+        catch(...) {
+            release(r1, amount1);
+            throw;
+        }
+    }
+
+    /**
+     * Gives <amount> of resource <r> back
+     *
+     * @param r the resource
+     * @param amount the amount
+     */
+    void release(Resource r, size_t amount) {
+        Atomic::add(_used + r, -amount);
+    }
+    /**
+     * Gives <amount1> of <r1> and <amount2> of <r2> back
+     */
+    void release(Resource r1, size_t amount1, Resource r2, size_t amount2) {
+        release(r1, amount1);
+        release(r2, amount2);
+    }
+
+    /**
+     * Parses the given limits, i.e. the part behind "quota=".
+     *
+     * @param str the string
+     * @param len the length of the string
+     * @throws Exception if the string is invalid
+     */
+    void parse(const char *str, size_t len);
+
+private:
+    size_t _limit[COUNT];
+    volatile size_t _used[COUNT];
+};
+
+OStream &operator<<(OStream &os, const ChildQuota &q);
+
+}
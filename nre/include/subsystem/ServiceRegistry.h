@@ -37,9 +37,15 @@ class Child;
 
 /**
  * Keeps track of registered services, i.e. stores the child that registered it, the name, on
- * which CPUs its available and the portal capabilities.
+ * which CPUs its available and the portal capabilities. The services are hashed by name, so that
+ * lookups don't have to compare against all services. Additionally, one can wait for a service
+ * to become available, whereas only the waiters for that name are woken up on a registration.
+ *
+ * Note that the registry does no locking, i.e. the caller has to do that.
  */
 class ServiceRegistry {
+    static const size_t BUCKETS     = 32;
+
 public:
     /**
      * A service in the registry
@@ -59,7 +65,7 @@ public:
         explicit Service(Child *child, const String &name, capsel_t pts, size_t count,
                          const BitField<Hip::MAX_CPUS> &available)
             : SListItem(), _child(child), _name(name), _pts(pts), _count(count), _sm(0),
-              _available(available) {
+              _available(available), _hnext() {
         }
         /**
          * The destructor revokes the caps and frees the selectors
@@ -111,6 +117,49 @@ public:
         size_t _count;
         Sm _sm;
         BitField<Hip::MAX_CPUS> _available;
+        Service *_hnext;
+    };
+
+    /**
+     * Somebody that waits for a service with a specific name
+     */
+    class Waiter {
+        friend class ServiceRegistry;
+
+    public:
+        /**
+         * Creates a waiter for the service <name>
+         */
+        explicit Waiter(const String &name) : _name(name), _sm(0), _notified(false), _next() {
+        }
+
+        /**
+         * @return the name of the service that is waited for
+         */
+        const String &name() const {
+            return _name;
+        }
+        /**
+         * @return the semaphore that is up'ed as soon as the service is registered
+         */
+        Sm &sm() {
+            return _sm;
+        }
+        /**
+         * @return true if the service has been registered
+         */
+        bool notified() const {
+            return _notified;
+        }
+
+    private:
+        Waiter(const Waiter&);
+        Waiter& operator=(const Waiter&);
+
+        String _name;
+        Sm _sm;
+        bool _notified;
+        Waiter *_next;
     };
 
     typedef SList<Service>::iterator iterator;
@@ -119,7 +168,7 @@ public:
     /**
      * Creates an empty service registry
      */
-    explicit ServiceRegistry() : _srvs() {
+    explicit ServiceRegistry() : _srvs(), _table(), _waiters() {
     }
     /**
      * Deletes all registered services
@@ -188,28 +237,67 @@ public:
     void remove(Child *child) {
         for(auto it = _srvs.begin(); it != _srvs.end(); ) {
             if(it->child() == child) {
-                _srvs.remove(&*it);
-                delete &*it;
-                it = _srvs.begin();
+                Service *s = &*it;
+                ++it;
+                unlink(s);
+                delete s;
             }
             else
                 ++it;
         }
     }
 
+    /**
+     * Adds the given waiter. As soon as the service is registered, the waiter is removed, marked
+     * as notified and its semaphore is up'ed.
+     *
+     * @param w the waiter
+     */
+    void add_waiter(Waiter *w) {
+        Waiter **head = _waiters + hash(w->name());
+        w->_next = *head;
+        *head = w;
+    }
+    /**
+     * Removes the given waiter, if it has not been notified yet (e.g. because of a timeout)
+     *
+     * @param w the waiter
+     */
+    void remove_waiter(Waiter *w) {
+        for(Waiter **p = _waiters + hash(w->name()); *p; p = &(*p)->_next) {
+            if(*p == w) {
+                *p = w->_next;
+                break;
+            }
+        }
+    }
+
 private:
+    static size_t hash(const String &name) {
+        // FNV-1a
+        uint32_t h = 2166136261U;
+        for(size_t i = 0; i < name.length(); ++i)
+            h = (h ^ static_cast<uint8_t>(name.str()[i])) * 16777619U;
+        return h % BUCKETS;
+    }
+
+    void unlink(Service *s);
+    void notify(const String &name);
+
     Service *search(const String &name) {
         return const_cast<Service*>(const_cast<const ServiceRegistry*>(this)->search(name));
     }
     const Service *search(const String &name) const {
-        for(auto it = _srvs.cbegin(); it != _srvs.cend(); ++it) {
-            if(it->name() == name)
-                return &*it;
+        for(const Service *s = _table[hash(name)]; s; s = s->_hnext) {
+            if(s->name() == name)
+                return s;
         }
         return 0;
     }
 
     SList<Service> _srvs;
+    Service *_table[BUCKETS];
+    Waiter *_waiters[BUCKETS];
 };
 
 }
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <arch/Types.h>
+#include <services/ACPI.h>
+
+namespace nre {
+
+/**
+ * Collects the ACPI tables of the system, verifies them and builds an ACPI::TableSet from them.
+ * That is, the checksums are only checked once, when the tables are added. Afterwards, all
+ * lookups can be done on the TableSet without touching the firmware tables again.
+ */
+class ACPITableBuilder {
+public:
+    static const size_t MAX_TABLES  = 64;
+
+    /**
+     * Provides access to the physical memory that contains the ACPI tables
+     */
+    class Mapper {
+    public:
+        virtual ~Mapper() {
+        }
+
+        /**
+         * Makes <size> bytes at physical address <phys> accessible. The memory has only to stay
+         * accessible until the next call of map().
+         *
+         * @param phys the physical address
+         * @param size the number of bytes
+         * @return the virtual address
+         */
+        virtual const void *map(uint64_t phys, size_t size) = 0;
+    };
+
+    /**
+     * Creates an empty builder
+     */
+    explicit ACPITableBuilder() : _count(0) {
+    }
+    /**
+     * Frees the collected tables
+     */
+    ~ACPITableBuilder();
+
+    /**
+     * Adds all tables that are reachable from <rsdp>. If the RSDP is from ACPI 2.0 or later and
+     * contains a valid XSDT, the XSDT is used. Otherwise, the RSDT is used. The DSDT, which is
+     * referenced by the FACP, is added as well. Tables with an invalid checksum are skipped.
+     *
+     * @param rsdp the root system description pointer
+     * @param mapper the mapper to access the tables
+     * @throws Exception if neither the XSDT nor the RSDT is valid
+     */
+    void load(const ACPI::RSDP *rsdp, Mapper &mapper);
+
+    /**
+     * Adds a copy of the given table, if its checksum is valid
+     *
+     * @param table the table
+     * @return true if it has been added
+     */
+    bool add(const ACPI::RSDT *table);
+
+    /**
+     * @return the number of collected tables
+     */
+    size_t count() const {
+        return _count;
+    }
+
+    /**
+     * @return the size of the TableSet that build() produces
+     */
+    size_t size() const;
+
+    /**
+     * Writes the TableSet with all collected tables to <dst>
+     *
+     * @param dst the destination, which needs to have at least size() bytes
+     */
+    void build(void *dst) const;
+
+    /**
+     * @return the sum of all bytes in <data> (0 if the checksum of an ACPI table is valid)
+     */
+    static uint8_t checksum(const void *data, size_t len) {
+        const uint8_t *bytes = reinterpret_cast<const uint8_t*>(data);
+        uint8_t res = 0;
+        while(len--)
+            res += bytes[len];
+        return res;
+    }
+
+private:
+    ACPITableBuilder(const ACPITableBuilder&);
+    ACPITableBuilder& operator=(const ACPITableBuilder&);
+
+    static size_t table_offset(size_t count) {
+        return sizeof(ACPI::TableSet) + count * sizeof(ACPI::TableEntry);
+    }
+    static size_t align(size_t size) {
+        return (size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+    }
+    static const ACPI::RSDT *map(uint64_t phys, size_t size, Mapper &mapper) {
+        return reinterpret_cast<const ACPI::RSDT*>(mapper.map(phys, size));
+    }
+    bool add_from(uint64_t phys, Mapper &mapper);
+    template<typename T>
+    bool add_all(uint64_t phys, const char *signature, Mapper &mapper);
+    void build_irq_map(ACPI::TableSet *set) const;
+
+    ACPI::RSDT *_tables[MAX_TABLES];
+    size_t _count;
+};
+
+}
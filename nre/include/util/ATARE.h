@@ -17,9 +17,11 @@
 
 #pragma once
 
-#include <services/PCIConfig.h>
+#include <arch/Types.h>
+#include <services/ACPI.h>
+#include <util/BDF.h>
 
-#include "HostACPI.h"
+namespace nre {
 
 /**
  * ATARE - ACPI table IRQ routing extraction.
@@ -31,7 +33,7 @@
  * State: testing
  * Features: direct PRT, referenced PRTs, exact name resolution, Routing Entries
  */
-class HostATARE {
+class ATARE {
     /**
      * A single PCI routing entry.
      */
@@ -39,8 +41,8 @@ class HostATARE {
         PciRoutingEntry * next;
         unsigned adr;
         unsigned char pin;
-        unsigned char gsi;
-        PciRoutingEntry(PciRoutingEntry *_next, unsigned _adr, unsigned char _pin, unsigned char _gsi)
+        unsigned gsi;
+        PciRoutingEntry(PciRoutingEntry *_next, unsigned _adr, unsigned char _pin, unsigned _gsi)
             : next(_next), adr(_adr), pin(_pin), gsi(_gsi) {
         }
     };
@@ -62,17 +64,21 @@ class HostATARE {
     };
 
 public:
-    typedef nre::PCIConfig::value_type value_type;
-
-    explicit HostATARE(HostACPI &acpi, uint debug) : _head(nullptr) {
-        // add entries from the SSDT
-        const HostACPI::ACPIListItem *item = acpi.find("DSDT", 0);
-        if(item)
-            _head = add_refs(reinterpret_cast<uint8_t*>(item->start()), item->length(), _head);
+    /**
+     * Parses the DSDT and all SSDTs in <tables> and collects the PCI routing information
+     *
+     * @param tables the ACPI tables (have to stay valid as long as this object exists)
+     * @param debug bit 0: print all named objects, bit 1: print the routing
+     */
+    explicit ATARE(const ACPI::TableSet &tables, uint debug) : _head(nullptr) {
+        // add entries from the DSDT
+        const ACPI::RSDT *tbl = tables.find("DSDT", 0);
+        if(tbl)
+            _head = add_refs(reinterpret_cast<const uint8_t*>(tbl), tbl->length, _head);
 
         // and from the SSDTs
-        for(uint i = 0; (item = acpi.find("SSDT", i)) != nullptr; ++i)
-            _head = add_refs(reinterpret_cast<uint8_t*>(item->start()), item->length(), _head);
+        for(uint i = 0; (tbl = tables.find("SSDT", i)) != nullptr; ++i)
+            _head = add_refs(reinterpret_cast<const uint8_t*>(tbl), tbl->length, _head);
 
         add_routing(_head);
         if(debug & 1)
@@ -80,21 +86,20 @@ public:
         if(debug & 2)
             debug_show_routing();
     }
+    ~ATARE();
 
-    uint get_gsi(nre::BDF bdf, uint8_t pin, nre::BDF parent_bdf) {
-        // find the device
-        for(NamedRef *dev = _head; dev; dev = dev->next) {
-            if(dev->ptr[0] == 0x82 && get_device_bdf(_head, dev) == parent_bdf) {
-                // look for the right entry
-                for(PciRoutingEntry *p = dev->routing; p; p = p->next) {
-                    if((p->adr >> 16) == bdf.device() && (pin == p->pin))
-                        return p->gsi;
-                }
-            }
-        }
-        VTHROW(Exception, E_NOT_FOUND,
-               "ATARE was unable to find GSI for " << bdf << " parent " << parent_bdf << " pin " << pin);
-    }
+    /**
+     * @return the number of routing entries that have been found
+     */
+    size_t routes() const;
+
+    /**
+     * Resolves the BDF of all devices with routing information and stores the routes into <rt>.
+     * If there are multiple routes for the same triple, the one found last while parsing wins.
+     *
+     * @param rt the routing table, which has to be initialized with enough slots
+     */
+    void build_routing(ACPI::RoutingTable *rt) const;
 
 private:
     void debug_show_items();
@@ -113,9 +118,14 @@ private:
     static void search_prt_indirect(NamedRef *head, NamedRef *dev, NamedRef *prt);
     static uint get_namedef_value(NamedRef *head, NamedRef *parent, const char *name);
     static NamedRef *search_ref(NamedRef *head, NamedRef *parent, const char *name, bool upstream);
-    static nre::BDF get_device_bdf(NamedRef *head, NamedRef *dev);
+    static BDF get_device_bdf(NamedRef *head, NamedRef *dev);
     static NamedRef *add_refs(const uint8_t *table, unsigned len, NamedRef *res = nullptr);
     static void add_routing(NamedRef *head);
 
+    ATARE(const ATARE&);
+    ATARE& operator=(const ATARE&);
+
     NamedRef *_head;
 };
+
+}
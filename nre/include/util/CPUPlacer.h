@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+
+#pragma once
+
+#include <arch/Types.h>
+#include <services/Placement.h>
+#include <util/CPUSet.h>
+#include <Hip.h>
+#include <CPU.h>
+
+namespace nre {
+
+/**
+ * Implements the policies of the placement service. It knows the topology of the CPUs, their
+ * current load and how many threads have been placed on them. A placed thread is assumed to cause
+ * a load of PLACED_LOAD until it is released, because it takes a while until its time shows up in
+ * the measured load.
+ */
+class CPUPlacer {
+public:
+    static const cpu_t NO_CPU           = static_cast<cpu_t>(-1);
+    // the assumed load of a placed thread
+    static const uint PLACED_LOAD       = Placement::FULL_LOAD / 4;
+    // PACK and NEAR don't put more than this on one CPU, if possible
+    static const uint PACK_LIMIT        = (Placement::FULL_LOAD * 3) / 4;
+    // SIBLING_AVOID considers a sibling idle, if its load is below this
+    static const uint IDLE_LIMIT        = Placement::FULL_LOAD / 10;
+
+    /**
+     * Creates a placer without CPUs
+     */
+    explicit CPUPlacer() : _cpus(), _online() {
+    }
+
+    /**
+     * Adds all online CPUs
+     */
+    void add_online() {
+        for(auto it = CPU::begin(); it != CPU::end(); ++it)
+            add(it->log_id(), it->thread(), it->core(), it->package());
+    }
+    /**
+     * Adds the given CPU
+     */
+    void add(cpu_t cpu, uint8_t thread, uint8_t core, uint8_t package) {
+        Placement::CPULoad &c = _cpus[cpu];
+        c.cpu = cpu;
+        c.thread = thread;
+        c.core = core;
+        c.package = package;
+        c.load = 0;
+        c.placed = 0;
+        _online.set(cpu);
+    }
+
+    /**
+     * @return true if <cpu> has been added
+     */
+    bool online(cpu_t cpu) const {
+        return cpu < Hip::MAX_CPUS && _online.is_set(cpu);
+    }
+    /**
+     * @return the state of CPU <cpu>
+     */
+    const Placement::CPULoad &get(cpu_t cpu) const {
+        return _cpus[cpu];
+    }
+    /**
+     * Sets the measured load of CPU <cpu>
+     */
+    void load(cpu_t cpu, uint load) {
+        _cpus[cpu].load = load;
+    }
+
+    /**
+     * Chooses a CPU from <cpus> according to <policy> and charges the placement to it.
+     *
+     * @param policy the policy
+     * @param cpus the CPUs to choose from
+     * @param near the CPU to be close to (only used for Placement::NEAR; NO_CPU = anywhere)
+     * @return the chosen CPU
+     * @throws Exception if none of <cpus> is online
+     */
+    cpu_t place(Placement::Policy policy, const CPUSet &cpus, cpu_t near = NO_CPU);
+
+    /**
+     * Releases one placement on <cpu>
+     */
+    void release(cpu_t cpu) {
+        if(online(cpu) && _cpus[cpu].placed > 0)
+            _cpus[cpu].placed--;
+    }
+
+private:
+    uint cost(const Placement::CPULoad &c) const {
+        return c.load + c.placed * PLACED_LOAD;
+    }
+    static bool same_core(const Placement::CPULoad &a, const Placement::CPULoad &b) {
+        return a.package == b.package && a.core == b.core;
+    }
+    uint core_cost(const Placement::CPULoad &c) const;
+    uint package_cost(const Placement::CPULoad &c) const;
+    bool siblings_idle(const Placement::CPULoad &c) const;
+    static uint distance(const Placement::CPULoad &a, const Placement::CPULoad &b);
+    bool spread_less(const Placement::CPULoad &a, const Placement::CPULoad &b) const;
+    static bool topology_less(const Placement::CPULoad &a, const Placement::CPULoad &b);
+    cpu_t choose(Placement::Policy policy, const CPUSet &cpus, cpu_t near) const;
+
+    Placement::CPULoad _cpus[Hip::MAX_CPUS];
+    BitField<Hip::MAX_CPUS> _online;
+};
+
+}
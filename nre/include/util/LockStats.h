@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <arch/Types.h>
+#include <kobj/UserSm.h>
+#include <collection/SList.h>
+#include <util/Atomic.h>
+#include <util/ScopedLock.h>
+
+namespace nre {
+
+class OStream;
+
+/**
+ * Contention statistics for a UserSm. All existing objects are kept in a list, so that they can be
+ * printed by name. Usage:
+ * static LockStats stats("mylock");
+ * ...
+ * sm.stats(&stats);
+ */
+class LockStats : public SListItem {
+public:
+    /**
+     * Creates a new statistics object with given name and registers it
+     *
+     * @param name the name (not copied)
+     */
+    explicit LockStats(const char *name)
+        : SListItem(), _name(name), _acquisitions(), _contended(), _blocked(), _waitcycles() {
+        ScopedLock<UserSm> guard(&_list_sm);
+        _list.append(this);
+    }
+    /**
+     * Unregisters the object
+     */
+    ~LockStats() {
+        ScopedLock<UserSm> guard(&_list_sm);
+        _list.remove(this);
+    }
+
+    /**
+     * @return the name
+     */
+    const char *name() const {
+        return _name;
+    }
+    /**
+     * @return the total number of acquisitions
+     */
+    ulong acquisitions() const {
+        return _acquisitions;
+    }
+    /**
+     * @return the number of acquisitions where the semaphore was not available immediately
+     */
+    ulong contended() const {
+        return _contended;
+    }
+    /**
+     * @return the number of contended acquisitions that had to block, i.e. where spinning did not
+     *  help
+     */
+    ulong blocked() const {
+        return _blocked;
+    }
+    /**
+     * @return the total number of cycles spent waiting for the semaphore
+     */
+    uint64_t wait_cycles() const {
+        return _waitcycles;
+    }
+
+    /**
+     * Resets all counters to zero
+     */
+    void reset() {
+        _acquisitions = _contended = _blocked = 0;
+        _waitcycles = 0;
+    }
+
+    /**
+     * Records an acquisition. Is called by UserSm.
+     *
+     * @param contended whether it was contended
+     * @param blocked whether we had to block
+     * @param waited the number of cycles we've waited
+     */
+    void record(bool contended, bool blocked, uint64_t waited) {
+        Atomic::add(&_acquisitions, 1);
+        if(contended) {
+            Atomic::add(&_contended, 1);
+            if(blocked)
+                Atomic::add(&_blocked, 1);
+            Atomic::add(&_waitcycles, waited);
+        }
+    }
+
+    /**
+     * Prints the statistics of all locks with given name into <os>.
+     *
+     * @param os the stream to write to
+     * @param name the name of the locks to print (nullptr = all)
+     */
+    static void print(OStream &os, const char *name = nullptr);
+
+private:
+    LockStats(const LockStats&);
+    LockStats& operator=(const LockStats&);
+
+    const char *_name;
+    volatile ulong _acquisitions;
+    volatile ulong _contended;
+    volatile ulong _blocked;
+    volatile uint64_t _waitcycles;
+    static UserSm _list_sm;
+    static SList<LockStats> _list;
+};
+
+OStream &operator<<(OStream &os, const LockStats &s);
+
+}
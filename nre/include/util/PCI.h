@@ -50,7 +50,8 @@ public:
     static const cap_type CAP_MSIX          = 0x11U;
     static const cap_type CAP_PCIE          = 0x10U;
 
-    explicit PCI(PCIConfigSession &pcicfg, ACPISession *acpi = nullptr) : _pcicfg(pcicfg), _acpi(acpi) {
+    explicit PCI(PCIConfigSession &pcicfg, ACPISession *acpi = nullptr)
+        : _pcicfg(pcicfg), _acpi(acpi), _dev(), _devvalid(false) {
     }
 
     value_type conf_read(BDF bdf, size_t dword) {
@@ -64,7 +65,7 @@ public:
      * Induce the number of the bars from the header-type.
      */
     uint count_bars(BDF bdf) {
-        switch((conf_read(bdf, 0x3) >> 24) & 0x7f) {
+        switch(device(bdf).header_type()) {
             case 0:
                 return 6;
             case 1:
@@ -74,10 +75,23 @@ public:
         }
     }
 
+    /**
+     * @return the number of MSI-X vectors the given device supports (0 if it has no MSI-X)
+     */
+    uint msix_vectors(BDF bdf) {
+        size_t msix_offset = find_cap(bdf, CAP_MSIX);
+        if(!msix_offset)
+            return 0;
+        return ((conf_read(bdf, msix_offset) >> 16) & 0x7FF) + 1;
+    }
+
     /**
      * Program the nr-th MSI/MSI-X vector of the given device.
+     *
+     * @param cpu the CPU to route the interrupt to
      */
-    Gsi *get_gsi_msi(BDF bdf, uint nr, void *msix_table = nullptr);
+    Gsi *get_gsi_msi(BDF bdf, uint nr, void *msix_table = nullptr,
+                     cpu_t cpu = CPU::current().log_id());
 
     /**
      * Returns the gsi and enables them.
@@ -94,6 +108,19 @@ private:
         conf_write(bdf, msix_offset, 1U << 31);
     }
 
+    /**
+     * @return the properties of the given device. The last one is cached, so that subsequent
+     *  capability lookups don't need any IPC.
+     */
+    const PCIConfig::Device &device(BDF bdf) {
+        if(!_devvalid || _dev.bdf != bdf) {
+            _devvalid = false;
+            _pcicfg.get_device(bdf, _dev);
+            _devvalid = true;
+        }
+        return _dev;
+    }
+
     /**
      * Find the position of a legacy PCI capability.
      */
@@ -118,6 +145,8 @@ private:
 private:
     PCIConfigSession &_pcicfg;
     ACPISession *_acpi;
+    PCIConfig::Device _dev;
+    bool _devvalid;
 };
 
 }
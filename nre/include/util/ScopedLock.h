@@ -49,4 +49,66 @@ private:
     T *_lock;
 };
 
+/**
+ * RAII class for acquiring reader-writer locks for reading. Assumes that the used class template
+ * has the method down_read() to acquire the lock and up_read() to release it.
+ */
+template<class T>
+class ScopedReadLock {
+public:
+    /**
+     * Constructor. Acquires the lock for reading.
+     *
+     * @param lock the pointer to the lock-object
+     */
+    explicit ScopedReadLock(T *lock)
+        : _lock(lock) {
+        _lock->down_read();
+    }
+
+    /**
+     * Destructor. Releases the lock
+     */
+    ~ScopedReadLock() {
+        _lock->up_read();
+    }
+
+private:
+    ScopedReadLock(const ScopedReadLock&);
+    ScopedReadLock& operator=(const ScopedReadLock&);
+
+    T *_lock;
+};
+
+/**
+ * RAII class for acquiring reader-writer locks for writing. Assumes that the used class template
+ * has the method down_write() to acquire the lock and up_write() to release it.
+ */
+template<class T>
+class ScopedWriteLock {
+public:
+    /**
+     * Constructor. Acquires the lock for writing.
+     *
+     * @param lock the pointer to the lock-object
+     */
+    explicit ScopedWriteLock(T *lock)
+        : _lock(lock) {
+        _lock->down_write();
+    }
+
+    /**
+     * Destructor. Releases the lock
+     */
+    ~ScopedWriteLock() {
+        _lock->up_write();
+    }
+
+private:
+    ScopedWriteLock(const ScopedWriteLock&);
+    ScopedWriteLock& operator=(const ScopedWriteLock&);
+
+    T *_lock;
+};
+
 }
@@ -23,7 +23,10 @@
 #include <stream/OStringStream.h>
 #include <util/ScopedLock.h>
 #include <util/Sync.h>
+#include <util/Util.h>
+#include <util/Math.h>
 #include <Logging.h>
+#include <Hip.h>
 #include <CPU.h>
 
 namespace nre {
@@ -36,22 +39,51 @@ namespace nre {
  * It works like the following:
  * - we have a GlobalThread on each CPU, whereas CPU0 runs the "coordinator thread" and all others
  *   run a "helper thread".
- * - when calling del() the object is queued and the coordinator is waked up. At first, he
- *   invalidates the object (which should e.g. revoke the portals). Afterwards he notifies the other
- *   CPUs to call the function, does it as well and waits until they're finished.
- * - Finally, the coordinator deletes the object.
+ * - when calling del() the object is queued and the coordinator is waked up. He takes a batch of
+ *   the queued objects and invalidates them one after another (which should e.g. revoke the
+ *   portals). Afterwards he notifies the other CPUs to call the function once for the whole
+ *   batch, does it as well and waits until they're finished.
+ * - Finally, the coordinator deletes the objects of the batch. They are removed from the queue
+ *   afterwards, so that wait() returns only if all objects have actually been destroyed.
+ *
+ * A batch contains at most MAX_BATCH objects. Additionally, the coordinator stops to invalidate
+ * further objects as soon as the latency target has been exceeded, so that a long queue doesn't
+ * hold back the deletion of the objects at the beginning of it.
  */
 template<class T>
 class ThreadedDeleter {
 public:
+    static const size_t MAX_BATCH           = 32;
+    // the default latency target in milliseconds
+    static const uint DEFAULT_LATENCY       = 10;
+
+    /**
+     * Statistics for monitoring purposes
+     */
+    struct Stats {
+        // the number of objects that are currently waiting to be deleted
+        size_t queued;
+        // the maximum of <queued> so far
+        size_t max_queued;
+        // the number of batches and objects that have been deleted
+        ulong batches;
+        ulong deleted;
+        // the time from del() to the deletion of the oldest object of the last batch and the
+        // maximum so far (in microseconds)
+        timevalue_t last_latency;
+        timevalue_t max_latency;
+    };
+
     /**
      * Creates a new threaded-deleter and uses <name> as prefix for the thread-names.
      *
      * @param name the prefix for the thread-names
+     * @param latency the latency target in milliseconds
      */
-    explicit ThreadedDeleter(const char *name)
+    explicit ThreadedDeleter(const char *name, uint latency = DEFAULT_LATENCY)
             : _sms(new Sm*[CPU::count()]), _gts(new Reference<GlobalThread>[CPU::count()]),
-              _cpu_done(0), _done(0), _sm(), _objs(), _run(true) {
+              _cpu_done(0), _done(0), _sm(), _objs(), _entries(), _batch(), _count(),
+              _latency(latency), _stats(), _run(true) {
         OStringStream os;
         os << "cleanup-" << name;
         for(auto it = CPU::begin(); it != CPU::end(); ++it) {
@@ -80,6 +112,29 @@ public:
         delete[] _gts;
     }
 
+    /**
+     * @return the latency target in milliseconds
+     */
+    uint latency() const {
+        return _latency;
+    }
+    /**
+     * Sets the latency target to <ms> milliseconds
+     */
+    void latency(uint ms) {
+        _latency = ms;
+    }
+
+    /**
+     * @return the current statistics
+     */
+    Stats stats() {
+        ScopedLock<UserSm> guard(&_sm);
+        Stats res = _stats;
+        res.queued = _objs.length();
+        return res;
+    }
+
     /**
      * Deletes the given object. It will wakeup the coordinator and force every CPU to do call().
      * Note that this method doesn't make sure that objects aren't deleted twice! So, the caller
@@ -88,9 +143,11 @@ public:
      * @param obj the object to delete
      */
     void del(T *obj) {
+        Entry *e = new Entry(obj);
         {
             ScopedLock<UserSm> guard(&_sm);
-            _objs.append(obj);
+            _objs.append(e);
+            _stats.max_queued = Math::max(_stats.max_queued, _objs.length());
             LOG(THREADEDDEL, "del(" << obj << ")\n");
         }
         // notify the coordinator-thread
@@ -119,9 +176,24 @@ public:
 
 private:
     /**
-     * Is called by all CPUs. Has to be overridden by the subclass.
+     * A queued object, together with the time it has been queued
      */
-    virtual void call() = 0;
+    struct Entry : public SListItem {
+        explicit Entry(T *obj) : SListItem(), obj(obj), queued(Util::tsc()) {
+        }
+
+        T *obj;
+        timevalue_t queued;
+    };
+
+    /**
+     * Is called by all CPUs once per batch, after all objects of it have been invalidated. Has to
+     * be overridden by the subclass.
+     *
+     * @param objs the objects of the batch
+     * @param count the number of objects
+     */
+    virtual void call(T *const *objs, size_t count) = 0;
     /**
      * Invalidates the given object. This function is called before call() is called by every
      * CPU to e.g. make portals no longer callable by clients.
@@ -138,10 +210,42 @@ private:
         delete obj;
     }
 
-    void remove(T *obj) {
+    /**
+     * Takes the next batch from the queue and invalidates its objects
+     */
+    void invalidate_batch() {
+        timevalue_t deadline = Util::tsc();
+        deadline += static_cast<timevalue_t>(_latency) * Hip::get().freq_tsc;
+        _count = 0;
+        while(_count < MAX_BATCH) {
+            // the objects stay in the queue until they are destroyed, so that wait() works
+            Entry *e = nullptr;
+            {
+                ScopedLock<UserSm> guard(&_sm);
+                auto it = _objs.begin();
+                for(size_t i = 0; i < _count && it != _objs.end(); ++i)
+                    ++it;
+                if(it != _objs.end())
+                    e = &*it;
+            }
+            if(!e)
+                break;
+
+            LOG(THREADEDDEL, "Invalidating " << e->obj << "\n");
+            invalidate(e->obj);
+            _entries[_count] = e;
+            _batch[_count++] = e->obj;
+            if(Util::tsc() >= deadline)
+                break;
+        }
+    }
+
+    void remove_batch() {
         assert(CPU::current().log_id() == 0);
-        LOG(THREADEDDEL, "Deleting " << obj << "\n");
-        invalidate(obj);
+        invalidate_batch();
+        size_t count = _count;
+        if(count == 0)
+            return;
 
         // let all helper threads do call()
         for(size_t i = 1; i < CPU::count(); ++i)
@@ -150,20 +254,31 @@ private:
         // we have to do that as well because the caller of del() might have been on e.g. CPU 1
         // this is safe because when doing del() in a portal, we don't wait anyway and if we wait
         // we don't do that in a portal.
-        call();
+        call(_batch, count);
 
         // wait for the others
         size_t n = CPU::count() - 1;
         while(n-- > 0)
             _cpu_done.down();
 
-        // now it's safe to delete it
+        // now it's safe to delete them
+        for(size_t i = 0; i < count; ++i)
+            destroy(_batch[i]);
+
+        // the first one of the batch is the oldest one, because the queue is FIFO
+        timevalue_t latency = ((Util::tsc() - _entries[0]->queued) * 1000) / Hip::get().freq_tsc;
         {
             ScopedLock<UserSm> guard(&_sm);
-            _objs.remove(obj);
+            for(size_t i = 0; i < count; ++i)
+                _objs.remove(_entries[i]);
+            _stats.last_latency = latency;
+            _stats.max_latency = Math::max(_stats.max_latency, latency);
+            _stats.batches++;
+            _stats.deleted += count;
         }
-        destroy(obj);
-        LOG(THREADEDDEL, "Deletion of " << obj << " completed\n");
+        for(size_t i = 0; i < count; ++i)
+            delete _entries[i];
+        LOG(THREADEDDEL, "Deletion of " << count << " objects completed\n");
     }
 
     static void cleanup_coordinator(void*) {
@@ -175,18 +290,14 @@ private:
                 break;
 
             while(1) {
-                // get first object from list
-                T *obj = nullptr;
                 {
                     ScopedLock<UserSm> guard(&ct->_sm);
-                    if(ct->_objs.length() > 0)
-                        obj = &*ct->_objs.begin();
+                    if(ct->_objs.length() == 0)
+                        break;
                 }
-                if(!obj)
-                    break;
 
-                // delete it
-                ct->remove(obj);
+                // delete the next batch
+                ct->remove_batch();
                 ct->_done.up();
             }
             LOG(THREADEDDEL, "No more objects to delete\n");
@@ -200,7 +311,7 @@ private:
             sm->down();
             if(!ct->_run)
                 break;
-            ct->call();
+            ct->call(ct->_batch, ct->_count);
             ct->_cpu_done.up();
         }
     }
@@ -210,7 +321,12 @@ private:
     Sm _cpu_done;
     Sm _done;
     UserSm _sm;
-    SList<T> _objs;
+    SList<Entry> _objs;
+    Entry *_entries[MAX_BATCH];
+    T *_batch[MAX_BATCH];
+    size_t _count;
+    uint _latency;
+    Stats _stats;
     volatile bool _run;
 };
 
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <arch/Types.h>
+#include <arch/ExecEnv.h>
+#include <util/Util.h>
+#include <util/Math.h>
+#include <Compiler.h>
+
+/**
+ * Records the event <type> for the tracepoint <point> with the argument <arg>. If tracing is
+ * disabled for this Pd, this costs a load and a well predictable branch.
+ */
+#define TRACE(point, type, arg)                                                         \
+    do {                                                                                \
+        if(nre::Trace::enabled(point))                                                  \
+            nre::Trace::record((point), (type), (arg));                                 \
+    }                                                                                   \
+    while(0)
+
+/**
+ * Records a BEGIN event for <point> now and the corresponding END event at the end of the scope
+ */
+#define TRACE_SCOPE(point, arg)     nre::TraceScope __trace_scope((point), (arg))
+
+namespace nre {
+
+class DataSpace;
+class Thread;
+class TracerSession;
+
+/**
+ * Low-overhead event tracing. Every Pd that has tracing enabled gets a trace area from the tracer
+ * service in root, which contains one buffer per thread. A thread claims a buffer when it records
+ * its first event and writes its events into it without any lock or IPC. The buffer is released
+ * when the thread is destroyed, so that its events stay until another thread claims it. The
+ * buffers are rings, i.e. old events are overwritten. The tracer service knows all areas and
+ * merges the buffers by TSC on request.
+ *
+ * Tracing is enabled for a child by passing "trace" or "trace=<hexmask>" on its command line. The
+ * mask of enabled tracepoints is stored in the trace area, so that the tracer can change it at
+ * runtime for all Pds.
+ */
+class Trace {
+public:
+    static const uint32_t MAGIC         = 0x54524345;   // "TRCE"
+    static const uint32_t VERSION       = 2;
+    // the number of buffers per Pd; threads beyond that are not traced, until others exit
+    static const size_t MAX_THREADS     = 32;
+    // the number of events per buffer (has to be a power of 2)
+    static const size_t EVENTS          = 1024;
+    static const size_t MAX_NAME_LEN    = 32;
+
+    /**
+     * The registry of all tracepoints. New ones have to be added here and in Trace::_names.
+     */
+    enum Point {
+        SERVICE_PORTAL,     // open/close session in ServiceCPUHandler; arg = command
+        CHILD_PF,           // pagefault handling in ChildManager; arg = pagefault address
+        STORAGE_REQUEST,    // storage request from submit to completion; arg = tag
+        NET_RECEIVE,        // delivery of a received frame by the network service; arg = length
+        FUNCTION,           // function entry/exit, if built with PROFILE; arg = function address
+        POINT_COUNT
+    };
+
+    enum Type {
+        BEGIN,
+        END,
+        INSTANT,
+        ASYNC_BEGIN,        // begin of an operation that may end in a different thread
+        ASYNC_END,          // the arg is used to match it with the ASYNC_BEGIN
+    };
+
+    struct Event {
+        uint64_t tsc;
+        uint64_t arg;
+        uint16_t point;
+        uint8_t type;
+        uint8_t cpu;
+    } PACKED;
+
+    struct Buffer {
+        // the total number of events written so far; event n is at events[n % EVENTS]
+        volatile uint64_t count;
+        uint32_t thread;
+        // whether a thread owns this buffer at the moment
+        volatile uint32_t used;
+        Event events[EVENTS];
+    } PACKED;
+
+    /**
+     * The trace area of one Pd, located at the beginning of a dataspace
+     */
+    struct Area {
+        uint32_t magic;
+        uint32_t version;
+        volatile word_t mask;
+        // the number of buffers that have been claimed at least once
+        volatile word_t threads;
+        char name[MAX_NAME_LEN];
+        Buffer buffers[MAX_THREADS];
+    } PACKED;
+
+    /**
+     * @return the size of the dataspace for one trace area
+     */
+    static size_t area_size() {
+        return Math::round_up<size_t>(sizeof(Area), ExecEnv::PAGE_SIZE);
+    }
+
+    /**
+     * @return the name of the given tracepoint
+     */
+    static const char *name(uint point) {
+        return point < POINT_COUNT ? _names[point] : "??";
+    }
+
+    /**
+     * @return true if <point> is enabled
+     */
+    static bool enabled(Point point) {
+        // the mask lives in the area, because the tracer changes it at runtime. but we look at it
+        // only if tracing is enabled for this Pd at all
+        return EXPECT_FALSE(_area != nullptr) && (_area->mask & (static_cast<word_t>(1) << point));
+    }
+
+    /**
+     * Records the given event. Should only be used via the TRACE macro.
+     */
+    static void record(Point point, Type type, word_t arg);
+
+    /**
+     * Gives the buffer of <t> back, so that other threads can use it. Is called when <t> is
+     * destroyed.
+     */
+    static void release(Thread *t);
+
+    /**
+     * Initializes the given area and uses it for all following events.
+     *
+     * @param area the trace area (is not copied)
+     * @param name the name of this Pd
+     * @param mask the tracepoints to enable
+     */
+    static void attach(Area *area, const char *name, word_t mask);
+
+    /**
+     * Checks whether tracing has been requested on the command line. If so, the trace area is
+     * requested from the tracer service. Is called during startup.
+     */
+    static void init(int argc, char *argv[]);
+
+private:
+    static Buffer *claim(uint32_t thread);
+
+    static Area *_area;
+    // marks the threads that don't get a buffer anymore
+    static Buffer _untraced;
+    static TracerSession *_sess;
+    static const char *_names[POINT_COUNT];
+};
+
+/**
+ * Records a BEGIN event on construction and an END event on destruction
+ */
+class TraceScope {
+public:
+    explicit TraceScope(Trace::Point point, word_t arg) : _point(point), _arg(arg) {
+        TRACE(_point, Trace::BEGIN, _arg);
+    }
+    ~TraceScope() {
+        TRACE(_point, Trace::END, _arg);
+    }
+
+private:
+    TraceScope(const TraceScope&);
+    TraceScope& operator=(const TraceScope&);
+
+    Trace::Point _point;
+    word_t _arg;
+};
+
+}
@@ -16,6 +16,7 @@
 
 #include <arch/Types.h>
 #include <arch/Startup.h>
+#include <util/Trace.h>
 #include <Compiler.h>
 
 #define MAX_EXIT_FUNCS      32
@@ -72,6 +73,10 @@ void _init(int argc, char **argv) {
     // call constructors
     for(constr_func *func = &CTORS_END; func > &CTORS_BEGIN; )
         (*--func)();
+
+    // now everything is ready to let the child request its trace area, if desired
+    if(_startup_info.child)
+        nre::Trace::init(argc, argv);
 }
 
 int __cxa_atexit(void (*f)(void *), void *p, void *d) {
@@ -19,7 +19,7 @@
 namespace nre {
 
 ServiceSession *Service::new_session(const String &args) {
-    ScopedLock<UserSm> guard(&_sm);
+    ScopedWriteLock<RWLock> guard(&_sm);
     ServiceSession *sess = create_session(_next_id++, args, _func);
     _sessions.insert(sess);
     return sess;
@@ -29,11 +29,13 @@ void Service::remove_session(ServiceSession *sess) {
     // take care that we don't delete a session twice.
     bool del = false;
     {
-        ScopedLock<UserSm> guard(&_sm);
+        ScopedWriteLock<RWLock> guard(&_sm);
         del = _sessions.remove(sess);
     }
-    if(del)
+    if(del) {
+        sess->closed();
         _deleter.del(sess);
+    }
 }
 
 }
@@ -17,6 +17,7 @@
 #include <ipc/ServiceCPUHandler.h>
 #include <ipc/Service.h>
 #include <utcb/UtcbFrame.h>
+#include <util/Trace.h>
 #include <Logging.h>
 
 namespace nre {
@@ -36,6 +37,7 @@ void ServiceCPUHandler::portal(void*) {
         Service::Command cmd;
         String name;
         uf >> cmd >> name;
+        TRACE_SCOPE(Trace::SERVICE_PORTAL, cmd);
         switch(cmd) {
             case Service::OPEN_SESSION: {
                 String args;
@@ -33,4 +33,15 @@ void Sc::start(const String &name, void *ptr) {
     uf >> _qpd;
 }
 
+cpu_t Sc::migration(bool migratable) {
+    UtcbFrame uf;
+    uf << Sc::MIGRATION << migratable;
+    uf.translate(sel());
+    CPU::current().sc_pt().call(uf);
+    uf.check_reply();
+    cpu_t cpu;
+    uf >> cpu;
+    return cpu;
+}
+
 }
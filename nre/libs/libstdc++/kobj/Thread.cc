@@ -14,37 +14,53 @@
  * General Public License version 2 for more details.
  */
 
+#include <arch/Startup.h>
 #include <kobj/Sc.h>
 #include <kobj/Thread.h>
 #include <kobj/Pt.h>
 #include <utcb/UtcbFrame.h>
+#include <util/Math.h>
+#include <util/Trace.h>
 #include <CPU.h>
 #include <RCU.h>
 
 namespace nre {
 
+#ifdef PROFILE
+// gives the shadow stack of <t> back to the function profiler (see profile.cc)
+void profile_release(Thread *t);
+#endif
+
 // slot 0 is reserved
 size_t Thread::_tls_idx = 1;
 
 Thread::Thread(Pd *pd, Syscalls::ECType type, ExecEnv::startup_func start, uintptr_t ret, cpu_t cpu,
                capsel_t evb, uintptr_t stack, uintptr_t uaddr)
     : Ec(cpu, evb, create(this, pd, type, cpu, evb, start, ret, uaddr, stack, _flags)),
-      SListItem(), RefCounted(), _rcu_counter(0), _utcb_addr(uaddr), _stack_addr(stack), _tls() {
+      SListItem(), RefCounted(), _rcu_counter(0), _trace(), _profile(), _utcb_addr(uaddr),
+      _stack_addr(stack), _tls() {
 }
 
 Thread::Thread(cpu_t cpu, capsel_t evb, capsel_t cap, uintptr_t stack, uintptr_t uaddr)
-    : Ec(cpu, evb, cap), SListItem(), RefCounted(), _rcu_counter(0), _utcb_addr(uaddr), _stack_addr(stack),
-      _flags(), _tls() {
+    : Ec(cpu, evb, cap), SListItem(), RefCounted(), _rcu_counter(0), _trace(), _profile(),
+      _utcb_addr(uaddr), _stack_addr(stack), _flags(), _tls() {
 }
 
 capsel_t Thread::create(Thread *t, Pd *pd, Syscalls::ECType type, cpu_t cpu, capsel_t evb,
                         ExecEnv::startup_func start, uintptr_t ret, uintptr_t &uaddr,
                         uintptr_t &stack, uint &flags) {
-    // request stack and utcb from parent, if necessary
+    // request stack and utcb from parent, if necessary. the parent creates the portals for a CPU
+    // only when we use it the first time, so we have to ask him as well, if we create an Ec on a
+    // different CPU.
     flags = HAS_OWN_STACK | HAS_OWN_UTCB;
-    if(stack == 0 || uaddr == 0) {
+    bool othercpu = _startup_info.child && pd == Pd::current() && cpu != CPU::current().log_id();
+    if(stack == 0 || uaddr == 0 || othercpu) {
         UtcbFrame uf;
-        uf << Sc::ALLOC << (stack == 0) << (uaddr == 0);
+        if(othercpu) {
+            capsel_t caps = Hip::get().service_caps();
+            uf.delegation_window(Crd(cpu * caps, Math::next_pow2_shift(caps), Crd::OBJ_ALL));
+        }
+        uf << Sc::ALLOC << (stack == 0) << (uaddr == 0) << cpu;
         CPU::current().sc_pt().call(uf);
         uf.check_reply();
         if(stack == 0) {
@@ -69,6 +85,10 @@ capsel_t Thread::create(Thread *t, Pd *pd, Syscalls::ECType type, cpu_t cpu, cap
 
 Thread::~Thread() {
     RCU::remove(this);
+    Trace::release(this);
+#ifdef PROFILE
+    profile_release(this);
+#endif
 }
 
 }
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <kobj/UserSm.h>
+#include <util/LockStats.h>
+#include <util/Math.h>
+#include <util/Util.h>
+
+namespace nre {
+
+void UserSm::account(bool contended, bool blocked, timevalue_t waited) {
+    _stats->record(contended, blocked, waited);
+}
+
+void UserSm::down_slow() {
+    timevalue_t start = Util::tsc();
+    Thread *t = ExecEnv::get_current_thread();
+    cpu_t owner = _owner;
+
+    // spinning only makes sense if the holder is able to make progress meanwhile
+    if(t && owner != NO_OWNER && owner != t->cpu()) {
+        uint spins = _spins;
+        for(uint i = 0; i < spins; ++i) {
+            Util::pause();
+            if(_value > 0 && decrease()) {
+                // it was worth it, so try it a bit longer next time
+                _spins = Math::min<uint>(spins * 2, MAX_SPINS);
+                acquired(true, false, Util::tsc() - start);
+                return;
+            }
+        }
+        _spins = Math::max<uint>(spins / 2, MIN_SPINS);
+    }
+
+    if(Atomic::add(&_value, -1) <= 0)
+        _sem.down();
+    acquired(true, true, Util::tsc() - start);
+}
+
+}
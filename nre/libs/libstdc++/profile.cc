@@ -15,145 +15,143 @@
  */
 
 #include <arch/Startup.h>
-#include <arch/SpinLock.h>
+#include <arch/ExecEnv.h>
 #include <kobj/Thread.h>
-#include <util/ScopedLock.h>
-#include <util/Math.h>
+#include <util/Trace.h>
 #include <Compiler.h>
-#include <Assert.h>
-#include <Hip.h>
 
-#define MAX_EVENTS  1024
-#define STACK_SIZE  1024
 #define NOINSTR     __attribute__ ((no_instrument_function))
 
 #ifdef PROFILE
-struct ProfileEvent {
-    enum {ENTER, LEAVE} type;
-    int tid;
-    uintptr_t func;
-    timevalue_t time;
-    ProfileEvent *next;
-};
-
-NOINSTR static uint8_t inb(uint16_t port);
-NOINSTR static void outb(uint16_t port, uint8_t value);
-NOINSTR static timevalue_t rdtsc();
-NOINSTR static void logc(char c);
-NOINSTR static void logu(ulong u, uint base);
-NOINSTR static void init();
-NOINSTR static ProfileEvent *alloc();
 
 EXTERN_C NOINSTR void __cyg_profile_func_enter(void *this_fn, void *call_site);
 EXTERN_C NOINSTR void __cyg_profile_func_exit(void *this_fn, void *call_site);
 
-static ProfileEvent *evfree = nullptr;
-static ProfileEvent *evlist = nullptr;
-static ProfileEvent *evend = nullptr;
-static ProfileEvent evbuf[MAX_EVENTS];
-static nre::SpinLock spin;
-
-static bool inited = false;
-static size_t stackPos = 0;
-static bool inProf = false;
-static timevalue_t callStack[STACK_SIZE];
-
-static inline uint8_t inb(uint16_t port) {
-    uint8_t val;
-    asm volatile ("inb %1, %0" : "=a" (val) : "d" (port));
-    return val;
-}
-static inline void outb(uint16_t port, uint8_t value) {
-    asm volatile ("outb %0, %1" : : "a" (value), "d" (port));
-}
+namespace nre {
 
-static inline timevalue_t rdtsc() {
-    uint32_t u, l;
-    asm volatile ("rdtsc" : "=a" (l), "=d" (u));
-    return (timevalue_t)u << 32 | l;
-}
+/**
+ * Records function entries and exits as events of the tracepoint Trace::FUNCTION, i.e. in the
+ * per-thread buffers of the trace area, with the exact thread id and CPU. Thus, it needs tracing
+ * to be enabled for this Pd. The events can be merged and written to the log via the tracer
+ * service and turned into folded stacks by tools/profold.
+ *
+ * Every thread has a shadow stack of the functions it is in, which serves two purposes: first, it
+ * contains a flag that prevents us from profiling the profiler. second, it allows us to close
+ * the frames of functions that have been left via an exception, because these don't get an exit
+ * event from the compiler.
+ *
+ * The shadow stacks are taken from a static pool, because we can't use the heap here. A thread
+ * gives its slot back when it is destroyed (see Thread::~Thread).
+ *
+ * Note that everything that is called before the flag is set, has to be NOINSTR, including inline
+ * functions, because the compiler instruments them as well.
+ */
+class FuncProfiler {
+public:
+    static const size_t MAX_THREADS = 64;
+    static const size_t MAX_DEPTH   = 256;
 
-static void logc(char c) {
-    outb(0x3f8, c);
-    while((inb(0x3fd) & 0x20) == 0)
-        ;
-}
-static void logu(ulong u, uint base) {
-    if(u >= base)
-        logu(u / base, base);
-    logc("0123456789ABCDEF"[(u % base)]);
-}
+    struct State {
+        bool used;
+        bool busy;
+        size_t depth;
+        uintptr_t stack[MAX_DEPTH];
+    };
 
-static void init() {
-    evfree = nullptr;
-    for(size_t i = 0; i < MAX_EVENTS; ++i) {
-        evbuf[i].next = evfree;
-        evfree = evbuf + i;
+    static NOINSTR State *get() {
+        if(!_startup_info.done)
+            return nullptr;
+        Thread *t = current();
+        if(EXPECT_FALSE(t->_profile == nullptr))
+            t->_profile = alloc();
+        State *s = static_cast<State*>(t->_profile);
+        if(s->busy)
+            return nullptr;
+        s->busy = true;
+        return s;
     }
-    inited = true;
-}
 
-static ProfileEvent *alloc() {
-    nre::ScopedLock<nre::SpinLock> guard(&spin);
-    ProfileEvent *ev = evfree;
-    if(!ev) {
-        ev = evlist;
-        while(ev) {
-            logc(ev->type == ProfileEvent::ENTER ? '>' : '<');
-            logu(ev->tid, 10);
-            logc(':');
-            if(ev->type == ProfileEvent::ENTER)
-                logu(ev->func, 16);
-            else
-                logu(ev->time, 10);
-            logc('\n');
-            ev = ev->next;
+    static NOINSTR void enter(State *s, uintptr_t func) {
+        if(s->depth < MAX_DEPTH)
+            s->stack[s->depth] = func;
+        s->depth++;
+        TRACE(Trace::FUNCTION, Trace::BEGIN, func);
+    }
+
+    static NOINSTR void leave(State *s, uintptr_t func) {
+        // if we don't know the function (e.g. it has been entered before we started), ignore it
+        size_t depth = s->depth;
+        while(depth > 0 && depth <= MAX_DEPTH && s->stack[depth - 1] != func)
+            depth--;
+        if(depth == 0)
+            return;
+
+        // close all frames above it; they have been left by an exception
+        while(s->depth >= depth) {
+            s->depth--;
+            uintptr_t f = s->depth < MAX_DEPTH ? s->stack[s->depth] : 0;
+            TRACE(Trace::FUNCTION, Trace::END, f);
         }
-        evfree = evlist;
-        evlist = nullptr;
-        evend = nullptr;
-        ev = evfree;
     }
-    evfree = evfree->next;
-    ev->next = nullptr;
-    if(evend)
-        evend->next = ev;
-    else
-        evlist = ev;
-    evend = ev;
-    return ev;
+
+    static NOINSTR void release(Thread *t) {
+        State *s = static_cast<State*>(t->_profile);
+        // from now on, the thread is not profiled anymore, because its destruction is instrumented
+        // as well
+        t->_profile = &_nostate;
+        if(s >= _states && s < _states + MAX_THREADS) {
+            s->busy = false;
+            s->depth = 0;
+            __sync_synchronize();
+            s->used = false;
+        }
+    }
+
+private:
+    static NOINSTR State *alloc() {
+        for(size_t i = 0; i < MAX_THREADS; ++i) {
+            if(__sync_bool_compare_and_swap(&_states[i].used, false, true))
+                return _states + i;
+        }
+        // if there are more than MAX_THREADS threads at once, the others are not profiled
+        return &_nostate;
+    }
+
+    static NOINSTR Thread *current() {
+        // don't use ExecEnv::get_current_thread() here, because it might be instrumented
+        uintptr_t sp;
+        asm volatile ("mov %%" EXPAND(REG(sp)) ", %0" : "=g" (sp));
+        return *reinterpret_cast<Thread**>((sp & ~(ExecEnv::STACK_SIZE - 1)) +
+                                           ExecEnv::STACK_SIZE - sizeof(void*));
+    }
+
+    static State _states[MAX_THREADS];
+    static State _nostate;
+};
+
+FuncProfiler::State FuncProfiler::_states[MAX_THREADS];
+FuncProfiler::State FuncProfiler::_nostate = {true, true, 0, {0}};
+
+NOINSTR void profile_release(Thread *t) {
+    FuncProfiler::release(t);
+}
+
 }
 
 void __cyg_profile_func_enter(void *this_fn, UNUSED void *call_site) {
-    if(inProf || _startup_info.child || !_startup_info.done)
-        return;
-    if(!inited)
-        init();
-    inProf = true;
-    ProfileEvent *ev = alloc();
-    ev->type = ProfileEvent::ENTER;
-    ev->tid = ((ulong) nre::Thread::current()->utcb() >> 12) % 64;
-    ev->func = (ulong)this_fn;
-    ev->time = rdtsc();
-    callStack[stackPos++] = ev->time;
-    inProf = false;
+    nre::FuncProfiler::State *s = nre::FuncProfiler::get();
+    if(s) {
+        nre::FuncProfiler::enter(s, reinterpret_cast<uintptr_t>(this_fn));
+        s->busy = false;
+    }
 }
 
-void __cyg_profile_func_exit(UNUSED void *this_fn, UNUSED void *call_site) {
-    timevalue_t now = rdtsc();
-    if(inProf || _startup_info.child || !_startup_info.done || stackPos <= 0)
-        return;
-    inProf = true;
-    timevalue_t lastsched = nre::Hip::get().last_sched;
-    ProfileEvent *ev = alloc();
-    stackPos--;
-    ev->type = ProfileEvent::LEAVE;
-    ev->tid = ((ulong) nre::Thread::current()->utcb() >> 12) % 64;
-    if(lastsched > callStack[stackPos])
-        ev->time = nre::Math::min<timevalue_t>((now - lastsched) * 2, now - callStack[stackPos]);
-    else
-        ev->time = now - callStack[stackPos];
-    inProf = false;
+void __cyg_profile_func_exit(void *this_fn, UNUSED void *call_site) {
+    nre::FuncProfiler::State *s = nre::FuncProfiler::get();
+    if(s) {
+        nre::FuncProfiler::leave(s, reinterpret_cast<uintptr_t>(this_fn));
+        s->busy = false;
+    }
 }
 
 #endif
@@ -62,7 +62,17 @@ void VGAStream::put(ushort value, ushort *base, uint &pos) {
         memmove(base, base + COLS, (ROWS - 1) * COLS * 2);
         memset(base + (ROWS - 1) * COLS, 0, COLS * 2);
         pos = COLS * (ROWS - 1);
+        damage(base, 0, COLS * ROWS);
     }
-    if(visible)
+    if(visible) {
+        damage(base, pos, 1);
         base[pos++] = value;
+    }
+}
+
+void VGAStream::damage(ushort *base, uint pos, uint count) {
+    const DataSpace &screen = _sess.screen();
+    uintptr_t addr = reinterpret_cast<uintptr_t>(base + pos);
+    if(addr >= screen.virt() && addr < screen.virt() + screen.size())
+        _sess.damage(addr - screen.virt(), count * 2);
 }
@@ -26,6 +26,7 @@ namespace nre {
 
 Child::~Child() {
     delete[] _pts;
+    delete[] _handlers;
     delete _pd;
     destroy_sc(_ec->sc()->sel());
     release_gsis();
@@ -34,6 +35,7 @@ Child::~Child() {
     release_regs();
     release_sessions();
     CapSelSpace::get().free(_gsi_caps, Hip::MAX_GSIS);
+    _cm->unreserve(_quota);
     Atomic::add(&_cm->_child_count, -1);
     Sync::memory_fence();
     _cm->_diesm.up();
@@ -42,13 +44,19 @@ Child::~Child() {
 const ClientSession *Child::open_session(const String &name, const String &args,
                                          const ServiceRegistry::Service *s) {
     ScopedLock<UserSm> guard(&_sm);
-    // atm, we simply accept all sessions here. later we might restrict the number of sessions
-    // per service and client
+    // we accept all sessions as long as the quota allows it
+    _quota.charge(ChildQuota::SESSION, 1, ChildQuota::CAPS, 1 << CPU::order());
     ClientSession *sess;
-    if(s)
-        sess = new ClientSession(name, args, s->pts());
-    else
-        sess = new ClientSession(name, args);
+    try {
+        if(s)
+            sess = new ClientSession(name, args, s->pts());
+        else
+            sess = new ClientSession(name, args);
+    }
+    catch(...) {
+        _quota.release(ChildQuota::SESSION, 1, ChildQuota::CAPS, 1 << CPU::order());
+        throw;
+    }
     _sessions.append(sess);
     return sess;
 }
@@ -59,12 +67,30 @@ void Child::close_session(capsel_t handle) {
         if(it->caps() + CPU::current().log_id() == handle) {
             _sessions.remove(&*it);
             delete &*it;
+            _quota.release(ChildQuota::SESSION, 1, ChildQuota::CAPS, 1 << CPU::order());
             return;
         }
     }
     VTHROW(Exception, E_NOT_FOUND, "Session with handle " << handle << " not found");
 }
 
+void Child::charge_ds(size_t mem) {
+    // every dataspace comes with an unmap capability
+    _quota.charge(ChildQuota::DS, 1, ChildQuota::CAPS, 1);
+    try {
+        _quota.charge(ChildQuota::MEM, mem);
+    }
+    catch(...) {
+        _quota.release(ChildQuota::DS, 1, ChildQuota::CAPS, 1);
+        throw;
+    }
+}
+
+void Child::release_ds(size_t mem) {
+    _quota.release(ChildQuota::DS, 1, ChildQuota::CAPS, 1);
+    _quota.release(ChildQuota::MEM, mem);
+}
+
 void Child::alloc_thread(uintptr_t *stack_addr, uintptr_t *utcb_addr) {
     ScopedLock<UserSm> childguard(&_sm);
     // TODO we might leak resources here if something fails
@@ -72,6 +98,7 @@ void Child::alloc_thread(uintptr_t *stack_addr, uintptr_t *utcb_addr) {
         uint align = Math::next_pow2_shift(ExecEnv::STACK_SIZE);
         DataSpaceDesc desc(ExecEnv::STACK_SIZE, DataSpaceDesc::ANONYMOUS,
                            DataSpaceDesc::RW, 0, 0, align - ExecEnv::PAGE_SHIFT);
+        charge_ds(ExecEnv::STACK_SIZE);
         const DataSpace &ds = _cm->_dsm.create(desc);
         *stack_addr = _regs.find_free(ds.size(), ExecEnv::STACK_SIZE);
         _regs.add(ds.desc(), *stack_addr, ds.flags() | ChildMemory::OWN, ds.unmapsel());
@@ -85,8 +112,9 @@ void Child::alloc_thread(uintptr_t *stack_addr, uintptr_t *utcb_addr) {
 
 capsel_t Child::create_thread(capsel_t ec, const String &name, void *ptr, cpu_t cpu, Qpd &qpd) {
     // TODO later one could add policy here and adjust the qpd accordingly
+    _quota.charge(ChildQuota::SC, 1, ChildQuota::CAPS, 1);
     capsel_t sc;
-    {
+    try {
         UtcbFrame puf;
         puf.accept_delegates(0);
         // we don't want to join this thread
@@ -97,6 +125,10 @@ capsel_t Child::create_thread(capsel_t ec, const String &name, void *ptr, cpu_t
         sc = puf.get_delegated(0).offset();
         puf >> qpd;
     }
+    catch(...) {
+        _quota.release(ChildQuota::SC, 1, ChildQuota::CAPS, 1);
+        throw;
+    }
 
     ScopedLock<UserSm> guard(&_sm);
     _scs.append(new SchedEntity(ptr, name, cpu, sc));
@@ -144,6 +176,7 @@ void Child::term_thread(void *ptr, uintptr_t stack, uintptr_t utcb) {
         capsel_t sel;
         DataSpaceDesc desc = _regs.remove_by_addr(stack, &sel);
         _cm->_dsm.release(desc, sel);
+        release_ds(desc.size());
     }
     // TODO if(utcb)
     //   c->reglist().remove_by_addr(utcb);
@@ -167,6 +200,24 @@ void Child::remove_thread(capsel_t cap) {
         destroy_thread(se);
 }
 
+cpu_t Child::migrate_thread(capsel_t cap, bool migratable) {
+    {
+        ScopedLock<UserSm> guard(&_sm);
+        if(!get_thread_by_cap(cap))
+            VTHROW(Exception, E_NOT_FOUND, "Unable to find Sc " << cap);
+    }
+
+    // the decision is made by root, so just pass it on
+    UtcbFrame uf;
+    uf << Sc::MIGRATION << migratable;
+    uf.translate(cap);
+    CPU::current().sc_pt().call(uf);
+    uf.check_reply();
+    cpu_t cpu;
+    uf >> cpu;
+    return cpu;
+}
+
 void Child::destroy_sc(capsel_t cap) {
     UtcbFrame uf;
     uf << Sc::DESTROY;
@@ -180,6 +231,7 @@ void Child::destroy_thread(SchedEntity *se) {
     LOG(ADMISSION, "Child '" << cmdline() << "' destroyed sc " << se->ptr() << ":" << se->name() << "\n");
     _scs.remove(se);
     delete se;
+    _quota.release(ChildQuota::SC, 1, ChildQuota::CAPS, 1);
 }
 
 void Child::release_gsis() {
@@ -242,6 +294,7 @@ OStream & operator<<(OStream &os, const Child &c) {
     os << "\tScs:\n";
     for(auto it = c.scs().cbegin(); it != c.scs().cend(); ++it)
         os << "\t\t" << it->name() << " on CPU " << CPU::get(it->cpu()).phys_id() << "\n";
+    os << "\tQuota: " << c.quota() << "\n";
     os << "\tGSIs: " << c.gsis() << "\n";
     os << "\tPorts:\n" << c.io();
     os << c.reglist();
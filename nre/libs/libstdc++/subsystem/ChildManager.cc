@@ -22,30 +22,56 @@
 #include <kobj/Ports.h>
 #include <arch/Elf.h>
 #include <util/Math.h>
+#include <util/Trace.h>
+#include <util/Util.h>
 #include <Logging.h>
 #include <new>
 
 namespace nre {
 
-ChildManager::ChildManager()
-    : _next_id(0), _child_count(0), _childs(), _deleter(this), _dsm(), _registry(), _sm(),
-      _switchsm(), _slotsm(), _regsm(0), _diesm(0), _ecs(), _srvecs() {
-    _ecs = new Reference<LocalThread>[CPU::count()];
-    _srvecs = new Reference<LocalThread>[CPU::count()];
+// the exception portals get the state that is required to handle the fault or kill the child
+static const word_t EXC_MTD = Mtd::GPR_ACDB | Mtd::GPR_BSD | Mtd::RSP | Mtd::RFLAGS | Mtd::QUAL |
+                              Mtd::RIP_LEN;
+
+const ChildManager::Portals::Desc ChildManager::Portals::descs[] = {
+    {CapSelSpace::EV_DIVIDE,     ex_de,      EXC_MTD,  false},
+    {CapSelSpace::EV_DEBUG,      ex_db,      EXC_MTD,  false},
+    {CapSelSpace::EV_BREAKPOINT, ex_bp,      EXC_MTD,  false},
+    {CapSelSpace::EV_OVERFLOW,   ex_of,      EXC_MTD,  false},
+    {CapSelSpace::EV_BOUNDRANGE, ex_br,      EXC_MTD,  false},
+    {CapSelSpace::EV_UNDEFOP,    ex_ud,      EXC_MTD,  false},
+    {CapSelSpace::EV_NOMATHPROC, ex_nm,      EXC_MTD,  false},
+    {CapSelSpace::EV_DBLFAULT,   ex_df,      EXC_MTD,  false},
+    {CapSelSpace::EV_TSS,        ex_ts,      EXC_MTD,  false},
+    {CapSelSpace::EV_INVSEG,     ex_np,      EXC_MTD,  false},
+    {CapSelSpace::EV_STACK,      ex_ss,      EXC_MTD,  false},
+    {CapSelSpace::EV_GENPROT,    ex_gp,      EXC_MTD,  false},
+    {CapSelSpace::EV_PAGEFAULT,  ex_pf,      EXC_MTD,  false},
+    {CapSelSpace::EV_MATHFAULT,  ex_mf,      EXC_MTD,  false},
+    {CapSelSpace::EV_ALIGNCHK,   ex_ac,      EXC_MTD,  false},
+    {CapSelSpace::EV_MACHCHK,    ex_mc,      EXC_MTD,  false},
+    {CapSelSpace::EV_SIMD,       ex_xm,      EXC_MTD,  false},
+    {CapSelSpace::EV_STARTUP,    startup,    Mtd::RSP, false},
+    {CapSelSpace::SRV_INIT,      init_caps,  0,        false},
+    {CapSelSpace::SRV_SERVICE,   service,    0,        true},
+    {CapSelSpace::SRV_IO,        io,         0,        false},
+    {CapSelSpace::SRV_SC,        sc,         0,        false},
+    {CapSelSpace::SRV_GSI,       gsi,        0,        false},
+    {CapSelSpace::SRV_DS,        dataspace,  0,        false},
+};
+
+ChildManager::ChildManager(size_t pool)
+    : _next_id(0), _child_count(0), _pool(pool), _childs(), _deleter(this), _dsm(), _registry(),
+      _budget(), _sm(), _switchsm(), _slotsm(), _diesm(0), _exits(), _exit_rpos(),
+      _exit_wpos(), _ecs(), _srvecs() {
+    _ecs = new Reference<LocalThread>[CPU::count() * _pool];
+    _srvecs = new Reference<LocalThread>[CPU::count() * _pool];
     for(auto it = CPU::begin(); it != CPU::end(); ++it) {
-        _ecs[it->log_id()] = LocalThread::create(it->log_id());
-        _ecs[it->log_id()]->set_tls(Thread::TLS_PARAM, this);
-
-        _srvecs[it->log_id()] = LocalThread::create(it->log_id());
-        _srvecs[it->log_id()]->set_tls(Thread::TLS_PARAM, this);
-
-        UtcbFrameRef defuf(_ecs[it->log_id()]->utcb());
-        defuf.accept_translates();
-        defuf.accept_delegates(0);
-
-        UtcbFrameRef srvuf(_srvecs[it->log_id()]->utcb());
-        srvuf.accept_translates();
-        srvuf.accept_delegates(Math::next_pow2_shift<size_t>(CPU::count()));
+        for(size_t i = 0; i < _pool; ++i) {
+            size_t idx = it->log_id() * _pool + i;
+            _ecs[idx] = create_handler(it->log_id(), 0);
+            _srvecs[idx] = create_handler(it->log_id(), Math::next_pow2_shift<size_t>(CPU::count()));
+        }
     }
 }
 
@@ -53,13 +79,92 @@ ChildManager::~ChildManager() {
     {
         Reference<Child> child;
         while((child = get_first()).valid())
-            destroy_child(&*child);
+            destroy_child(&*child, KILLED, 0);
         _deleter.wait();
     }
     delete[] _ecs;
     delete[] _srvecs;
 }
 
+Reference<LocalThread> ChildManager::create_handler(cpu_t cpu, uint order) {
+    Reference<LocalThread> ec = LocalThread::create(cpu);
+    ec->set_tls(Thread::TLS_PARAM, this);
+    UtcbFrameRef uf(ec->utcb());
+    uf.accept_translates();
+    uf.accept_delegates(order);
+    return ec;
+}
+
+void ChildManager::create_portals(Child *c, cpu_t cpu) {
+    static_assert(ARRAY_SIZE(Portals::descs) == Portals::PER_CPU, "Portals::PER_CPU is wrong");
+    ScopedLock<UserSm> guard(&c->_sm);
+    size_t idx = cpu * Portals::PER_CPU;
+    if(c->_pts[idx])
+        return;
+
+    Reference<LocalThread> ec = _ecs[cpu * _pool + c->_slot];
+    if(c->_handlers) {
+        if(!c->_handlers[cpu].valid())
+            c->_handlers[cpu] = create_handler(cpu, 0);
+        ec = c->_handlers[cpu];
+    }
+    Reference<LocalThread> srvec = _srvecs[cpu * _pool + c->_slot];
+
+    capsel_t off = c->_ptsel + cpu * Hip::get().service_caps();
+    try {
+        for(size_t i = 0; i < Portals::PER_CPU; ++i) {
+            const Portals::Desc *d = Portals::descs + i;
+            c->_pts[idx + i] = new Pt(d->srv ? srvec : ec, off + d->no,
+                                      reinterpret_cast<Pt::portal_func>(d->portal), Mtd(d->mtd));
+            c->_pts[idx + i]->set_id(reinterpret_cast<word_t>(c));
+        }
+    }
+    catch(...) {
+        for(size_t i = 0; i < Portals::PER_CPU; ++i) {
+            delete c->_pts[idx + i];
+            c->_pts[idx + i] = nullptr;
+        }
+        throw;
+    }
+}
+
+void ChildManager::delegate_portals(UtcbFrameRef &uf, Child *c, cpu_t cpu) {
+    create_portals(c, cpu);
+    // the child has opened a delegation window for the capabilities of <cpu>. so, we use the
+    // offset within that range as hotspot
+    size_t idx = cpu * Portals::PER_CPU;
+    capsel_t off = c->_ptsel + cpu * Hip::get().service_caps();
+    for(size_t i = 0; i < Portals::PER_CPU; ++i)
+        uf.delegate(c->_pts[idx + i]->sel(), c->_pts[idx + i]->sel() - off);
+}
+
+void ChildManager::reserve(const ChildQuota &quota) {
+    size_t i = 0;
+    try {
+        for(; i < ChildQuota::COUNT; ++i) {
+            ChildQuota::Resource r = static_cast<ChildQuota::Resource>(i);
+            if(quota.limit(r) != ChildQuota::UNLIMITED)
+                _budget.charge(r, quota.limit(r));
+        }
+    }
+    catch(...) {
+        while(i-- > 0) {
+            ChildQuota::Resource r = static_cast<ChildQuota::Resource>(i);
+            if(quota.limit(r) != ChildQuota::UNLIMITED)
+                _budget.release(r, quota.limit(r));
+        }
+        throw;
+    }
+}
+
+void ChildManager::unreserve(const ChildQuota &quota) {
+    for(size_t i = 0; i < ChildQuota::COUNT; ++i) {
+        ChildQuota::Resource r = static_cast<ChildQuota::Resource>(i);
+        if(quota.limit(r) != ChildQuota::UNLIMITED)
+            _budget.release(r, quota.limit(r));
+    }
+}
+
 void ChildManager::prepare_stack(Child *c, uintptr_t &sp, uintptr_t csp) {
     /*
      * Initial stack:
@@ -180,71 +285,34 @@ Child::id_type ChildManager::load(uintptr_t addr, size_t size, const ChildConfig
          elf->e_ident[2] == 'L' && elf->e_ident[3] == 'F'))
         throw ElfException(E_ELF_SIG, "No ELF signature");
 
-    static struct {
-        int no;
-        PORTAL void (*portal)(Child*);
-    } exc[] = {
-        {CapSelSpace::EV_DIVIDE,        Portals::ex_de},
-        {CapSelSpace::EV_DEBUG,         Portals::ex_db},
-        {CapSelSpace::EV_BREAKPOINT,    Portals::ex_bp},
-        {CapSelSpace::EV_OVERFLOW,      Portals::ex_of},
-        {CapSelSpace::EV_BOUNDRANGE,    Portals::ex_br},
-        {CapSelSpace::EV_UNDEFOP,       Portals::ex_ud},
-        {CapSelSpace::EV_NOMATHPROC,    Portals::ex_nm},
-        {CapSelSpace::EV_DBLFAULT,      Portals::ex_df},
-        {CapSelSpace::EV_TSS,           Portals::ex_ts},
-        {CapSelSpace::EV_INVSEG,        Portals::ex_np},
-        {CapSelSpace::EV_STACK,         Portals::ex_ss},
-        {CapSelSpace::EV_GENPROT,       Portals::ex_gp},
-        {CapSelSpace::EV_PAGEFAULT,     Portals::ex_pf},
-        {CapSelSpace::EV_MATHFAULT,     Portals::ex_mf},
-        {CapSelSpace::EV_ALIGNCHK,      Portals::ex_ac},
-        {CapSelSpace::EV_MACHCHK,       Portals::ex_mc},
-        {CapSelSpace::EV_SIMD,          Portals::ex_xm},
-    };
+    // the limits of the child are taken from our budget until it dies. as soon as the child
+    // exists, its destructor gives them back
+    reserve(config.quota());
 
     // create child
-    capsel_t pts = CapSelSpace::get().allocate(per_child_caps(), per_child_caps());
-    Child *c = new Child(this, _next_id++, config.cmdline());
+    capsel_t pts;
+    Child *c;
     try {
-        // we have to create the portals first to be able to delegate them to the new Pd
-        c->_ptcount = CPU::count() * (ARRAY_SIZE(exc) + Portals::COUNT - 1);
+        pts = CapSelSpace::get().allocate(per_child_caps(), per_child_caps());
+        c = new Child(this, _next_id++, config.cmdline(), config.quota());
+    }
+    catch(...) {
+        unreserve(config.quota());
+        throw;
+    }
+    try {
+        // we have to create the portals first to be able to delegate them to the new Pd. but we
+        // do that only for the CPU of the main thread; the others follow as soon as the child
+        // creates a thread on them (see Portals::sc).
+        c->_ptsel = pts;
+        c->_ptcount = CPU::count() * Portals::PER_CPU;
         c->_pts = new Pt *[c->_ptcount];
         memset(c->_pts, 0, c->_ptcount * sizeof(Pt*));
-        for(cpu_t cpu = 0; cpu < CPU::count(); ++cpu) {
-            size_t idx = cpu * (ARRAY_SIZE(exc) + Portals::COUNT - 1);
-            size_t off = cpu * Hip::get().service_caps();
-            size_t i = 0;
-            for(; i < ARRAY_SIZE(exc); ++i) {
-                c->_pts[idx + i] = new Pt(_ecs[cpu], pts + off + exc[i].no,
-                                          reinterpret_cast<Pt::portal_func>(exc[i].portal),
-                                          Mtd(Mtd::GPR_ACDB | Mtd::GPR_BSD | Mtd::RSP | Mtd::RFLAGS |
-                                              Mtd::QUAL | Mtd::RIP_LEN));
-            }
-            c->_pts[idx + i++] = new Pt(_ecs[cpu], pts + off + CapSelSpace::EV_STARTUP,
-                                        reinterpret_cast<Pt::portal_func>(Portals::startup),
-                                        Mtd(Mtd::RSP));
-            c->_pts[idx + i++] = new Pt(_ecs[cpu], pts + off + CapSelSpace::SRV_INIT,
-                                        reinterpret_cast<Pt::portal_func>(Portals::init_caps),
-                                        Mtd(0));
-            c->_pts[idx + i++] = new Pt(_srvecs[cpu], pts + off + CapSelSpace::SRV_SERVICE,
-                                        reinterpret_cast<Pt::portal_func>(Portals::service),
-                                        Mtd(0));
-            c->_pts[idx + i++] = new Pt(_ecs[cpu], pts + off + CapSelSpace::SRV_IO,
-                                        reinterpret_cast<Pt::portal_func>(Portals::io),
-                                        Mtd(0));
-            c->_pts[idx + i++] = new Pt(_ecs[cpu], pts + off + CapSelSpace::SRV_SC,
-                                        reinterpret_cast<Pt::portal_func>(Portals::sc),
-                                        Mtd(0));
-            c->_pts[idx + i++] = new Pt(_ecs[cpu], pts + off + CapSelSpace::SRV_GSI,
-                                        reinterpret_cast<Pt::portal_func>(Portals::gsi),
-                                        Mtd(0));
-            c->_pts[idx + i++] = new Pt(_ecs[cpu], pts + off + CapSelSpace::SRV_DS,
-                                        reinterpret_cast<Pt::portal_func>(Portals::dataspace),
-                                        Mtd(0));
-            while(i-- > 0)
-                c->_pts[idx + i]->set_id(reinterpret_cast<word_t>(c));
-        }
+        c->_slot = c->id() % _pool;
+        if(config.dedicated_handlers())
+            c->_handlers = new Reference<LocalThread>[CPU::count()];
+        create_portals(c, config.cpu());
+
         // now create Pd and pass portals
         c->_pd = new Pd(Crd(pts, Math::next_pow2_shift(per_child_caps()), Crd::OBJ_ALL));
         c->_pd->set_name(config.cmdline().str());
@@ -298,6 +366,14 @@ Child::id_type ChildManager::load(uintptr_t addr, size_t size, const ChildConfig
         // and a Hip
         build_hip(c, config);
 
+        // charge the memory that we've allocated for him so far. like in map(), only what he
+        // owns counts, because that is what unmap() gives back
+        for(auto it = c->reglist().begin(); it != c->reglist().end(); ++it) {
+            const DataSpaceDesc &desc = it->desc();
+            if(desc.type() != DataSpaceDesc::VIRTUAL && (desc.flags() & ChildMemory::OWN))
+                c->charge_ds(it->desc().size());
+        }
+
         LOG(CHILD_CREATE, "Starting child '" << c->cmdline() << "'...\n");
         LOG(CHILD_CREATE, *c << "\n");
 
@@ -317,20 +393,43 @@ Child::id_type ChildManager::load(uintptr_t addr, size_t size, const ChildConfig
 
     // wait until all services are registered
     if(config.waits() > 0) {
-        size_t services_present;
-        do {
-            _regsm.down();
-            services_present = 0;
-            for(size_t i = 0; i < config.waits(); ++i) {
-                if(_registry.find(config.wait(i)))
-                    services_present++;
+        timevalue_t timeout = 0;
+        if(config.wait_timeout()) {
+            timevalue_t ticks = static_cast<timevalue_t>(config.wait_timeout()) * Hip::get().freq_tsc;
+            timeout = Util::tsc() + ticks;
+        }
+        for(size_t i = 0; i < config.waits(); ++i) {
+            if(!wait_service(config.wait(i), timeout)) {
+                Child::id_type id = c->id();
+                destroy_child(c, TIMEOUT, 0);
+                VTHROW(ChildException, E_TIMEOUT, "Child " << id << " did not register service '"
+                                                  << config.wait(i) << "' within "
+                                                  << config.wait_timeout() << "ms");
             }
         }
-        while(services_present < config.waits());
     }
     return c->id();
 }
 
+bool ChildManager::wait_service(const String &name, timevalue_t timeout) {
+    ServiceRegistry::Waiter w(name);
+    {
+        ScopedLock<UserSm> guard(&_sm);
+        if(_registry.find(name))
+            return true;
+        _registry.add_waiter(&w);
+    }
+    if(w.sm().down(timeout))
+        return true;
+
+    // the service might have been registered between the timeout and now
+    ScopedLock<UserSm> guard(&_sm);
+    if(w.notified())
+        return true;
+    _registry.remove_waiter(&w);
+    return false;
+}
+
 void ChildManager::Portals::startup(Child *c) {
     UtcbExcFrameRef uf;
     try {
@@ -568,12 +667,20 @@ void ChildManager::Portals::sc(Child *c) {
 
         switch(cmd) {
             case Sc::ALLOC: {
+                ChildManager *cm = Thread::current()->get_tls<ChildManager*>(Thread::TLS_PARAM);
                 uintptr_t stackaddr = 0, utcbaddr = 0;
                 bool stack, utcb;
-                uf >> stack >> utcb;
+                cpu_t cpu;
+                uf >> stack >> utcb >> cpu;
                 uf.finish_input();
+                if(cpu >= CPU::count())
+                    VTHROW(Exception, E_ARGS_INVALID, "Invalid CPU " << cpu);
 
                 c->alloc_thread(stack ? &stackaddr : nullptr, utcb ? &utcbaddr : nullptr);
+                // if the thread is created on a different CPU, the child might not have portals
+                // there yet
+                if(cpu != CPU::current().log_id())
+                    cm->delegate_portals(uf, c, cpu);
                 uf << E_SUCCESS;
                 if(stack)
                     uf << stackaddr;
@@ -621,6 +728,18 @@ void ChildManager::Portals::sc(Child *c) {
                 uf << E_SUCCESS;
             }
             break;
+
+            case Sc::MIGRATION: {
+                capsel_t sc = uf.get_translated(0).offset();
+                bool migratable;
+                uf >> migratable;
+                uf.finish_input();
+
+                cpu_t cpu = c->migrate_thread(sc, migratable);
+
+                uf << E_SUCCESS << cpu;
+            }
+            break;
         }
     }
     catch(const Exception& e) {
@@ -650,8 +769,22 @@ void ChildManager::map(UtcbFrameRef &uf, Child *c, DataSpace::RequestType type)
         uf << E_SUCCESS << desc;
     }
     else {
+        // only creations of non-device-memory allocate memory
+        size_t mem = 0;
+        if(type != DataSpace::JOIN && desc.phys() == 0)
+            mem = Math::round_up<size_t>(desc.size(), ExecEnv::PAGE_SIZE);
+        c->charge_ds(mem);
+
         // create it or attach to the existing dataspace
-        const DataSpace &ds = type == DataSpace::JOIN ? _dsm.join(crd.offset()) : _dsm.create(desc);
+        const DataSpace *dsptr;
+        try {
+            dsptr = type == DataSpace::JOIN ? &_dsm.join(crd.offset()) : &_dsm.create(desc);
+        }
+        catch(...) {
+            c->release_ds(mem);
+            throw;
+        }
+        const DataSpace &ds = *dsptr;
 
         // add it to the regions of the child
         uint flags = ds.flags();
@@ -672,6 +805,7 @@ void ChildManager::map(UtcbFrameRef &uf, Child *c, DataSpace::RequestType type)
         }
         catch(...) {
             _dsm.release(desc, ds.unmapsel());
+            c->release_ds(mem);
             throw;
         }
 
@@ -707,7 +841,7 @@ void ChildManager::switch_to(UtcbFrameRef &uf, Child *c) {
         // note that we need another lock here since it may also involve childs of c (c may have
         // delegated it and if they cause a pagefault during this operation, we might get mixed
         // results)
-        ScopedLock<UserSm> guard_switch(&_switchsm);
+        ScopedWriteLock<RWLock> guard_switch(&_switchsm);
 
         uintptr_t srcorg, dstorg;
         {
@@ -791,7 +925,8 @@ void ChildManager::unmap(UtcbFrameRef &uf, Child *c) {
                                   << fmt(sel, "#x") << ": " << desc << "\n");
         // destroy (decrease refs) the ds
         _dsm.release(desc, sel);
-        c->reglist().remove(sel);
+        DataSpaceDesc cdesc = c->reglist().remove(sel);
+        c->release_ds((cdesc.flags() & ChildMemory::OWN) ? cdesc.size() : 0);
     }
     uf << E_SUCCESS;
 }
@@ -842,8 +977,11 @@ void ChildManager::Portals::ex_pf(Child *c) {
         return;
     }
 
+    TRACE_SCOPE(Trace::CHILD_PF, pfaddr);
     try {
-        ScopedLock<UserSm> guard_switch(&cm->_switchsm);
+        // faults of different childs don't conflict with each other, only with switch_to(). thus,
+        // we only need the switch-lock for reading here
+        ScopedReadLock<RWLock> guard_switch(&cm->_switchsm);
         ScopedLock<UserSm> guard_regs(&c->_sm);
 
         LOG(PFS, "Child '" << c->cmdline() << "': Pagefault for " << fmt(pfaddr, "p")
@@ -1083,11 +1221,15 @@ void ChildManager::kill_child(Child *c, int vector, UtcbExcFrameRef &uf, ExitTyp
     // let the kernel kill the Thread by causing it a pagefault in kernel-area
     uf->mtd = Mtd::RIP_LEN;
     uf->rip = ExecEnv::KERNEL_START;
-    if(!dead && type != THREAD_EXIT)
-        destroy_child(c);
+    if(!dead && type != THREAD_EXIT) {
+        if(type == FAULT)
+            destroy_child(c, FAULTED, vector);
+        else
+            destroy_child(c, EXITED, exitcode);
+    }
 }
 
-void ChildManager::destroy_child(Child *c) {
+void ChildManager::destroy_child(Child *c, ExitReason reason, int code) {
     // take care that we don't delete childs twice.
     bool del = false;
     {
@@ -1095,6 +1237,12 @@ void ChildManager::destroy_child(Child *c) {
         if(_childs.remove(c)) {
             del = true;
             _registry.remove(c);
+            // if nobody fetches the exits, we simply overwrite the oldest ones
+            ExitInfo *info = _exits + (_exit_wpos++ % MAX_EXITS);
+            info->id = c->id();
+            info->reason = reason;
+            info->code = code;
+            info->time = Util::tsc();
         }
     }
     if(del)
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <subsystem/ChildQuota.h>
+#include <stream/OStream.h>
+#include <cstring>
+
+namespace nre {
+
+void ChildQuota::parse(const char *str, size_t len) {
+    const char *end = str + len;
+    while(str < end) {
+        const char *colon = str;
+        while(colon < end && *colon != ':')
+            colon++;
+        if(colon == end)
+            VTHROW(Exception, E_ARGS_INVALID, "Invalid quota '" << String(str, end - str) << "'");
+
+        size_t i;
+        size_t namelen = colon - str;
+        for(i = 0; i < COUNT; ++i) {
+            const char *n = name(static_cast<Resource>(i));
+            if(strlen(n) == namelen && strncmp(n, str, namelen) == 0)
+                break;
+        }
+        if(i == COUNT)
+            VTHROW(Exception, E_ARGS_INVALID, "Unknown resource '" << String(str, namelen) << "'");
+
+        const char *numend;
+        size_t value = strtoul(colon + 1, &numend, 0);
+        if(numend < end) {
+            switch(*numend) {
+                case 'K':
+                    value *= 1024;
+                    numend++;
+                    break;
+                case 'M':
+                    value *= 1024 * 1024;
+                    numend++;
+                    break;
+                case 'G':
+                    value *= 1024 * 1024 * 1024;
+                    numend++;
+                    break;
+            }
+        }
+        if(numend == colon + 1 || (numend < end && *numend != ','))
+            VTHROW(Exception, E_ARGS_INVALID, "Invalid value for " << String(str, namelen));
+        _limit[i] = value;
+        str = numend + 1;
+    }
+}
+
+OStream &operator<<(OStream &os, const ChildQuota &q) {
+    for(size_t i = 0; i < ChildQuota::COUNT; ++i) {
+        ChildQuota::Resource r = static_cast<ChildQuota::Resource>(i);
+        os << (i > 0 ? " " : "") << ChildQuota::name(r) << "=" << q.used(r) << "/";
+        if(q.limit(r) == ChildQuota::UNLIMITED)
+            os << "-";
+        else
+            os << q.limit(r);
+    }
+    return os;
+}
+
+}
@@ -26,6 +26,10 @@ const ServiceRegistry::Service* ServiceRegistry::reg(Child *child, const String
         VTHROW(ServiceRegistryException, E_EXISTS, "Service '" << name << "' does already exist");
     Service *s = new Service(child, name, pts, count, available);
     _srvs.append(s);
+    Service **head = _table + hash(name);
+    s->_hnext = *head;
+    *head = s;
+    notify(name);
     return s;
 }
 
@@ -37,8 +41,31 @@ void ServiceRegistry::unreg(Child *child, const String &name) {
         VTHROW(ServiceRegistryException, E_NOT_FOUND,
                "Child '" << child->cmdline() << "' does not own service '" << name << "'");
     }
-    _srvs.remove(s);
+    unlink(s);
     delete s;
 }
 
+void ServiceRegistry::unlink(Service *s) {
+    _srvs.remove(s);
+    for(Service **p = _table + hash(s->name()); *p; p = &(*p)->_hnext) {
+        if(*p == s) {
+            *p = s->_hnext;
+            break;
+        }
+    }
+}
+
+void ServiceRegistry::notify(const String &name) {
+    for(Waiter **p = _waiters + hash(name); *p; ) {
+        Waiter *w = *p;
+        if(w->name() == name) {
+            *p = w->_next;
+            w->_notified = true;
+            w->_sm.up();
+        }
+        else
+            p = &w->_next;
+    }
+}
+
 }
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <util/ACPITableBuilder.h>
+#include <Logging.h>
+#include <cstring>
+
+namespace nre {
+
+// the offsets of the 32-bit and 64-bit address of the DSDT in the FACP
+static const size_t FACP_DSDT_OFF   = 40;
+static const size_t FACP_XDSDT_OFF  = 140;
+
+ACPITableBuilder::~ACPITableBuilder() {
+    for(size_t i = 0; i < _count; ++i)
+        delete[] reinterpret_cast<char*>(_tables[i]);
+}
+
+void ACPITableBuilder::load(const ACPI::RSDP *rsdp, Mapper &mapper) {
+    // prefer the XSDT, because the RSDT can only reference tables below 4G
+    if(rsdp->revision >= 2 && rsdp->xsdtAddr && rsdp->length >= sizeof(ACPI::RSDP) &&
+       checksum(rsdp, rsdp->length) == 0) {
+        if(add_all<uint64_t>(rsdp->xsdtAddr, "XSDT", mapper))
+            return;
+        LOG(ACPI, "ACPI: XSDT invalid, falling back to RSDT\n");
+    }
+    if(!add_all<uint32_t>(rsdp->rsdtAddr, "RSDT", mapper))
+        throw Exception(E_NOT_FOUND, "RSDT checksum invalid");
+}
+
+template<typename T>
+bool ACPITableBuilder::add_all(uint64_t phys, const char *signature, Mapper &mapper) {
+    const ACPI::RSDT *root = map(phys, sizeof(ACPI::RSDT), mapper);
+    size_t len = root->length;
+    if(len < sizeof(ACPI::RSDT))
+        return false;
+    root = map(phys, len, mapper);
+    if(memcmp(root->signature, signature, 4) != 0 || checksum(root, len) != 0)
+        return false;
+
+    // copy the addresses, because mapping the tables may unmap the root table. the entries of the
+    // XSDT are not necessarily aligned
+    size_t count = (len - sizeof(ACPI::RSDT)) / sizeof(T);
+    T *addrs = new T[count];
+    memcpy(addrs, root + 1, count * sizeof(T));
+    for(size_t i = 0; i < count; ++i)
+        add_from(addrs[i], mapper);
+    delete[] addrs;
+    return true;
+}
+
+bool ACPITableBuilder::add_from(uint64_t phys, Mapper &mapper) {
+    if(phys == 0)
+        return false;
+
+    const ACPI::RSDT *tbl = map(phys, sizeof(ACPI::RSDT), mapper);
+    size_t len = tbl->length;
+    if(len < sizeof(ACPI::RSDT))
+        return false;
+    tbl = map(phys, len, mapper);
+    if(!add(tbl)) {
+        LOG(ACPI, "ACPI: skipping table " << fmt(tbl->signature, 0U, 4)
+                                          << " @ " << fmt(phys, "p") << "\n");
+        return false;
+    }
+    LOG(ACPI, "ACPI: found table " << fmt(tbl->signature, 0U, 4)
+                                   << " @ " << fmt(phys, "p") << "\n");
+
+    // the DSDT is not listed in the RSDT/XSDT, but referenced by the FACP
+    if(memcmp(tbl->signature, "FACP", 4) == 0 && len >= FACP_DSDT_OFF + sizeof(uint32_t)) {
+        const char *raw = reinterpret_cast<const char*>(tbl);
+        uint64_t dsdt = 0;
+        if(len >= FACP_XDSDT_OFF + sizeof(uint64_t))
+            memcpy(&dsdt, raw + FACP_XDSDT_OFF, sizeof(uint64_t));
+        if(dsdt == 0) {
+            uint32_t dsdt32;
+            memcpy(&dsdt32, raw + FACP_DSDT_OFF, sizeof(uint32_t));
+            dsdt = dsdt32;
+        }
+        add_from(dsdt, mapper);
+    }
+    return true;
+}
+
+bool ACPITableBuilder::add(const ACPI::RSDT *table) {
+    if(table->length < sizeof(ACPI::RSDT) || checksum(table, table->length) != 0)
+        return false;
+    if(_count == MAX_TABLES) {
+        LOG(ACPI, "ACPI: too many tables, ignoring " << fmt(table->signature, 0U, 4) << "\n");
+        return false;
+    }
+
+    char *copy = new char[table->length];
+    memcpy(copy, table, table->length);
+    _tables[_count++] = reinterpret_cast<ACPI::RSDT*>(copy);
+    return true;
+}
+
+size_t ACPITableBuilder::size() const {
+    size_t total = align(table_offset(_count));
+    for(size_t i = 0; i < _count; ++i)
+        total += align(_tables[i]->length);
+    return total;
+}
+
+void ACPITableBuilder::build(void *dst) const {
+    ACPI::TableSet *set = reinterpret_cast<ACPI::TableSet*>(dst);
+    set->magic = ACPI::TableSet::MAGIC;
+    set->count = _count;
+
+    // sort the tables by signature. the sort is stable, so that the instances are numbered in the
+    // order in which the tables have been added
+    size_t *order = new size_t[_count];
+    for(size_t i = 0; i < _count; ++i) {
+        size_t j = i;
+        for(; j > 0 && memcmp(_tables[order[j - 1]]->signature, _tables[i]->signature, 4) > 0; --j)
+            order[j] = order[j - 1];
+        order[j] = i;
+    }
+
+    size_t off = align(table_offset(_count));
+    for(size_t i = 0; i < _count; ++i) {
+        const ACPI::RSDT *tbl = _tables[order[i]];
+        ACPI::TableEntry *e = set->entries + i;
+        memcpy(e->signature, tbl->signature, 4);
+        if(i > 0 && memcmp(e[-1].signature, tbl->signature, 4) == 0)
+            e->instance = e[-1].instance + 1;
+        else
+            e->instance = 0;
+        e->offset = off;
+        e->length = tbl->length;
+        memcpy(reinterpret_cast<char*>(dst) + off, tbl, tbl->length);
+        off += align(tbl->length);
+    }
+    set->size = off;
+    delete[] order;
+
+    build_irq_map(set);
+}
+
+void ACPITableBuilder::build_irq_map(ACPI::TableSet *set) const {
+    for(uint i = 0; i < ACPI::ISA_IRQS; ++i)
+        set->isa_gsi[i] = i;
+
+    const ACPI::MADT *madt = reinterpret_cast<const ACPI::MADT*>(set->find("APIC"));
+    if(!madt)
+        return;
+
+    // search for interrupt source overrides in the MADT. the first one for an IRQ wins
+    uint overridden = 0;
+    uintptr_t end = reinterpret_cast<uintptr_t>(madt) + madt->length;
+    const ACPI::APIC *apic = madt->apic;
+    while(reinterpret_cast<uintptr_t>(apic) + sizeof(ACPI::APIC) <= end && apic->length >= 2) {
+        if(apic->type == ACPI::APIC::INTR &&
+           reinterpret_cast<uintptr_t>(apic) + sizeof(ACPI::APICIntr) <= end) {
+            const ACPI::APICIntr *iso = reinterpret_cast<const ACPI::APICIntr*>(apic);
+            if(iso->irq < ACPI::ISA_IRQS && !(overridden & (1U << iso->irq))) {
+                set->isa_gsi[iso->irq] = iso->gsi;
+                overridden |= 1U << iso->irq;
+            }
+        }
+        uintptr_t next = reinterpret_cast<uintptr_t>(apic) + apic->length;
+        apic = reinterpret_cast<const ACPI::APIC*>(next);
+    }
+}
+
+}
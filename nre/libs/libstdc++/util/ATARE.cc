@@ -16,12 +16,46 @@
  */
 
 #include <stream/Serial.h>
+#include <util/ATARE.h>
+#include <cstring>
 
-#include "HostATARE.h"
+namespace nre {
 
-using namespace nre;
+ATARE::~ATARE() {
+    for(NamedRef *ref = _head; ref; ) {
+        for(PciRoutingEntry *p = ref->routing; p; ) {
+            PciRoutingEntry *next = p->next;
+            delete p;
+            p = next;
+        }
+        NamedRef *next = ref->next;
+        delete[] ref->name;
+        delete ref;
+        ref = next;
+    }
+}
+
+size_t ATARE::routes() const {
+    size_t count = 0;
+    for(NamedRef *dev = _head; dev; dev = dev->next) {
+        for(PciRoutingEntry *p = dev->routing; p; p = p->next)
+            count++;
+    }
+    return count;
+}
 
-void HostATARE::debug_show_items() {
+void ATARE::build_routing(ACPI::RoutingTable *rt) const {
+    for(NamedRef *dev = _head; dev; dev = dev->next) {
+        if(dev->ptr[0] == 0x82 && dev->routing) {
+            // resolving the BDF requires name lookups, so do that only once per device
+            BDF bdf = get_device_bdf(_head, dev);
+            for(PciRoutingEntry *p = dev->routing; p; p = p->next)
+                rt->add(bdf, p->adr >> 16, p->pin, p->gsi);
+        }
+    }
+}
+
+void ATARE::debug_show_items() {
     NamedRef *ref = _head;
     for(unsigned i = 0; ref; ref = ref->next, i++) {
         Serial::get() << "at: " << fmt(i, 3) << " " << ref->ptr << "+" << fmt(ref->len, "0x", 4)
@@ -30,7 +64,7 @@ void HostATARE::debug_show_items() {
     }
 }
 
-void HostATARE::debug_show_routing() {
+void ATARE::debug_show_routing() {
     if(!search_ref(_head, 0, "_PIC", false))
         Serial::get() << "at: APIC mode unavailable - no _PIC method\n";
 
@@ -52,14 +86,14 @@ void HostATARE::debug_show_routing() {
 /**
  * Returns the number of bytes for this package len.
  */
-size_t HostATARE::get_pkgsize_len(const uint8_t *data) {
+size_t ATARE::get_pkgsize_len(const uint8_t *data) {
     return ((data[0] & 0xc0) && (data[0] & 0x30)) ? 0 : 1 + (data[0] >> 6);
 }
 
 /**
  * Read the pkgsize.
  */
-size_t HostATARE::read_pkgsize(const uint8_t *data) {
+size_t ATARE::read_pkgsize(const uint8_t *data) {
     size_t res = data[0] & 0x3f;
     for(size_t i = 1; i < get_pkgsize_len(data); i++)
         res += data[i] << (8 * i - 4);
@@ -69,7 +103,7 @@ size_t HostATARE::read_pkgsize(const uint8_t *data) {
 /**
  * Returns whether this is a nameseg.
  */
-bool HostATARE::name_seg(const uint8_t *res) {
+bool ATARE::name_seg(const uint8_t *res) {
     for(size_t i = 0; i < 4; i++) {
         if(!((res[i] >= 'A' && res[i] <= 'Z') || (res[i] == '_')
              || (i && res[i] >= '0' && res[i] <= '9')))
@@ -81,7 +115,7 @@ bool HostATARE::name_seg(const uint8_t *res) {
 /**
  * Get the length of the nameprefix;
  */
-size_t HostATARE::get_nameprefix_len(const uint8_t *table) {
+size_t ATARE::get_nameprefix_len(const uint8_t *table) {
     const uint8_t *res = table;
     if(*res == 0x5c)
         res++;
@@ -102,7 +136,7 @@ size_t HostATARE::get_nameprefix_len(const uint8_t *table) {
  *
  * Returns 0 on failure or the length.
  */
-size_t HostATARE::get_name_len(const uint8_t *table) {
+size_t ATARE::get_name_len(const uint8_t *table) {
     const uint8_t *res = table;
     if(*res == 0x5c)
         res++;
@@ -132,8 +166,8 @@ size_t HostATARE::get_name_len(const uint8_t *table) {
 /**
  * Calc an absname.
  */
-void HostATARE::get_absname(NamedRef *parent, const uint8_t *name, size_t &namelen, char *res,
-                            size_t skip) {
+void ATARE::get_absname(NamedRef *parent, const uint8_t *name, size_t &namelen, char *res,
+                        size_t skip) {
     size_t nameprefixlen = get_nameprefix_len(name);
     namelen = namelen - nameprefixlen;
 
@@ -157,7 +191,7 @@ void HostATARE::get_absname(NamedRef *parent, const uint8_t *name, size_t &namel
  *
  * Note: We support only numbers here.
  */
-uint HostATARE::read_data(const uint8_t *data, size_t &length) {
+uint ATARE::read_data(const uint8_t *data, size_t &length) {
     switch(data[0]) {
         case 0:
             length = 1;
@@ -186,7 +220,7 @@ uint HostATARE::read_data(const uint8_t *data, size_t &length) {
 /**
  * Search and read a packet with 4 entries.
  */
-ssize_t HostATARE::get_packet4(const uint8_t *table, ssize_t len, uint *x) {
+ssize_t ATARE::get_packet4(const uint8_t *table, ssize_t len, uint *x) {
     for(const uint8_t *data = table; data < table + len; data++) {
         if(data[0] == 0x12) {
             size_t pkgsize_len = get_pkgsize_len(data + 1);
@@ -210,7 +244,7 @@ ssize_t HostATARE::get_packet4(const uint8_t *table, ssize_t len, uint *x) {
 /**
  * Searches for PCI routing information in some region and adds them to dev.
  */
-void HostATARE::search_prt_direct(NamedRef *dev, NamedRef *ref) {
+void ATARE::search_prt_direct(NamedRef *dev, NamedRef *ref) {
     size_t l;
     for(size_t offset = 0; offset < ref->len; offset += l) {
         uint x[4];
@@ -228,7 +262,7 @@ void HostATARE::search_prt_direct(NamedRef *dev, NamedRef *ref) {
  * Searches for PCI routing information by following references in
  * the PRT method and adds them to dev.
  */
-void HostATARE::search_prt_indirect(NamedRef *head, NamedRef *dev, NamedRef *prt) {
+void ATARE::search_prt_indirect(NamedRef *head, NamedRef *dev, NamedRef *prt) {
     uint found = 0;
     size_t name_len;
     for(size_t offset = get_pkgsize_len(prt->ptr + 1); offset < prt->len; offset += name_len) {
@@ -253,7 +287,7 @@ void HostATARE::search_prt_indirect(NamedRef *head, NamedRef *dev, NamedRef *prt
 /**
  * Return a single value of a namedef declaration.
  */
-uint HostATARE::get_namedef_value(NamedRef *head, NamedRef *parent, const char *name) {
+uint ATARE::get_namedef_value(NamedRef *head, NamedRef *parent, const char *name) {
     NamedRef *ref = search_ref(head, parent, name, false);
     if(ref && ref->ptr[0] == 0x8) {
         size_t name_len = get_name_len(ref->ptr + 1);
@@ -268,8 +302,8 @@ uint HostATARE::get_namedef_value(NamedRef *head, NamedRef *parent, const char *
 /**
  * Search some reference per name, either absolute or relative to some parent.
  */
-HostATARE::NamedRef *HostATARE::search_ref(NamedRef *head, NamedRef *parent, const char *name,
-                                           bool upstream) {
+ATARE::NamedRef *ATARE::search_ref(NamedRef *head, NamedRef *parent, const char *name,
+                                   bool upstream) {
     size_t slen = strlen(name);
     size_t plen = parent ? parent->namelen : 0;
     for(size_t skip = 0; skip <= plen / 4; skip++) {
@@ -289,7 +323,7 @@ HostATARE::NamedRef *HostATARE::search_ref(NamedRef *head, NamedRef *parent, con
 /**
  * Return a single bdf for a device struct by combining different device properties.
  */
-BDF HostATARE::get_device_bdf(NamedRef *head, NamedRef *dev) {
+BDF ATARE::get_device_bdf(NamedRef *head, NamedRef *dev) {
     uint adr = get_namedef_value(head, dev, "_ADR");
     uint bbn = get_namedef_value(head, dev, "_BBN");
     uint seg = get_namedef_value(head, dev, "_SEG");
@@ -299,7 +333,7 @@ BDF HostATARE::get_device_bdf(NamedRef *head, NamedRef *dev) {
 /**
  * Add all named refs from a table and return the list head pointer.
  */
-HostATARE::NamedRef *HostATARE::add_refs(const uint8_t *table, unsigned len, NamedRef *res) {
+ATARE::NamedRef *ATARE::add_refs(const uint8_t *table, unsigned len, NamedRef *res) {
     for(const uint8_t *data = table; data < table + len; data++) {
         if((data[0] == 0x5b && data[1] == 0x82) // devices
            || (data[0] == 0x08)      // named objects
@@ -350,7 +384,7 @@ HostATARE::NamedRef *HostATARE::add_refs(const uint8_t *table, unsigned len, Nam
 /**
  * Add the PCI routing information to the devices.
  */
-void HostATARE::add_routing(NamedRef *head) {
+void ATARE::add_routing(NamedRef *head) {
     for(NamedRef *dev = head; dev; dev = dev->next) {
         if(dev->ptr[0] == 0x82) {
             NamedRef *prt = search_ref(head, dev, "_PRT", false);
@@ -361,3 +395,5 @@ void HostATARE::add_routing(NamedRef *head) {
         }
     }
 }
+
+}
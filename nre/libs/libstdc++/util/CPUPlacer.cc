@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+
+#include <util/CPUPlacer.h>
+#include <Exception.h>
+
+namespace nre {
+
+uint CPUPlacer::core_cost(const Placement::CPULoad &c) const {
+    uint total = 0;
+    for(cpu_t i = 0; i < Hip::MAX_CPUS; ++i) {
+        if(_online.is_set(i) && same_core(_cpus[i], c))
+            total += cost(_cpus[i]);
+    }
+    return total;
+}
+
+uint CPUPlacer::package_cost(const Placement::CPULoad &c) const {
+    uint total = 0, count = 0;
+    for(cpu_t i = 0; i < Hip::MAX_CPUS; ++i) {
+        if(_online.is_set(i) && _cpus[i].package == c.package) {
+            total += cost(_cpus[i]);
+            count++;
+        }
+    }
+    return total / count;
+}
+
+bool CPUPlacer::siblings_idle(const Placement::CPULoad &c) const {
+    for(cpu_t i = 0; i < Hip::MAX_CPUS; ++i) {
+        if(i != c.cpu && _online.is_set(i) && same_core(_cpus[i], c) &&
+           (_cpus[i].placed > 0 || _cpus[i].load >= IDLE_LIMIT))
+            return false;
+    }
+    return true;
+}
+
+uint CPUPlacer::distance(const Placement::CPULoad &a, const Placement::CPULoad &b) {
+    if(a.cpu == b.cpu)
+        return 0;
+    if(same_core(a, b))
+        return 1;
+    if(a.package == b.package)
+        return 2;
+    return 3;
+}
+
+bool CPUPlacer::spread_less(const Placement::CPULoad &a, const Placement::CPULoad &b) const {
+    // prefer the least loaded core, then the least loaded package and finally the CPU itself
+    uint acore = core_cost(a), bcore = core_cost(b);
+    if(acore != bcore)
+        return acore < bcore;
+    uint apkg = package_cost(a), bpkg = package_cost(b);
+    if(apkg != bpkg)
+        return apkg < bpkg;
+    if(cost(a) != cost(b))
+        return cost(a) < cost(b);
+    return topology_less(a, b);
+}
+
+bool CPUPlacer::topology_less(const Placement::CPULoad &a, const Placement::CPULoad &b) {
+    if(a.package != b.package)
+        return a.package < b.package;
+    if(a.core != b.core)
+        return a.core < b.core;
+    if(a.thread != b.thread)
+        return a.thread < b.thread;
+    return a.cpu < b.cpu;
+}
+
+cpu_t CPUPlacer::choose(Placement::Policy policy, const CPUSet &cpus, cpu_t near) const {
+    const Placement::CPULoad *best = nullptr;
+    const Placement::CPULoad *target = online(near) ? _cpus + near : nullptr;
+    for(cpu_t i = 0; i < Hip::MAX_CPUS; ++i) {
+        if(!_online.is_set(i) || !cpus.get().is_set(i))
+            continue;
+
+        const Placement::CPULoad *c = _cpus + i;
+        bool better = false;
+        switch(policy) {
+            case Placement::SPREAD:
+                better = !best || spread_less(*c, *best);
+                break;
+
+            case Placement::PACK: {
+                // the first one in topology order that has room left
+                bool room = cost(*c) + PLACED_LOAD <= PACK_LIMIT;
+                bool bestroom = best && cost(*best) + PLACED_LOAD <= PACK_LIMIT;
+                if(room != bestroom)
+                    better = room;
+                else if(room)
+                    better = topology_less(*c, *best);
+                else
+                    better = !best || cost(*c) < cost(*best);
+            }
+            break;
+
+            case Placement::SIBLING_AVOID: {
+                bool idle = siblings_idle(*c);
+                bool bestidle = best && siblings_idle(*best);
+                if(idle != bestidle)
+                    better = idle;
+                else
+                    better = !best || spread_less(*c, *best);
+            }
+            break;
+
+            case Placement::NEAR: {
+                if(!target) {
+                    better = !best || spread_less(*c, *best);
+                    break;
+                }
+                // the closest one that has room left
+                bool room = cost(*c) + PLACED_LOAD <= PACK_LIMIT;
+                bool bestroom = best && cost(*best) + PLACED_LOAD <= PACK_LIMIT;
+                if(room != bestroom)
+                    better = room;
+                else if(!best || distance(*c, *target) != distance(*best, *target))
+                    better = !best || distance(*c, *target) < distance(*best, *target);
+                else
+                    better = cost(*c) < cost(*best);
+            }
+            break;
+        }
+        if(better)
+            best = c;
+    }
+    if(!best)
+        throw Exception(E_NOT_FOUND, "None of the given CPUs is online");
+    return best->cpu;
+}
+
+cpu_t CPUPlacer::place(Placement::Policy policy, const CPUSet &cpus, cpu_t near) {
+    cpu_t cpu = choose(policy, cpus, near);
+    _cpus[cpu].placed++;
+    return cpu;
+}
+
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <arch/Startup.h>
+#include <util/LockStats.h>
+#include <stream/OStream.h>
+#include <cstring>
+
+namespace nre {
+
+// static LockStats objects register themselves during initialization
+UserSm LockStats::_list_sm INIT_PRIO_LOCKSTATS;
+SList<LockStats> LockStats::_list INIT_PRIO_LOCKSTATS;
+
+void LockStats::print(OStream &os, const char *name) {
+    ScopedLock<UserSm> guard(&_list_sm);
+    for(auto it = _list.cbegin(); it != _list.cend(); ++it) {
+        if(name == nullptr || strcmp(it->name(), name) == 0)
+            os << *it << "\n";
+    }
+}
+
+OStream &operator<<(OStream &os, const LockStats &s) {
+    os << s.name() << ": acquisitions=" << s.acquisitions() << " contended=" << s.contended()
+       << " blocked=" << s.blocked() << " waitcycles=" << s.wait_cycles();
+    if(s.contended() > 0)
+        os << " (avg " << (s.wait_cycles() / s.contended()) << ")";
+    return os;
+}
+
+}
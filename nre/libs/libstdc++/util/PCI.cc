@@ -19,7 +19,7 @@
 
 namespace nre {
 
-Gsi *PCI::get_gsi_msi(BDF bdf, uint nr, void *msix_table) {
+Gsi *PCI::get_gsi_msi(BDF bdf, uint nr, void *msix_table, cpu_t cpu) {
     size_t msix_offset = find_cap(bdf, CAP_MSIX);
     size_t msi_offset = find_cap(bdf, CAP_MSI);
     if(!(msix_offset || msi_offset))
@@ -33,7 +33,7 @@ Gsi *PCI::get_gsi_msi(BDF bdf, uint nr, void *msix_table) {
     DataSpace devds(ExecEnv::PAGE_SIZE, DataSpaceDesc::LOCKED, DataSpaceDesc::R, phys_addr);
 
     // create GSI
-    Gsi *gsi = new Gsi(reinterpret_cast<void*>(devds.virt()), CPU::current().log_id());
+    Gsi *gsi = new Gsi(reinterpret_cast<void*>(devds.virt()), cpu);
     if(!gsi->msi_addr())
         throw PCIException(E_FAILURE, "Attach to MSI failed - IRQs may be broken!");
 
@@ -86,7 +86,9 @@ Gsi *PCI::get_gsi(BDF bdf, uint nr, bool /*level*/, void *msix_table) {
 
     uint gsi;
     try {
-        gsi = _acpi->get_gsi(bdf, pin - 1, _pcicfg.search_bridge(bdf));
+        // devices on the root bus are routed by the host bridge
+        BDF parent = bdf.bus() == 0 ? BDF(bdf.value() & ~0xFFFFU) : _pcicfg.search_bridge(bdf);
+        gsi = _acpi->get_gsi(bdf, pin - 1, parent);
     }
     catch(...) {
         // No clue which GSI is triggered - fall back to PIC irq
@@ -97,15 +99,10 @@ Gsi *PCI::get_gsi(BDF bdf, uint nr, bool /*level*/, void *msix_table) {
 
 size_t PCI::find_cap(BDF bdf, cap_type id) {
     try {
-        // capabilities supported?
-        if((conf_read(bdf, 1) >> 16) & 0x10) {
-            for(uint8_t offset = conf_read(bdf, 0xd);
-                (offset != 0) && !(offset & 0x3);
-                offset = conf_read(bdf, offset >> 2) >> 8) {
-                if((conf_read(bdf, offset >> 2) & 0xFF) == id)
-                    return offset >> 2;
-            }
-        }
+        // the service has already walked the capability list for us
+        size_t offset = device(bdf).find_cap(id, false);
+        if(offset)
+            return offset >> 2;
     }
     catch(...) {
         // ignore
@@ -116,16 +113,9 @@ size_t PCI::find_cap(BDF bdf, cap_type id) {
 
 size_t PCI::find_extended_cap(BDF bdf, cap_type id) {
     try {
-        value_type header;
-        size_t offset;
-        if((find_cap(bdf, CAP_PCIE)) && (~0U != conf_read(bdf, 0x40))) {
-            for(offset = 0x100, header = conf_read(bdf, offset >> 2);
-                offset != 0;
-                offset = header >> 20, header = conf_read(bdf, offset >> 2)) {
-                if((header & 0xFFFF) == id)
-                    return offset >> 2;
-            }
-        }
+        size_t offset = device(bdf).find_cap(id, true);
+        if(offset)
+            return offset >> 2;
     }
     catch(...) {
         // ignore
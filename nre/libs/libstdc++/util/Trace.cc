@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <arch/Startup.h>
+#include <services/Tracer.h>
+#include <kobj/Thread.h>
+#include <util/Trace.h>
+#include <util/Atomic.h>
+#include <util/Sync.h>
+#include <Logging.h>
+#include <cstring>
+
+namespace nre {
+
+Trace::Area *Trace::_area = nullptr;
+Trace::Buffer Trace::_untraced;
+TracerSession *Trace::_sess = nullptr;
+const char *Trace::_names[Trace::POINT_COUNT] = {
+    "service-portal",
+    "child-pf",
+    "storage-request",
+    "net-receive",
+    "function",
+};
+
+void Trace::record(Point point, Type type, word_t arg) {
+    Thread *t = ExecEnv::get_current_thread();
+    Buffer *buf = static_cast<Buffer*>(t->_trace);
+    if(EXPECT_FALSE(buf == nullptr)) {
+        buf = claim(t->sel());
+        t->_trace = buf;
+    }
+    if(EXPECT_FALSE(buf == &_untraced))
+        return;
+
+    // we are the only writer of this buffer. the reader might see a partially written event if it
+    // does not stop the tracing before reading, but never an event that has not been counted yet.
+    uint64_t n = buf->count;
+    Event *ev = buf->events + (n & (EVENTS - 1));
+    ev->tsc = Util::tsc();
+    ev->arg = arg;
+    ev->point = point;
+    ev->type = type;
+    ev->cpu = t->cpu();
+    Sync::memory_barrier();
+    buf->count = n + 1;
+}
+
+Trace::Buffer *Trace::claim(uint32_t thread) {
+    for(word_t i = 0; i < MAX_THREADS; ++i) {
+        Buffer *buf = _area->buffers + i;
+        if(buf->used || !Atomic::cmpnswap(&buf->used, 0U, 1U))
+            continue;
+
+        // the events of the previous owner are gone now
+        buf->count = 0;
+        buf->thread = thread;
+        word_t threads;
+        while((threads = _area->threads) <= i && !Atomic::cmpnswap(&_area->threads, threads, i + 1))
+            ;
+        return buf;
+    }
+    // threads that don't get a buffer are not traced. note that we don't let them write into a
+    // shared buffer, because they might run on different CPUs
+    return &_untraced;
+}
+
+void Trace::release(Thread *t) {
+    Buffer *buf = static_cast<Buffer*>(t->_trace);
+    t->_trace = nullptr;
+    if(buf && buf != &_untraced) {
+        // all events have to be written before somebody else takes it
+        Sync::memory_barrier();
+        buf->used = 0;
+    }
+}
+
+void Trace::attach(Area *area, const char *name, word_t mask) {
+    area->magic = MAGIC;
+    area->version = VERSION;
+    area->threads = 0;
+    size_t len = Math::min(strlen(name), MAX_NAME_LEN - 1);
+    memcpy(area->name, name, len);
+    area->name[len] = '\0';
+    area->mask = mask;
+    Sync::memory_barrier();
+    // from now on, the tracepoints check the mask in the area
+    _area = area;
+}
+
+void Trace::init(int argc, char *argv[]) {
+    for(int i = 1; i < argc; ++i) {
+        if(strncmp(argv[i], "trace", 5) != 0 || (argv[i][5] != '\0' && argv[i][5] != '='))
+            continue;
+
+        word_t mask = ~static_cast<word_t>(0);
+        if(argv[i][5] == '=')
+            mask = strtoul(argv[i] + 6, nullptr, 16);
+        try {
+            _sess = new TracerSession("tracer", _startup_info.progname);
+            DataSpace *ds = _sess->get_area();
+            attach(reinterpret_cast<Area*>(ds->virt()), _startup_info.progname, mask);
+        }
+        catch(const Exception &e) {
+            LOG(ALWAYS, "Unable to enable tracing: " << e.msg() << "\n");
+        }
+        break;
+    }
+}
+
+}
@@ -19,9 +19,13 @@
 
 #include <arch/Types.h>
 #include <services/ACPI.h>
-#include <collection/SList.h>
-#include <Compiler.h>
+#include <mem/DataSpace.h>
+#include <util/ACPITableBuilder.h>
 
+/**
+ * Collects the ACPI tables at startup, verifies them once and provides them in one read-only
+ * dataspace, so that clients can do the lookups locally.
+ */
 class HostACPI {
     static const uintptr_t BIOS_MEM_ADDR    = 0xE0000;
     static const size_t BIOS_MEM_SIZE       = 0x20000;
@@ -30,91 +34,54 @@ class HostACPI {
     static const size_t BIOS_EBDA_OFF       = 0x40E;
     static const size_t BIOS_EBDA_SIZE      = 1024;
 
-    // root system descriptor pointer
-    struct RSDP {
-        uint32_t signature[2];
-        uint8_t checksum;
-        char oemId[6];
-        uint8_t revision;
-        uint32_t rsdtAddr;
-        // since 2.0
-        uint32_t length;
-        uint64_t xsdtAddr;
-        uint8_t xchecksum;
-    } PACKED;
-
-    // APIC Structure (5.2.11.4)
-    struct APIC {
-        enum Type {
-            LAPIC = 0, IOAPIC = 1, INTR = 2,
-        };
-        uint8_t type;
-        uint8_t length;
-    } PACKED;
-
-    // Interrupt Source Override (5.2.11.8)
-    struct APICIntr : public APIC {
-        uint8_t bus;
-        uint8_t irq;
-        uint32_t gsi;
-        uint16_t flags;
-    } PACKED;
-
-    // Multiple APIC Description Table
-    struct MADT : public nre::ACPI::RSDT {
-        uint32_t apic_addr;
-        uint32_t flags;
-        APIC apic[];
-    } PACKED;
-
-public:
-    class ACPIListItem : public nre::SListItem {
+    /**
+     * Maps the tables from physical memory
+     */
+    class PhysMapper : public nre::ACPITableBuilder::Mapper {
     public:
-        explicit ACPIListItem(const nre::ACPI::RSDT *tbl)
-            : nre::SListItem(), _ds(tbl->length, nre::DataSpaceDesc::ANONYMOUS, nre::DataSpaceDesc::RW) {
-            memcpy(reinterpret_cast<void*>(_ds.virt()), tbl, tbl->length);
-        }
-
-        nre::Crd cap() const {
-            // give them only read permissions
-            return _ds.crd(nre::DataSpaceDesc::R);
-        }
-        uintptr_t start() const {
-            return _ds.virt();
-        }
-        uintptr_t end() const {
-            return _ds.virt() + length();
-        }
-        size_t length() const {
-            return table()->length;
+        explicit PhysMapper() : _ds() {
         }
-        const nre::ACPI::RSDT *table() const {
-            return reinterpret_cast<nre::ACPI::RSDT*>(_ds.virt());
+        virtual ~PhysMapper() {
+            delete _ds;
         }
 
-    private:
-        ACPIListItem(const ACPIListItem&);
-        ACPIListItem &operator=(const ACPIListItem&);
+        virtual const void *map(uint64_t phys, size_t size);
 
-        nre::DataSpace _ds;
+    private:
+        nre::DataSpace *_ds;
     };
 
+public:
     explicit HostACPI();
     ~HostACPI() {
-        for(auto it = _tables.begin(); it != _tables.end(); ) {
-            auto old = it++;
-            delete &*old;
-        }
+        delete _ds;
     }
 
-    const ACPIListItem *find(const char *name, uint instance);
-    uint irq_to_gsi(uint irq);
+    /**
+     * @return the dataspace that contains the TableSet
+     */
+    const nre::DataSpace &dataspace() const {
+        return *_ds;
+    }
+    /**
+     * @return all tables
+     */
+    const nre::ACPI::TableSet &tables() const {
+        return *reinterpret_cast<const nre::ACPI::TableSet*>(_ds->virt());
+    }
 
-private:
-    static nre::DataSpace map_table(uintptr_t addr, nre::ACPI::RSDT *&res);
-    static char checksum(const char *table, unsigned count);
-    static RSDP *get_rsdp();
+    const nre::ACPI::RSDT *find(const char *name, uint instance) const {
+        return tables().find(name, instance);
+    }
+    uint irq_to_gsi(uint irq) const {
+        return tables().irq_to_gsi(irq);
+    }
 
 private:
-    nre::SList<ACPIListItem> _tables;
+    HostACPI(const HostACPI&);
+    HostACPI& operator=(const HostACPI&);
+
+    static nre::ACPI::RSDP *get_rsdp();
+
+    nre::DataSpace *_ds;
 };
@@ -16,15 +16,15 @@
 
 #include <ipc/Service.h>
 #include <services/ACPI.h>
+#include <util/ATARE.h>
 #include <Logging.h>
 
 #include "HostACPI.h"
-#include "HostATARE.h"
 
 using namespace nre;
 
 static HostACPI *hostacpi;
-static HostATARE *hostatare;
+static DataSpace *routing;
 
 PORTAL static void portal_acpi(void*) {
     UtcbFrameRef uf;
@@ -36,45 +36,23 @@ PORTAL static void portal_acpi(void*) {
             throw Exception(E_NOT_FOUND, "No ACPI");
 
         switch(cmd) {
-            case ACPI::FIND_TABLE: {
-                String name;
-                uint instance;
-                uf >> name >> instance;
+            case ACPI::GET_TABLES: {
                 uf.finish_input();
 
-                const HostACPI::ACPIListItem *item = hostacpi->find(name.str(), instance);
-                LOG(ACPI, "ACPI::FIND_TABLE '" << name << "' #" << instance
-                                               << " -> " << (item ? "found" : "not found") << "\n");
-                if(!item) {
-                    VTHROW(Exception, E_NOT_FOUND,
-                           "Unable to find APCI table '" << name << "' #" << instance);
-                }
-                uf.delegate(item->cap());
+                LOG(ACPI, "ACPI::GET_TABLES -> " << hostacpi->tables().count << " tables\n");
+                // give them only read permissions
+                uf.delegate(hostacpi->dataspace().crd(DataSpaceDesc::R));
                 uf << E_SUCCESS;
             }
             break;
 
-            case ACPI::IRQ_TO_GSI: {
-                uint irq;
-                uf >> irq;
+            case ACPI::GET_ROUTING: {
                 uf.finish_input();
 
-                uint gsi = hostacpi->irq_to_gsi(irq);
-                LOG(ACPI, "ACPI::IRQ_TO_GSI " << irq << " -> " << gsi << "\n");
-                uf << E_SUCCESS << gsi;
-            }
-            break;
-
-            case ACPI::GET_GSI: {
-                BDF bdf, parentbdf;
-                uint8_t pin;
-                uf >> bdf >> pin >> parentbdf;
-                uf.finish_input();
-
-                uint gsi = hostatare->get_gsi(bdf, pin, parentbdf);
-                LOG(ACPI, "ACPI::GET_GSI" << " bdf=" << bdf << ", pin=" << pin
-                                          << ", parent=" << parentbdf << " -> " << gsi << "\n");
-                uf << E_SUCCESS << gsi;
+                if(!routing)
+                    throw Exception(E_NOT_FOUND, "No PCI routing");
+                uf.delegate(routing->crd(DataSpaceDesc::R));
+                uf << E_SUCCESS;
             }
             break;
         }
@@ -88,7 +66,16 @@ PORTAL static void portal_acpi(void*) {
 int main() {
     try {
         hostacpi = new HostACPI();
-        hostatare = new HostATARE(*hostacpi, 0);
+
+        // resolve the PCI interrupt routing once, so that clients can look it up locally
+        ATARE atare(hostacpi->tables(), 0);
+        size_t slots = ACPI::RoutingTable::slots_for(atare.routes());
+        routing = new DataSpace(ACPI::RoutingTable::size(slots), DataSpaceDesc::ANONYMOUS,
+                                DataSpaceDesc::RW);
+        ACPI::RoutingTable *rt = reinterpret_cast<ACPI::RoutingTable*>(routing->virt());
+        rt->init(slots);
+        atare.build_routing(rt);
+        LOG(ACPI, "ACPI: " << rt->count << " PCI routes in " << slots << " slots\n");
     }
     catch(const Exception &e) {
         Serial::get() << e;
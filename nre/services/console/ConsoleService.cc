@@ -27,7 +27,7 @@ ConsoleService::ConsoleService(const char *name, uint modifier)
     : Service(name, CPUSet(CPUSet::ALL), reinterpret_cast<portal_func>(ConsoleSessionData::portal)),
       _vbe(), _reboot("reboot"), _console(), _mode(0), _cons(), _concyc(), _switcher(this),
       _modifier(modifier) {
-    // we want to accept two dataspaces
+    // we want to accept the dataspaces and the semaphore of a session
     for(auto it = CPU::begin(); it != CPU::end(); ++it) {
         Reference<LocalThread> t = get_thread(it->log_id());
         UtcbFrameRef uf(t->utcb());
@@ -55,7 +55,7 @@ void ConsoleService::create_dummy(uint page, const String &title) {
     ConsoleSessionData *sess = static_cast<ConsoleSessionData*>(new_session(args.str()));
     DataSpace *ds = new DataSpace(ExecEnv::PAGE_SIZE * VGAScreen::PAGES, DataSpaceDesc::ANONYMOUS,
                                   DataSpaceDesc::RW);
-    sess->create(nullptr, ds, 0);
+    sess->create(nullptr, ds, 0, nullptr);
     sess->set_page(page);
     memset(reinterpret_cast<void*>(ds->virt()), 0, ExecEnv::PAGE_SIZE * VGAScreen::PAGES);
     memcpy(reinterpret_cast<void*>(ds->virt() + sess->offset()),
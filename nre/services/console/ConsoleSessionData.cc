@@ -14,18 +14,25 @@
  * General Public License version 2 for more details.
  */
 
+#include <util/Atomic.h>
+#include <util/Math.h>
+#include <util/Sync.h>
 
 #include "ConsoleSessionData.h"
 
 using namespace nre;
 
-void ConsoleSessionData::create(DataSpace *in_ds, DataSpace *out_ds, Sm *sm) {
+void ConsoleSessionData::create(DataSpace *in_ds, DataSpace *out_ds, Sm *sm, DataSpace *dmg_ds) {
     ScopedLock<UserSm> guard(&_sm);
     if(_in_ds != nullptr)
         throw Exception(E_EXISTS, "Console session already initialized");
+    if(dmg_ds && dmg_ds->size() < sizeof(Console::Damage))
+        throw Exception(E_ARGS_INVALID, "Damage area too small");
     _in_ds = in_ds;
     _out_ds = out_ds;
     _in_sm = sm;
+    _dmg_ds = dmg_ds;
+    read_row_size();
     if(_in_ds)
         _prod = new Producer<Console::ReceivePacket>(*in_ds, *sm, false);
     _screen = _srv->create_screen(_mode, _out_ds->size());
@@ -40,6 +47,7 @@ void ConsoleSessionData::change_mode(nre::DataSpace *out_ds, size_t mode) {
     delete _out_ds;
     delete _screen;
     _out_ds = out_ds;
+    read_row_size();
     _screen = _srv->create_screen(_mode, _out_ds->size());
     if(_has_screen) {
         activate();
@@ -47,6 +55,72 @@ void ConsoleSessionData::change_mode(nre::DataSpace *out_ds, size_t mode) {
     }
 }
 
+void ConsoleSessionData::read_row_size() {
+    // we copy it because the client may change it at any time
+    Console::Damage *dmg = damage();
+    _row_size = 0;
+    if(dmg) {
+        size_t size = dmg->row_size;
+        if(size >= Console::Damage::MIN_ROW && Math::is_pow2(size) &&
+           _out_ds->size() <= size * Console::Damage::ROWS)
+            _row_size = size;
+    }
+}
+
+void ConsoleSessionData::refresh(bool full) {
+    if(!_out_ds)
+        return;
+
+    const char *src = reinterpret_cast<const char*>(_out_ds->virt());
+    Console::Damage *dmg = damage();
+    _stats.refreshs++;
+    if(full || !tracks_damage()) {
+        if(dmg) {
+            dmg->pending = 0;
+            for(size_t i = 0; i < Console::Damage::WORDS; ++i)
+                dmg->rows[i] = 0;
+        }
+        _stats.bytes += _screen->refresh(src, 0, _out_ds->size());
+        return;
+    }
+
+    // reset pending first, so that the client notifies us again about changes that we miss here
+    dmg->pending = 0;
+    Sync::memory_barrier();
+    // copy the changed rows, combining adjacent ones into one copy
+    size_t start = 0, count = 0;
+    for(size_t i = 0; i < Console::Damage::WORDS; ++i) {
+        word_t bits;
+        do
+            bits = dmg->rows[i];
+        while(bits && !Atomic::cmpnswap(dmg->rows + i, bits, static_cast<word_t>(0)));
+
+        for(size_t b = 0; b < sizeof(word_t) * 8; ++b) {
+            size_t row = i * sizeof(word_t) * 8 + b;
+            if(bits & (static_cast<word_t>(1) << b)) {
+                if(count == 0)
+                    start = row;
+                count++;
+            }
+            else if(count) {
+                refresh_rows(src, start, count);
+                count = 0;
+            }
+        }
+    }
+    if(count)
+        refresh_rows(src, start, count);
+}
+
+void ConsoleSessionData::refresh_rows(const char *src, size_t start, size_t count) {
+    // the bits are set by the client. thus, the rows might be beyond the end of the buffer
+    size_t size = _out_ds->size();
+    size_t off = start * _row_size;
+    if(off >= size)
+        return;
+    _stats.bytes += _screen->refresh(src, off, Math::min(count * _row_size, size - off));
+}
+
 void ConsoleSessionData::portal(ConsoleSessionData *sess) {
     UtcbFrameRef uf;
     try {
@@ -57,10 +131,14 @@ void ConsoleSessionData::portal(ConsoleSessionData *sess) {
                 capsel_t insel = uf.get_delegated(0).offset();
                 capsel_t outsel = uf.get_delegated(0).offset();
                 capsel_t smsel = uf.get_delegated(0).offset();
+                capsel_t dmgsel = uf.get_delegated(0).offset();
                 uf.finish_input();
 
-                sess->create(new DataSpace(insel), new DataSpace(outsel), new Sm(smsel, false));
+                sess->create(new DataSpace(insel), new DataSpace(outsel), new Sm(smsel, false),
+                             new DataSpace(dmgsel));
                 uf.accept_delegates();
+                // the client notifies the view switcher about changes
+                uf.delegate(sess->_srv->switcher().notify_sm().sel());
                 uf << E_SUCCESS;
             }
             break;
@@ -97,6 +175,14 @@ void ConsoleSessionData::portal(ConsoleSessionData *sess) {
             }
             break;
 
+            case Console::GET_STATS: {
+                uf.finish_input();
+
+                ScopedLock<UserSm> guard(&sess->_sm);
+                uf << E_SUCCESS << sess->stats();
+            }
+            break;
+
             case Console::SET_REGS: {
                 Console::Register regs;
                 uf >> regs;
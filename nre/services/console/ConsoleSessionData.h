@@ -28,7 +28,8 @@ public:
     ConsoleSessionData(ConsoleService *srv, size_t id, portal_func func,
                        size_t con, size_t mode, const nre::String &title)
         : ServiceSession(srv, id, func), DListItem(), _has_screen(false), _console(con), _mode(mode),
-          _screen(), _title(title), _sm(), _in_ds(), _out_ds(), _in_sm(), _prod(), _regs(), _srv(srv) {
+          _screen(), _title(title), _sm(), _in_ds(), _out_ds(), _in_sm(), _dmg_ds(), _row_size(),
+          _prod(), _regs(), _stats(), _srv(srv) {
         _regs.offset = nre::VGAStream::TEXT_OFF >> 1;
         _regs.mode = 0;
         _regs.cursor_pos = (nre::VGAStream::ROWS - 1) * nre::VGAStream::COLS + (nre::VGAStream::TEXT_OFF >> 1);
@@ -38,6 +39,7 @@ public:
         delete _prod;
         delete _in_ds;
         delete _in_sm;
+        delete _dmg_ds;
         delete _out_ds;
         delete _screen;
     }
@@ -73,10 +75,28 @@ public:
     nre::DataSpace *out_ds() {
         return _out_ds;
     }
+    const nre::Console::Stats &stats() const {
+        return _stats;
+    }
+    /**
+     * @return true if the client marks all changes of the screen buffer
+     */
+    bool tracks_damage() {
+        nre::Console::Damage *dmg = damage();
+        return dmg && dmg->enabled && _row_size != 0;
+    }
 
-    void create(nre::DataSpace *in_ds, nre::DataSpace *out_ds, nre::Sm *sm);
+    void create(nre::DataSpace *in_ds, nre::DataSpace *out_ds, nre::Sm *sm, nre::DataSpace *dmg_ds);
     void change_mode(nre::DataSpace *out_ds, size_t mode);
 
+    /**
+     * Copies the changed parts of the screen buffer to the screen. If the client does not track
+     * the damage or <full> is true, everything is copied.
+     *
+     * @param full whether to copy everything
+     */
+    void refresh(bool full);
+
     void to_front() {
         if(!_has_screen) {
             swap();
@@ -119,7 +139,13 @@ public:
 private:
     void swap() {
         _out_ds->switch_to(_screen->mem());
+        _screen->invalidate();
+    }
+    nre::Console::Damage *damage() {
+        return _dmg_ds ? reinterpret_cast<nre::Console::Damage*>(_dmg_ds->virt()) : nullptr;
     }
+    void read_row_size();
+    void refresh_rows(const char *src, size_t start, size_t count);
 
     bool _has_screen;
     size_t _console;
@@ -130,7 +156,10 @@ private:
     nre::DataSpace *_in_ds;
     nre::DataSpace *_out_ds;
     nre::Sm *_in_sm;
+    nre::DataSpace *_dmg_ds;
+    size_t _row_size;
     nre::Producer<nre::Console::ReceivePacket> *_prod;
     nre::Console::Register _regs;
+    nre::Console::Stats _stats;
     ConsoleService *_srv;
 };
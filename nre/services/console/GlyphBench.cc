@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <mem/DataSpace.h>
+#include <util/Util.h>
+#include <Test.h>
+#include <Hip.h>
+#include <cstring>
+
+#include "GlyphBench.h"
+#include "GlyphBlitter.h"
+#include "VESAFont.h"
+
+using namespace nre;
+
+static const uint WIDTH     = 1024;
+static const uint HEIGHT    = 768;
+static const uint ROUNDS    = 4;
+
+/**
+ * Draws glyphs pixel by pixel, as VESAScreen did before the GlyphBlitter was introduced
+ */
+class PixelRenderer {
+public:
+    explicit PixelRenderer(const Console::ModeInfo &info, uintptr_t fb) : _info(info), _fb(fb) {
+    }
+
+    void draw_char(unsigned xoff, unsigned yoff, char c, uint8_t color) {
+        const uint8_t *fg = GlyphBlitter::rgb(color & 0xf);
+        const uint8_t *bg = GlyphBlitter::rgb(color >> 4);
+        uint8_t ch = static_cast<uint8_t>(c);
+        for(unsigned y = 0; y < FONT_HEIGHT; y++) {
+            for(unsigned x = 0; x < FONT_WIDTH; x++) {
+                if(font8x16[ch * FONT_HEIGHT + y] & (1 << (FONT_WIDTH - x - 1)))
+                    set_pixel(xoff + x, yoff + y, fg[0], fg[1], fg[2]);
+                else
+                    set_pixel(xoff + x, yoff + y, bg[0], bg[1], bg[2]);
+            }
+        }
+    }
+
+private:
+    void set_pixel(unsigned x, unsigned y, uint8_t r, uint8_t g, uint8_t b) {
+        uint8_t red = r >> (8 - _info.red_mask_size);
+        uint8_t green = g >> (8 - _info.green_mask_size);
+        uint8_t blue = b >> (8 - _info.blue_mask_size);
+        uint32_t val = (red << _info.red_field_pos) |
+                (green << _info.green_field_pos) |
+                (blue << _info.blue_field_pos);
+        uintptr_t start = _fb + (y * _info.resolution[0] + x) * (_info.bpp / 8);
+        uint8_t *screen = reinterpret_cast<uint8_t*>(start);
+        switch(_info.bpp) {
+            case 32:
+                screen[3] = val >> 24;
+            case 24:
+                screen[2] = val >> 16;
+            case 16:
+                screen[1] = val >> 8;
+            case 8:
+                screen[0] = val;
+                break;
+        }
+    }
+
+    const Console::ModeInfo &_info;
+    uintptr_t _fb;
+};
+
+static Console::ModeInfo mode_info(uint8_t bpp) {
+    Console::ModeInfo info;
+    memset(&info, 0, sizeof(info));
+    info.resolution[0] = WIDTH;
+    info.resolution[1] = HEIGHT;
+    info.bpp = bpp;
+    info.memory_model = 6;
+    if(bpp == 16) {
+        info.red_mask_size = 5;
+        info.red_field_pos = 11;
+        info.green_mask_size = 6;
+        info.green_field_pos = 5;
+        info.blue_mask_size = 5;
+        info.blue_field_pos = 0;
+    }
+    else {
+        info.red_mask_size = info.green_mask_size = info.blue_mask_size = 8;
+        info.red_field_pos = 16;
+        info.green_field_pos = 8;
+        info.blue_field_pos = 0;
+    }
+    return info;
+}
+
+static char cell_char(uint x, uint y, uint round) {
+    return 'A' + (x + y + round) % 26;
+}
+
+static uint64_t glyphs_per_sec(uint64_t glyphs, uint64_t cycles) {
+    return cycles ? (glyphs * Hip::get().freq_tsc * 1000) / cycles : 0;
+}
+
+static void bench(uint8_t bpp) {
+    Console::ModeInfo info = mode_info(bpp);
+    size_t size = WIDTH * HEIGHT * (bpp / 8);
+    DataSpace pixds(size, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW);
+    DataSpace glyphds(size, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW);
+    PixelRenderer pixels(info, pixds.virt());
+    GlyphBlitter glyphs;
+    glyphs.set_mode(info, glyphds.virt());
+    uint cols = glyphs.cols(), rows = glyphs.rows();
+    uint64_t count = static_cast<uint64_t>(cols) * rows * ROUNDS;
+
+    uint64_t start = Util::tsc();
+    for(uint r = 0; r < ROUNDS; ++r) {
+        for(uint y = 0; y < rows; ++y) {
+            for(uint x = 0; x < cols; ++x)
+                pixels.draw_char(x * FONT_WIDTH, y * FONT_HEIGHT, cell_char(x, y, r), 0x07 + r);
+        }
+    }
+    uint64_t pixtime = Util::tsc() - start;
+
+    start = Util::tsc();
+    for(uint r = 0; r < ROUNDS; ++r) {
+        for(uint y = 0; y < rows; ++y) {
+            for(uint x = 0; x < cols; ++x)
+                glyphs.draw(x, y, cell_char(x, y, r), 0x07 + r);
+        }
+    }
+    uint64_t glyphtime = Util::tsc() - start;
+
+    // draw the last round again; nothing has changed, so that all cells are skipped
+    uint64_t drawn = 0;
+    start = Util::tsc();
+    for(uint y = 0; y < rows; ++y) {
+        for(uint x = 0; x < cols; ++x)
+            drawn += glyphs.draw(x, y, cell_char(x, y, ROUNDS - 1), 0x07 + ROUNDS - 1);
+    }
+    uint64_t unchangedtime = Util::tsc() - start;
+
+    WVPRINT(bpp << " bpp, " << cols << "x" << rows << " cells:");
+    WVPASSEQ(memcmp(reinterpret_cast<void*>(pixds.virt()), reinterpret_cast<void*>(glyphds.virt()),
+                    size), 0);
+    WVPASSEQ(drawn, static_cast<uint64_t>(0));
+    WVPERF(glyphs_per_sec(count, pixtime), "glyphs/s per pixel");
+    WVPERF(glyphs_per_sec(count, glyphtime), "glyphs/s with blitter");
+    WVPERF(glyphs_per_sec(count / ROUNDS, unchangedtime), "glyphs/s unchanged");
+}
+
+void glyph_bench() {
+    static const uint8_t depths[] = {16, 24, 32};
+    for(size_t i = 0; i < ARRAY_SIZE(depths); ++i)
+        bench(depths[i]);
+}
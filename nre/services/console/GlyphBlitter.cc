@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <Compiler.h>
+
+#include "GlyphBlitter.h"
+#include "VESAFont.h"
+
+using namespace nre;
+
+static const uint8_t colors[][3] = {
+    /* BLACK   */ {0x00,0x00,0x00},
+    /* BLUE    */ {0x00,0x00,0xA8},
+    /* GREEN   */ {0x00,0xA8,0x00},
+    /* CYAN    */ {0x00,0xA8,0xA8},
+    /* RED     */ {0xA8,0x00,0x00},
+    /* MARGENT */ {0xA8,0x00,0xA8},
+    /* ORANGE  */ {0xA8,0x57,0x00},
+    /* WHITE   */ {0xA8,0xA8,0xA8},
+    /* GRAY    */ {0x57,0x57,0x57},
+    /* LIBLUE  */ {0x57,0x57,0xFF},
+    /* LIGREEN */ {0x57,0xFF,0x57},
+    /* LICYAN  */ {0x57,0xFF,0xFF},
+    /* LIRED   */ {0xFF,0x57,0x57},
+    /* LIMARGE */ {0xFF,0x57,0xFF},
+    /* LIORANG */ {0xFF,0xFF,0x57},
+    /* LIWHITE */ {0xFF,0xFF,0xFF},
+};
+
+/**
+ * Copies one glyph into the framebuffer. A glyph row has FONT_WIDTH * BYTES bytes, which is always
+ * a multiple of 4, so that we can copy it with a fixed number of 32-bit stores.
+ */
+template<size_t BYTES>
+static inline void blit(uint8_t *dst, size_t pitch, const uint8_t *table, const uint8_t *glyph) {
+    static const size_t WORDS = (FONT_WIDTH * BYTES) / sizeof(uint32_t);
+    for(uint y = 0; y < FONT_HEIGHT; ++y, dst += pitch) {
+        uint32_t *d = reinterpret_cast<uint32_t*>(dst);
+        const uint32_t *s = reinterpret_cast<const uint32_t*>(table + glyph[y] * FONT_WIDTH * BYTES);
+        for(size_t i = 0; i < WORDS; ++i)
+            d[i] = s[i];
+    }
+}
+
+const uint8_t *GlyphBlitter::rgb(uint col) {
+    return colors[col & 0xf];
+}
+
+void GlyphBlitter::reset() {
+    for(uint i = 0; i < COLOR_PAIRS; ++i) {
+        delete[] _tables[i];
+        _tables[i] = nullptr;
+    }
+    delete[] _cells;
+    _cells = nullptr;
+    _cols = _rows = 0;
+}
+
+void GlyphBlitter::set_mode(const Console::ModeInfo &info, uintptr_t fb) {
+    reset();
+    _info = info;
+    _fb = reinterpret_cast<uint8_t*>(fb);
+    _bytespp = info.bpp / 8;
+    _pitch = info.resolution[0] * _bytespp;
+    // we support only direct color modes
+    if(info.memory_model != 6 || _bytespp == 0 || _bytespp > sizeof(uint32_t))
+        return;
+
+    _cols = info.resolution[0] / FONT_WIDTH;
+    _rows = info.resolution[1] / FONT_HEIGHT;
+    _cells = new uint32_t[_cols * _rows];
+    invalidate();
+}
+
+void GlyphBlitter::invalidate() {
+    for(size_t i = 0; i < static_cast<size_t>(_cols) * _rows; ++i)
+        _cells[i] = INVALID;
+}
+
+bool GlyphBlitter::draw(uint x, uint y, char c, uint8_t color) {
+    if(x >= _cols || y >= _rows)
+        return false;
+
+    uint8_t ch = static_cast<uint8_t>(c);
+    uint32_t *cell = _cells + y * _cols + x;
+    uint32_t val = (color << 8) | ch;
+    if(*cell == val)
+        return false;
+    *cell = val;
+
+    const uint8_t *tbl = table(color);
+    const uint8_t *glyph = font8x16 + ch * FONT_HEIGHT;
+    uint8_t *dst = _fb + y * FONT_HEIGHT * _pitch + x * FONT_WIDTH * _bytespp;
+    switch(_bytespp) {
+        case 4:
+            blit<4>(dst, _pitch, tbl, glyph);
+            break;
+        case 3:
+            blit<3>(dst, _pitch, tbl, glyph);
+            break;
+        case 2:
+            blit<2>(dst, _pitch, tbl, glyph);
+            break;
+        case 1:
+            blit<1>(dst, _pitch, tbl, glyph);
+            break;
+    }
+    return true;
+}
+
+uint32_t GlyphBlitter::pixel(uint col) const {
+    uint8_t red = colors[col][0] >> (8 - _info.red_mask_size);
+    uint8_t green = colors[col][1] >> (8 - _info.green_mask_size);
+    uint8_t blue = colors[col][2] >> (8 - _info.blue_mask_size);
+    return (red << _info.red_field_pos) |
+           (green << _info.green_field_pos) |
+           (blue << _info.blue_field_pos);
+}
+
+const uint8_t *GlyphBlitter::table(uint8_t color) {
+    if(EXPECT_FALSE(_tables[color] == nullptr)) {
+        // expand every possible glyph row into the pixel format of the framebuffer
+        size_t rowsize = FONT_WIDTH * _bytespp;
+        uint8_t *tbl = new uint8_t[256 * rowsize];
+        uint32_t fg = pixel(color & 0xf);
+        uint32_t bg = pixel(color >> 4);
+        for(uint bits = 0; bits < 256; ++bits) {
+            uint8_t *row = tbl + bits * rowsize;
+            for(uint x = 0; x < FONT_WIDTH; ++x) {
+                uint32_t val = (bits & (1 << (FONT_WIDTH - x - 1))) ? fg : bg;
+                // the framebuffer is little endian
+                for(size_t b = 0; b < _bytespp; ++b)
+                    row[x * _bytespp + b] = val >> (b * 8);
+            }
+        }
+        _tables[color] = tbl;
+    }
+    return _tables[color];
+}
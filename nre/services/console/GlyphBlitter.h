@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2012, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <arch/Types.h>
+#include <services/Console.h>
+
+/**
+ * Draws the characters of the font into a direct color framebuffer. Instead of composing every
+ * pixel separately, it expands each possible row of a glyph (i.e. each byte of the font) into the
+ * pixel format of the framebuffer, once per color pair that is used. Thus, drawing a glyph is a
+ * copy of FONT_HEIGHT precomputed rows. Additionally, it remembers what each cell shows to skip
+ * characters that have not changed.
+ */
+class GlyphBlitter {
+    static const uint32_t INVALID   = static_cast<uint32_t>(-1);
+
+public:
+    static const uint COLOR_PAIRS   = 256;
+
+    /**
+     * Creates a blitter without a framebuffer
+     */
+    explicit GlyphBlitter() : _fb(), _pitch(), _bytespp(), _cols(), _rows(), _info(), _cells(),
+        _tables() {
+    }
+    ~GlyphBlitter() {
+        reset();
+    }
+
+    /**
+     * @param col the color index (0..15)
+     * @return the red, green and blue component of the given color
+     */
+    static const uint8_t *rgb(uint col);
+
+    /**
+     * Sets the mode and the framebuffer to draw into. Forgets the expanded glyphs and the cells.
+     *
+     * @param info the mode info
+     * @param fb the address of the framebuffer
+     */
+    void set_mode(const nre::Console::ModeInfo &info, uintptr_t fb);
+
+    /**
+     * Forgets what the cells show. Has to be called if somebody else wrote to the framebuffer.
+     */
+    void invalidate();
+
+    /**
+     * @return the number of columns
+     */
+    uint cols() const {
+        return _cols;
+    }
+    /**
+     * @return the number of rows
+     */
+    uint rows() const {
+        return _rows;
+    }
+
+    /**
+     * Draws <c> with <color> into the cell <x>,<y>, unless it shows that already.
+     *
+     * @param x the column
+     * @param y the row
+     * @param c the character
+     * @param color the color (foreground in the lower, background in the upper 4 bits)
+     * @return true if something has been drawn
+     */
+    bool draw(uint x, uint y, char c, uint8_t color);
+
+private:
+    const uint8_t *table(uint8_t color);
+    uint32_t pixel(uint col) const;
+    void reset();
+
+    GlyphBlitter(const GlyphBlitter&);
+    GlyphBlitter& operator=(const GlyphBlitter&);
+
+    uint8_t *_fb;
+    size_t _pitch;
+    size_t _bytespp;
+    uint _cols;
+    uint _rows;
+    nre::Console::ModeInfo _info;
+    uint32_t *_cells;
+    // per color pair: the pixels of all 256 glyph rows
+    uint8_t *_tables[COLOR_PAIRS];
+};
@@ -29,6 +29,18 @@ public:
 
     virtual nre::DataSpace &mem() = 0;
     virtual void set_regs(const nre::Console::Register &regs, bool force) = 0;
-    virtual void refresh(const char *src, size_t size) = 0;
+    /**
+     * Copies the range <offset> .. <offset> + <size> of the buffer <src> to the screen, as far as
+     * it is visible and not covered by the tag.
+     *
+     * @return the number of copied bytes
+     */
+    virtual size_t refresh(const char *src, size_t offset, size_t size) = 0;
     virtual void write_tag(const char *tag, size_t len, uint8_t color) = 0;
+    /**
+     * Is called if the screen memory has been changed by somebody else, e.g. by a swap of the
+     * dataspaces.
+     */
+    virtual void invalidate() {
+    }
 };
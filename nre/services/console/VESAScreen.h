@@ -22,6 +22,7 @@
 #include <services/Console.h>
 
 #include "ConsoleSessionData.h"
+#include "GlyphBlitter.h"
 #include "Screen.h"
 #include "VBE.h"
 
@@ -29,7 +30,7 @@ class VESAScreen : public Screen {
 public:
     explicit VESAScreen(const VBE &vbe, uintptr_t phys, size_t size)
         : Screen(), _vbe(vbe), _ds(size, nre::DataSpaceDesc::ANONYMOUS, nre::DataSpaceDesc::RW, phys),
-          _info(), _last() {
+          _info(), _last(), _glyphs() {
     }
 
     virtual nre::DataSpace &mem() {
@@ -37,14 +38,15 @@ public:
     }
     virtual void set_regs(const nre::Console::Register &, bool);
     virtual void write_tag(const char *tag, size_t len, uint8_t color);
-    virtual void refresh(const char *src, size_t size);
+    virtual size_t refresh(const char *src, size_t offset, size_t size);
+    virtual void invalidate() {
+        _glyphs.invalidate();
+    }
 
 private:
-    void draw_char(unsigned x, unsigned y, char c, uint8_t color);
-    void set_pixel(unsigned x, unsigned y, uint8_t r, uint8_t g, uint8_t b);
-
     const VBE &_vbe;
     nre::DataSpace _ds;
     nre::Console::ModeInfo _info;
     nre::Console::Register _last;
+    GlyphBlitter _glyphs;
 };
@@ -47,8 +47,13 @@ void VGAScreen::write_tag(const char *tag, size_t len, uint8_t color) {
     }
 }
 
-void VGAScreen::refresh(const char *src, size_t size) {
-    size_t offset = _last.offset << 1;
-    memcpy(reinterpret_cast<void*>(_ds.virt() + offset + COLS * 2),
-           src + offset + COLS * 2, nre::Math::min<size_t>(size, SIZE - COLS * 2));
+size_t VGAScreen::refresh(const char *src, size_t offset, size_t size) {
+    // only the visible page, except the first line
+    size_t page = _last.offset << 1;
+    size_t end = nre::Math::min(offset + size, page + SIZE);
+    offset = nre::Math::max(offset, page + COLS * 2);
+    if(offset >= end)
+        return 0;
+    memcpy(reinterpret_cast<void*>(_ds.virt() + offset), src + offset, end - offset);
+    return end - offset;
 }
@@ -15,8 +15,8 @@
  */
 
 #include <stream/OStringStream.h>
-#include <services/Timer.h>
 #include <util/Clock.h>
+#include <util/Math.h>
 #include <Logging.h>
 
 #include "ViewSwitcher.h"
@@ -29,7 +29,7 @@ char ViewSwitcher::_buffer[256];
 
 ViewSwitcher::ViewSwitcher(ConsoleService *srv)
     : _usm(1), _ds(DS_SIZE, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW), _sm(0),
-      _prod(_ds, _sm, true), _cons(_ds, _sm, false),
+      _prod(_ds, _sm, true), _cons(_ds, _sm, false), _notify(0),
       _ec(GlobalThread::create(switch_thread, CPU::current().log_id(), "console-vs")),
       _srv(srv) {
     _ec->set_tls<ViewSwitcher*>(Thread::TLS_PARAM, this);
@@ -43,14 +43,16 @@ void ViewSwitcher::switch_to(ConsoleSessionData *from, ConsoleSessionData *to) {
     // we can't access the producer concurrently
     ScopedLock<UserSm> guard(&_usm);
     _prod.produce(cmd);
+    // wake up the switch thread, if it's waiting for changes of the previous session
+    _notify.up();
 }
 
 void ViewSwitcher::switch_thread(void*) {
     ViewSwitcher *vs = Thread::current()->get_tls<ViewSwitcher*>(Thread::TLS_PARAM);
     nre::Clock clock(1000);
-    TimerSession timer("timer");
     timevalue_t until = 0;
     size_t sessid = 0;
+    bool full = false, periodic = true;
     while(1) {
         // are we finished?
         if(until && clock.source_time() >= until) {
@@ -96,6 +98,7 @@ void ViewSwitcher::switch_thread(void*) {
             sessid = cmd->sessid;
             // show the tag for 1sec
             until = clock.source_time(SWITCH_TIME);
+            full = true;
             vs->_cons.next();
         }
 
@@ -103,19 +106,19 @@ void ViewSwitcher::switch_thread(void*) {
             Reference<ConsoleSessionData> sess = vs->_srv->get_session<ConsoleSessionData>(sessid);
             ScopedLock<UserSm> guard(&sess->sm());
 
-            // repaint all lines from the buffer except the first
-            Screen *screen = sess->screen();
-            if(sess->out_ds())
-                screen->refresh(reinterpret_cast<char*>(sess->out_ds()->virt()), sess->out_ds()->size());
+            // repaint the changed lines from the buffer except the first
+            sess->refresh(full);
 
-            // write tag into buffer
-            memset(_buffer, 0, sizeof(_buffer));
-            OStringStream os(_buffer, sizeof(_buffer));
-            os << "Console " << sess->console() << ": " << sess->title() << " (" <<
-            sess->id() << ")";
-
-            // write console tag
-            screen->write_tag(_buffer, os.length(), COLOR);
+            // the tag is not touched by the refresh, so that we need to write it only once
+            if(full) {
+                memset(_buffer, 0, sizeof(_buffer));
+                OStringStream os(_buffer, sizeof(_buffer));
+                os << "Console " << sess->console() << ": " << sess->title() << " (" <<
+                sess->id() << ")";
+                sess->screen()->write_tag(_buffer, os.length(), COLOR);
+                full = false;
+            }
+            periodic = !sess->tracks_damage();
         }
         catch(const Exception &e) {
             LOG(CONSOLE, e);
@@ -124,9 +127,11 @@ void ViewSwitcher::switch_thread(void*) {
             continue;
         }
 
-        // wait 25ms
-        LOG(CONSOLE, "Waiting until " << clock.source_time(REFRESH_DELAY) << "\n");
-        timer.wait_until(clock.source_time(REFRESH_DELAY));
+        // wait until the client notifies us about changes or the switch is finished. clients that
+        // don't track their changes are refreshed periodically.
+        timevalue_t timeout = periodic ? Math::min(until, clock.source_time(REFRESH_DELAY)) : until;
+        LOG(CONSOLE, "Waiting until " << timeout << "\n");
+        vs->_notify.down(timeout);
         LOG(CONSOLE, "Waiting done\n");
     }
 }
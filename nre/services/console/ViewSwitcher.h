@@ -31,7 +31,7 @@ class ViewSwitcher {
     static const size_t DS_SIZE       = nre::ExecEnv::PAGE_SIZE;
     static const uint COLOR           = 0x1F;
     static const uint SWITCH_TIME     = 1000; // ms
-    static const uint REFRESH_DELAY   = 25;   // ms
+    static const uint REFRESH_DELAY   = 25;   // ms (for clients that don't track the damage)
 
     struct SwitchCommand {
         size_t oldsessid;
@@ -47,6 +47,13 @@ public:
 
     void switch_to(ConsoleSessionData *from, ConsoleSessionData *to);
 
+    /**
+     * @return the semaphore that clients up to notify us about changes in their screen buffer
+     */
+    nre::Sm &notify_sm() {
+        return _notify;
+    }
+
 private:
     static void switch_thread(void*);
 
@@ -55,6 +62,7 @@ private:
     nre::Sm _sm;
     nre::Producer<SwitchCommand> _prod;
     nre::Consumer<SwitchCommand> _cons;
+    nre::Sm _notify;
     nre::Reference<nre::GlobalThread> _ec;
     ConsoleService *_srv;
     static char _buffer[];
@@ -18,6 +18,7 @@
 
 #include "ConsoleSessionData.h"
 #include "ConsoleService.h"
+#include "GlyphBench.h"
 #include "Keymap.h"
 
 using namespace nre;
@@ -25,7 +26,7 @@ using namespace nre;
 static ConsoleService *srv;
 
 static void input_thread(void*) {
-    KeyboardSession kb("keyboard");
+    KeyboardSession kb("keyboard", true);
     for(Keyboard::Packet *pk; (pk = kb.consumer().get()) != 0; kb.consumer().next()) {
         if(!srv->handle_keyevent(*pk)) {
             ConsoleService::SessionReference *sess = srv->active();
@@ -46,6 +47,8 @@ int main(int argc, char *argv[]) {
     for(int i = 1; i < argc; ++i) {
         if(strncmp(argv[i], "modifier=", 9) == 0)
             modifier = 1 << IStringStream::read_from<uint>(String(argv[i] + 9, strlen(argv[i] + 9)));
+        else if(strcmp(argv[i], "glyphbench") == 0)
+            glyph_bench();
     }
 
     srv = new ConsoleService("console", modifier);
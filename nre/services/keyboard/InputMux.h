@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <ipc/Service.h>
+#include <ipc/Producer.h>
+#include <services/Keyboard.h>
+#include <services/Mouse.h>
+#include <util/ScopedLock.h>
+
+/**
+ * A session at the keyboard or mouse service. It receives the events while it has the focus and,
+ * independent of that, the events that match one of its hot-keys.
+ */
+template<class T>
+class KeyboardSessionData : public nre::ServiceSession {
+public:
+    static const size_t MAX_HOTKEYS     = 16;
+
+    struct Hotkey {
+        nre::Keyboard::keycode_t keycode;
+        uint flags;
+    };
+
+    explicit KeyboardSessionData(nre::Service *s, size_t id, portal_func func)
+        : ServiceSession(s, id, func), _prod(), _ds(), _sm(), _focus_seq(), _hotkeys(),
+          _hotkey_count(), _dropped(), _pending() {
+    }
+    virtual ~KeyboardSessionData() {
+        delete _ds;
+        delete _sm;
+        delete _prod;
+    }
+
+    nre::Producer<T> *prod() {
+        return _prod;
+    }
+
+    void set_ds(nre::DataSpace *ds, nre::Sm *sm) {
+        if(_ds != nullptr)
+            throw nre::Exception(nre::E_EXISTS, "Keyboard session already initialized");
+        _ds = ds;
+        _sm = sm;
+        _prod = new nre::Producer<T>(*ds, *sm, false);
+    }
+
+    /**
+     * @return when this session requested the focus the last time (0 = never)
+     */
+    ulong focus_seq() const {
+        return _focus_seq;
+    }
+    void focus_seq(ulong seq) {
+        _focus_seq = seq;
+    }
+
+    /**
+     * Adds the given hot-key. Has to be done with the lock of the service held for writing.
+     */
+    void add_hotkey(nre::Keyboard::keycode_t keycode, uint flags) {
+        if(_hotkey_count == MAX_HOTKEYS)
+            VTHROW(Exception, E_CAPACITY, "Too many hot-keys (max " << MAX_HOTKEYS << ")");
+        _hotkeys[_hotkey_count].keycode = keycode;
+        _hotkeys[_hotkey_count].flags = flags;
+        _hotkey_count++;
+    }
+    /**
+     * @return true if <ev> matches one of the hot-keys
+     */
+    bool is_hotkey(const T &ev) const {
+        for(size_t i = 0; i < _hotkey_count; ++i) {
+            if(matches(_hotkeys[i], ev))
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * @return the number of events that have been dropped, because the ring was full
+     */
+    ulong dropped() const {
+        return _dropped;
+    }
+
+    /**
+     * Puts <ev> into the ring without notifying the consumer. If the ring is full, the event is
+     * dropped, so that a slow consumer can't block the delivery to the others.
+     */
+    void put(const T &ev) {
+        T *slot = _prod->current();
+        if(EXPECT_FALSE(slot == nullptr)) {
+            _dropped++;
+            return;
+        }
+        *slot = ev;
+        _prod->advance();
+        _pending = true;
+    }
+    /**
+     * Notifies the consumer once about all events that have been put into the ring since the
+     * last call.
+     */
+    void notify() {
+        if(_pending) {
+            _prod->notify();
+            _pending = false;
+        }
+    }
+
+private:
+    static bool matches(const Hotkey &hk, const nre::Keyboard::Packet &ev) {
+        return hk.keycode == ev.keycode && (ev.flags & hk.flags) == hk.flags;
+    }
+    static bool matches(const Hotkey &, const nre::Mouse::Packet &) {
+        return false;
+    }
+
+    nre::Producer<T> *_prod;
+    nre::DataSpace *_ds;
+    nre::Sm *_sm;
+    ulong _focus_seq;
+    Hotkey _hotkeys[MAX_HOTKEYS];
+    size_t _hotkey_count;
+    ulong _dropped;
+    bool _pending;
+};
+
+/**
+ * Multiplexes the events of one input device to the sessions. The events that are read during one
+ * interrupt are collected in a batch, whereas consecutive mouse movements are merged into one
+ * event. The batch is delivered to the session that has the focus, which is the one that requested
+ * it last, and to the sessions that registered a matching hot-key. Each session is notified only
+ * once per batch.
+ */
+template<class T>
+class InputMux : public nre::Service {
+public:
+    static const size_t BATCH_SIZE  = 32;
+
+    explicit InputMux(const char *name, portal_func func)
+        : Service(name, nre::CPUSet(nre::CPUSet::ALL), func), _focus(), _focus_seq(), _batch(),
+          _count() {
+        // we want to accept one dataspaces
+        for(auto it = nre::CPU::begin(); it != nre::CPU::end(); ++it) {
+            nre::Reference<nre::LocalThread> ec = get_thread(it->log_id());
+            nre::UtcbFrameRef uf(ec->utcb());
+            uf.accept_delegates(1);
+        }
+    }
+
+    /**
+     * Gives <sess> the focus
+     */
+    void focus(KeyboardSessionData<T> *sess) {
+        nre::ScopedLock<Service> guard(this);
+        sess->focus_seq(++_focus_seq);
+        _focus = sess->id();
+    }
+
+    /**
+     * Adds <ev> to the current batch. If the batch is full, it is delivered first.
+     */
+    void add(const T &ev) {
+        if(_count > 0 && coalesce(_batch[_count - 1], ev))
+            return;
+        if(_count == BATCH_SIZE)
+            flush();
+        _batch[_count++] = ev;
+    }
+
+    /**
+     * Delivers the current batch
+     */
+    void flush() {
+        if(_count == 0)
+            return;
+
+        nre::ScopedReadLock<Service> guard(this);
+        KeyboardSessionData<T> *focus = focused();
+        for(auto it = sessions_begin(); it != sessions_end(); ++it) {
+            KeyboardSessionData<T> *sess = static_cast<KeyboardSessionData<T>*>(&*it);
+            if(!sess->prod())
+                continue;
+            for(size_t i = 0; i < _count; ++i) {
+                if(sess == focus || sess->is_hotkey(_batch[i]))
+                    sess->put(_batch[i]);
+            }
+            sess->notify();
+        }
+        _count = 0;
+    }
+
+private:
+    virtual nre::ServiceSession *create_session(size_t id, const nre::String &, portal_func func) {
+        return new KeyboardSessionData<T>(this, id, func);
+    }
+
+    KeyboardSessionData<T> *focused() {
+        // if the session with the focus is gone, the one that requested it most recently gets it
+        KeyboardSessionData<T> *last = nullptr;
+        for(auto it = sessions_begin(); it != sessions_end(); ++it) {
+            KeyboardSessionData<T> *sess = static_cast<KeyboardSessionData<T>*>(&*it);
+            if(sess->id() == _focus && sess->focus_seq())
+                return sess;
+            if(sess->focus_seq() && (!last || sess->focus_seq() > last->focus_seq()))
+                last = sess;
+        }
+        if(last)
+            _focus = last->id();
+        return last;
+    }
+
+    static bool coalesce(nre::Keyboard::Packet &, const nre::Keyboard::Packet &) {
+        return false;
+    }
+    static bool coalesce(nre::Mouse::Packet &last, const nre::Mouse::Packet &ev) {
+        // only pure movements with the same buttons and without overflow
+        if(((last.status ^ ev.status) & nre::Mouse::BUTTONS) ||
+           ((last.status | ev.status) & (nre::Mouse::X_OVERFLOW | nre::Mouse::Y_OVERFLOW)) ||
+           last.z || ev.z)
+            return false;
+        int x = nre::Mouse::delta_x(last) + nre::Mouse::delta_x(ev);
+        int y = nre::Mouse::delta_y(last) + nre::Mouse::delta_y(ev);
+        if(x < nre::Mouse::MIN_DELTA || x > nre::Mouse::MAX_DELTA ||
+           y < nre::Mouse::MIN_DELTA || y > nre::Mouse::MAX_DELTA)
+            return false;
+        nre::Mouse::set_delta(last, x, y);
+        return true;
+    }
+
+    volatile size_t _focus;
+    ulong _focus_seq;
+    T _batch[BATCH_SIZE];
+    size_t _count;
+};
@@ -14,13 +14,12 @@
  * General Public License version 2 for more details.
  */
 
-#include <ipc/Service.h>
-#include <ipc/Producer.h>
 #include <kobj/GlobalThread.h>
 #include <kobj/Gsi.h>
 #include <services/ACPI.h>
 
 #include "HostKeyboard.h"
+#include "InputMux.h"
 
 using namespace nre;
 
@@ -29,81 +28,22 @@ enum {
     MOUSE_IRQ       = 12
 };
 
-template<class T>
-class KeyboardSessionData : public ServiceSession {
-public:
-    explicit KeyboardSessionData(Service *s, size_t id, portal_func func)
-        : ServiceSession(s, id, func), _prod(), _ds(), _sm() {
-    }
-    virtual ~KeyboardSessionData() {
-        delete _ds;
-        delete _sm;
-        delete _prod;
-    }
-
-    Producer<T> *prod() {
-        return _prod;
-    }
-
-    void set_ds(DataSpace *ds, Sm *sm) {
-        if(_ds != nullptr)
-            throw Exception(E_EXISTS, "Keyboard session already initialized");
-        _ds = ds;
-        _sm = sm;
-        _prod = new Producer<T>(*ds, *sm, false);
-    }
-
-private:
-    Producer<T> *_prod;
-    DataSpace *_ds;
-    Sm *_sm;
-};
-
-template<class T>
-class KeyboardService : public Service {
-public:
-    typedef typename SListTreap<KeyboardSessionData<T> >::iterator iterator;
-
-    explicit KeyboardService(const char *name, portal_func func)
-        : Service(name, CPUSet(CPUSet::ALL), func) {
-        // we want to accept one dataspaces
-        for(auto it = CPU::begin(); it != CPU::end(); ++it) {
-            Reference<LocalThread> ec = get_thread(it->log_id());
-            UtcbFrameRef uf(ec->utcb());
-            uf.accept_delegates(1);
-        }
-    }
-
-private:
-    virtual ServiceSession *create_session(size_t id, const String &, portal_func func) {
-        return new KeyboardSessionData<T>(this, id, func);
-    }
-};
-
 static HostKeyboard *hostkb;
-static KeyboardService<Keyboard::Packet> *kbsrv;
-static KeyboardService<Mouse::Packet> *mousesrv;
+static InputMux<Keyboard::Packet> *kbsrv;
+static InputMux<Mouse::Packet> *mousesrv;
 static uint kbgsi;
 static uint msgsi;
 
-template<class T>
-static void broadcast(KeyboardService<T> *srv, const T &data) {
-    ScopedLock<Service> guard(srv);
-    for(auto it = srv->sessions_begin(); it != srv->sessions_end(); ++it) {
-        KeyboardSessionData<T> *sess = static_cast<KeyboardSessionData<T>*>(&*it);
-        if(sess->prod())
-            sess->prod()->produce(data);
-    }
-}
-
 static void kbhandler(void*) {
     Gsi gsi(kbgsi);
     while(1) {
         gsi.down();
 
+        // deliver everything the controller has for us at once
         Keyboard::Packet data;
-        if(hostkb->read(data))
-            broadcast(kbsrv, data);
+        while(hostkb->read(data))
+            kbsrv->add(data);
+        kbsrv->flush();
     }
 }
 
@@ -113,8 +53,9 @@ static void mousehandler(void*) {
         gsi.down();
 
         Mouse::Packet data;
-        if(hostkb->read(data))
-            broadcast(mousesrv, data);
+        while(hostkb->read(data))
+            mousesrv->add(data);
+        mousesrv->flush();
     }
 }
 
@@ -140,6 +81,26 @@ PORTAL static void portal_keyboard(KeyboardSessionData<typename Keyboard::Packet
             case Keyboard::SHARE_DS:
                 handle_share<Keyboard>(uf, sess);
                 break;
+
+            case Keyboard::FOCUS:
+                uf.finish_input();
+                kbsrv->focus(sess);
+                break;
+
+            case Keyboard::ADD_HOTKEY: {
+                Keyboard::keycode_t keycode;
+                uint flags;
+                uf >> keycode >> flags;
+                uf.finish_input();
+                ScopedLock<Service> guard(kbsrv);
+                sess->add_hotkey(keycode, flags);
+            }
+            break;
+
+            case Keyboard::GET_DROPPED:
+                uf.finish_input();
+                uf << E_SUCCESS << sess->dropped();
+                return;
         }
         uf << E_SUCCESS;
     }
@@ -153,6 +114,8 @@ PORTAL static void portal_mouse(KeyboardSessionData<typename Mouse::Packet>* ses
     UtcbFrameRef uf;
     try {
         handle_share<Mouse>(uf, sess);
+        // there is only one consumer of the mouse at a time
+        mousesrv->focus(sess);
         uf << E_SUCCESS;
     }
     catch(const Exception &e) {
@@ -162,7 +125,7 @@ PORTAL static void portal_mouse(KeyboardSessionData<typename Mouse::Packet>* ses
 }
 
 static void mouseservice(void*) {
-    mousesrv = new KeyboardService<Mouse::Packet>("mouse",
+    mousesrv = new InputMux<Mouse::Packet>("mouse",
             reinterpret_cast<Service::portal_func>(portal_mouse));
     GlobalThread::create(mousehandler, CPU::current().log_id(), "mouse-broadcast")->start();
     mousesrv->start();
@@ -188,7 +151,7 @@ int main(int argc, char *argv[]) {
     hostkb = new HostKeyboard(scset, mouse);
     hostkb->reset();
 
-    kbsrv = new KeyboardService<Keyboard::Packet>("keyboard",
+    kbsrv = new InputMux<Keyboard::Packet>("keyboard",
             reinterpret_cast<Service::portal_func>(portal_keyboard));
     if(hostkb->mouse_enabled())
         GlobalThread::create(mouseservice, CPU::current().log_id(), "mouse")->start();
@@ -17,15 +17,88 @@
 #pragma once
 
 #include <services/Network.h>
+#include <kobj/Sm.h>
+#include <util/Atomic.h>
+#include <util/Sync.h>
+#include <Hip.h>
 
 class NICDriver {
 public:
-    explicit NICDriver() {
+    explicit NICDriver() : _id(), _txwaiters() {
     }
     virtual ~NICDriver() {
     }
 
+    /**
+     * @return the id of this NIC (assigned by NICList::reg)
+     */
+    size_t id() const {
+        return _id;
+    }
+    void id(size_t id) {
+        _id = id;
+    }
+
+    /**
+     * A frame for send_batch()
+     */
+    struct Packet {
+        const void *data;
+        size_t size;
+    };
+
     virtual const char *name() const = 0;
     virtual bool send(const void *packet, size_t size) = 0;
     virtual nre::Network::EthernetAddr get_mac() = 0;
+    /**
+     * @return the size of the largest frame the NIC is able to send
+     */
+    virtual size_t max_frame_size() const = 0;
+
+    /**
+     * Sends the given frames in this order. Drivers should override it if they can send multiple
+     * frames cheaper than one at a time. By default, send() is called for each frame.
+     *
+     * @param packets the frames
+     * @param count the number of frames
+     * @return the number of frames that have been accepted. The frames behind them have not been
+     *  touched, because the NIC has no room for them at the moment. In this case, the driver
+     *  notifies the waiters (see wait_tx) as soon as it has room again.
+     */
+    virtual size_t send_batch(const Packet *packets, size_t count) {
+        size_t i = 0;
+        while(i < count && send(packets[i].data, packets[i].size))
+            i++;
+        return i;
+    }
+
+    /**
+     * Lets the driver up <sm> as soon as the NIC has made room for new frames. This is meant to be
+     * used if send_batch() did not accept all frames. Since the NIC might have made room in the
+     * meantime, the caller should call send_batch() once more afterwards, before it blocks on <sm>.
+     *
+     * @param cpu the CPU of the caller (there is at most one waiter per CPU)
+     * @param sm the semaphore to up
+     */
+    void wait_tx(cpu_t cpu, nre::Sm &sm) {
+        _txwaiters[cpu] = &sm;
+        nre::Sync::memory_barrier();
+    }
+
+protected:
+    /**
+     * Has to be called by the driver whenever the NIC has made room for new frames. Wakes up all
+     * waiters once.
+     */
+    void tx_done() {
+        for(size_t i = 0; i < nre::Hip::MAX_CPUS; ++i) {
+            nre::Sm *sm = _txwaiters[i];
+            if(sm && nre::Atomic::cmpnswap(_txwaiters + i, sm, static_cast<nre::Sm*>(nullptr)))
+                sm->up();
+        }
+    }
+
+private:
+    size_t _id;
+    nre::Sm *volatile _txwaiters[nre::Hip::MAX_CPUS];
 };
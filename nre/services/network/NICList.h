@@ -44,6 +44,7 @@ public:
 
     size_t reg(NICDriver *driver) {
         assert(_count < nre::Network::MAX_NICS - 1);
+        driver->id(_count);
         _drivers[_count++] = driver;
         return _count - 1;
     }
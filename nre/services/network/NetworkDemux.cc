@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include "NetworkDemux.h"
+#include "NetworkService.h"
+
+using namespace nre;
+
+NetworkDemux::Table::~Table() {
+    for(size_t i = 0; i < all_count; ++i) {
+        if(all[i]->rem_ref())
+            delete all[i];
+    }
+    delete[] entries;
+    delete[] all;
+    delete[] promisc;
+}
+
+void NetworkDemux::add_mac(NetworkService &srv, NetworkSessionData *sess,
+                           const Network::EthernetAddr &mac) {
+    ScopedLock<UserSm> guard(&_sm);
+    if(sess->has_mac(mac))
+        VTHROW(Exception, E_EXISTS, "MAC " << mac << " is already registered");
+    if(sess->mac_count() == Network::MAX_MACS)
+        VTHROW(Exception, E_CAPACITY, "No free MAC slots (max " << Network::MAX_MACS << ")");
+    sess->_macs[sess->_mac_count++] = mac;
+    rebuild(srv, sess->nic());
+}
+
+void NetworkDemux::remove_mac(NetworkService &srv, NetworkSessionData *sess,
+                              const Network::EthernetAddr &mac) {
+    ScopedLock<UserSm> guard(&_sm);
+    for(size_t i = 0; i < sess->_mac_count; ++i) {
+        if(sess->_macs[i] == mac) {
+            sess->_macs[i] = sess->_macs[--sess->_mac_count];
+            rebuild(srv, sess->nic());
+            return;
+        }
+    }
+    VTHROW(Exception, E_NOT_FOUND, "MAC " << mac << " is not registered");
+}
+
+void NetworkDemux::update(NetworkService &srv, size_t nic) {
+    ScopedLock<UserSm> guard(&_sm);
+    rebuild(srv, nic);
+}
+
+void NetworkDemux::rebuild(NetworkService &srv, size_t nic) {
+    Table *table;
+    {
+        ScopedLock<Service> guard(&srv);
+        size_t sessions = 0, entries = 0;
+        for(auto it = srv.sessions_begin(); it != srv.sessions_end(); ++it) {
+            NetworkSessionData *sess = static_cast<NetworkSessionData*>(&*it);
+            if(sess->nic() == nic) {
+                sessions++;
+                entries += sess->mac_count() + sess->_learned_count;
+            }
+        }
+
+        table = new Table(sessions, entries);
+        for(auto it = srv.sessions_begin(); it != srv.sessions_end(); ++it) {
+            NetworkSessionData *sess = static_cast<NetworkSessionData*>(&*it);
+            if(sess->nic() != nic)
+                continue;
+
+            sess->add_ref();
+            table->all[table->all_count++] = sess;
+            if(sess->mac_count() == 0)
+                table->promisc[table->promisc_count++] = sess;
+            for(size_t i = 0; i < sess->mac_count() + sess->_learned_count; ++i) {
+                Entry *e = table->entries + table->entry_count++;
+                e->learned = i >= sess->mac_count();
+                e->mac = e->learned ? sess->_learned[i - sess->mac_count()].raw() : sess->_macs[i].raw();
+                e->sess = sess;
+                size_t idx = hash(e->mac);
+                e->next = table->buckets[idx];
+                table->buckets[idx] = e;
+            }
+        }
+    }
+
+    // publish the new table and let RCU delete the old one as soon as no receiver uses it anymore
+    Table *old = _table;
+    rcu_assign_pointer(_table, table);
+    if(old)
+        RCU::invalidate(old);
+}
+
+void NetworkDemux::deliver(const void *packet, size_t len) {
+    if(len < sizeof(Network::EthernetHeader))
+        return;
+
+    ScopedLock<RCULock> guard(&RCU::lock());
+    const Table *table = rcu_dereference(_table);
+    if(!table)
+        return;
+
+    const Network::EthernetHeader *header = reinterpret_cast<const Network::EthernetHeader*>(packet);
+    Network::EthernetAddr dst(header->mac_dst);
+    if(dst.is_broadcast()) {
+        for(size_t i = 0; i < table->all_count; ++i)
+            table->all[i]->enqueue(packet, len);
+        return;
+    }
+
+    // learned addresses belong to sessions without registered addresses, which get it anyway
+    for(Entry *e = table->buckets[hash(dst.raw())]; e != nullptr; e = e->next) {
+        if(!e->learned && e->mac == dst.raw())
+            e->sess->enqueue(packet, len);
+    }
+    for(size_t i = 0; i < table->promisc_count; ++i)
+        table->promisc[i]->enqueue(packet, len);
+}
+
+bool NetworkDemux::forward(NetworkService &srv, NetworkSessionData *from, const void *packet,
+                           size_t len) {
+    if(len < sizeof(Network::EthernetHeader))
+        return true;
+
+    const Network::EthernetHeader *header = reinterpret_cast<const Network::EthernetHeader*>(packet);
+    Network::EthernetAddr src(header->mac_src);
+    Network::EthernetAddr dst(header->mac_dst);
+
+    // learn where the source address lives, if we don't know that yet
+    if(!src.is_multicast()) {
+        bool known;
+        {
+            ScopedLock<RCULock> guard(&RCU::lock());
+            const Table *table = rcu_dereference(_table);
+            known = table && knows(table, src.raw(), from);
+        }
+        if(!known)
+            learn(srv, from, src);
+    }
+
+    ScopedLock<RCULock> guard(&RCU::lock());
+    const Table *table = rcu_dereference(_table);
+    if(!table)
+        return true;
+
+    if(dst.is_broadcast()) {
+        for(size_t i = 0; i < table->all_count; ++i) {
+            if(table->all[i] != from)
+                table->all[i]->enqueue(packet, len);
+        }
+        return true;
+    }
+
+    bool found = false;
+    for(Entry *e = table->buckets[hash(dst.raw())]; e != nullptr; e = e->next) {
+        if(e->mac == dst.raw() && e->sess != from && (!e->learned || !dst.is_multicast())) {
+            e->sess->enqueue(packet, len);
+            found = true;
+        }
+    }
+    // a known unicast address is local, so that we're done
+    if(found && !dst.is_multicast())
+        return false;
+
+    // otherwise flood it
+    for(size_t i = 0; i < table->promisc_count; ++i) {
+        if(table->promisc[i] != from)
+            table->promisc[i]->enqueue(packet, len);
+    }
+    return true;
+}
+
+void NetworkDemux::learn(NetworkService &srv, NetworkSessionData *sess, const Network::EthernetAddr &mac) {
+    ScopedLock<UserSm> guard(&_sm);
+    if(sess->has_mac(mac) || sess->has_learned(mac))
+        return;
+
+    // if the address has moved, forget it at the previous session
+    {
+        ScopedLock<Service> sguard(&srv);
+        for(auto it = srv.sessions_begin(); it != srv.sessions_end(); ++it) {
+            NetworkSessionData *other = static_cast<NetworkSessionData*>(&*it);
+            if(other->nic() == sess->nic())
+                other->forget(mac);
+        }
+    }
+
+    LOG(NET_DETAIL, "Learned MAC " << mac << " at client " << sess->id() << "\n");
+    sess->_learned[sess->_learned_next] = mac;
+    sess->_learned_next = (sess->_learned_next + 1) % NetworkSessionData::MAX_LEARNED;
+    if(sess->_learned_count < NetworkSessionData::MAX_LEARNED)
+        sess->_learned_count++;
+    rebuild(srv, sess->nic());
+}
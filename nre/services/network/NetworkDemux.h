@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <kobj/UserSm.h>
+#include <services/Network.h>
+#include <RCU.h>
+
+class NetworkService;
+class NetworkSessionData;
+
+/**
+ * Delivers the frames received by one NIC to the sessions they are destined for. Sessions that
+ * registered addresses receive only the frames to one of their addresses, sessions without
+ * addresses receive all frames. Broadcast frames are delivered to all sessions.
+ *
+ * Additionally, it acts as a learning L2 switch between the sessions of the NIC: it learns the
+ * source addresses of the frames the sessions send and forwards frames to a known local address
+ * directly into the ring of that session, without involving the NIC. Frames to unknown addresses
+ * are flooded, i.e. delivered to all sessions without registered addresses and sent via the NIC.
+ *
+ * The lookup is done in a hash table that is rebuilt whenever the sessions or their addresses
+ * change and published via RCU. Thus, the receive path does not need to take any lock.
+ */
+class NetworkDemux {
+    static const size_t BUCKETS = 64;
+
+    struct Entry {
+        uint64_t mac;
+        NetworkSessionData *sess;
+        bool learned;
+        Entry *next;
+    };
+
+    /**
+     * An immutable snapshot of the demultiplexing state. It holds a reference to all contained
+     * sessions, so that they are not destroyed while a receiver might still use them.
+     */
+    class Table : public nre::RCUObject {
+    public:
+        explicit Table(size_t sessions, size_t entries)
+            : nre::RCUObject(), buckets(), entries(new Entry[entries]), entry_count(),
+              all(new NetworkSessionData*[sessions]), all_count(),
+              promisc(new NetworkSessionData*[sessions]), promisc_count() {
+        }
+        virtual ~Table();
+
+        Entry *buckets[BUCKETS];
+        Entry *entries;
+        size_t entry_count;
+        NetworkSessionData **all;
+        size_t all_count;
+        NetworkSessionData **promisc;
+        size_t promisc_count;
+    };
+
+public:
+    explicit NetworkDemux() : _sm(), _table() {
+    }
+
+    /**
+     * Adds <mac> to the addresses of <sess>.
+     *
+     * @throws Exception if the address is already registered or there is no slot left
+     */
+    void add_mac(NetworkService &srv, NetworkSessionData *sess, const nre::Network::EthernetAddr &mac);
+    /**
+     * Removes <mac> from the addresses of <sess>.
+     *
+     * @throws Exception if the address is not registered
+     */
+    void remove_mac(NetworkService &srv, NetworkSessionData *sess,
+                    const nre::Network::EthernetAddr &mac);
+
+    /**
+     * Rebuilds the table from the sessions of <srv> that belong to <nic>. Has to be called
+     * whenever a session has been added or removed.
+     */
+    void update(NetworkService &srv, size_t nic);
+
+    /**
+     * Delivers the given frame to all sessions it is destined for.
+     */
+    void deliver(const void *packet, size_t len);
+
+    /**
+     * Switches the given frame, sent by session <from>, to the local sessions it is destined for.
+     *
+     * @return true if the frame has to be sent via the NIC as well
+     */
+    bool forward(NetworkService &srv, NetworkSessionData *from, const void *packet, size_t len);
+
+private:
+    static size_t hash(uint64_t mac) {
+        return (mac ^ (mac >> 12) ^ (mac >> 24) ^ (mac >> 36)) % BUCKETS;
+    }
+    static bool knows(const Table *table, uint64_t mac, const NetworkSessionData *sess) {
+        for(Entry *e = table->buckets[hash(mac)]; e != nullptr; e = e->next) {
+            if(e->mac == mac && e->sess == sess)
+                return true;
+        }
+        return false;
+    }
+    void learn(NetworkService &srv, NetworkSessionData *sess, const nre::Network::EthernetAddr &mac);
+    void rebuild(NetworkService &srv, size_t nic);
+
+    nre::UserSm _sm;
+    Table *_table;
+};
@@ -15,6 +15,9 @@
  */
 
 #include <util/Endian.h>
+#include <util/Math.h>
+#include <util/Sync.h>
+#include <util/Trace.h>
 
 #include "NetworkService.h"
 
@@ -46,53 +49,123 @@ static void print_packet(const char *prefix, size_t len, const void *packet) {
     }
 }
 
-void NetworkSessionData::init(DataSpace *inds, Sm *insm, DataSpace *outds, Sm *outsm) {
-    if(_in.ds != nullptr)
+NetworkSessionData::NetworkSessionData(NetworkService *s, size_t id, portal_func func, size_t nic,
+                                       NICDriver *driver)
+    : ServiceSession(s, id, func), _srv(s), _inds(), _out(), _statuschan(), _cons(), _prod(),
+      _prodsm(), _txstatus(), _txbatch(), _txframes(), _txwire(), _txdone(), _txdropped(),
+      _worker(), _tx_next(), _nic(nic), _driver(driver), _macs(), _mac_count(), _learned(),
+      _learned_count(), _learned_next(), _stats() {
+}
+
+void NetworkSessionData::closed() {
+    // we have already been removed from the session list; so this drops us from the demux. the
+    // receivers that still use the old table keep a reference to us
+    _srv->demux(_nic).update(*_srv, _nic);
+}
+
+void NetworkSessionData::invalidate() {
+    if(_worker)
+        _worker->remove(this);
+}
+
+void NetworkSessionData::init(DataSpace *inds, DataSpace *outds, Sm *outsm, DataSpace *statusds,
+                              Sm *statussm) {
+    if(_inds != nullptr)
         throw Exception(E_EXISTS, "Network session already initialized");
-    _in.ds = inds;
-    _in.sm = insm;
+    if(statusds->size() < sizeof(Network::TxStatusSlot))
+        throw Exception(E_ARGS_INVALID, "Status dataspace too small");
+    _inds = inds;
     _out.ds = outds;
     _out.sm = outsm;
-    _cons = new PacketConsumer(*_in.ds, *_in.sm, false);
+    _statuschan.ds = statusds;
+    _statuschan.sm = statussm;
+    // the client notifies the transmit worker of this CPU about new frames
+    _worker = &_srv->tx_workers().get(CPU::current().log_id());
+    _cons = new PacketConsumer(*_inds, _worker->sm(), false);
     _prod = new PacketProducer(*_out.ds, *_out.sm, false);
-    _gt = GlobalThread::create(consumer_thread, CPU::current().log_id(),
-                                    "network-consumer");
-    _gt->set_tls(Thread::TLS_PARAM, this);
-    _gt->start();
+    _txstatus = reinterpret_cast<Network::TxStatusSlot*>(_statuschan.ds->virt());
+    _worker->add(this);
 }
 
-void NetworkSessionData::consumer_thread(void*) {
-    NetworkSessionData *sess = Thread::current()->get_tls<NetworkSessionData*>(Thread::TLS_PARAM);
-    while(1) {
-        void *packet;
-        size_t len = sess->_cons->get(packet);
-        if(!len)
-            break;
+bool NetworkSessionData::transmit(size_t max) {
+    // start a new batch, if the previous one is done
+    if(_txframes == 0) {
+        void *packets[TxWorkers::BATCH_SIZE];
+        size_t lengths[TxWorkers::BATCH_SIZE];
+        _txframes = _cons->peek(packets, lengths, Math::min(max, TxWorkers::BATCH_SIZE));
+        if(_txframes == 0)
+            return false;
 
-        print_packet("Sending", len, packet);
-        sess->_driver->send(packet, len);
-        sess->_cons->next();
+        // switch them locally and collect the ones that have to be sent via the NIC. they stay in
+        // the ring until the batch is done
+        NetworkDemux &demux = _srv->demux(_nic);
+        _txwire = _txdone = _txdropped = 0;
+        for(size_t i = 0; i < _txframes; ++i) {
+            print_packet("Sending", lengths[i], packets[i]);
+            if(demux.forward(*_srv, this, packets[i], lengths[i])) {
+                // the NIC will never be able to send it, so that there is no point in waiting
+                if(lengths[i] > _driver->max_frame_size()) {
+                    LOG(NET_DETAIL, "Client " << id() << " lost packet of length " << lengths[i]
+                        << " (too large)\n");
+                    _txdropped++;
+                    continue;
+                }
+                _txbatch[_txwire].data = packets[i];
+                _txbatch[_txwire].size = lengths[i];
+                _txwire++;
+            }
+        }
+    }
+
+    // if the NIC has no room, the frames stay in the ring and the client sees that via the status,
+    // which is not updated until the batch is done. the driver wakes up the worker again, as soon
+    // as the NIC has room. since that might have happened already, we try it once more afterwards
+    if(_txdone < _txwire) {
+        _txdone += _driver->send_batch(_txbatch + _txdone, _txwire - _txdone);
+        if(_txdone < _txwire) {
+            _driver->wait_tx(CPU::current().log_id(), _worker->sm());
+            _txdone += _driver->send_batch(_txbatch + _txdone, _txwire - _txdone);
+            if(_txdone < _txwire)
+                return false;
+        }
     }
+
+    _cons->next(_txframes);
+    report_tx(_txframes, _txdropped);
+    _txframes = 0;
+    return _cons->has_data();
+}
+
+void NetworkSessionData::report_tx(size_t count, size_t dropped) {
+    Atomic::add(&_stats.tx_packets, count - dropped);
+    Atomic::add(&_stats.tx_dropped, dropped);
+
+    // the status is cumulative and overwritten in place, so that the client always gets the
+    // latest one, even if it hasn't looked at it for a while
+    _txstatus->seq++;
+    Sync::memory_barrier();
+    _txstatus->status.completed += count;
+    _txstatus->status.dropped += dropped;
+    Sync::memory_barrier();
+    _txstatus->seq++;
+    _statuschan.sm->up();
 }
 
 NetworkService::NetworkService(NICList &nics, const char *name)
     : Service(name, CPUSet(CPUSet::ALL), reinterpret_cast<portal_func>(portal)),
-      _nics(nics) {
-    // we want to accept two dataspaces and two sms
+      _nics(nics), _demux(), _workers() {
+    // we want to accept three dataspaces and two sms
     for(auto it = CPU::begin(); it != CPU::end(); ++it) {
         Reference<LocalThread> ec = get_thread(it->log_id());
         UtcbFrameRef uf(ec->utcb());
-        uf.accept_delegates(2);
+        uf.accept_delegates(3);
     }
 }
 
-void NetworkService::broadcast(const void *packet, size_t len) {
-    ScopedLock<Service> guard(this);
+void NetworkService::broadcast(size_t nic, const void *packet, size_t len) {
+    TRACE_SCOPE(Trace::NET_RECEIVE, len);
     print_packet("Received", len, packet);
-    for(auto sess = sessions_begin(); sess != sessions_end(); ++sess) {
-        if(!static_cast<NetworkSessionData*>(&*sess)->enqueue(packet, len))
-            LOG(NET, "Client " << sess->id() << " lost packet of length " << len << "\n");
-    }
+    _demux[nic].deliver(packet, len);
 }
 
 ServiceSession *NetworkService::create_session(size_t id, const String &args, portal_func func) {
@@ -112,17 +185,43 @@ void NetworkService::portal(NetworkSessionData *sess) {
         switch(cmd) {
             case Network::INIT: {
                 capsel_t inds = uf.get_delegated(0).offset();
-                capsel_t insm = uf.get_delegated(0).offset();
                 capsel_t outds = uf.get_delegated(0).offset();
                 capsel_t outsm = uf.get_delegated(0).offset();
+                capsel_t statusds = uf.get_delegated(0).offset();
+                capsel_t statussm = uf.get_delegated(0).offset();
                 uf.finish_input();
-                sess->init(new DataSpace(inds), new Sm(insm, false),
-                        new DataSpace(outds), new Sm(outsm, false));
+                sess->init(new DataSpace(inds), new DataSpace(outds), new Sm(outsm, false),
+                        new DataSpace(statusds), new Sm(statussm, false));
+                sess->_srv->demux(sess->nic()).update(*sess->_srv, sess->nic());
                 uf.accept_delegates();
+                // the client may only notify the worker, but not wait for it
+                uf.delegate(Crd(sess->tx_worker()->sm().sel(), 0, Crd::OBJ | Crd::SM_UP));
                 uf << E_SUCCESS;
             }
             break;
 
+            case Network::ADD_MAC:
+            case Network::REMOVE_MAC: {
+                Network::EthernetAddr mac;
+                uf >> mac;
+                uf.finish_input();
+                NetworkDemux &demux = sess->_srv->demux(sess->nic());
+                if(cmd == Network::ADD_MAC)
+                    demux.add_mac(*sess->_srv, sess, mac);
+                else
+                    demux.remove_mac(*sess->_srv, sess, mac);
+                LOG(NET, "Client " << sess->id() << (cmd == Network::ADD_MAC ? " added" : " removed")
+                    << " MAC " << mac << "\n");
+                uf << E_SUCCESS;
+            }
+            break;
+
+            case Network::GET_STATS: {
+                uf.finish_input();
+                uf << E_SUCCESS << sess->stats();
+            }
+            break;
+
             case Network::GET_INFO: {
                 uf.finish_input();
                 Network::NIC info;
@@ -18,15 +18,30 @@
 
 #include <mem/DataSpace.h>
 #include <kobj/Sm.h>
+#include <kobj/UserSm.h>
 #include <ipc/ServiceSession.h>
 #include <ipc/Service.h>
 #include <ipc/PacketProducer.h>
 #include <ipc/PacketConsumer.h>
 #include <stream/IStringStream.h>
+#include <util/Atomic.h>
+#include <util/ScopedLock.h>
+#include <Logging.h>
 
 #include "NICList.h"
+#include "NetworkDemux.h"
+#include "TxWorkers.h"
+
+class NetworkService;
 
 class NetworkSessionData : public nre::ServiceSession {
+    friend class NetworkService;
+    friend class NetworkDemux;
+    friend class TxWorkers;
+
+    // the number of source addresses the switch remembers per session
+    static const size_t MAX_LEARNED = 8;
+
     struct Channel {
         Channel() : ds(), sm() {
         }
@@ -39,20 +54,16 @@ class NetworkSessionData : public nre::ServiceSession {
     };
 
 public:
-    explicit NetworkSessionData(nre::Service *s, size_t id, portal_func func, size_t nic,
-                                NICDriver *driver)
-        : ServiceSession(s, id, func), _in(), _out(), _cons(), _prod(), _gt(),
-          _nic(nic), _driver(driver) {
-    }
+    explicit NetworkSessionData(NetworkService *s, size_t id, portal_func func, size_t nic,
+                                NICDriver *driver);
     virtual ~NetworkSessionData() {
         delete _prod;
         delete _cons;
+        delete _inds;
     }
 
-    virtual void invalidate() {
-        if(_cons)
-            _cons->stop();
-    }
+    virtual void closed();
+    virtual void invalidate();
 
     size_t nic() const {
         return _nic;
@@ -60,29 +71,126 @@ public:
     NICDriver *driver() {
         return _driver;
     }
+    const nre::Network::Stats &stats() const {
+        return _stats;
+    }
+    size_t mac_count() const {
+        return _mac_count;
+    }
+    bool has_mac(const nre::Network::EthernetAddr &mac) const {
+        for(size_t i = 0; i < _mac_count; ++i) {
+            if(_macs[i] == mac)
+                return true;
+        }
+        return false;
+    }
+    bool has_learned(const nre::Network::EthernetAddr &mac) const {
+        for(size_t i = 0; i < _learned_count; ++i) {
+            if(_learned[i] == mac)
+                return true;
+        }
+        return false;
+    }
+
+    /**
+     * Puts the given frame into the ring of this session.
+     *
+     * @return true if successful, false if it has been dropped
+     */
     bool enqueue(const void *packet, size_t len) {
-        return _prod->produce(packet, len);
+        // not initialized yet?
+        if(!_prod)
+            return false;
+        // the receive thread of the NIC and the transmit workers of other sessions might call us
+        // at the same time, but the ring supports only one producer
+        bool res;
+        {
+            nre::ScopedLock<nre::UserSm> guard(&_prodsm);
+            res = _prod->produce(packet, len);
+        }
+        if(!res) {
+            nre::Atomic::add(&_stats.rx_dropped, 1);
+            LOG(NET_DETAIL, "Client " << id() << " lost packet of length " << len << "\n");
+            return false;
+        }
+        nre::Atomic::add(&_stats.rx_packets, 1);
+        return true;
     }
 
-    void init(nre::DataSpace *inds, nre::Sm *insm, nre::DataSpace *outds, nre::Sm *outsm);
+    void init(nre::DataSpace *inds, nre::DataSpace *outds, nre::Sm *outsm,
+              nre::DataSpace *statusds, nre::Sm *statussm);
+
+    /**
+     * @return the transmit worker of this session (only valid after init)
+     */
+    TxWorkers::Worker *tx_worker() {
+        return _worker;
+    }
 
 private:
-    static void consumer_thread(void*);
+    void forget(const nre::Network::EthernetAddr &mac) {
+        for(size_t i = 0; i < _learned_count; ++i) {
+            if(_learned[i] == mac) {
+                _learned[i] = _learned[--_learned_count];
+                _learned_next = _learned_count;
+                break;
+            }
+        }
+    }
+
+    /**
+     * Takes up to <max> frames from the transmit ring, switches them and passes them to the NIC.
+     * If the NIC has no room for all of them, the rest stays in the ring and the driver is asked to
+     * notify the worker as soon as it has room again. As soon as a batch is done, the progress is
+     * reported via the status dataspace.
+     *
+     * @param max the maximum number of frames to take
+     * @return true if there are more frames that can be sent right away
+     */
+    bool transmit(size_t max);
+    void report_tx(size_t count, size_t dropped);
 
-    Channel _in;
+    NetworkService *_srv;
+    nre::DataSpace *_inds;
     Channel _out;
+    Channel _statuschan;
     nre::PacketConsumer *_cons;
     nre::PacketProducer *_prod;
-    nre::Reference<nre::GlobalThread> _gt;
+    nre::UserSm _prodsm;
+    nre::Network::TxStatusSlot *_txstatus;
+    // the frames of the current batch that still have to be passed to the NIC
+    NICDriver::Packet _txbatch[TxWorkers::BATCH_SIZE];
+    size_t _txframes;
+    size_t _txwire;
+    size_t _txdone;
+    size_t _txdropped;
+    TxWorkers::Worker *_worker;
+    NetworkSessionData *_tx_next;
     size_t _nic;
     NICDriver *_driver;
+    nre::Network::EthernetAddr _macs[nre::Network::MAX_MACS];
+    size_t _mac_count;
+    nre::Network::EthernetAddr _learned[MAX_LEARNED];
+    size_t _learned_count;
+    size_t _learned_next;
+    nre::Network::Stats _stats;
 };
 
 class NetworkService : public nre::Service {
 public:
     explicit NetworkService(NICList &nics, const char *name);
 
-    void broadcast(const void *packet, size_t len);
+    /**
+     * Delivers the given frame, received by NIC <nic>, to the sessions it is destined for.
+     */
+    void broadcast(size_t nic, const void *packet, size_t len);
+
+    NetworkDemux &demux(size_t nic) {
+        return _demux[nic];
+    }
+    TxWorkers &tx_workers() {
+        return _workers;
+    }
 
 private:
     virtual nre::ServiceSession *create_session(size_t id, const nre::String &args, portal_func func);
@@ -91,4 +199,6 @@ private:
 
 private:
     NICList &_nics;
+    NetworkDemux _demux[nre::Network::MAX_NICS];
+    TxWorkers _workers;
 };
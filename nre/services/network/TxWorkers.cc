@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <util/ScopedLock.h>
+#include <CPU.h>
+
+#include "TxWorkers.h"
+#include "NetworkService.h"
+
+using namespace nre;
+
+TxWorkers::TxWorkers() : _workers(new Worker[CPU::count()]) {
+    for(auto it = CPU::begin(); it != CPU::end(); ++it) {
+        Worker *w = _workers + it->log_id();
+        w->_gt = GlobalThread::create(worker_thread, it->log_id(), "network-tx");
+        w->_gt->set_tls(Thread::TLS_PARAM, w);
+        w->_gt->start();
+    }
+}
+
+void TxWorkers::Worker::add(NetworkSessionData *sess) {
+    ScopedLock<UserSm> guard(&_lock);
+    sess->_tx_next = _sessions;
+    _sessions = sess;
+}
+
+void TxWorkers::Worker::remove(NetworkSessionData *sess) {
+    ScopedLock<UserSm> guard(&_lock);
+    for(NetworkSessionData **p = &_sessions; *p != nullptr; p = &(*p)->_tx_next) {
+        if(*p == sess) {
+            *p = sess->_tx_next;
+            break;
+        }
+    }
+}
+
+void TxWorkers::worker_thread(void*) {
+    Worker *w = Thread::current()->get_tls<Worker*>(Thread::TLS_PARAM);
+    while(1) {
+        // wait for a notification and collapse all pending ones. everything that has been produced
+        // before the notification is visible afterwards
+        w->_sm.zero();
+
+        // sessions whose NIC has no room don't count as more work. the driver ups our semaphore as
+        // soon as that changes, so that we block until then
+        bool more;
+        do {
+            ScopedLock<UserSm> guard(&w->_lock);
+            more = false;
+            for(NetworkSessionData *sess = w->_sessions; sess != nullptr; sess = sess->_tx_next)
+                more |= sess->transmit(BATCH_SIZE);
+        }
+        while(more);
+    }
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <kobj/GlobalThread.h>
+#include <kobj/UserSm.h>
+#include <kobj/Sm.h>
+
+class NetworkSessionData;
+
+/**
+ * A pool of transmit workers, one per CPU. Instead of having a thread per session, every session
+ * is assigned to the worker of the CPU it has been initialized on. The clients of a worker get its
+ * semaphore (with the permission to up it only), so that the worker wakes up as soon as one of its
+ * sessions has something to send. It drains the sessions round-robin in batches of up to
+ * BATCH_SIZE frames.
+ */
+class TxWorkers {
+public:
+    static const size_t BATCH_SIZE  = 32;
+
+    class Worker {
+        friend class TxWorkers;
+
+    public:
+        explicit Worker() : _sm(0), _lock(), _sessions(), _gt() {
+        }
+
+        /**
+         * @return the semaphore that the clients of this worker notify
+         */
+        nre::Sm &sm() {
+            return _sm;
+        }
+
+        /**
+         * Adds <sess> to the sessions this worker transmits frames for.
+         */
+        void add(NetworkSessionData *sess);
+        /**
+         * Removes <sess> again. Afterwards, the worker does not use it anymore.
+         */
+        void remove(NetworkSessionData *sess);
+
+    private:
+        nre::Sm _sm;
+        nre::UserSm _lock;
+        NetworkSessionData *_sessions;
+        nre::Reference<nre::GlobalThread> _gt;
+    };
+
+    /**
+     * Creates and starts a worker on every CPU
+     */
+    explicit TxWorkers();
+    ~TxWorkers() {
+        delete[] _workers;
+    }
+
+    /**
+     * @return the worker on CPU <cpu>
+     */
+    Worker &get(cpu_t cpu) {
+        return _workers[cpu];
+    }
+
+private:
+    static void worker_thread(void*);
+
+    Worker *_workers;
+};
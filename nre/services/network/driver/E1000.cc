@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <services/PCIConfig.h>
+#include <services/ACPI.h>
+#include <util/Clock.h>
+#include <util/Sync.h>
+#include <util/PCI.h>
+
+#include "E1000.h"
+
+using namespace nre;
+
+static const PCIConfig::value_type supported_devices[] = {
+    0x100e8086,     // 82540EM (qemu)
+    0x100f8086,     // 82545EM
+};
+
+void E1000::detect(NetworkService &srv, NICList &list) {
+    PCIConfigSession pcicfg("pcicfg");
+    ACPISession acpi("acpi");
+    PCI pci(pcicfg, &acpi);
+    try {
+        for(uint inst = 0; ; inst++) {
+            BDF bdf = pcicfg.search_device(0x2, 0x0, inst);
+            PCIConfig::value_type id = pcicfg.read(bdf, 0);
+            bool supported = false;
+            for(size_t i = 0; i < ARRAY_SIZE(supported_devices); ++i)
+                supported |= supported_devices[i] == id;
+            if(!supported)
+                continue;
+
+            PCIConfig::value_type bar = pci.conf_read(bdf, PCI::BAR0);
+            // must be a 32bit memory bar
+            if(bar & 7)
+                continue;
+
+            try {
+                // we need memory-decode and busmaster DMA
+                pci.conf_write(bdf, 1, pci.conf_read(bdf, 1) | 0x6);
+                Gsi *gsi = pci.get_gsi(bdf, 0);
+                E1000 *e1000 = new E1000(srv, bar & PCI::BAR_MEM_MASK, gsi);
+                size_t id = list.reg(e1000);
+                LOG(NET, "Found E1000 card with id=" << id << ", bdf=" << bdf
+                    << ", gsi=" << gsi->gsi() << ", MAC=" << e1000->get_mac() << "\n");
+            }
+            catch(const Exception &e) {
+                LOG(NET, "Instantiation of E1000 driver failed: " << e.msg() << "\n");
+            }
+        }
+    }
+    catch(...) {
+    }
+}
+
+E1000::E1000(NetworkService &srv, uintptr_t mmio, Gsi *gsi)
+        : _sm(1), _srv(srv), _mmio(0x20000, DataSpaceDesc::LOCKED, DataSpaceDesc::RW, mmio),
+          _gsi(gsi),
+          _rxring(RX_DESCS * sizeof(RxDesc), DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW),
+          _txring(TX_DESCS * sizeof(TxDesc), DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW),
+          _rxbufs(RX_DESCS * BUF_SIZE, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW),
+          _txbufs(TX_DESCS * BUF_SIZE, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW),
+          _rxdescs(reinterpret_cast<RxDesc*>(_rxring.virt())),
+          _txdescs(reinterpret_cast<TxDesc*>(_txring.virt())),
+          _rxnext(0), _txnext(0), _txclean(0),
+          _gt(GlobalThread::create(irq_thread, CPU::current().log_id(), "network-irq")), _mac() {
+    reset();
+
+    // get MAC (qemu and the BIOS load it from the EEPROM into the first receive address)
+    uint32_t ral = read(REG_RAL0);
+    uint32_t rah = read(REG_RAH0);
+    _mac = Network::EthernetAddr(ral, ral >> 8, ral >> 16, ral >> 24, rah, rah >> 8);
+
+    // start irq-thread
+    _gt->set_tls(Thread::TLS_PARAM, this);
+    _gt->start();
+}
+
+bool E1000::send(const void *packet, size_t size) {
+    Packet p = {packet, size};
+    return send_batch(&p, 1) == 1;
+}
+
+size_t E1000::send_batch(const Packet *packets, size_t count) {
+    ScopedLock<UserSm> guard(&_sm);
+    reclaim_tx();
+    size_t i;
+    for(i = 0; i < count; ++i) {
+        if(!put_tx(packets[i].data, packets[i].size))
+            break;
+    }
+
+    // the descriptors have to be visible before the device sees the new tail, which we write only
+    // once for the whole batch
+    if(i > 0) {
+        Sync::memory_fence();
+        write(REG_TDT, _txnext);
+    }
+    return i;
+}
+
+bool E1000::put_tx(const void *packet, size_t size) {
+    if(size > BUF_SIZE)
+        return false;
+    // ring full?
+    size_t next = (_txnext + 1) % TX_DESCS;
+    if(next == _txclean)
+        return false;
+
+    memcpy(reinterpret_cast<void*>(_txbufs.virt() + _txnext * BUF_SIZE), packet, size);
+    TxDesc *desc = _txdescs + _txnext;
+    desc->addr = phys(_txbufs, _txnext * BUF_SIZE);
+    desc->length = size;
+    desc->cso = 0;
+    desc->cmd = TXCMD_EOP | TXCMD_IFCS | TXCMD_RS;
+    desc->status = 0;
+    desc->css = 0;
+    desc->special = 0;
+    _txnext = next;
+    return true;
+}
+
+void E1000::irq_thread(void*) {
+    E1000 *e1000 = Thread::current()->get_tls<E1000*>(Thread::TLS_PARAM);
+    while(1) {
+        e1000->_gsi->down();
+        LOG(NET_DETAIL, "Got IRQ\n");
+        e1000->handle_irq();
+    }
+}
+
+void E1000::handle_irq() {
+    // reading ICR acknowledges all pending causes
+    uint32_t icr = read(REG_ICR);
+
+    if(icr & (ICR_RXT0 | ICR_RXDMT0 | ICR_RXO))
+        receive();
+
+    if(icr & ICR_TXDW) {
+        {
+            ScopedLock<UserSm> guard(&_sm);
+            reclaim_tx();
+        }
+        tx_done();
+    }
+
+    if(icr & ICR_LSC)
+        LOG(NET, "E1000: link is " << ((read(REG_STATUS) & 0x2) ? "up" : "down") << "\n");
+}
+
+void E1000::receive() {
+    // hand out all completed frames directly from the DMA buffers
+    size_t last = RX_DESCS;
+    while(_rxdescs[_rxnext].status & DESC_DD) {
+        RxDesc *desc = _rxdescs + _rxnext;
+        // we don't support frames that span multiple buffers; they are dropped
+        if((desc->status & DESC_EOP) && !desc->errors) {
+            _srv.broadcast(id(), reinterpret_cast<void*>(_rxbufs.virt() + _rxnext * BUF_SIZE),
+                           desc->length);
+        }
+        else {
+            LOG(NET, "E1000: dropping frame with status=" << fmt(desc->status, "#x")
+                << ", errors=" << fmt(desc->errors, "#x") << "\n");
+        }
+
+        desc->status = 0;
+        last = _rxnext;
+        _rxnext = (_rxnext + 1) % RX_DESCS;
+    }
+
+    // give all consumed descriptors back to the device at once
+    if(last != RX_DESCS) {
+        Sync::memory_fence();
+        write(REG_RDT, last);
+    }
+}
+
+void E1000::reclaim_tx() {
+    while(_txclean != _txnext && (_txdescs[_txclean].status & DESC_DD)) {
+        _txdescs[_txclean].status = 0;
+        _txclean = (_txclean + 1) % TX_DESCS;
+    }
+}
+
+void E1000::reset() {
+    // disable interrupts and reset the card
+    write(REG_IMC, ~0U);
+    write(REG_CTRL, read(REG_CTRL) | CTRL_RST);
+
+    // wait up to 1ms for the reset to complete
+    Clock clock(1000);
+    timevalue_t timeout = 1 + clock.dest_time();
+    while((read(REG_CTRL) & CTRL_RST) && clock.dest_time() < timeout)
+        Util::pause();
+    write(REG_IMC, ~0U);
+    read(REG_ICR);
+
+    write(REG_CTRL, read(REG_CTRL) | CTRL_SLU | CTRL_ASDE);
+
+    // the multicast table is not used, because we accept all multicast frames via MPE
+    for(size_t i = 0; i < 128; ++i)
+        write(REG_MTA + i * 4, 0);
+
+    // setup receive ring. all descriptors except one belong to the device
+    memset(_rxdescs, 0, RX_DESCS * sizeof(RxDesc));
+    for(size_t i = 0; i < RX_DESCS; ++i)
+        _rxdescs[i].addr = phys(_rxbufs, i * BUF_SIZE);
+    write(REG_RDBAL, phys(_rxring, 0));
+    write(REG_RDBAH, phys(_rxring, 0) >> 32);
+    write(REG_RDLEN, RX_DESCS * sizeof(RxDesc));
+    write(REG_RDH, 0);
+    write(REG_RDT, RX_DESCS - 1);
+    write(REG_RDTR, 0);
+    _rxnext = 0;
+
+    // setup transmit ring
+    memset(_txdescs, 0, TX_DESCS * sizeof(TxDesc));
+    write(REG_TDBAL, phys(_txring, 0));
+    write(REG_TDBAH, phys(_txring, 0) >> 32);
+    write(REG_TDLEN, TX_DESCS * sizeof(TxDesc));
+    write(REG_TDH, 0);
+    write(REG_TDT, 0);
+    _txnext = _txclean = 0;
+
+    // 2048 byte buffers, strip CRC, broadcast, multicast and promiscuous
+    write(REG_RCTL, RCTL_EN | RCTL_UPE | RCTL_MPE | RCTL_BAM | RCTL_SECRC);
+    write(REG_TCTL, TCTL_EN | TCTL_PSP | TCTL_CT | TCTL_COLD);
+    write(REG_TIPG, 10 | (8 << 10) | (6 << 20));
+
+    // moderate interrupts and enable the ones we're interested in
+    write(REG_ITR, ITR_VALUE);
+    write(REG_IMS, ICR_TXDW | ICR_LSC | ICR_RXDMT0 | ICR_RXO | ICR_RXT0);
+}
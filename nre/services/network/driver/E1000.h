@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <kobj/GlobalThread.h>
+#include <kobj/UserSm.h>
+#include <kobj/Gsi.h>
+#include <mem/DataSpace.h>
+#include <services/Network.h>
+
+#include "../NICDriver.h"
+#include "../NetworkService.h"
+
+/**
+ * A driver for the Intel 8254x gigabit ethernet controllers (e1000), mainly used on qemu devices.
+ * In contrast to the NE2K, frames are transferred via descriptor rings and DMA. Received frames
+ * are passed upstream directly from the DMA buffers and the receive tail is updated once per
+ * interrupt. Batches of frames to send are put into the transmit ring with a single tail update.
+ * Interrupts are moderated via ITR.
+ *
+ * Features: reset, send, irq, receive, interrupt moderation
+ * Missing:  read counters, checksum offloading, TSO, jumbo frames
+ * State: testing
+ * Documentation: Intel PCI/PCI-X Family of Gigabit Ethernet Controllers SDM (8254x)
+ */
+class E1000 : public NICDriver {
+    enum {
+        REG_CTRL    = 0x0000,
+        REG_STATUS  = 0x0008,
+        REG_ICR     = 0x00C0,
+        REG_ITR     = 0x00C4,
+        REG_IMS     = 0x00D0,
+        REG_IMC     = 0x00D8,
+        REG_RCTL    = 0x0100,
+        REG_TCTL    = 0x0400,
+        REG_TIPG    = 0x0410,
+        REG_RDBAL   = 0x2800,
+        REG_RDBAH   = 0x2804,
+        REG_RDLEN   = 0x2808,
+        REG_RDH     = 0x2810,
+        REG_RDT     = 0x2818,
+        REG_RDTR    = 0x2820,
+        REG_TDBAL   = 0x3800,
+        REG_TDBAH   = 0x3804,
+        REG_TDLEN   = 0x3808,
+        REG_TDH     = 0x3810,
+        REG_TDT     = 0x3818,
+        REG_MTA     = 0x5200,
+        REG_RAL0    = 0x5400,
+        REG_RAH0    = 0x5404,
+    };
+    enum {
+        CTRL_ASDE   = 1 << 5,
+        CTRL_SLU    = 1 << 6,
+        CTRL_RST    = 1 << 26,
+    };
+    enum {
+        RCTL_EN     = 1 << 1,
+        RCTL_UPE    = 1 << 3,
+        RCTL_MPE    = 1 << 4,
+        RCTL_BAM    = 1 << 15,
+        RCTL_SECRC  = 1 << 26,
+    };
+    enum {
+        TCTL_EN     = 1 << 1,
+        TCTL_PSP    = 1 << 3,
+        TCTL_CT     = 0x10 << 4,
+        TCTL_COLD   = 0x40 << 12,
+    };
+    enum {
+        ICR_TXDW    = 1 << 0,
+        ICR_LSC     = 1 << 2,
+        ICR_RXDMT0  = 1 << 4,
+        ICR_RXO     = 1 << 6,
+        ICR_RXT0    = 1 << 7,
+    };
+    enum {
+        TXCMD_EOP   = 1 << 0,
+        TXCMD_IFCS  = 1 << 1,
+        TXCMD_RS    = 1 << 3,
+    };
+    enum {
+        DESC_DD     = 1 << 0,
+        DESC_EOP    = 1 << 1,
+    };
+    enum {
+        RX_DESCS    = 256,
+        TX_DESCS    = 256,
+        BUF_SIZE    = 2048,
+        // the interrupt throttling interval in 256ns units (~8000 interrupts per second)
+        ITR_VALUE   = 488,
+    };
+
+    /**
+     * The legacy receive descriptor
+     */
+    struct RxDesc {
+        uint64_t addr;
+        uint16_t length;
+        uint16_t csum;
+        uint8_t status;
+        uint8_t errors;
+        uint16_t special;
+    } PACKED;
+
+    /**
+     * The legacy transmit descriptor
+     */
+    struct TxDesc {
+        uint64_t addr;
+        uint16_t length;
+        uint8_t cso;
+        uint8_t cmd;
+        uint8_t status;
+        uint8_t css;
+        uint16_t special;
+    } PACKED;
+
+public:
+    static void detect(NetworkService &srv, NICList &list);
+
+    explicit E1000(NetworkService &srv, uintptr_t mmio, nre::Gsi *gsi);
+    virtual ~E1000() {
+        delete _gsi;
+    }
+
+    virtual const char *name() const {
+        return "E1000";
+    }
+    virtual nre::Network::EthernetAddr get_mac() {
+        return _mac;
+    }
+    virtual size_t max_frame_size() const {
+        return BUF_SIZE;
+    }
+    virtual bool send(const void *packet, size_t size);
+    virtual size_t send_batch(const Packet *packets, size_t count);
+
+private:
+    uint32_t read(size_t reg) const {
+        return *reinterpret_cast<volatile uint32_t*>(_mmio.virt() + reg);
+    }
+    void write(size_t reg, uint32_t value) {
+        *reinterpret_cast<volatile uint32_t*>(_mmio.virt() + reg) = value;
+    }
+    static uint64_t phys(const nre::DataSpace &ds, size_t offset) {
+        return ds.phys() + offset;
+    }
+
+    static void irq_thread(void*);
+    void handle_irq();
+    void receive();
+    bool put_tx(const void *packet, size_t size);
+    void reclaim_tx();
+    void reset();
+
+    nre::UserSm _sm;
+    NetworkService &_srv;
+    nre::DataSpace _mmio;
+    nre::Gsi *_gsi;
+    nre::DataSpace _rxring;
+    nre::DataSpace _txring;
+    nre::DataSpace _rxbufs;
+    nre::DataSpace _txbufs;
+    RxDesc *_rxdescs;
+    TxDesc *_txdescs;
+    size_t _rxnext;
+    size_t _txnext;
+    size_t _txclean;
+    nre::Reference<nre::GlobalThread> _gt;
+    nre::Network::EthernetAddr _mac;
+};
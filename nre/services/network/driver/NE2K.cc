@@ -72,6 +72,19 @@ NE2K::NE2K(NetworkService &srv, Ports::port_t port, Gsi *gsi)
 
 bool NE2K::send(const void *packet, size_t size) {
     ScopedLock<UserSm> guard(&_sm);
+    return transmit(packet, size);
+}
+
+size_t NE2K::send_batch(const Packet *packets, size_t count) {
+    // the card can only transmit one frame at a time, but we can at least keep the lock
+    ScopedLock<UserSm> guard(&_sm);
+    size_t i = 0;
+    while(i < count && transmit(packets[i].data, packets[i].size))
+        i++;
+    return i;
+}
+
+bool NE2K::transmit(const void *packet, size_t size) {
     // is a transmit in progress or the packet to large?
     if((_ports.in<uint8_t>(REG_CR) & 4) || (size > (PG_START - PG_TX) * PAGE_SIZE))
         return false;
@@ -87,6 +100,8 @@ bool NE2K::send(const void *packet, size_t size) {
         Util::pause();
     LOG(NET_DETAIL, "Packet transmission: status=" << status
         << ", rx-status=" << _ports.in<uint8_t>(REG_TSR) << "\n");
+    // the transmission is complete, so that there is room for the next frame
+    tx_done();
     return true;
 }
 
@@ -165,7 +180,7 @@ void NE2K::handle_irq() {
                 packet_len = _receive_buffer[offset + 2] + (_receive_buffer[offset + 3] << 8);
                 assert(packet_len + offset < BUFFER_SIZE);
 
-                _srv.broadcast(_receive_buffer + offset + 4, packet_len - 4);
+                _srv.broadcast(id(), _receive_buffer + offset + 4, packet_len - 4);
             }
         }
     }
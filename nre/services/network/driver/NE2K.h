@@ -88,10 +88,15 @@ public:
     virtual nre::Network::EthernetAddr get_mac() {
         return _mac;
     }
+    virtual size_t max_frame_size() const {
+        return (PG_START - PG_TX) * PAGE_SIZE;
+    }
     virtual bool send(const void *packet, size_t size);
+    virtual size_t send_batch(const Packet *packets, size_t count);
 
 private:
     static void irq_thread(void*);
+    bool transmit(const void *packet, size_t size);
     void access_internal_ram(uint16_t offset, uint16_t dwords, void *buffer, bool read);
     void handle_irq();
     void reset();
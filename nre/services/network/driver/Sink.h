@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <services/Network.h>
+
+#include "../NICDriver.h"
+
+/**
+ * A software-only NIC without a wire. Note that it is no loopback device: every frame that is
+ * sent via it is silently dropped and it never receives anything. Thus, all communication between
+ * the sessions of this NIC happens via the virtual switch. This allows to test and benchmark the
+ * switch without any network hardware.
+ */
+class Sink : public NICDriver {
+public:
+    explicit Sink() : NICDriver() {
+    }
+
+    virtual const char *name() const {
+        return "Sink";
+    }
+    virtual nre::Network::EthernetAddr get_mac() {
+        // a locally administered unicast address
+        return nre::Network::EthernetAddr(0x02, 0x00, 0x00, 0x00, 0x00, 0x01);
+    }
+    virtual size_t max_frame_size() const {
+        return static_cast<size_t>(-1);
+    }
+    virtual bool send(const void *, size_t) {
+        return true;
+    }
+    virtual size_t send_batch(const Packet *, size_t count) {
+        return count;
+    }
+};
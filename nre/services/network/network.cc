@@ -14,16 +14,32 @@
  * General Public License version 2 for more details.
  */
 
+#include <Logging.h>
+#include <cstring>
+
 #include "driver/NE2K.h"
+#include "driver/E1000.h"
+#include "driver/Sink.h"
 #include "NetworkService.h"
 #include "NICList.h"
 
 using namespace nre;
 
-int main() {
+int main(int argc, char *argv[]) {
+    bool sink = false;
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "sink") == 0)
+            sink = true;
+    }
+
     NICList nics;
     NetworkService srv(nics, "network");
     NE2K::detect(srv, nics);
+    E1000::detect(srv, nics);
+    if(sink) {
+        size_t id = nics.reg(new Sink());
+        LOG(NET, "Created sink NIC with id=" << id << "\n");
+    }
     srv.start();
     return 0;
 }
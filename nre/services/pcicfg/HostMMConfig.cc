@@ -25,11 +25,10 @@ using namespace nre;
 
 HostMMConfig::HostMMConfig() {
     ACPISession sess("acpi");
-    DataSpace table = sess.find_table("MCFG");
-    AcpiMCFG *mcfg = reinterpret_cast<AcpiMCFG*>(table.virt());
+    const AcpiMCFG *mcfg = reinterpret_cast<const AcpiMCFG*>(sess.find_table("MCFG"));
     size_t count = (mcfg->len - sizeof(AcpiMCFG)) / sizeof(AcpiMCFG::Entry);
     for(size_t i = 0; i < count; ++i) {
-        AcpiMCFG::Entry *entry = mcfg->entries + i;
+        const AcpiMCFG::Entry *entry = mcfg->entries + i;
         LOG(PCICFG, "MMConfig:" << " base " << fmt(entry->base, "#x")
                                 << " seg " << fmt(entry->pci_seg, "#0x", 2)
                                 << " bus " << fmt(entry->pci_bus_start, "#0x", 2)
@@ -56,9 +56,6 @@ public:
         _addr.out<uint8_t>(0x01, 1);
     }
 
-    nre::BDF search_device(value_type theclass = ~0U, value_type subclass = ~0U, uint inst = ~0U);
-    nre::BDF search_bridge(value_type dst);
-
 private:
     void select(nre::BDF bdf, size_t offset) {
         uint32_t addr = 0x80000000 | (bdf.value() << 8) | (offset & 0xFC);
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Copyright (C) 2009-2010, Bernhard Kauer <bk@vmmon.org>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+
+#include <util/ScopedLock.h>
+#include <util/PCI.h>
+#include <Logging.h>
+#include <cstring>
+
+#include "Inventory.h"
+
+using namespace nre;
+
+Inventory::Inventory(Config *pcicfg, Config *mmcfg) : _devs(), _count(), _size(), _sm() {
+    for(BDF::bdf_type bus = 0; bus < 256; bus++) {
+        for(BDF::bdf_type dev = 0; dev < 32; dev++) {
+            BDF::bdf_type maxfunc = 1;
+            for(BDF::bdf_type func = 0; func < maxfunc; func++) {
+                BDF bdf(bus, dev, func);
+                if(pcicfg->read(bdf, 0) == ~0U)
+                    continue;
+                add(pcicfg, mmcfg, bdf);
+                if(maxfunc == 1 && _devs[_count - 1].dev.multifunc())
+                    maxfunc = 8;
+            }
+        }
+    }
+    LOG(PCICFG, "PCIConfig: found " << _count << " devices\n");
+}
+
+void Inventory::add(Config *pcicfg, Config *mmcfg, BDF bdf) {
+    if(_count == _size) {
+        size_t nsize = _size ? _size * 2 : 32;
+        Entry *ndevs = new Entry[nsize];
+        if(_devs) {
+            memcpy(ndevs, _devs, _count * sizeof(Entry));
+            delete[] _devs;
+        }
+        _devs = ndevs;
+        _size = nsize;
+    }
+
+    Entry *e = _devs + _count++;
+    e->mmconfig = nullptr;
+    PCIConfig::Device &dev = e->dev;
+    dev.bdf = bdf;
+    dev.capcount = 0;
+    for(size_t i = 0; i < PCIConfig::HEADER_DWORDS; ++i)
+        dev.header[i] = pcicfg->read(bdf, i * 4);
+
+    // legacy capabilities, if supported. limit the number of steps to not loop forever with
+    // broken devices
+    if((dev.header[1] >> 16) & 0x10) {
+        size_t steps = 0;
+        for(uint8_t offset = dev.header[0xd]; offset != 0 && !(offset & 0x3) && steps < 48;
+            offset = pcicfg->read(bdf, offset) >> 8, ++steps) {
+            add_cap(dev, pcicfg->read(bdf, offset) & 0xFF, offset);
+        }
+    }
+
+    // extended capabilities are only reachable via MMCONFIG
+    if(mmcfg && dev.find_cap(PCI::CAP_PCIE, false) && mmcfg->contains(bdf, 0x100)) {
+        size_t offset = 0x100;
+        for(size_t steps = 0; steps < 1024; ++steps) {
+            value_type header = mmcfg->read(bdf, offset);
+            if(header == ~0U || header == 0)
+                break;
+            add_cap(dev, header & 0xFFFF, offset);
+            offset = header >> 20;
+            if(offset < 0x100 || (offset & 0x3))
+                break;
+        }
+    }
+
+    LOG(PCICFG, "PCIConfig: " << bdf << " id " << fmt(dev.header[0], "#x")
+                              << " class " << fmt(dev.header[2], "#x")
+                              << " caps " << dev.capcount << "\n");
+}
+
+void Inventory::add_cap(PCIConfig::Device &dev, uint id, size_t offset) {
+    if(dev.capcount < PCIConfig::MAX_CAPS) {
+        dev.caps[dev.capcount].id = id;
+        dev.caps[dev.capcount].offset = offset;
+        dev.capcount++;
+    }
+}
+
+Inventory::Entry *Inventory::find(BDF bdf) const {
+    // the devices are sorted by BDF, because we've added them in that order
+    size_t left = 0, right = _count;
+    while(left < right) {
+        size_t mid = left + (right - left) / 2;
+        if(_devs[mid].dev.bdf.value() == bdf.value())
+            return _devs + mid;
+        if(_devs[mid].dev.bdf.value() < bdf.value())
+            left = mid + 1;
+        else
+            right = mid;
+    }
+    VTHROW(Exception, E_NOT_FOUND, "Device " << bdf << " not found");
+}
+
+BDF Inventory::search_device(value_type theclass, value_type subclass, uint inst) const {
+    uint orginst = inst;
+    for(size_t i = 0; i < _count; ++i) {
+        const PCIConfig::Device &dev = _devs[i].dev;
+        if((theclass == ~0U || dev.theclass() == theclass)
+           && (subclass == ~0U || dev.subclass() == subclass)
+           && (inst == ~0U || !inst--))
+            return dev.bdf;
+    }
+    VTHROW(Exception, E_NOT_FOUND,
+           "Unable to find class " << fmt(theclass, "#x") << " subclass "
+                                   << fmt(subclass, "#x") << " inst "
+                                   << fmt(orginst, "#x"));
+}
+
+BDF Inventory::search_bridge(value_type dst) const {
+    value_type dstbus = dst >> 8;
+    for(size_t i = 0; i < _count && _devs[i].dev.bdf.bus() == 0; ++i) {
+        const PCIConfig::Device &dev = _devs[i].dev;
+        if(dev.header_type() != 1)
+            continue;
+
+        // we have a bridge
+        value_type b = dev.header[6];
+        if((((b >> 8) & 0xff) <= dstbus) && (((b >> 16) & 0xff) >= dstbus))
+            return dev.bdf;
+    }
+    VTHROW(Exception, E_NOT_FOUND, "Unable to find bridge " << fmt(dst, "#x"));
+}
+
+const DataSpace &Inventory::mmconfig(Config *mmcfg, BDF bdf) {
+    ScopedLock<UserSm> guard(&_sm);
+    Entry *e = find(bdf);
+    if(!e->mmconfig) {
+        uintptr_t addr = mmcfg->addr(bdf, 0);
+        e->mmconfig = new DataSpace(ExecEnv::PAGE_SIZE, DataSpaceDesc::LOCKED, DataSpaceDesc::R,
+                                    addr);
+    }
+    return *e->mmconfig;
+}
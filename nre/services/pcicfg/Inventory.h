@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <arch/Types.h>
+#include <mem/DataSpace.h>
+#include <kobj/UserSm.h>
+#include <services/PCIConfig.h>
+
+#include "Config.h"
+
+/**
+ * The inventory of all PCI devices. The busses are scanned once at startup and the standard header
+ * and the capability offsets of each function are recorded. Afterwards, searches and device
+ * queries are answered from here without touching the config space again.
+ */
+class Inventory {
+    struct Entry {
+        nre::PCIConfig::Device dev;
+        // the MMCONFIG page of this device, if it has been requested
+        nre::DataSpace *mmconfig;
+    };
+
+public:
+    typedef nre::PCIConfig::value_type value_type;
+
+    /**
+     * Scans all busses
+     *
+     * @param pcicfg the config space to use for the header and the legacy capabilities
+     * @param mmcfg the config space to use for the extended capabilities (may be nullptr)
+     */
+    explicit Inventory(Config *pcicfg, Config *mmcfg);
+
+    /**
+     * @return the number of devices
+     */
+    size_t count() const {
+        return _count;
+    }
+
+    /**
+     * @param bdf the bus-device-function triple
+     * @return the device with given BDF
+     * @throws Exception if not found
+     */
+    const nre::PCIConfig::Device &get(nre::BDF bdf) const {
+        return find(bdf)->dev;
+    }
+
+    /**
+     * Searches for the <inst>'th device that has the given class and/or subclass. The order is the
+     * same as the one of a bus scan.
+     *
+     * @param theclass the class of the device (~0U = ignore)
+     * @param subclass the subclass of the device (~0U = ignore)
+     * @param inst the instance of the device (~0U = ignore)
+     * @return the bus-device-function triple
+     * @throws Exception if not found
+     */
+    nre::BDF search_device(value_type theclass, value_type subclass, uint inst) const;
+
+    /**
+     * Searches for the bridge on bus 0 behind which the given device is located
+     *
+     * @param dst the bdf of the device
+     * @return the bus-device-function triple of the bridge
+     * @throws Exception if not found
+     */
+    nre::BDF search_bridge(value_type dst) const;
+
+    /**
+     * Returns the dataspace for the MMCONFIG page of the given device. It is created on the first
+     * request and kept afterwards.
+     *
+     * @param mmcfg the MMCONFIG space
+     * @param bdf the bus-device-function triple
+     * @return the dataspace
+     * @throws Exception if not found
+     */
+    const nre::DataSpace &mmconfig(Config *mmcfg, nre::BDF bdf);
+
+private:
+    Entry *find(nre::BDF bdf) const;
+    void add(Config *pcicfg, Config *mmcfg, nre::BDF bdf);
+    static void add_cap(nre::PCIConfig::Device &dev, uint id, size_t offset);
+
+    Entry *_devs;
+    size_t _count;
+    size_t _size;
+    nre::UserSm _sm;
+};
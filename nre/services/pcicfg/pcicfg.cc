@@ -17,14 +17,20 @@
 #include <ipc/Service.h>
 #include <services/PCIConfig.h>
 #include <Logging.h>
+#include <cstring>
 
 #include "HostPCIConfig.h"
 #include "HostMMConfig.h"
+#include "Inventory.h"
 
 using namespace nre;
 
 static HostPCIConfig *pcicfg;
 static HostMMConfig *mmcfg;
+static Inventory *inventory;
+// whether clients may map the MMCONFIG pages of devices. since that bypasses the service
+// entirely, it has to be granted explicitly on the command line
+static bool mapmmconfig = false;
 
 static Config *find(BDF bdf, size_t offset) {
     if(pcicfg->contains(bdf, offset))
@@ -43,7 +49,8 @@ PORTAL static void portal_pcicfg(void*) {
         uf >> cmd;
 
         Config *cfg = nullptr;
-        if(cmd == PCIConfig::READ || cmd == PCIConfig::WRITE || cmd == PCIConfig::ADDR) {
+        if(cmd == PCIConfig::READ || cmd == PCIConfig::WRITE || cmd == PCIConfig::ADDR ||
+           cmd == PCIConfig::READ_BLOCK) {
             uf >> bdf >> offset;
             cfg = find(bdf, offset);
         }
@@ -82,7 +89,7 @@ PORTAL static void portal_pcicfg(void*) {
                 PCIConfig::value_type theclass, subclass, inst;
                 uf >> theclass >> subclass >> inst;
                 uf.finish_input();
-                BDF bdf = pcicfg->search_device(theclass, subclass, inst);
+                BDF bdf = inventory->search_device(theclass, subclass, inst);
                 LOG(PCICFG, "PCIConfig::SEARCH_DEVICE" << " class=" << fmt(theclass, "#x")
                                                        << " subclass=" << fmt(subclass, "#x")
                                                        << " inst=" << fmt(inst, "#x")
@@ -95,13 +102,53 @@ PORTAL static void portal_pcicfg(void*) {
                 PCIConfig::value_type bridge;
                 uf >> bridge;
                 uf.finish_input();
-                BDF bdf = pcicfg->search_bridge(bridge);
+                BDF bdf = inventory->search_bridge(bridge);
                 LOG(PCICFG, "PCIConfig::SEARCH_BRIDGE bridge=" << fmt(bridge, "#x")
                                                                << " => " << bdf << "\n");
                 uf << E_SUCCESS << bdf;
             }
             break;
 
+            case PCIConfig::GET_DEVICE: {
+                uf >> bdf;
+                uf.finish_input();
+                const PCIConfig::Device &dev = inventory->get(bdf);
+                LOG(PCICFG, "PCIConfig::GET_DEVICE " << bdf << "\n");
+                uf << E_SUCCESS << dev;
+            }
+            break;
+
+            case PCIConfig::READ_BLOCK: {
+                size_t count;
+                uf >> count;
+                uf.finish_input();
+                if(count == 0 || count > PCIConfig::MAX_BLOCK)
+                    VTHROW(Exception, E_ARGS_INVALID, "Invalid number of dwords: " << count);
+                size_t end = offset + (count - 1) * sizeof(PCIConfig::value_type);
+                if(!cfg->contains(bdf, end))
+                    VTHROW(Exception, E_ARGS_INVALID, bdf << "+" << fmt(end, "#x") << " not found");
+                LOG(PCICFG, cfg->name() << "::READ_BLOCK " << bdf << " off=" << fmt(offset, "#x")
+                                        << " count=" << count << "\n");
+                uf << E_SUCCESS;
+                for(size_t i = 0; i < count; ++i)
+                    uf << cfg->read(bdf, offset + i * sizeof(PCIConfig::value_type));
+            }
+            break;
+
+            case PCIConfig::MAP_MMCONFIG: {
+                uf >> bdf;
+                uf.finish_input();
+                if(!mapmmconfig)
+                    throw Exception(E_ARGS_INVALID, "Mapping MMConfig is not permitted");
+                if(!mmcfg)
+                    throw Exception(E_NOT_FOUND, "No MMConfig available");
+                const DataSpace &ds = inventory->mmconfig(mmcfg, bdf);
+                LOG(PCICFG, "MMConfig::MAP " << bdf << ": " << ds << "\n");
+                uf.delegate(ds.sel());
+                uf << E_SUCCESS;
+            }
+            break;
+
             case PCIConfig::REBOOT: {
                 uf.finish_input();
                 pcicfg->reset();
@@ -116,7 +163,12 @@ PORTAL static void portal_pcicfg(void*) {
     }
 }
 
-int main() {
+int main(int argc, char *argv[]) {
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "mapmmconfig") == 0)
+            mapmmconfig = true;
+    }
+
     pcicfg = new HostPCIConfig();
     try {
         mmcfg = new HostMMConfig();
@@ -124,6 +176,7 @@ int main() {
     catch(const Exception &e) {
         Serial::get() << e.name() << ": " << e.msg() << "\n";
     }
+    inventory = new Inventory(pcicfg, mmcfg);
 
     Service *srv = new Service("pcicfg", CPUSet(CPUSet::ALL), portal_pcicfg);
     srv->start();
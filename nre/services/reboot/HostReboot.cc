@@ -48,9 +48,8 @@ void HostRebootPCIReset::reboot() {
 HostRebootACPI::HostRebootACPI()
     : HostRebootMethod(), _method(), _value(), _addr(), _sess("acpi"), _ports(), _ds() {
     LOG(REBOOT, "Trying reboot via ACPI...\n");
-    DataSpace table = _sess.find_table("FACP");
-    ACPI::RSDT *rsdt = reinterpret_cast<ACPI::RSDT*>(table.virt());
-    char *raw = reinterpret_cast<char*>(table.virt());
+    const ACPI::RSDT *rsdt = _sess.find_table("FACP");
+    const char *raw = reinterpret_cast<const char*>(rsdt);
     if(rsdt->length < 129)
         VTHROW(Exception, E_NOT_FOUND, "FACP too small (" << rsdt->length << ")");
     if(~raw[113] & 0x4)
@@ -64,7 +63,7 @@ HostRebootACPI::HostRebootACPI()
 
     _method = raw[116];
     _value = raw[128];
-    _addr = *reinterpret_cast<uint64_t*>(raw + 120);
+    _addr = *reinterpret_cast<const uint64_t*>(raw + 120);
     LOG(REBOOT, "Using method=" << fmt(_method, "#x") << ", value=" << fmt(_value, "#x")
                                 << ", addr=" << fmt(_addr, "#x") << "\n");
     switch(_method) {
@@ -28,6 +28,7 @@ using namespace nre;
 
 UserSm Admission::_sm INIT_PRIO_ADM;
 SList<Admission::SchedEntity> Admission::_list INIT_PRIO_ADM;
+timevalue_t Admission::_dead_time[Hip::MAX_CPUS];
 
 void Admission::init() {
     // add idle Scs
@@ -36,7 +37,7 @@ void Admission::init() {
         OStringStream stream(name, sizeof(name));
         stream << "CPU" << it->log_id() << "-idle";
         capsel_t sc = Hypervisor::request_idle_sc(it->phys_id());
-        add_sc(new SchedEntity(name, it->log_id(), sc));
+        add_sc(new SchedEntity(name, it->log_id(), sc, true));
     }
 }
 
@@ -50,7 +51,9 @@ void Admission::portal_sc(void*) {
             case Sc::ALLOC: {
                 uintptr_t stackaddr = 0, utcbaddr = 0;
                 bool stack, utcb;
-                uf >> stack >> utcb;
+                cpu_t cpu;
+                // we have our portals on all CPUs already, so we don't care about the CPU
+                uf >> stack >> utcb >> cpu;
                 uf.finish_input();
 
                 // TODO we might leak resources here if something fails
@@ -103,6 +106,17 @@ void Admission::portal_sc(void*) {
             }
             break;
 
+            case Sc::MIGRATION: {
+                capsel_t sc = uf.get_translated(0).offset();
+                bool migratable;
+                uf >> migratable;
+                uf.finish_input();
+
+                cpu_t cpu = Balancer::migration(sc, migratable);
+                uf << E_SUCCESS << cpu;
+            }
+            break;
+
             case Sc::JOIN:
                 uf.clear();
                 uf << E_ARGS_INVALID;
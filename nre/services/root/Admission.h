@@ -20,9 +20,12 @@
 #include <cap/CapRange.h>
 #include <collection/SList.h>
 #include <util/ScopedLock.h>
+#include <services/SysInfo.h>
 #include <Exception.h>
 #include <String.h>
 
+#include "Balancer.h"
+
 /**
  * This class keeps track of all schedulable entities in the system. Note that there is no policy
  * here. This is done by ChildManager. This class does only react on portal-calls by adding
@@ -30,14 +33,17 @@
  * is allowed to create Scs, it does so as well.
  */
 class Admission {
+    friend class Balancer;
+
     /**
      * Represents a scheduling entity. So, basically a global thread.
      */
     class SchedEntity : public nre::SListItem {
     public:
-        explicit SchedEntity(const nre::String &name, cpu_t cpu, capsel_t cap)
-            : nre::SListItem(), _name(name), _cpu(cpu), _cap(cap),
-              _last(nre::Syscalls::sc_time(_cap)), _lastdiff() {
+        explicit SchedEntity(const nre::String &name, cpu_t cpu, capsel_t cap, bool idle = false)
+            : nre::SListItem(), _name(name), _cpu(cpu), _cap(cap), _idle(idle),
+              _last(nre::Syscalls::sc_time(_cap)), _lastdiff(), _migratable(), _target(cpu),
+              _target_period(), _told(), _balance_last(_last), _balance_diff(), _periods() {
         }
         virtual ~SchedEntity() {
             nre::CapRange(_cap, 1, nre::Crd::OBJ_ALL).revoke(true);
@@ -53,6 +59,9 @@ class Admission {
         capsel_t cap() const {
             return _cap;
         }
+        bool idle() const {
+            return _idle;
+        }
         timevalue_t ms_last_sec(bool update) {
             timevalue_t res = _lastdiff;
             if(update) {
@@ -67,12 +76,81 @@ class Admission {
             return _last;
         }
 
+        /**
+         * @return whether the load balancer may move this Sc to another CPU
+         */
+        bool migratable() const {
+            return _migratable;
+        }
+        void migratable(bool migratable) {
+            _migratable = migratable;
+        }
+        /**
+         * @return the CPU the load balancer wants this Sc to move to (cpu() if none)
+         */
+        cpu_t target() const {
+            return _target;
+        }
+        /**
+         * @return the balancing period in which the target has been set
+         */
+        ulong target_period() const {
+            return _target_period;
+        }
+        void target(cpu_t cpu, ulong period) {
+            _target = cpu;
+            _target_period = period;
+            _told = false;
+        }
+        /**
+         * @return whether the thread has been told to move to the target
+         */
+        bool told() const {
+            return _told;
+        }
+        void told(bool told) {
+            _told = told;
+        }
+        /**
+         * Starts a new balancing period. This is independent of ms_last_sec(), which is used by
+         * the sysinfo service.
+         *
+         * @return the time the Sc has run in the last period (in microseconds)
+         */
+        timevalue_t balance_period() {
+            timevalue_t time = nre::Syscalls::sc_time(_cap);
+            _balance_diff = time - _balance_last;
+            _balance_last = time;
+            _periods++;
+            return _balance_diff;
+        }
+        /**
+         * @return the time the Sc has run in the last balancing period (in microseconds)
+         */
+        timevalue_t balance_time() const {
+            return _balance_diff;
+        }
+        /**
+         * @return the number of balancing periods this Sc has existed for
+         */
+        uint periods() const {
+            return _periods;
+        }
+
     private:
         nre::String _name;
         cpu_t _cpu;
         capsel_t _cap;
+        bool _idle;
         timevalue_t _last;
         timevalue_t _lastdiff;
+        bool _migratable;
+        cpu_t _target;
+        ulong _target_period;
+        bool _told;
+        timevalue_t _balance_last;
+        timevalue_t _balance_diff;
+        uint _periods;
     };
 
 public:
@@ -124,6 +202,66 @@ public:
         return false;
     }
 
+    /**
+     * Fills <scs> with the properties of all SchedEntities and <cputime> with the total time that
+     * has elapsed on each CPU, in one pass and under one lock.
+     *
+     * @param cputime the array for the time per CPU (Hip::MAX_CPUS entries)
+     * @param scs the array for the SchedEntities
+     * @param max the number of entries in <scs>
+     * @param update if true, a new second is started (see total_time())
+     * @return the number of entries written to <scs>
+     */
+    static size_t get_sched_entities(timevalue_t *cputime, nre::SysInfo::SnapshotSc *scs,
+                                     size_t max, bool update) {
+        nre::ScopedLock<nre::UserSm> guard(&_sm);
+        size_t count = 0;
+        memset(cputime, 0, sizeof(timevalue_t) * nre::Hip::MAX_CPUS);
+        for(auto s = _list.begin(); s != _list.end(); ++s) {
+            timevalue_t time = s->ms_last_sec(update);
+            cputime[s->cpu()] += time;
+            if(count < max) {
+                nre::SysInfo::SnapshotSc *sc = scs + count++;
+                size_t len = nre::Math::min(s->name().length(), nre::SysInfo::MAX_SCNAME_LEN - 1);
+                memcpy(sc->name, s->name().str(), len);
+                sc->name[len] = '\0';
+                sc->cpu = s->cpu();
+                sc->time = time;
+                sc->totaltime = s->totaltime();
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Fills <times> with the total time that all Scs except the idle Scs have run on each CPU so
+     * far, including the Scs that have already been destroyed. In contrast to total_time(), this
+     * does not influence the measurement periods of the sysinfo service.
+     *
+     * @param times the array for the time per CPU (Hip::MAX_CPUS entries; in microseconds)
+     */
+    static void busy_time(timevalue_t *times) {
+        nre::ScopedLock<nre::UserSm> guard(&_sm);
+        memcpy(times, _dead_time, sizeof(_dead_time));
+        for(auto s = _list.begin(); s != _list.end(); ++s) {
+            if(!s->idle())
+                times[s->cpu()] += nre::Syscalls::sc_time(s->cap());
+        }
+    }
+
+    /**
+     * @return the number of Scs, except the idle Scs
+     */
+    static size_t busy_count() {
+        nre::ScopedLock<nre::UserSm> guard(&_sm);
+        size_t count = 0;
+        for(auto s = _list.begin(); s != _list.end(); ++s) {
+            if(!s->idle())
+                count++;
+        }
+        return count;
+    }
+
     /**
      * End-of-recursion service portal
      */
@@ -136,17 +274,27 @@ private:
         nre::ScopedLock<nre::UserSm> guard(&_sm);
         _list.append(se);
     }
-    static SchedEntity *remove_sc(capsel_t sc) {
-        nre::ScopedLock<nre::UserSm> guard(&_sm);
+    static SchedEntity *find_sc(capsel_t sc) {
         for(auto it = _list.begin(); it != _list.end(); ++it) {
-            if(it->cap() == sc) {
-                _list.remove(&*it);
+            if(it->cap() == sc)
                 return &*it;
-            }
         }
         VTHROW(Exception, E_NOT_FOUND, "Unable to find Sc " << sc);
     }
+    static SchedEntity *remove_sc(capsel_t sc) {
+        nre::ScopedLock<nre::UserSm> guard(&_sm);
+        SchedEntity *se = find_sc(sc);
+        _list.remove(se);
+        // keep its time for busy_time()
+        _dead_time[se->cpu()] += nre::Syscalls::sc_time(sc);
+        // the thread moves by creating a new one on the target CPU and terminating. so, if it has
+        // been told to do so, this is the move. otherwise, it is gone for a different reason
+        if(se->target() != se->cpu())
+            Balancer::finished(se->told());
+        return se;
+    }
 
     static nre::UserSm _sm;
     static nre::SList<SchedEntity> _list;
+    static timevalue_t _dead_time[nre::Hip::MAX_CPUS];
 };
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+
+#include <kobj/Sm.h>
+#include <util/ScopedLock.h>
+#include <util/Util.h>
+#include <util/Math.h>
+#include <Logging.h>
+#include <CPU.h>
+#include <cstring>
+
+#include "Balancer.h"
+#include "Admission.h"
+
+using namespace nre;
+
+uint Balancer::_overloaded[Hip::MAX_CPUS];
+Balancer::Stats Balancer::_stats;
+
+void Balancer::run() {
+    Sm sm(0);
+    timevalue_t last = Util::tsc();
+    while(1) {
+        // nobody ups the Sm, we just want to sleep
+        sm.down(last + INTERVAL * Hip::get().freq_tsc);
+
+        timevalue_t now = Util::tsc();
+        timevalue_t elapsed = ((now - last) * 1000) / Hip::get().freq_tsc;
+        last = now;
+
+        Migration mig;
+        Stats stats;
+        bool moved;
+        {
+            ScopedLock<UserSm> guard(&Admission::_sm);
+            moved = balance(elapsed, mig);
+            stats = _stats;
+        }
+        if(moved) {
+            LOG(ADMISSION, "Balancer: moving sc '" << mig.name << "' (" << mig.load / 10
+                           << "%) from cpu " << mig.from << " (" << mig.fromload / 10
+                           << "%) to cpu " << mig.to << " (" << mig.toload / 10 << "%); "
+                           << stats.requested << " requested, " << stats.done << " done, "
+                           << stats.withdrawn << " withdrawn\n");
+        }
+    }
+}
+
+cpu_t Balancer::migration(capsel_t sc, bool migratable) {
+    ScopedLock<UserSm> guard(&Admission::_sm);
+    Admission::SchedEntity *se = Admission::find_sc(sc);
+    se->migratable(migratable);
+    // pinning it withdraws a pending migration
+    if(!migratable && se->target() != se->cpu()) {
+        se->target(se->cpu(), 0);
+        _stats.withdrawn++;
+    }
+    // from now on, we expect the thread to move
+    else if(se->target() != se->cpu())
+        se->told(true);
+    return se->target();
+}
+
+bool Balancer::balance(timevalue_t elapsed, Migration &mig) {
+    timevalue_t busy[Hip::MAX_CPUS];
+    bool pending[Hip::MAX_CPUS];
+    memset(busy, 0, sizeof(busy));
+    memset(pending, 0, sizeof(pending));
+    if(elapsed == 0)
+        return false;
+
+    _stats.periods++;
+    for(auto s = Admission::_list.begin(); s != Admission::_list.end(); ++s) {
+        timevalue_t time = s->balance_period();
+        if(!s->idle())
+            busy[s->cpu()] += time;
+        if(s->target() != s->cpu()) {
+            // the thread didn't move in time; maybe it doesn't ask often enough
+            if(_stats.periods - s->target_period() >= PENDING_PERIODS) {
+                s->target(s->cpu(), 0);
+                _stats.withdrawn++;
+            }
+            else
+                pending[s->cpu()] = pending[s->target()] = true;
+        }
+    }
+
+    // determine the CPU that has been overloaded for long enough and the least loaded one
+    uint load[Hip::MAX_CPUS];
+    cpu_t src = Hip::MAX_CPUS, dst = Hip::MAX_CPUS;
+    for(auto it = CPU::begin(); it != CPU::end(); ++it) {
+        cpu_t cpu = it->log_id();
+        load[cpu] = Math::min<timevalue_t>((busy[cpu] * 1000) / elapsed, 1000);
+        _overloaded[cpu] = load[cpu] >= HIGH_LOAD ? _overloaded[cpu] + 1 : 0;
+        if(pending[cpu])
+            continue;
+        if(_overloaded[cpu] >= OVERLOAD_PERIODS && (src == Hip::MAX_CPUS || load[cpu] > load[src]))
+            src = cpu;
+        if(load[cpu] < LOW_LOAD && (dst == Hip::MAX_CPUS || load[cpu] < load[dst]))
+            dst = cpu;
+    }
+    if(src == Hip::MAX_CPUS || dst == Hip::MAX_CPUS)
+        return false;
+
+    // choose the Sc that brings both CPUs closest to the same load without making <dst> the more
+    // loaded one, so that it doesn't move back and forth
+    uint gap = (load[src] - load[dst]) / 2;
+    Admission::SchedEntity *best = nullptr;
+    uint bestload = 0, bestdiff = 0;
+    for(auto s = Admission::_list.begin(); s != Admission::_list.end(); ++s) {
+        if(s->cpu() != src || s->idle() || !s->migratable() || s->periods() < MIN_PERIODS)
+            continue;
+        uint scload = Math::min<timevalue_t>((s->balance_time() * 1000) / elapsed, 1000);
+        if(scload == 0 || load[dst] + 2 * scload >= load[src] || load[dst] + scload >= HIGH_LOAD)
+            continue;
+        uint diff = scload > gap ? scload - gap : gap - scload;
+        if(!best || diff < bestdiff) {
+            best = &*s;
+            bestload = scload;
+            bestdiff = diff;
+        }
+    }
+    if(!best)
+        return false;
+
+    best->target(dst, _stats.periods);
+    _overloaded[src] = 0;
+    _stats.requested++;
+
+    mig.name = best->name();
+    mig.from = src;
+    mig.to = dst;
+    mig.fromload = load[src];
+    mig.toload = load[dst];
+    mig.load = bestload;
+    return true;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+
+#pragma once
+
+#include <String.h>
+#include <Hip.h>
+
+/**
+ * The load balancer moves threads away from overloaded CPUs. Once per INTERVAL, it measures the
+ * time of the Scs that Admission keeps track of. If a CPU has been busy for at least HIGH_LOAD
+ * during OVERLOAD_PERIODS consecutive periods and another CPU is below LOW_LOAD, it chooses one
+ * migratable Sc to move from the first to the second CPU. At most one Sc is moved per period and
+ * CPUs with a pending migration are left alone until it has been done or has been withdrawn.
+ *
+ * Since the Ec of an Sc is bound to its CPU, the move has to be done by the thread itself (see
+ * Sc::migration()). That is, the thread asks regularly whether it should move, creates a new
+ * thread on the given CPU and terminates. Scs that never ask, stay pinned to their CPU.
+ */
+class Balancer {
+public:
+    // the length of a period in milliseconds
+    static const uint INTERVAL          = 1000;
+    // the load thresholds in per-mille of a period
+    static const uint HIGH_LOAD         = 900;
+    static const uint LOW_LOAD          = 500;
+    // the number of periods a CPU has to be overloaded before an Sc is moved away
+    static const uint OVERLOAD_PERIODS  = 3;
+    // the number of periods an Sc has to exist before it is moved
+    static const uint MIN_PERIODS       = 2;
+    // the number of periods after which a migration that has not been done is withdrawn
+    static const uint PENDING_PERIODS   = 5;
+
+    /**
+     * Runs the load balancer in the current thread. Does not return.
+     */
+    NORETURN static void run();
+
+    /**
+     * Sets whether the Sc <sc> may be moved by the load balancer.
+     *
+     * @param sc the Sc
+     * @param migratable whether it may be moved
+     * @return the CPU it should move to (its current CPU if it should stay)
+     */
+    static cpu_t migration(capsel_t sc, bool migratable);
+
+    /**
+     * Is called if an Sc with a pending migration is destroyed. Has to be called with the lock of
+     * Admission held.
+     *
+     * @param done whether the Sc has been told to move, i.e., whether it has moved
+     */
+    static void finished(bool done) {
+        if(done)
+            _stats.done++;
+        else
+            _stats.withdrawn++;
+    }
+
+private:
+    Balancer();
+
+    struct Stats {
+        ulong periods;
+        ulong requested;
+        ulong done;
+        ulong withdrawn;
+    };
+
+    struct Migration {
+        nre::String name;
+        cpu_t from;
+        cpu_t to;
+        uint fromload;
+        uint toload;
+        uint load;
+    };
+
+    static bool balance(timevalue_t elapsed, Migration &mig);
+
+    static uint _overloaded[nre::Hip::MAX_CPUS];
+    static Stats _stats;
+};
@@ -16,6 +16,7 @@
 
 #include <ipc/Service.h>
 #include <stream/Serial.h>
+#include <util/ScopedLock.h>
 #include <String.h>
 
 #include "VirtualMemory.h"
@@ -44,7 +45,7 @@ Ports::port_t Log::get_com1_base() {
     return base;
 }
 
-Log::Log() : BaseSerial(), _ports(get_com1_base(), 6), _sm(1), _ready(true) {
+Log::Log() : BaseSerial(), _ports(get_com1_base(), 6), _sm(1), _ready(true), _writers() {
     _ports.out<uint8_t>(0x80, LCR);          // Enable DLAB (set baud rate divisor)
     _ports.out<uint8_t>(0x01, DLR_LO);       // Set divisor to 1 (lo byte) 115200 baud
     _ports.out<uint8_t>(0x00, DLR_HI);       //                  (hi byte)
@@ -55,13 +56,21 @@ Log::Log() : BaseSerial(), _ports(get_com1_base(), 6), _sm(1), _ready(true) {
 }
 
 void Log::start() {
+    _writers = new Writer[CPU::count()];
+    for(auto it = CPU::begin(); it != CPU::end(); ++it)
+        _writers[it->log_id()].start(it->log_id());
     _srv = new LogService("log");
     _srv->start();
 }
 
-void Log::write(const char *name, uint sessid, const char *line, size_t len) {
+void Log::write(const char *name, uint sessid, const char *line, size_t len,
+                LogRing::Severity severity) {
     ScopedLock<UserSm> guard(&_sm);
     *this << "\e[0;" << _colors[sessid % ARRAY_SIZE(_colors)] << "m[" << fmt(name, 8, 8) << "] ";
+    if(severity == LogRing::WARNING)
+        *this << "(warning) ";
+    else if(severity == LogRing::ERROR)
+        *this << "(error) ";
     for(size_t i = 0; i < len; ++i) {
         char c = line[i];
         if(c != '\n')
@@ -70,15 +79,111 @@ void Log::write(const char *name, uint sessid, const char *line, size_t len) {
     *this << "\e[0m\n";
 }
 
+const DataSpace &Log::LogServiceSession::create_ring(Writer *writer) {
+    if(_ds)
+        throw Exception(E_EXISTS, "Log ring already created");
+    _ds = new DataSpace(LogRing::SIZE, DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW);
+    _cons = new Consumer<LogRing::Record>(*_ds, writer->sm(), true);
+    _writer = writer;
+    _writer->add(this);
+    return *_ds;
+}
+
+void Log::LogServiceSession::invalidate() {
+    if(_writer)
+        _writer->remove(this);
+}
+
+bool Log::LogServiceSession::drain(size_t max) {
+    for(size_t i = 0; i < max && _cons->has_data(); ++i) {
+        LogRing::Record *rec = _cons->get();
+        if(rec->dropped) {
+            _dropped += rec->dropped;
+            char msg[64];
+            OStringStream os(msg, sizeof(msg));
+            os << "<" << rec->dropped << " lines dropped, " << _dropped << " in total>";
+            Log::get().write(_name.str(), id() + 1, msg, os.length(), LogRing::WARNING);
+        }
+        size_t len = Math::min<size_t>(rec->len, LogRing::MAX_LINE_LEN);
+        Log::get().write(_name.str(), id() + 1, rec->line, len,
+                         static_cast<LogRing::Severity>(rec->severity));
+        _cons->next();
+    }
+    return _cons->has_data();
+}
+
+void Log::Writer::start(cpu_t cpu) {
+    _gt = GlobalThread::create(thread, cpu, "root-logwriter");
+    _gt->set_tls(Thread::TLS_PARAM, this);
+    _gt->start();
+}
+
+void Log::Writer::add(LogServiceSession *sess) {
+    ScopedLock<UserSm> guard(&_lock);
+    sess->_next = _sessions;
+    _sessions = sess;
+}
+
+void Log::Writer::remove(LogServiceSession *sess) {
+    ScopedLock<UserSm> guard(&_lock);
+    // write what the client has put into the ring before it closed the session
+    while(sess->drain(BATCH_SIZE))
+        ;
+    for(LogServiceSession **p = &_sessions; *p != nullptr; p = &(*p)->_next) {
+        if(*p == sess) {
+            *p = sess->_next;
+            break;
+        }
+    }
+}
+
+void Log::Writer::thread(void*) {
+    Writer *w = Thread::current()->get_tls<Writer*>(Thread::TLS_PARAM);
+    while(1) {
+        // collapse all pending notifications; everything produced before is visible afterwards
+        w->_sm.zero();
+
+        bool more;
+        do {
+            ScopedLock<UserSm> guard(&w->_lock);
+            more = false;
+            for(LogServiceSession *sess = w->_sessions; sess != nullptr; sess = sess->_next)
+                more |= sess->drain(BATCH_SIZE);
+        }
+        while(more);
+    }
+}
+
 void Log::LogService::portal(LogServiceSession *sess) {
     UtcbFrameRef uf;
     try {
-        String line;
-        uf >> line;
-        uf.finish_input();
+        LogRing::Command cmd;
+        uf >> cmd;
+        switch(cmd) {
+            case LogRing::WRITE: {
+                String line;
+                LogRing::Severity severity;
+                uf >> line >> severity;
+                uf.finish_input();
+
+                Log::get().write(sess->name().str(), sess->id() + 1, line.str(), line.length(),
+                                 severity);
+                uf << E_SUCCESS;
+            }
+            break;
+
+            case LogRing::GET_RING: {
+                uf.finish_input();
 
-        Log::get().write(sess->name().str(), sess->id() + 1, line.str(), line.length());
-        uf << E_SUCCESS;
+                Writer *writer = Log::get()._writers + CPU::current().log_id();
+                const DataSpace &ds = sess->create_ring(writer);
+                uf.delegate(ds.sel(), 0);
+                // the client may only notify the writer, but not wait for it
+                uf.delegate(writer->sm().sel(), 1, UtcbFrame::NONE, Crd::OBJ | Crd::SM_UP);
+                uf << E_SUCCESS;
+            }
+            break;
+        }
     }
     catch(const Exception &e) {
         uf.clear();
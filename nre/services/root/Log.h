@@ -17,8 +17,11 @@
 #pragma once
 
 #include <ipc/Service.h>
+#include <ipc/Consumer.h>
+#include <services/Log.h>
 #include <stream/Serial.h>
 #include <stream/IStringStream.h>
+#include <kobj/GlobalThread.h>
 #include <kobj/Ports.h>
 #include <kobj/Sm.h>
 
@@ -26,23 +29,88 @@ class BufferedLog;
 
 /**
  * The log implementation that provides a service for child tasks that allows them to print lines
- * to the serial line.
+ * to the serial line. The clients put their lines into a ring in shared memory, which is drained by
+ * a writer thread on the CPU the session has been established on. Thus, the clients never have to
+ * wait for the serial line.
  */
 class Log : public nre::BaseSerial {
     friend class BufferedLog;
 
+    class Writer;
+
     class LogServiceSession : public nre::ServiceSession {
+        friend class Writer;
+
     public:
         explicit LogServiceSession(nre::Service *s, size_t id, portal_func func, const nre::String &name)
-            : ServiceSession(s, id, func), _name(name) {
+            : ServiceSession(s, id, func), _name(name), _ds(), _cons(), _writer(), _next(),
+              _dropped() {
+        }
+        virtual ~LogServiceSession() {
+            delete _cons;
+            delete _ds;
         }
 
+        virtual void invalidate();
+
         const nre::String &name() const {
             return _name;
         }
 
+        /**
+         * Creates the ring for this session, which is drained by <writer>.
+         *
+         * @return the dataspace for the ring
+         */
+        const nre::DataSpace &create_ring(Writer *writer);
+
+        /**
+         * Writes up to <max> records from the ring to the serial line.
+         *
+         * @return true if there are more records
+         */
+        bool drain(size_t max);
+
     private:
         nre::String _name;
+        nre::DataSpace *_ds;
+        nre::Consumer<nre::LogRing::Record> *_cons;
+        Writer *_writer;
+        LogServiceSession *_next;
+        uint64_t _dropped;
+    };
+
+    /**
+     * Drains the rings of all sessions that have been established on one CPU. The clients get the
+     * semaphore of the writer (with the permission to up it only) to notify it about new records.
+     */
+    class Writer {
+    public:
+        // the number of records we write for one session before we look at the next one
+        static const size_t BATCH_SIZE  = 16;
+
+        explicit Writer() : _sm(0), _lock(), _sessions(), _gt() {
+        }
+
+        nre::Sm &sm() {
+            return _sm;
+        }
+
+        void start(cpu_t cpu);
+        void add(LogServiceSession *sess);
+        /**
+         * Drains the remaining records of <sess> and removes it. Afterwards, the writer does not
+         * use it anymore.
+         */
+        void remove(LogServiceSession *sess);
+
+    private:
+        static void thread(void*);
+
+        nre::Sm _sm;
+        nre::UserSm _lock;
+        LogServiceSession *_sessions;
+        nre::Reference<nre::GlobalThread> _gt;
     };
 
     class LogService : public nre::Service {
@@ -69,13 +137,13 @@ class Log : public nre::BaseSerial {
             return str;
         }
 
-        // note that we use a portal here instead of shared-memory because dataspace sharing doesn't
-        // work with services living in root. the problem is the translation of caps. the translation
-        // stops as soon as the destination Pd is reached. since stuff in root walks to the
-        // directly to the root-ds-manager and bypasses the childmanager, we receive the cap that is
-        // actually meant for the childmanager in the root-ds-manager. thus, we don't find the dataspace.
-        // to prevent the whole problem, we use a portal which works fine in this case, since its
-        // not performance critical anyway. so, sending a long string doesn't really hurt.
+        // note that clients can't share dataspaces with services living in root. the problem is the
+        // translation of caps. the translation stops as soon as the destination Pd is reached.
+        // since stuff in root walks to the directly to the root-ds-manager and bypasses the
+        // childmanager, we receive the cap that is actually meant for the childmanager in the
+        // root-ds-manager. thus, we don't find the dataspace. therefore, we create the dataspace
+        // for the ring here and let the client join it. if that fails, the client sends the lines
+        // via this portal.
         PORTAL static void portal(LogServiceSession *sess);
     };
 
@@ -108,7 +176,8 @@ public:
 private:
     explicit Log();
 
-    void write(const char *name, uint sessid, const char *line, size_t len);
+    void write(const char *name, uint sessid, const char *line, size_t len,
+               nre::LogRing::Severity severity = nre::LogRing::INFO);
 
     virtual void write(char c) {
         if(c == '\0')
@@ -124,6 +193,7 @@ private:
     nre::Ports _ports;
     nre::UserSm _sm;
     bool _ready;
+    Writer *_writers;
     static Log _inst;
     static nre::Service *_srv;
     static const char *_colors[];
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+
+#include <utcb/UtcbFrame.h>
+#include <util/Util.h>
+#include <Logging.h>
+
+#include "PlacementService.h"
+#include "Admission.h"
+
+using namespace nre;
+
+PlacementService::PlacementService(ChildManager *cm)
+    : Service("placement", CPUSet(CPUSet::ALL), reinterpret_cast<portal_func>(portal)), _cm(cm),
+      _sm(), _placer(), _last_sample(Util::tsc()), _last_busy() {
+    for(auto it = CPU::begin(); it != CPU::end(); ++it) {
+        Reference<LocalThread> ec = get_thread(it->log_id());
+        ec->set_tls<PlacementService*>(Thread::TLS_PARAM, this);
+    }
+    _placer.add_online();
+    Admission::busy_time(_last_busy);
+}
+
+void PlacementService::update_load() {
+    timevalue_t now = Util::tsc();
+    timevalue_t elapsed = ((now - _last_sample) * 1000) / Hip::get().freq_tsc;
+    if(elapsed < SAMPLE_INTERVAL * 1000)
+        return;
+
+    timevalue_t busy[Hip::MAX_CPUS];
+    Admission::busy_time(busy);
+    for(auto it = CPU::begin(); it != CPU::end(); ++it) {
+        cpu_t cpu = it->log_id();
+        // the busy time might decrease if an Sc has been destroyed between the measurements
+        timevalue_t diff = busy[cpu] > _last_busy[cpu] ? busy[cpu] - _last_busy[cpu] : 0;
+        uint load = Math::min<timevalue_t>((diff * Placement::FULL_LOAD) / elapsed,
+                                           Placement::FULL_LOAD);
+        _placer.load(cpu, load);
+        _last_busy[cpu] = busy[cpu];
+    }
+    _last_sample = now;
+}
+
+cpu_t PlacementService::service_cpu(const String &name) {
+    ScopedLock<ChildManager> guard(_cm);
+    const ServiceRegistry::Service *s = _cm->registry().find(name);
+    if(!s)
+        VTHROW(Exception, E_NOT_FOUND, "Service '" << name << "' not found");
+    // the services of root itself are available everywhere
+    return s->child() ? s->child()->cpu() : CPUPlacer::NO_CPU;
+}
+
+cpu_t PlacementService::place(Placement::Policy policy, const CPUSet &cpus, const String &near) {
+    cpu_t nearcpu = CPUPlacer::NO_CPU;
+    if(policy == Placement::NEAR)
+        nearcpu = service_cpu(near);
+
+    ScopedLock<UserSm> guard(&_sm);
+    update_load();
+    cpu_t cpu = _placer.place(policy, cpus, nearcpu);
+    LOG(ADMISSION, "Placement: policy " << policy << " -> CPU " << cpu << " (load "
+                                        << _placer.get(cpu).load << ")\n");
+    return cpu;
+}
+
+void PlacementService::get_load(UtcbFrameRef &uf) {
+    ScopedLock<UserSm> guard(&_sm);
+    update_load();
+    uf << CPU::count();
+    for(auto it = CPU::begin(); it != CPU::end(); ++it)
+        uf << _placer.get(it->log_id());
+}
+
+void PlacementService::portal(PlacementServiceSession *sess) {
+    UtcbFrameRef uf;
+    PlacementService *srv = Thread::current()->get_tls<PlacementService*>(Thread::TLS_PARAM);
+    try {
+        Placement::Command cmd;
+        uf >> cmd;
+
+        switch(cmd) {
+            case Placement::PLACE: {
+                Placement::Policy policy;
+                CPUSet cpus;
+                String near;
+                uf >> policy >> cpus >> near;
+                uf.finish_input();
+
+                if(policy > Placement::NEAR)
+                    VTHROW(Exception, E_ARGS_INVALID, "Invalid policy " << policy);
+                cpu_t cpu = srv->place(policy, cpus, near);
+                sess->placed(cpu);
+                uf << E_SUCCESS << cpu;
+            }
+            break;
+
+            case Placement::RELEASE: {
+                cpu_t cpu;
+                uf >> cpu;
+                uf.finish_input();
+
+                if(cpu >= Hip::MAX_CPUS)
+                    VTHROW(Exception, E_ARGS_INVALID, "Invalid CPU " << cpu);
+                sess->released(cpu);
+                srv->release(cpu);
+                uf << E_SUCCESS;
+            }
+            break;
+
+            case Placement::GET_LOAD:
+                uf.finish_input();
+                uf << E_SUCCESS;
+                srv->get_load(uf);
+                break;
+        }
+    }
+    catch(const Exception &e) {
+        uf.clear();
+        uf << e;
+    }
+}
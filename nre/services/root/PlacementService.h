@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+
+#pragma once
+
+#include <ipc/Service.h>
+#include <kobj/UserSm.h>
+#include <subsystem/ChildManager.h>
+#include <util/CPUPlacer.h>
+
+/**
+ * The placement service chooses CPUs for the threads and childs of its clients. It knows the
+ * topology from the CPU objects and measures the load of each CPU via the time of the Scs that
+ * Admission keeps track of. The load is updated on demand, but at most once per SAMPLE_INTERVAL.
+ */
+class PlacementService : public nre::Service {
+    class PlacementServiceSession : public nre::ServiceSession {
+    public:
+        explicit PlacementServiceSession(PlacementService *s, size_t id, portal_func func)
+            : ServiceSession(s, id, func), _srv(s), _placed() {
+        }
+        virtual ~PlacementServiceSession() {
+            // give back what has not been released by the client
+            for(cpu_t cpu = 0; cpu < nre::Hip::MAX_CPUS; ++cpu) {
+                while(_placed[cpu] > 0) {
+                    _srv->release(cpu);
+                    _placed[cpu]--;
+                }
+            }
+        }
+
+        void placed(cpu_t cpu) {
+            _placed[cpu]++;
+        }
+        void released(cpu_t cpu) {
+            if(_placed[cpu] == 0)
+                VTHROW(Exception, E_ARGS_INVALID, "Nothing placed on CPU " << cpu);
+            _placed[cpu]--;
+        }
+
+    private:
+        PlacementService *_srv;
+        uint _placed[nre::Hip::MAX_CPUS];
+    };
+
+public:
+    // the minimum time between two load measurements in milliseconds
+    static const uint SAMPLE_INTERVAL   = 100;
+
+    explicit PlacementService(nre::ChildManager *cm);
+
+    /**
+     * Chooses a CPU according to <policy>
+     *
+     * @param policy the policy
+     * @param cpus the CPUs to choose from
+     * @param near the name of the service to be close to (only used for Placement::NEAR)
+     * @return the chosen CPU
+     */
+    cpu_t place(nre::Placement::Policy policy, const nre::CPUSet &cpus, const nre::String &near);
+
+    /**
+     * Releases one placement on <cpu>
+     */
+    void release(cpu_t cpu) {
+        nre::ScopedLock<nre::UserSm> guard(&_sm);
+        _placer.release(cpu);
+    }
+
+    /**
+     * Writes the state of all online CPUs into <uf>
+     */
+    void get_load(nre::UtcbFrameRef &uf);
+
+private:
+    void update_load();
+    cpu_t service_cpu(const nre::String &name);
+
+    virtual nre::ServiceSession *create_session(size_t id, const nre::String &, portal_func func) {
+        return new PlacementServiceSession(this, id, func);
+    }
+
+    PORTAL static void portal(PlacementServiceSession *sess);
+
+    nre::ChildManager *_cm;
+    nre::UserSm _sm;
+    nre::CPUPlacer _placer;
+    timevalue_t _last_sample;
+    timevalue_t _last_busy[nre::Hip::MAX_CPUS];
+};
@@ -15,6 +15,9 @@
  */
 
 #include <services/SysInfo.h>
+#include <util/ScopedLock.h>
+#include <util/Sync.h>
+#include <cstring>
 
 #include "SysInfoService.h"
 #include "Admission.h"
@@ -42,14 +45,21 @@ const char *SysInfoService::get_root_info(size_t &virt, size_t &phys, size_t &th
     // determine physical memory by taking the total amount of used mem and substracting the amount
     // we've passed to children
     phys = PhysicalMemory::total_size() - PhysicalMemory::free_size();
+    // all Scs are created by us. thus, our threads are the ones that don't belong to a child, plus
+    // our main thread, which has been created by the hypervisor
+    size_t child_threads = 0;
     {
         ScopedLock<ChildManager> guard(_cm);
         for(auto it = _cm->begin(); it != _cm->end(); ++it) {
             size_t cvirt, cphys;
             it->reglist().memusage(cvirt, cphys);
             phys -= cphys;
+            // the main thread of the child is not included in the sc-list
+            child_threads += it->scs().length() + 1;
         }
+        threads = Admission::busy_count();
     }
+    threads = 1 + (threads > child_threads ? threads - child_threads : 0);
     // determine virtual memory by calculating the mem for our text and data area and the one we
     // assign dynamically.
     size_t textsize = reinterpret_cast<uintptr_t>(&TEXT_END)
@@ -57,8 +67,6 @@ const char *SysInfoService::get_root_info(size_t &virt, size_t &phys, size_t &th
     size_t datasize = reinterpret_cast<uintptr_t>(&DATA_END)
                       - reinterpret_cast<uintptr_t>(&DATA_BEGIN);
     virt = VirtualMemory::used() + textsize + datasize;
-    // log and sysinfo
-    threads = 2;
     return cmdline;
 }
 
@@ -72,6 +80,54 @@ Reference<const Child> SysInfoService::get_child_at(size_t idx) {
     return Reference<const Child>(&*it);
 }
 
+static void copy_str(char *dst, const char *src, size_t max) {
+    size_t len = Math::min(strlen(src), max - 1);
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+static void copy_quota(SysInfo::SnapshotChild *c, const ChildQuota &quota) {
+    for(size_t i = 0; i < ChildQuota::COUNT; ++i) {
+        c->quota_used[i] = quota.used(static_cast<ChildQuota::Resource>(i));
+        c->quota_limit[i] = quota.limit(static_cast<ChildQuota::Resource>(i));
+    }
+}
+
+void SysInfoService::update_snapshot(bool update) {
+    ScopedLock<UserSm> guard(&_sm);
+    SysInfo::Snapshot *s = reinterpret_cast<SysInfo::Snapshot*>(_ds.virt());
+    // tell the readers that an update is in progress
+    s->seq++;
+    Sync::memory_barrier();
+
+    s->cpus = CPU::count();
+    s->mem_total = PhysicalMemory::total_size();
+    s->mem_free = PhysicalMemory::free_size();
+    s->sc_count = Admission::get_sched_entities(s->cpu_time, s->scs, SysInfo::MAX_SNAPSHOT_SCS,
+                                                update);
+
+    SysInfo::SnapshotChild *c = s->children;
+    copy_str(c->cmdline, get_root_info(c->virt, c->phys, c->threads), SysInfo::MAX_CMDLINE_LEN);
+    copy_quota(c, ChildQuota());
+    s->child_count = 1;
+    {
+        ScopedLock<ChildManager> cmguard(_cm);
+        for(auto it = _cm->begin(); it != _cm->end(); ++it) {
+            if(s->child_count == SysInfo::MAX_SNAPSHOT_CHILDS)
+                break;
+            c = s->children + s->child_count++;
+            copy_str(c->cmdline, it->cmdline().str(), SysInfo::MAX_CMDLINE_LEN);
+            it->reglist().memusage(c->virt, c->phys);
+            // the main thread is not included in the sc-list
+            c->threads = it->scs().length() + 1;
+            copy_quota(c, it->quota());
+        }
+    }
+
+    Sync::memory_barrier();
+    s->seq++;
+}
+
 void SysInfoService::portal(ServiceSession*) {
     UtcbFrameRef uf;
     try {
@@ -140,6 +196,26 @@ void SysInfoService::portal(ServiceSession*) {
                 }
             }
             break;
+
+            case SysInfo::GET_SNAPSHOT: {
+                SysInfoService *srv = Thread::current()->get_tls<SysInfoService*>(Thread::TLS_PARAM);
+                uf.finish_input();
+                // only we write to it; without the up permission, the client can join it read-only
+                uf.delegate(srv->snapshot_ds().sel(), CapRange::NO_HOTSPOT, UtcbFrame::NONE,
+                            Crd::OBJ_ALL & ~(Crd::SM_UP | Crd::SM_DN));
+                uf << E_SUCCESS;
+            }
+            break;
+
+            case SysInfo::UPDATE_SNAPSHOT: {
+                SysInfoService *srv = Thread::current()->get_tls<SysInfoService*>(Thread::TLS_PARAM);
+                bool update;
+                uf >> update;
+                uf.finish_input();
+                srv->update_snapshot(update);
+                uf << E_SUCCESS;
+            }
+            break;
         }
     }
     catch(const Exception& e) {
@@ -15,28 +15,50 @@
  */
 
 #include <ipc/Service.h>
+#include <mem/DataSpace.h>
+#include <kobj/UserSm.h>
+#include <services/SysInfo.h>
 #include <subsystem/ChildManager.h>
 
 /**
  * The sysinfo-service is intended to allow applications to display information about the running
  * system to the user. At the moment, you can get information about the existing Scs, and the
  * child tasks of root with the memory usage and some other things.
+ * Besides the per-index requests, it maintains a snapshot of all that in a dataspace that is shared
+ * with all clients, so that they can enumerate everything without one IPC per entry.
  */
 class SysInfoService : public nre::Service {
 public:
     SysInfoService(nre::ChildManager *cm)
         : nre::Service("sysinfo", nre::CPUSet(nre::CPUSet::ALL), reinterpret_cast<portal_func>(portal)),
-          _cm(cm) {
+          _cm(cm), _sm(), _ds(nre::SysInfo::snapshot_size(), nre::DataSpaceDesc::ANONYMOUS,
+                           nre::DataSpaceDesc::RW) {
         for(auto it = nre::CPU::begin(); it != nre::CPU::end(); ++it) {
             nre::Reference<nre::LocalThread> ec = get_thread(it->log_id());
             ec->set_tls<SysInfoService*>(nre::Thread::TLS_PARAM, this);
         }
     }
 
+    /**
+     * @return the dataspace that contains the snapshot
+     */
+    const nre::DataSpace &snapshot_ds() const {
+        return _ds;
+    }
+
+    /**
+     * Updates the snapshot
+     *
+     * @param update whether to start a new measurement period for the Sc times
+     */
+    void update_snapshot(bool update);
+
 private:
     const char *get_root_info(size_t &virt, size_t &phys, size_t &threads);
     nre::Reference<const nre::Child> get_child_at(size_t idx);
     PORTAL static void portal(nre::ServiceSession*);
 
     nre::ChildManager *_cm;
+    nre::UserSm _sm;
+    nre::DataSpace _ds;
 };
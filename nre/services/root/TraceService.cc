@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <services/Tracer.h>
+#include <stream/Serial.h>
+#include <util/ScopedLock.h>
+#include <util/Sync.h>
+#include <Logging.h>
+#include <Hip.h>
+#include <cstring>
+
+#include "TraceService.h"
+
+using namespace nre;
+
+const DataSpace &TraceService::TraceServiceSession::create_area() {
+    if(_ds)
+        throw Exception(E_EXISTS, "Trace area already created");
+    _ds = new DataSpace(Trace::area_size(), DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW);
+    // the client initializes it, but until then, we should not look at it
+    memset(reinterpret_cast<void*>(_ds->virt()), 0, sizeof(Trace::Area));
+    return *_ds;
+}
+
+TraceService::TraceService(word_t mask)
+    : Service("tracer", CPUSet(CPUSet::ALL), reinterpret_cast<portal_func>(portal)), _sm(),
+      _rootds(Trace::area_size(), DataSpaceDesc::ANONYMOUS, DataSpaceDesc::RW), _owner() {
+    for(auto it = CPU::begin(); it != CPU::end(); ++it) {
+        Reference<LocalThread> ec = get_thread(it->log_id());
+        ec->set_tls<TraceService*>(Thread::TLS_PARAM, this);
+    }
+    Trace::attach(reinterpret_cast<Trace::Area*>(_rootds.virt()), "root", mask);
+}
+
+void TraceService::set_mask(word_t mask) {
+    reinterpret_cast<Trace::Area*>(_rootds.virt())->mask = mask;
+    ScopedLock<Service> guard(this);
+    for(auto it = sessions_begin(); it != sessions_end(); ++it) {
+        Trace::Area *area = static_cast<TraceServiceSession*>(&*it)->area();
+        if(area && area->magic == Trace::MAGIC)
+            area->mask = mask;
+    }
+}
+
+void TraceService::check_control(TraceServiceSession *sess) {
+    if(_owner != sess &&
+       !Atomic::cmpnswap(&_owner, static_cast<TraceServiceSession*>(nullptr), sess))
+        throw Exception(E_ARGS_INVALID, "Tracing is controlled by another session");
+}
+
+bool TraceService::fill(Cursor *c, uint64_t &lost) {
+    while(c->next < c->end) {
+        size_t n = Math::min<uint64_t>(c->end - c->next, CHUNK_SIZE);
+        for(size_t i = 0; i < n; ++i)
+            c->chunk[i] = c->buf->events[(c->next + i) & (Trace::EVENTS - 1)];
+        Sync::memory_barrier();
+
+        // if the buffer has a new owner, the rest is gone
+        uint64_t count = c->buf->count;
+        if(count < c->end) {
+            lost += c->end - c->next;
+            c->next = c->end;
+            break;
+        }
+        // the owner might have overwritten some of them in the meantime, including the event it
+        // is currently writing. skip these and try it again
+        uint64_t valid = count >= Trace::EVENTS ? count - Trace::EVENTS + 1 : 0;
+        if(valid > c->next) {
+            uint64_t skip = Math::min(valid, c->end) - c->next;
+            lost += skip;
+            c->next += skip;
+            continue;
+        }
+
+        c->pos = 0;
+        c->len = n;
+        c->next += n;
+        return true;
+    }
+    return false;
+}
+
+void TraceService::dump() {
+    ScopedLock<UserSm> guard(&_sm);
+
+    // collect all areas, with root being the first one. we hold a reference to the sessions, so
+    // that their areas stay alive, but don't block the others while we are writing to the log
+    size_t count = 1;
+    Reference<TraceServiceSession> *sessions;
+    {
+        ScopedLock<Service> sguard(this);
+        for(auto it = sessions_begin(); it != sessions_end(); ++it)
+            count++;
+        sessions = new Reference<TraceServiceSession>[count];
+        count = 1;
+        for(auto it = sessions_begin(); it != sessions_end(); ++it) {
+            TraceServiceSession *sess = static_cast<TraceServiceSession*>(&*it);
+            Trace::Area *area = sess->area();
+            if(area && area->magic == Trace::MAGIC && area->version == Trace::VERSION)
+                sessions[count++] = Reference<TraceServiceSession>(sess);
+        }
+    }
+
+    // take a snapshot of the position of all buffers. we only write the events until there
+    uint64_t lost = 0;
+    size_t ncursors = 0;
+    Cursor *cursors = new Cursor[count * Trace::MAX_THREADS];
+    LOG(ALWAYS, "@trace begin " << Hip::get().freq_tsc << "\n");
+    for(uint p = 0; p < Trace::POINT_COUNT; ++p)
+        LOG(ALWAYS, "@trace point " << p << " " << Trace::name(p) << "\n");
+    for(size_t i = 0; i < count; ++i) {
+        const Trace::Area *area = i == 0 ? reinterpret_cast<Trace::Area*>(_rootds.virt())
+                                         : sessions[i]->area();
+        char name[Trace::MAX_NAME_LEN];
+        memcpy(name, area->name, Trace::MAX_NAME_LEN);
+        name[Trace::MAX_NAME_LEN - 1] = '\0';
+        LOG(ALWAYS, "@trace pd " << i << " " << name << "\n");
+
+        size_t threads = Math::min<size_t>(area->threads, Trace::MAX_THREADS);
+        for(size_t t = 0; t < threads; ++t) {
+            Cursor *c = cursors + ncursors;
+            c->buf = area->buffers + t;
+            c->end = c->buf->count;
+            c->next = c->end > Trace::EVENTS ? c->end - Trace::EVENTS : 0;
+            c->pd = i;
+            c->thread = c->buf->thread;
+            lost += c->next;
+            if(fill(c, lost))
+                ncursors++;
+        }
+    }
+
+    // merge the buffers by always taking the oldest event. the events within one buffer are
+    // already ordered, because each buffer is written by one thread only.
+    uint64_t events = 0;
+    while(true) {
+        Cursor *min = nullptr;
+        for(size_t i = 0; i < ncursors; ++i) {
+            Cursor *c = cursors + i;
+            if(c->pos < c->len && (!min || c->chunk[c->pos].tsc < min->chunk[min->pos].tsc))
+                min = c;
+        }
+        if(!min)
+            break;
+
+        const Trace::Event *ev = min->chunk + min->pos;
+        LOG(ALWAYS, "@trace ev " << min->pd << " " << min->thread << " "
+                    << static_cast<uint>(ev->cpu) << " " << static_cast<uint>(ev->type) << " "
+                    << static_cast<uint>(ev->point) << " " << ev->tsc << " " << ev->arg << "\n");
+        if(++min->pos == min->len)
+            fill(min, lost);
+        events++;
+    }
+    LOG(ALWAYS, "@trace end " << events << " " << lost << "\n");
+
+    delete[] cursors;
+    delete[] sessions;
+}
+
+void TraceService::portal(TraceServiceSession *sess) {
+    UtcbFrameRef uf;
+    try {
+        Tracer::Command cmd;
+        uf >> cmd;
+        switch(cmd) {
+            case Tracer::GET_AREA: {
+                uf.finish_input();
+                const DataSpace &ds = sess->create_area();
+                uf.delegate(ds.sel());
+                uf << E_SUCCESS;
+            }
+            break;
+
+            case Tracer::START:
+            case Tracer::STOP: {
+                TraceService *srv = Thread::current()->get_tls<TraceService*>(Thread::TLS_PARAM);
+                word_t mask = 0;
+                if(cmd == Tracer::START)
+                    uf >> mask;
+                uf.finish_input();
+                srv->check_control(sess);
+                srv->set_mask(mask);
+                uf << E_SUCCESS;
+            }
+            break;
+
+            case Tracer::DUMP: {
+                TraceService *srv = Thread::current()->get_tls<TraceService*>(Thread::TLS_PARAM);
+                uf.finish_input();
+                srv->check_control(sess);
+                srv->dump();
+                uf << E_SUCCESS;
+            }
+            break;
+        }
+    }
+    catch(const Exception &e) {
+        uf.clear();
+        uf << e;
+    }
+}
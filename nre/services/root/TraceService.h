@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <ipc/Service.h>
+#include <mem/DataSpace.h>
+#include <kobj/UserSm.h>
+#include <stream/IStringStream.h>
+#include <util/Atomic.h>
+#include <util/Reference.h>
+#include <util/Trace.h>
+
+/**
+ * The tracer service collects the trace areas of all Pds that have tracing enabled. Like for the
+ * log rings, the areas are created here and joined by the clients, because clients can't share
+ * dataspaces with services in root. Since the service knows all areas, it can enable and disable
+ * tracepoints for all Pds at once and merge all buffers by TSC.
+ *
+ * The tracing is controlled (START, STOP and DUMP) by one session at a time. The first session that
+ * does so becomes the owner and stays it until it is closed; the others are denied.
+ *
+ * The merged events are written to the log in the following format, which can be converted to the
+ * Chrome trace format by tools/trace2json:
+ * @trace begin <tsc-freq-khz>
+ * @trace point <point> <name>
+ * @trace pd <pd> <name>
+ * @trace ev <pd> <thread> <cpu> <type> <point> <tsc> <arg>
+ * @trace end <events> <lost>
+ */
+class TraceService : public nre::Service {
+    // the number of events per buffer that are copied at once during the merge
+    static const size_t CHUNK_SIZE  = 32;
+
+    class TraceServiceSession : public nre::ServiceSession {
+    public:
+        explicit TraceServiceSession(TraceService *s, size_t id, portal_func func,
+                                     const nre::String &name)
+            : ServiceSession(s, id, func), _srv(s), _name(name), _ds() {
+        }
+        virtual ~TraceServiceSession() {
+            delete _ds;
+        }
+
+        const nre::String &name() const {
+            return _name;
+        }
+        /**
+         * @return the trace area or nullptr if it hasn't been created yet
+         */
+        nre::Trace::Area *area() {
+            return _ds ? reinterpret_cast<nre::Trace::Area*>(_ds->virt()) : nullptr;
+        }
+
+        /**
+         * Creates the trace area for this session
+         *
+         * @return the dataspace for it
+         */
+        const nre::DataSpace &create_area();
+
+    private:
+        virtual void closed() {
+            _srv->release_control(this);
+        }
+
+        TraceService *_srv;
+        nre::String _name;
+        nre::DataSpace *_ds;
+    };
+
+    /**
+     * The read position in one buffer during the merge. The events are copied out in chunks,
+     * while the owner continues to write into the buffer.
+     */
+    struct Cursor {
+        size_t pd;
+        uint32_t thread;
+        const nre::Trace::Buffer *buf;
+        // the next event to copy and the end of the snapshot
+        uint64_t next;
+        uint64_t end;
+        nre::Trace::Event chunk[CHUNK_SIZE];
+        size_t pos;
+        size_t len;
+    };
+
+public:
+    /**
+     * Creates the service and the trace area for root itself
+     *
+     * @param mask the tracepoints to enable in root
+     */
+    explicit TraceService(word_t mask);
+
+    /**
+     * Sets the mask of enabled tracepoints in all Pds
+     */
+    void set_mask(word_t mask);
+
+    /**
+     * Merges the buffers of all Pds and writes them to the log. This includes all events that
+     * have been recorded until the call. The tracing continues meanwhile; the events that are
+     * overwritten before they are written to the log count as lost.
+     */
+    void dump();
+
+private:
+    /**
+     * Checks whether <sess> may control the tracing. If nobody does, <sess> becomes the owner.
+     *
+     * @throws Exception if another session controls it
+     */
+    void check_control(TraceServiceSession *sess);
+    void release_control(TraceServiceSession *sess) {
+        nre::Atomic::cmpnswap(&_owner, sess, static_cast<TraceServiceSession*>(nullptr));
+    }
+    static bool fill(Cursor *c, uint64_t &lost);
+
+    virtual nre::ServiceSession *create_session(size_t id, const nre::String &args, portal_func func) {
+        nre::IStringStream is(args);
+        nre::String name;
+        is >> name;
+        const char *str = name.str();
+        const char *res;
+        while((res = strchr(str, '/')) != NULL)
+            str = res + 1;
+        if(*str == '\0')
+            VTHROW(Exception, E_ARGS_INVALID, "Empty name");
+        return new TraceServiceSession(this, id, func, str);
+    }
+
+    PORTAL static void portal(TraceServiceSession *sess);
+
+    nre::UserSm _sm;
+    nre::DataSpace _rootds;
+    TraceServiceSession *volatile _owner;
+};
@@ -36,6 +36,9 @@
 #include "Hypervisor.h"
 #include "Admission.h"
 #include "SysInfoService.h"
+#include "TraceService.h"
+#include "PlacementService.h"
+#include "Balancer.h"
 #include "Log.h"
 
 using namespace nre;
@@ -50,10 +53,14 @@ class CPU0Init {
 EXTERN_C void dlmalloc_init();
 static void log_thread(void*);
 static void sysinfo_thread(void*);
+static void tracer_thread(void*);
+static void placement_thread(void*);
+static void balancer_thread(void*);
 PORTAL static void portal_service(void*);
 PORTAL static void portal_pagefault(void*);
 PORTAL static void portal_startup(void*);
 static void start_childs();
+static const char *root_arg(const char *name);
 
 CPU0Init CPU0Init::init INIT_PRIO_CPU0;
 
@@ -254,10 +261,18 @@ int main() {
     mng = new ChildManager();
     GlobalThread::create(log_thread, CPU::current().log_id(), "root-log")->start();
     GlobalThread::create(sysinfo_thread, CPU::current().log_id(), "root-sysinfo")->start();
+    GlobalThread::create(tracer_thread, CPU::current().log_id(), "root-tracer")->start();
+    GlobalThread::create(placement_thread, CPU::current().log_id(), "root-placement")->start();
 
-    // wait until log and sysinfo are registered
-    while(mng->registry().find("log") == nullptr || mng->registry().find("sysinfo") == nullptr)
-        Util::pause();
+    // wait until log, sysinfo, tracer and placement are registered
+    mng->wait_service("log");
+    mng->wait_service("sysinfo");
+    mng->wait_service("tracer");
+    mng->wait_service("placement");
+
+    // the load balancer is optional
+    if(root_arg("balance"))
+        GlobalThread::create(balancer_thread, CPU::current().log_id(), "root-balancer")->start();
 
     start_childs();
 
@@ -275,6 +290,48 @@ static void sysinfo_thread(void*) {
     sysinfo->start();
 }
 
+static const char *root_arg(const char *name) {
+    // our own cmdline is the one of the first module
+    size_t len = strlen(name);
+    for(auto it = Hip::get().mem_begin(); it != Hip::get().mem_end(); ++it) {
+        if(it->type == HipMem::MB_MODULE) {
+            const char *cmdline = it->cmdline();
+            for(const char *p = strstr(cmdline, name); p; p = strstr(p + 1, name)) {
+                if(p != cmdline && p[-1] != ' ')
+                    continue;
+                if(p[len] == '\0' || p[len] == ' ' || p[len] == '=')
+                    return p + len;
+            }
+            break;
+        }
+    }
+    return nullptr;
+}
+
+static word_t trace_mask() {
+    // tracing is enabled for root by "trace" or "trace=<hexmask>" on our own cmdline
+    const char *arg = root_arg("trace");
+    if(!arg)
+        return 0;
+    if(*arg == '=')
+        return strtoul(arg + 1, nullptr, 16);
+    return ~static_cast<word_t>(0);
+}
+
+static void tracer_thread(void*) {
+    TraceService *tracer = new TraceService(trace_mask());
+    tracer->start();
+}
+
+static void placement_thread(void*) {
+    PlacementService *placement = new PlacementService(mng);
+    placement->start();
+}
+
+static void balancer_thread(void*) {
+    Balancer::run();
+}
+
 static void start_childs() {
     size_t mod = 0, i = 0;
     ForwardCycler<CPU::iterator> cpus(CPU::begin(), CPU::end());
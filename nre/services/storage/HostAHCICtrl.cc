@@ -23,7 +23,7 @@ using namespace nre;
 
 HostAHCICtrl::HostAHCICtrl(uint id, PCI &pci, BDF bdf, Gsi *gsi, bool dmar)
     : Controller(id), _gsi(gsi), _bdf(bdf), _regs_ds(), _regs_high_ds(), _regs(),
-      _regs_high(0), _portcount(0), _ports() {
+      _regs_high(0), _portcount(0), _ports(), _vectorcount(0), _vectors() {
     assert(!(~pci.conf_read(_bdf, 1) & 6) && "we need mem-decode and busmaster dma");
     PCI::value_type bar = pci.conf_read(_bdf, 9);
     assert(!(bar & 7) && "we need a 32bit memory bar");
@@ -53,17 +53,72 @@ HostAHCICtrl::HostAHCICtrl(uint id, PCI &pci, BDF bdf, Gsi *gsi, bool dmar)
     for(uint i = 30; _regs_high && i < 32; i++)
         create_ahci_port(i, _regs_high + (i - 30), dmar);
 
+    // use one vector per port, if possible
+    create_vectors(pci);
+
     // clear pending irqs
     _regs->is = _regs->pi;
     // enable IRQs
     _regs->ghc |= 2;
 
-    // start the gsi thread
+    // start the gsi threads
+    for(size_t i = 0; i < _vectorcount; ++i)
+        start_vector(_vectors[i]);
+}
+
+void HostAHCICtrl::create_vectors(PCI &pci) {
+    // by default, the given GSI is responsible for all ports
+    _vectors[0].ctrl = this;
+    _vectors[0].gsi = _gsi;
+    _vectors[0].cpu = CPU::current().log_id();
+    _vectors[0].ports = ~0U;
+    _vectorcount = 1;
+
+    // with MSI-X and enough vectors, port i signals its interrupts via vector i
+    uint32_t ports = 0;
+    for(uint i = 0; i < ARRAY_SIZE(_ports); ++i) {
+        if(_ports[i])
+            ports |= 1U << i;
+    }
+    if(!_gsi->msi_addr() || CPU::count() == 1 || !ports)
+        return;
+    uint last = Math::bit_scan_reverse(ports);
+    if(pci.msix_vectors(_bdf) <= last)
+        return;
+
+    // let root spread the vector threads over the CPUs. the session is kept, because the
+    // placements are released when it is closed
+    static PlacementSession placement("placement");
+    _vectors[0].ports = 1U << 0;
+    for(uint i = 1; i <= last; ++i) {
+        IrqVector &vec = _vectors[_vectorcount];
+        vec.ctrl = this;
+        vec.cpu = placement.place(Placement::SPREAD);
+        vec.ports = 1U << i;
+        try {
+            vec.gsi = pci.get_gsi_msi(_bdf, i, nullptr, vec.cpu);
+        }
+        catch(const Exception &e) {
+            LOG(STORAGE, "Unable to allocate MSI-X vector " << i << ": " << e.msg() << "\n");
+            vec.gsi = nullptr;
+        }
+        // let the first vector handle the port, if that didn't work
+        if(!vec.gsi) {
+            placement.release(vec.cpu);
+            _vectors[0].ports |= 1U << i;
+            continue;
+        }
+        _vectorcount++;
+    }
+    LOG(STORAGE, "AHCI: using " << _vectorcount << " MSI-X vectors\n");
+}
+
+void HostAHCICtrl::start_vector(IrqVector &vec) {
     char name[32];
     OStringStream os(name, sizeof(name));
-    os << "ahci-gsi-" << _gsi->gsi();
-    Reference<GlobalThread> gt = GlobalThread::create(gsi_thread, CPU::current().log_id(), name);
-    gt->set_tls<HostAHCICtrl*>(Thread::TLS_PARAM, this);
+    os << "ahci-gsi-" << vec.gsi->gsi();
+    Reference<GlobalThread> gt = GlobalThread::create(gsi_thread, vec.cpu, name);
+    gt->set_tls<IrqVector*>(Thread::TLS_PARAM, &vec);
     gt->start();
 }
 
@@ -90,11 +145,13 @@ void HostAHCICtrl::create_ahci_port(uint nr, HostAHCIDevice::Register *portreg,
 }
 
 void HostAHCICtrl::gsi_thread(void*) {
-    HostAHCICtrl *ha = Thread::current()->get_tls<HostAHCICtrl*>(Thread::TLS_PARAM);
+    IrqVector *vec = Thread::current()->get_tls<IrqVector*>(Thread::TLS_PARAM);
+    HostAHCICtrl *ha = vec->ctrl;
     while(1) {
-        ha->_gsi->down();
+        vec->gsi->down();
 
-        uint32_t is = ha->_regs->is;
+        // only touch our ports; IS is write-1-to-clear, so that we don't disturb the others
+        uint32_t is = ha->_regs->is & vec->ports;
         uint32_t oldis = is;
         while(is) {
             uint32_t port = Math::bit_scan_forward(is);
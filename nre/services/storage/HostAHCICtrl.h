@@ -21,6 +21,7 @@
 #include <kobj/GlobalThread.h>
 #include <kobj/Sc.h>
 #include <mem/DataSpace.h>
+#include <services/Placement.h>
 #include <util/PCI.h>
 #include <Assert.h>
 #include <CPU.h>
@@ -31,10 +32,24 @@
 /**
  * A simple driver for AHCI.
  *
+ * If the controller offers an MSI-X vector per port, every port gets its own vector, which is
+ * routed to a different CPU. Thus, completions for different ports are handled in parallel.
+ * Otherwise, one thread handles the interrupts of all ports.
+ *
  * State: testing
- * Features: Ports
+ * Features: Ports, per-port MSI-X vectors
  */
 class HostAHCICtrl : public Controller {
+    /**
+     * An interrupt vector and the ports it is responsible for.
+     */
+    struct IrqVector {
+        HostAHCICtrl *ctrl;
+        nre::Gsi *gsi;
+        cpu_t cpu;
+        uint32_t ports;
+    };
+
     /**
      * The register set of an AHCI controller.
      */
@@ -61,6 +76,8 @@ class HostAHCICtrl : public Controller {
 public:
     explicit HostAHCICtrl(uint id, nre::PCI &pci, nre::BDF bdf, nre::Gsi *gsi, bool dmar);
     virtual ~HostAHCICtrl() {
+        for(size_t i = 1; i < _vectorcount; ++i)
+            delete _vectors[i].gsi;
         delete _gsi;
         delete _regs_ds;
         delete _regs_high_ds;
@@ -97,6 +114,8 @@ private:
         return drive % nre::Storage::MAX_DRIVES;
     }
     void create_ahci_port(uint nr, HostAHCIDevice::Register *portreg, bool dmar);
+    void create_vectors(nre::PCI &pci);
+    void start_vector(IrqVector &vec);
     static void gsi_thread(void*);
 
     nre::Gsi *_gsi;
@@ -107,4 +126,6 @@ private:
     HostAHCIDevice::Register *_regs_high;
     size_t _portcount;
     HostAHCIDevice *_ports[32];
+    size_t _vectorcount;
+    IrqVector _vectors[32];
 };
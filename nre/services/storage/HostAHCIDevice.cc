@@ -15,6 +15,7 @@
  * General Public License version 2 for more details.
  */
 
+#include <util/Trace.h>
 #include <Logging.h>
 
 #include "HostAHCIDevice.h"
@@ -22,6 +23,8 @@
 using namespace nre;
 
 void HostAHCIDevice::init() {
+    // nobody may issue commands while we reset the port
+    ScopedLock<UserSm> guard(&_sm);
     if(_regs->cmd & 0xc009) {
         // stop processing by clearing ST
         _regs->cmd &= ~1;
@@ -60,8 +63,9 @@ void HostAHCIDevice::init() {
     }
     _regs->cmd |= 0x1;
 
-    // nothing in progress anymore
-    _inprogress = 0;
+    // the commands that were in progress have been aborted by stopping the port. thus, report them
+    // as failed. the other slots are left alone, because they might be prepared on other CPUs
+    complete(_inprogress, 1);
 
     // enable irqs
     _regs->ie = 0xf98000f1;
@@ -79,10 +83,36 @@ void HostAHCIDevice::init() {
     //return identify_drive(buffer);
 }
 
+void HostAHCIDevice::partition_slots() {
+    // give every CPU a contiguous range of slots. if there are more CPUs than slots, they share
+    size_t per_cpu = Math::max<size_t>(1, _max_slots / CPU::count());
+    size_t i = 0;
+    for(auto it = CPU::begin(); it != CPU::end(); ++it, ++i) {
+        size_t first = (i * per_cpu) % _max_slots;
+        size_t count = Math::min(per_cpu, _max_slots - first);
+        _cpuslots[it->log_id()] = slot_mask(count) << first;
+    }
+}
+
+uint HostAHCIDevice::alloc_slot() {
+    uint32_t mine = _cpuslots[CPU::current().log_id()];
+    while(1) {
+        uint32_t free = _freeslots;
+        // prefer our own slots and steal from the other CPUs only if they are exhausted
+        uint32_t cand = (free & mine) ? (free & mine) : free;
+        if(!cand) {
+            VTHROW(Exception, E_CAPACITY,
+                   "Device " << _id << ": All " << _max_slots << " command slots are in use");
+        }
+        uint slot = Math::bit_scan_forward(cand);
+        if(Atomic::cmpnswap(&_freeslots, free, free & ~(1U << slot)))
+            return slot;
+    }
+}
+
 void HostAHCIDevice::readwrite(Producer<Storage::Packet> *prod, Storage::tag_type tag,
                                const DataSpace &ds, sector_type sector, const dma_type &dma,
                                bool write) {
-    ScopedLock<UserSm> guard(&_sm);
     size_t length = dma.bytecount();
     // exceeds max. length?
     if(length >> 22) {
@@ -93,17 +123,25 @@ void HostAHCIDevice::readwrite(Producer<Storage::Packet> *prod, Storage::tag_typ
     uint8_t command = has_lba48() ? 0x25 : 0xc8;
     if(write)
         command = has_lba48() ? 0x35 : 0xca;
-    set_command(command, sector, !write, length >> 9);
 
-    for(auto it = dma.begin(); it != dma.end(); ++it) {
-        if(it->offset > ds.size() || it->offset + it->count > ds.size()) {
-            VTHROW(Exception, E_ARGS_INVALID,
-                   "Device " << _id << ": Invalid offset(" << it->offset <<")/"
-                                               << "count(" << it->count << ")");
+    uint slot = alloc_slot();
+    try {
+        set_command(slot, command, sector, !write, length >> 9);
+
+        for(auto it = dma.begin(); it != dma.end(); ++it) {
+            if(it->offset > ds.size() || it->offset + it->count > ds.size()) {
+                VTHROW(Exception, E_ARGS_INVALID,
+                       "Device " << _id << ": Invalid offset(" << it->offset <<")/"
+                                                   << "count(" << it->count << ")");
+            }
+            add_dma(slot, ds, it->offset, it->count);
         }
-        add_dma(ds, it->offset, it->count);
     }
-    start_command(prod, tag);
+    catch(...) {
+        free_slot(slot);
+        throw;
+    }
+    start_command(slot, prod, tag);
 }
 
 void HostAHCIDevice::irq() {
@@ -112,14 +150,9 @@ void HostAHCIDevice::irq() {
     // clear interrupt status
     _regs->is = is;
 
-    for(uint done = _inprogress & ~_regs->ci, tag; done; done &= ~(1 << tag)) {
-        tag = nre::Math::bit_scan_forward(done);
-        LOG(STORAGE_DETAIL, "Operation for user " << fmt(_usertags[tag].tag, "x") << " is finished\n");
-        if(_usertags[tag].prod)
-            _usertags[tag].prod->produce(nre::Storage::Packet(_usertags[tag].tag, 0));
-
-        _usertags[tag].tag = ~0;
-        _inprogress &= ~(1 << tag);
+    {
+        ScopedLock<UserSm> guard(&_sm);
+        complete(_inprogress & ~_regs->ci, 0);
     }
 
     if((_regs->tfd & 1) && (~_regs->tfd & 0x400)) {
@@ -128,68 +161,90 @@ void HostAHCIDevice::irq() {
     }
 }
 
-void HostAHCIDevice::set_command(uint8_t command, uint64_t sector, bool read, uint count, bool atapi,
-                                 uint pmp, uint features) {
-    _cl[_tag * CL_DWORDS + 0] = (atapi ? 0x20 : 0) | (read ? 0 : 0x40) | 5 | ((pmp & 0xf) << 12);
-    _cl[_tag * CL_DWORDS + 1] = 0;
+void HostAHCIDevice::complete(uint32_t slots, uint status) {
+    for(uint32_t tag; slots; slots &= ~(1U << tag)) {
+        tag = nre::Math::bit_scan_forward(slots);
+        UserTag ut = _usertags[tag];
+        LOG(STORAGE_DETAIL, "Operation for user " << fmt(ut.tag, "x") << " is finished"
+            << " (status " << status << ")\n");
+
+        _usertags[tag].tag = ~0;
+        _inprogress &= ~(1U << tag);
+        free_slot(tag);
+
+        if(ut.prod) {
+            TRACE(nre::Trace::STORAGE_REQUEST, nre::Trace::ASYNC_END, ut.tag);
+            ut.prod->produce(nre::Storage::Packet(ut.tag, status));
+        }
+    }
+}
+
+void HostAHCIDevice::set_command(uint slot, uint8_t command, uint64_t sector, bool read, uint count,
+                                 bool atapi, uint pmp, uint features) {
+    _cl[slot * CL_DWORDS + 0] = (atapi ? 0x20 : 0) | (read ? 0 : 0x40) | 5 | ((pmp & 0xf) << 12);
+    _cl[slot * CL_DWORDS + 1] = 0;
 
     // link command list and tables
-    addr2phys(_ctds, _ct + _tag * (128 + MAX_PRD_COUNT * 16) / 4, _cl + _tag * CL_DWORDS + 2);
+    addr2phys(_ctds, _ct + slot * (128 + MAX_PRD_COUNT * 16) / 4, _cl + slot * CL_DWORDS + 2);
 
     // XXX Does any one know how to avoid these type casts in C++0x mode?
 #define UC(x) static_cast<uint8_t>(x)
     uint8_t cfis[20] = {0x27, UC(0x80 | (pmp & 0xf)), command, UC(features), UC(sector),
                         UC(sector >> 8), UC(sector >> 16), 0x40, UC(sector >> 24), UC(sector >> 32),
                         UC(sector >> 40), UC(features >> 8), UC(count), UC(count >> 8), 0, 0, 0, 0, 0, 0};
-    memcpy(_ct + _tag * (128 + MAX_PRD_COUNT * 16) / 4, cfis, sizeof(cfis));
+    memcpy(_ct + slot * (128 + MAX_PRD_COUNT * 16) / 4, cfis, sizeof(cfis));
 }
 
-void HostAHCIDevice::add_dma(const nre::DataSpace &ds, size_t offset, uint bytes) {
-    uint32_t prd = _cl[_tag * CL_DWORDS] >> 16;
+void HostAHCIDevice::add_dma(uint slot, const nre::DataSpace &ds, size_t offset, uint bytes) {
+    uint32_t prd = _cl[slot * CL_DWORDS] >> 16;
     if(prd >= MAX_PRD_COUNT)
         VTHROW(Exception, E_ARGS_INVALID, "Device " << _id << ": No free PRD slot");
-    _cl[_tag * CL_DWORDS] += 1 << 16;
-    uint32_t *p = _ct + ((_tag * (128 + MAX_PRD_COUNT * 16) + 0x80 + prd * 16) >> 2);
+    _cl[slot * CL_DWORDS] += 1 << 16;
+    uint32_t *p = _ct + ((slot * (128 + MAX_PRD_COUNT * 16) + 0x80 + prd * 16) >> 2);
     addr2phys(ds, reinterpret_cast<void*>(ds.virt() + offset), p);
     p[3] = bytes - 1;
 }
 
-void HostAHCIDevice::add_prd(const nre::DataSpace &ds, uint bytes) {
-    uint32_t prd = _cl[_tag * CL_DWORDS] >> 16;
+void HostAHCIDevice::add_prd(uint slot, const nre::DataSpace &ds, uint bytes) {
+    uint32_t prd = _cl[slot * CL_DWORDS] >> 16;
     assert(~bytes & 1);
     assert(!(bytes >> 22));
     if(prd >= MAX_PRD_COUNT)
         VTHROW(Exception, E_ARGS_INVALID, "Device " << _id << ": No free PRD slot");
-    _cl[_tag * CL_DWORDS] += 1 << 16;
-    uint32_t *p = _ct + ((_tag * (128 + MAX_PRD_COUNT * 16) + 0x80 + prd * 16) >> 2);
+    _cl[slot * CL_DWORDS] += 1 << 16;
+    uint32_t *p = _ct + ((slot * (128 + MAX_PRD_COUNT * 16) + 0x80 + prd * 16) >> 2);
     addr2phys(ds, reinterpret_cast<void*>(ds.virt()), p);
     p[3] = bytes - 1;
 }
 
-size_t HostAHCIDevice::start_command(nre::Producer<nre::Storage::Packet> *prod, ulong usertag) {
-    // remember work in progress commands
-    assert(!(_inprogress & (1 << _tag)));
-    _inprogress |= 1 << _tag;
-    _usertags[_tag].tag = usertag;
-    _usertags[_tag].prod = prod;
-
-    _regs->ci = 1 << _tag;
-    size_t res = _tag;
-    _tag = (_tag + 1) % _max_slots;
-    return res;
+void HostAHCIDevice::start_command(uint slot, nre::Producer<nre::Storage::Packet> *prod,
+                                   ulong usertag) {
+    // the irq handler considers all commands done that are in progress, but not set in CI. thus,
+    // it may never see the one without the other
+    ScopedLock<UserSm> guard(&_sm);
+    assert(!(_inprogress & (1U << slot)));
+    _usertags[slot].tag = usertag;
+    _usertags[slot].prod = prod;
+    _inprogress |= 1U << slot;
+
+    // CI is write-1-to-set, i.e. concurrent issues on other slots are not affected
+    _regs->ci = 1U << slot;
 }
 
 void HostAHCIDevice::identify_drive(nre::DataSpace &buffer) {
     uint16_t *buf = reinterpret_cast<uint16_t*>(buffer.virt());
     memset(reinterpret_cast<void*>(buffer.virt()), 0, 512);
-    set_command(0xec, 0, true);
-    add_prd(buffer, 512);
-    size_t tag = start_command(nullptr, 0);
+    uint slot = alloc_slot();
+    set_command(slot, 0xec, 0, true);
+    add_prd(slot, buffer, 512);
 
-    // there is no IRQ on identify, as this is PIO data-in command
-    if(wait_timeout(&_regs->ci, 1 << tag, 0))
+    // there is no IRQ on identify, as this is PIO data-in command. we are called from init, i.e.
+    // with the port locked, and poll it ourselves. thus, it is not marked as in progress
+    _regs->ci = 1U << slot;
+    uint32_t res = wait_timeout(&_regs->ci, 1U << slot, 0);
+    free_slot(slot);
+    if(res)
         VTHROW(Exception, E_TIMEOUT, "Device " << _id << ": Timeout while waiting on IDENTIFY to finish");
-    _inprogress &= ~(1 << tag);
 
     // we do not support spinup
     // TODO is 0 in qemu!? assert(buf[2] == 0xc837);
@@ -198,11 +253,14 @@ void HostAHCIDevice::identify_drive(nre::DataSpace &buffer) {
 }
 
 uint HostAHCIDevice::set_features(uint features, uint count) {
-    set_command(0xef, 0, false, count, false, 0, features);
-    size_t tag = start_command(nullptr, 0);
+    uint slot = alloc_slot();
+    set_command(slot, 0xef, 0, false, count, false, 0, features);
 
-    // there is no IRQ on set_features, as this is a PIO command
-    check3(wait_timeout(&_regs->ci, 1 << tag, 0));
-    _inprogress &= ~(1 << tag);
+    // there is no IRQ on set_features, as this is a PIO command. like identify, we poll it
+    ScopedLock<UserSm> guard(&_sm);
+    _regs->ci = 1U << slot;
+    uint32_t res = wait_timeout(&_regs->ci, 1U << slot, 0);
+    free_slot(slot);
+    check3(res);
     return 0;
 }
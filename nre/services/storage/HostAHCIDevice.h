@@ -19,8 +19,12 @@
 
 #include <mem/DataSpace.h>
 #include <ipc/Producer.h>
+#include <kobj/UserSm.h>
 #include <util/Clock.h>
+#include <util/Atomic.h>
+#include <util/ScopedLock.h>
 #include <Assert.h>
+#include <CPU.h>
 
 #include "Device.h"
 
@@ -29,6 +33,11 @@
 /**
  * A single AHCI port with its command list and receive FIS buffer.
  *
+ * The command slots are partitioned among the CPUs, so that requests that are submitted on
+ * different CPUs use disjoint slots and can be prepared and issued in parallel without a lock.
+ * Slots are allocated lock-free from a bitmap. If the slots of a CPU are exhausted, it steals
+ * free slots from the other CPUs.
+ *
  * State: testing
  * Supports: read-sectors, write-sectors, identify-drive
  * Missing: ATAPI detection
@@ -103,7 +112,7 @@ public:
     }
 
     explicit HostAHCIDevice(Register *regs, uint disknr, size_t max_slots, bool dmar)
-        : Device(disknr), _sm(), _regs(regs), _clock(FREQ), _max_slots(max_slots), _dmar(dmar),
+        : Device(disknr), _regs(regs), _clock(FREQ), _max_slots(max_slots), _dmar(dmar),
           _bufferds(512, nre::DataSpaceDesc::ANONYMOUS, nre::DataSpaceDesc::RW),
           _clds(max_slots * CL_DWORDS * 4, nre::DataSpaceDesc::ANONYMOUS, nre::DataSpaceDesc::RW),
           _ctds(max_slots * (32 + MAX_PRD_COUNT * 4) * 4,
@@ -112,7 +121,8 @@ public:
           _cl(reinterpret_cast<uint32_t*>(_clds.virt())),
           _ct(reinterpret_cast<uint32_t*>(_ctds.virt())),
           _fis(reinterpret_cast<uint32_t*>(_fisds.virt())),
-          _tag(0), _usertags(), _inprogress() {
+          _freeslots(slot_mask(max_slots)), _cpuslots(), _usertags(), _inprogress(), _sm() {
+        partition_slots();
         init();
     }
 
@@ -124,9 +134,9 @@ public:
     }
 
     void flush(nre::Producer<nre::Storage::Packet> *prod, nre::Storage::tag_type tag) {
-        nre::ScopedLock<nre::UserSm> guard(&_sm);
-        set_command(has_lba48() ? 0xea : 0xe7, 0, true);
-        start_command(prod, tag);
+        uint slot = alloc_slot();
+        set_command(slot, has_lba48() ? 0xea : 0xe7, 0, true);
+        start_command(slot, prod, tag);
     }
     void readwrite(nre::Producer<nre::Storage::Packet> *prod, nre::Storage::tag_type tag,
                    const nre::DataSpace &ds, sector_type sector, const dma_type &dma, bool write);
@@ -136,11 +146,15 @@ public:
         auto &ser = nre::Serial::get();
         ser << "AHCI is " << nre::fmt(_regs->is, "#x") << " ci " << nre::fmt(_regs->ci, "#x")
             << " ie " << nre::fmt(_regs->ie, "#x") << " cmd " << nre::fmt(_regs->cmd, "#x")
-            << " tfd " << nre::fmt(_regs->tfd, "#x") << " tag " << nre::fmt(_tag, "#x")
+            << " tfd " << nre::fmt(_regs->tfd, "#x") << " free " << nre::fmt(_freeslots, "#x")
             << "\n";
     }
 
 private:
+    static uint32_t slot_mask(size_t count) {
+        return count >= 32 ? ~0U : (1U << count) - 1;
+    }
+
     uint32_t wait_timeout(volatile uint32_t *reg, uint32_t mask, uint32_t value) {
         timevalue_t timeout = _clock.source_time(TIMEOUT);
         while(((*reg & mask) != value) && _clock.source_time() < timeout)
@@ -160,15 +174,20 @@ private:
     }
 
     void init();
-    void set_command(uint8_t command, uint64_t sector, bool read, uint count = 0, bool atapi = false,
+    void partition_slots();
+    uint alloc_slot();
+    void free_slot(uint slot) {
+        nre::Atomic::bit_or(&_freeslots, 1U << slot);
+    }
+    void set_command(uint slot, uint8_t command, uint64_t sector, bool read, uint count = 0, bool atapi = false,
                      uint pmp = 0, uint features = 0);
-    void add_dma(const nre::DataSpace &ds, size_t offset, uint count);
-    void add_prd(const nre::DataSpace &ds, uint count);
-    size_t start_command(nre::Producer<nre::Storage::Packet> *prod, ulong usertag);
+    void add_dma(uint slot, const nre::DataSpace &ds, size_t offset, uint count);
+    void add_prd(uint slot, const nre::DataSpace &ds, uint count);
+    void start_command(uint slot, nre::Producer<nre::Storage::Packet> *prod, ulong usertag);
+    void complete(uint32_t slots, uint status);
     void identify_drive(nre::DataSpace &buffer);
     uint set_features(uint features, uint count = 0);
 
-    nre::UserSm _sm;
     Register volatile *_regs;
     nre::Clock _clock;
     size_t _max_slots;
@@ -180,7 +199,11 @@ private:
     uint32_t *_cl;
     uint32_t *_ct;
     uint32_t *_fis;
-    size_t _tag;
+    uint32_t _freeslots;
+    uint32_t _cpuslots[nre::Hip::MAX_CPUS];
     UserTag _usertags[32];
-    uint _inprogress;
+    uint32_t _inprogress;
+    // protects the commands in progress against the issue of new ones. this is not about the
+    // slots, but about <_inprogress> and CI, which have to change at once for the irq handler
+    nre::UserSm _sm;
 };
@@ -14,6 +14,8 @@
  * General Public License version 2 for more details.
  */
 
+#include <util/Trace.h>
+
 #include "HostATADevice.h"
 
 using namespace nre;
@@ -104,8 +106,10 @@ void HostATADevice::transferPIO(Operation op, const DataSpace &ds, size_t secsiz
             VTHROW(Exception, E_ARGS_INVALID, "Device " << _id << ": Unable to copyout data");
         offset += secsize;
     }
-    if(prod)
+    if(prod) {
+        TRACE(Trace::STORAGE_REQUEST, Trace::ASYNC_END, tag);
         prod->produce(Storage::Packet(tag, 0));
+    }
 }
 
 void HostATADevice::transferDMA(Operation op, const DataSpace &ds, const dma_type &dma,
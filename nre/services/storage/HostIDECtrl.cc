@@ -75,6 +75,7 @@ void HostIDECtrl::write(size_t drive, producer_type *prod, tag_type tag, const n
 void HostIDECtrl::flush(size_t drive, producer_type *prod, tag_type tag) {
     nre::ScopedLock<nre::UserSm> guard(&_sm);
     _devs[idx(drive)]->flush_cache();
+    TRACE(nre::Trace::STORAGE_REQUEST, nre::Trace::ASYNC_END, tag);
     prod->produce(nre::Storage::Packet(tag, 0));
 }
 
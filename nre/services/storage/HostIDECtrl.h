@@ -21,6 +21,7 @@
 #include <kobj/GlobalThread.h>
 #include <kobj/Sc.h>
 #include <util/Clock.h>
+#include <util/Trace.h>
 #include <Logging.h>
 
 #include "Device.h"
@@ -219,8 +220,10 @@ private:
                 ctrl->inbmrb(BMR_REG_STATUS);
                 ctrl->outbmrb(BMR_REG_COMMAND, 0);
             }
-            if(ctrl->_tag.prod)
+            if(ctrl->_tag.prod) {
+                TRACE(nre::Trace::STORAGE_REQUEST, nre::Trace::ASYNC_END, ctrl->_tag.tag);
                 ctrl->_tag.prod->produce(nre::Storage::Packet(ctrl->_tag.tag, status));
+            }
             ctrl->_ready.up();
             ctrl->_in_progress = false;
             // just in case we receive another interrupt
@@ -20,6 +20,7 @@
 #include <services/ACPI.h>
 #include <stream/IStringStream.h>
 #include <util/PCI.h>
+#include <util/Trace.h>
 #include <Logging.h>
 #include <cstring>
 
@@ -134,6 +135,7 @@ void StorageService::portal(StorageServiceSession *sess) {
                 uf >> tag;
                 uf.finish_input();
                 LOG(STORAGE_DETAIL, "[" << sess->id() << "," << fmt(tag, "#x") << "] FLUSH\n");
+                TRACE(Trace::STORAGE_REQUEST, Trace::ASYNC_BEGIN, tag);
                 mng->get(sess->ctrl())->flush(sess->drive(), sess->prod(), tag);
                 uf << E_SUCCESS;
             }
@@ -170,6 +172,7 @@ void StorageService::portal(StorageServiceSession *sess) {
                                      << " (available: 0.." << sess->params().sectors - 1 << ")");
                 }
 
+                TRACE(Trace::STORAGE_REQUEST, Trace::ASYNC_BEGIN, tag);
                 if(cmd == Storage::READ) {
                     if(!(sess->data().flags() & DataSpaceDesc::R))
                         throw Exception(E_ARGS_INVALID, "Need to read, but no read permission");
@@ -190,8 +190,7 @@ HostHPET::HostHPET(bool force_legacy)
 uint16_t HostHPET::get_rid(uint8_t block, uint comparator) {
     ACPISession sess("acpi");
     try {
-        DataSpace table = sess.find_table("DMAR");
-        DmarTableParser p(reinterpret_cast<char*>(table.virt()));
+        DmarTableParser p(reinterpret_cast<const char*>(sess.find_table("DMAR")));
         DmarTableParser::Element e = p.get_element();
 
         uint16_t first_rid_found = 0;
@@ -235,13 +234,12 @@ uint16_t HostHPET::get_rid(uint8_t block, uint comparator) {
 
 uintptr_t HostHPET::get_address() {
     ACPISession sess("acpi");
-    DataSpace table = sess.find_table("HPET");
     struct HpetAcpiTable {
         char res[40];
         unsigned char gas[4];
         uint32_t address[2];
     };
-    HpetAcpiTable *hpet = reinterpret_cast<HpetAcpiTable*>(table.virt());
+    const HpetAcpiTable *hpet = reinterpret_cast<const HpetAcpiTable*>(sess.find_table("HPET"));
     if(hpet->gas[0])
         throw Exception(E_NOT_FOUND, "HPET access must be MMIO");
     if(hpet->address[1])
@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+/*
+ * Turns the function profile, recorded by libs/libstdc++/profile.cc and written to the log by the
+ * tracer service, into folded stacks, as expected by flamegraph.pl. The function addresses are
+ * resolved with the symbol tables of the given ELF files, which are matched with the Pds by name.
+ *
+ * The time between two consecutive events of a thread is attributed to its current stack. If an
+ * event of a different thread has been recorded on the same CPU in between, the thread has been
+ * preempted or blocked, so that the time is not counted. The unit is TSC cycles.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <elf.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+
+using namespace std;
+
+// has to match Trace::Type in include/util/Trace.h
+enum Type {
+    BEGIN,
+    END,
+};
+
+struct Event {
+    unsigned pd;
+    unsigned thread;
+    unsigned cpu;
+    unsigned type;
+    unsigned point;
+    unsigned long long tsc;
+    unsigned long long arg;
+};
+
+struct Dump {
+    map<unsigned, string> points;
+    map<unsigned, string> pds;
+    vector<Event> events;
+};
+
+struct Symbol {
+    unsigned long long size;
+    string name;
+};
+
+typedef map<unsigned long long, Symbol> symtab_t;
+
+static map<string, symtab_t> symbols;
+
+static string file_name(const string &path) {
+    size_t pos = path.rfind('/');
+    return pos == string::npos ? path : path.substr(pos + 1);
+}
+
+static string demangle(const char *name) {
+    int status;
+    char *res = abi::__cxa_demangle(name, NULL, NULL, &status);
+    if(status != 0 || !res)
+        return name;
+    string str(res);
+    free(res);
+    return str;
+}
+
+template<class Ehdr, class Shdr, class Sym>
+static bool load_syms(const vector<char> &file, symtab_t &syms) {
+    const Ehdr *eh = reinterpret_cast<const Ehdr*>(&file[0]);
+    if(eh->e_shoff + eh->e_shnum * sizeof(Shdr) > file.size())
+        return false;
+    const Shdr *sh = reinterpret_cast<const Shdr*>(&file[eh->e_shoff]);
+    for(size_t i = 0; i < eh->e_shnum; ++i) {
+        if(sh[i].sh_type != SHT_SYMTAB || sh[i].sh_link >= eh->e_shnum)
+            continue;
+        const Shdr &strsec = sh[sh[i].sh_link];
+        if(sh[i].sh_offset + sh[i].sh_size > file.size() ||
+           strsec.sh_offset + strsec.sh_size > file.size())
+            return false;
+        const Sym *sym = reinterpret_cast<const Sym*>(&file[sh[i].sh_offset]);
+        const char *strtab = &file[strsec.sh_offset];
+        for(size_t j = 0; j < sh[i].sh_size / sizeof(Sym); ++j) {
+            if((sym[j].st_info & 0xf) != STT_FUNC || sym[j].st_name >= strsec.sh_size)
+                continue;
+            Symbol s;
+            s.size = sym[j].st_size;
+            s.name = demangle(strtab + sym[j].st_name);
+            syms[sym[j].st_value] = s;
+        }
+    }
+    return true;
+}
+
+static bool load_elf(const char *path) {
+    ifstream in(path, ios::in | ios::binary);
+    if(!in)
+        return false;
+    vector<char> file((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    if(file.size() < EI_NIDENT || memcmp(&file[0], ELFMAG, SELFMAG) != 0)
+        return false;
+
+    symtab_t &syms = symbols[file_name(path)];
+    if(file[EI_CLASS] == ELFCLASS64 && file.size() >= sizeof(Elf64_Ehdr))
+        return load_syms<Elf64_Ehdr, Elf64_Shdr, Elf64_Sym>(file, syms);
+    if(file[EI_CLASS] == ELFCLASS32 && file.size() >= sizeof(Elf32_Ehdr))
+        return load_syms<Elf32_Ehdr, Elf32_Shdr, Elf32_Sym>(file, syms);
+    return false;
+}
+
+static string resolve(const string &pd, unsigned long long addr) {
+    map<string, symtab_t>::const_iterator file = symbols.find(pd);
+    if(file != symbols.end() && !file->second.empty()) {
+        symtab_t::const_iterator it = file->second.upper_bound(addr);
+        if(it != file->second.begin()) {
+            --it;
+            if(addr == it->first || addr < it->first + it->second.size)
+                return it->second.name;
+        }
+    }
+    ostringstream os;
+    os << "0x" << hex << addr;
+    return os.str();
+}
+
+static bool parse(istream &in, Dump &last) {
+    Dump cur;
+    bool active = false, found = false;
+    string line;
+    while(getline(in, line)) {
+        // the log prefixes every line with the sender and puts color codes around it
+        size_t pos = line.find("@trace ");
+        if(pos == string::npos)
+            continue;
+        line = line.substr(pos + 7);
+        size_t esc = line.find('\x1b');
+        if(esc != string::npos)
+            line.erase(esc);
+
+        istringstream is(line);
+        string cmd;
+        is >> cmd;
+        if(cmd == "begin") {
+            cur = Dump();
+            active = true;
+        }
+        else if(!active)
+            continue;
+        else if(cmd == "point" || cmd == "pd") {
+            unsigned id;
+            string name;
+            is >> id >> name;
+            if(cmd == "point")
+                cur.points[id] = name;
+            else
+                cur.pds[id] = name;
+        }
+        else if(cmd == "ev") {
+            Event ev;
+            is >> ev.pd >> ev.thread >> ev.cpu >> ev.type >> ev.point >> ev.tsc >> ev.arg;
+            if(is)
+                cur.events.push_back(ev);
+        }
+        else if(cmd == "end") {
+            last = cur;
+            found = true;
+            active = false;
+        }
+    }
+    return found;
+}
+
+static void fold(const Dump &dump, map<string, unsigned long long> &folded) {
+    unsigned func = ~0U;
+    for(map<unsigned, string>::const_iterator it = dump.points.begin(); it != dump.points.end(); ++it) {
+        if(it->second == "function")
+            func = it->first;
+    }
+
+    typedef pair<unsigned, unsigned> thread_t;
+    map<thread_t, vector<unsigned long long> > stacks;
+    map<unsigned, const Event*> last_on_cpu;
+    map<thread_t, const Event*> last_of_thread;
+    for(vector<Event>::const_iterator ev = dump.events.begin(); ev != dump.events.end(); ++ev) {
+        thread_t t(ev->pd, ev->thread);
+        vector<unsigned long long> &stack = stacks[t];
+
+        // attribute the time since the last event of this thread, if it ran all the time
+        const Event *prev = last_of_thread[t];
+        const Event *oncpu = last_on_cpu[ev->cpu];
+        if(prev && prev == oncpu && ev->tsc > prev->tsc) {
+            const string &pd = dump.pds.count(ev->pd) ? dump.pds.find(ev->pd)->second : "??";
+            ostringstream os;
+            os << pd << ";thread-" << ev->thread;
+            for(size_t i = 0; i < stack.size(); ++i)
+                os << ";" << resolve(pd, stack[i]);
+            folded[os.str()] += ev->tsc - prev->tsc;
+        }
+        last_of_thread[t] = &*ev;
+        last_on_cpu[ev->cpu] = &*ev;
+
+        if(ev->point != func)
+            continue;
+        if(ev->type == BEGIN)
+            stack.push_back(ev->arg);
+        else if(ev->type == END) {
+            // the begin might have been overwritten in the ring buffer
+            if(!stack.empty())
+                stack.pop_back();
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if(argc < 2) {
+        cerr << "Usage: " << argv[0] << " <logfile>|- [<elf>...]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    for(int i = 2; i < argc; ++i) {
+        if(!load_elf(argv[i]))
+            cerr << "Warning: unable to read symbols from " << argv[i] << endl;
+    }
+
+    Dump dump;
+    bool found;
+    if(strcmp(argv[1], "-") != 0) {
+        ifstream in(argv[1]);
+        if(!in) {
+            cerr << "Unable to open " << argv[1] << " for reading" << endl;
+            return EXIT_FAILURE;
+        }
+        found = parse(in, dump);
+    }
+    else
+        found = parse(cin, dump);
+    if(!found) {
+        cerr << "No complete trace found" << endl;
+        return EXIT_FAILURE;
+    }
+
+    map<string, unsigned long long> folded;
+    fold(dump, folded);
+    for(map<string, unsigned long long>::const_iterator it = folded.begin(); it != folded.end(); ++it)
+        cout << it->first << " " << it->second << "\n";
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2013, Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of NRE (NOVA runtime environment).
+ *
+ * NRE is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * NRE is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+/*
+ * Converts the trace that has been written to the log by the tracer service (see
+ * services/root/TraceService.h) into the Chrome trace format, which can be viewed with
+ * chrome://tracing. If the log contains multiple dumps, the last complete one is used.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+
+using namespace std;
+
+// has to match Trace::Type in include/util/Trace.h
+enum Type {
+    BEGIN,
+    END,
+    INSTANT,
+    ASYNC_BEGIN,
+    ASYNC_END,
+};
+
+struct Event {
+    unsigned pd;
+    unsigned thread;
+    unsigned cpu;
+    unsigned type;
+    unsigned point;
+    unsigned long long tsc;
+    unsigned long long arg;
+};
+
+struct Dump {
+    Dump() : freq(0), points(), pds(), events(), lost(0) {
+    }
+
+    unsigned long freq;
+    map<unsigned, string> points;
+    map<unsigned, string> pds;
+    vector<Event> events;
+    unsigned long long lost;
+};
+
+static string escape(const string &str) {
+    string res;
+    for(size_t i = 0; i < str.length(); ++i) {
+        if(str[i] == '"' || str[i] == '\\')
+            res += '\\';
+        if(static_cast<unsigned char>(str[i]) >= 0x20)
+            res += str[i];
+    }
+    return res;
+}
+
+static bool parse(istream &in, Dump &last) {
+    Dump cur;
+    bool active = false, found = false;
+    string line;
+    while(getline(in, line)) {
+        // the log prefixes every line with the sender and puts color codes around it
+        size_t pos = line.find("@trace ");
+        if(pos == string::npos)
+            continue;
+        line = line.substr(pos + 7);
+        size_t esc = line.find('\x1b');
+        if(esc != string::npos)
+            line.erase(esc);
+
+        istringstream is(line);
+        string cmd;
+        is >> cmd;
+        if(cmd == "begin") {
+            cur = Dump();
+            is >> cur.freq;
+            active = true;
+        }
+        else if(!active)
+            continue;
+        else if(cmd == "point" || cmd == "pd") {
+            unsigned id;
+            string name;
+            is >> id >> name;
+            if(cmd == "point")
+                cur.points[id] = name;
+            else
+                cur.pds[id] = name;
+        }
+        else if(cmd == "ev") {
+            Event ev;
+            is >> ev.pd >> ev.thread >> ev.cpu >> ev.type >> ev.point >> ev.tsc >> ev.arg;
+            if(is)
+                cur.events.push_back(ev);
+        }
+        else if(cmd == "end") {
+            unsigned long long events;
+            is >> events >> cur.lost;
+            last = cur;
+            found = true;
+            active = false;
+        }
+    }
+    return found;
+}
+
+static void write_json(ostream &out, const Dump &dump) {
+    static const char *phases[] = {"B", "E", "i", "b", "e"};
+    unsigned long long base = dump.events.empty() ? 0 : dump.events.front().tsc;
+    double cycles_per_us = dump.freq / 1000.0;
+    bool first = true;
+
+    out << "{\"traceEvents\":[\n";
+    for(map<unsigned, string>::const_iterator it = dump.pds.begin(); it != dump.pds.end(); ++it) {
+        out << (first ? "" : ",\n") << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":"
+            << it->first << ",\"args\":{\"name\":\"" << escape(it->second) << "\"}}";
+        first = false;
+    }
+    for(vector<Event>::const_iterator ev = dump.events.begin(); ev != dump.events.end(); ++ev) {
+        if(ev->type > ASYNC_END)
+            continue;
+        map<unsigned, string>::const_iterator name = dump.points.find(ev->point);
+        out << (first ? "" : ",\n") << "{\"name\":\""
+            << (name != dump.points.end() ? escape(name->second) : "??")
+            << "\",\"cat\":\"nre\",\"ph\":\"" << phases[ev->type] << "\",\"ts\":"
+            << fixed << (ev->tsc - base) / cycles_per_us << ",\"pid\":" << ev->pd
+            << ",\"tid\":" << ev->thread;
+        if(ev->type == INSTANT)
+            out << ",\"s\":\"t\"";
+        if(ev->type == ASYNC_BEGIN || ev->type == ASYNC_END)
+            out << ",\"id\":\"" << hex << "0x" << ev->arg << dec << "\"";
+        out << ",\"args\":{\"cpu\":" << ev->cpu << ",\"arg\":" << ev->arg << "}}";
+        first = false;
+    }
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+int main(int argc, char *argv[]) {
+    if(argc > 2) {
+        cerr << "Usage: " << argv[0] << " [<logfile>]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    Dump dump;
+    bool found;
+    if(argc == 2) {
+        ifstream in(argv[1]);
+        if(!in) {
+            cerr << "Unable to open " << argv[1] << " for reading" << endl;
+            return EXIT_FAILURE;
+        }
+        found = parse(in, dump);
+    }
+    else
+        found = parse(cin, dump);
+
+    if(!found) {
+        cerr << "No complete trace found" << endl;
+        return EXIT_FAILURE;
+    }
+    if(dump.freq == 0) {
+        cerr << "Invalid TSC frequency" << endl;
+        return EXIT_FAILURE;
+    }
+    if(dump.lost > 0)
+        cerr << "Warning: " << dump.lost << " events have been overwritten" << endl;
+
+    write_json(cout, dump);
+    return EXIT_SUCCESS;
+}